@@ -1,8 +1,7 @@
 #include "Exceptions.h"
 #include "ToolBase.h"
 #include "NGSHelper.h"
-#include "api/BamReader.h"
-#include "api/BamWriter.h"
+#include "BamFileStream.h"
 
 using namespace BamTools;
 
@@ -24,6 +23,7 @@ public:
 		addOutfile("out", "Output bam file.", false);
 		//optional
 		addInt("min_match", "Minimum number of CIGAR matches (M).", true, 30);
+		addInt("threads", "Number of threads used for BAM compression/decompression.", true, 1);
 	}
 
 	virtual void main()
@@ -34,10 +34,8 @@ public:
 		int c_reads_mapped = 0;
 		int c_reads_failed = 0;
 
-		BamReader reader;
-		NGSHelper::openBAM(reader, getInfile("in"));
-		BamWriter writer;
-		writer.Open(getOutfile("out").toStdString(), reader.GetConstSamHeader(), reader.GetReferenceData());
+		BamInfileStream reader(getInfile("in"), getInt("threads"));
+		BamOutfileStream writer(getOutfile("out"), reader.GetConstSamHeader(), reader.GetReferenceData(), getInt("threads"));
 
 		//process reads
 		BamAlignment al;
@@ -9,10 +9,10 @@
 #include <QFileInfo>
 #include <QSet>
 #include "NGSHelper.h"
-#include "api/BamReader.h"
-#include "api/BamWriter.h"
+#include "BamFileStream.h"
 #include "api/BamAlgorithms.h"
 #include <QHash>
+#include "BamMateCache.h"
 
 using namespace BamTools;
 
@@ -25,6 +25,10 @@ class ConcreteTool
 public:
 	ConcreteTool(int& argc, char *argv[])
 		: ToolBase(argc, argv)
+		, reads_saved_(0)
+		, reads_clipped_(0)
+		, reads_mismatch_(0)
+		, bases_clipped_(0)
 	{
 	}
 
@@ -39,30 +43,191 @@ public:
 		//optional
 		addFlag("amplicon", "Amplicon mode: one read of a pair will be clipped randomly.");
 		addFlag("v", "Verbose mode.");
+		addInt("max_mem", "Maximum memory (in MB) used to cache reads whose mate was not found yet. If exceeded, cached reads are written to temporary files.", true, 1000);
+		addInt("threads", "Number of threads used for BAM compression/decompression.", true, 1);
 
 		//changelog
+		changeLog(2017, 2, 1, "Added parameters 'max_mem' and 'threads'. Pairs whose first read was written to a temporary file (see 'max_mem') are written at the end of the output, sorted by name.");
 		changeLog(2017,01,16,"Added overlap mismatch filter.");
 	}
 
+	///Soft-clips the overlap of a read pair and writes both reads (@p mate is the read that was seen first).
+	void processPair(const BamAlignment& al, const BamAlignment& mate, BamOutfileStream& writer, QTextStream& out, bool verbose)
+	{
+		//check if reads are on different strands
+		BamAlignment forward_read = mate;
+		BamAlignment reverse_read = al;
+		bool both_strands = false;
+		if(forward_read.IsReverseStrand()!=reverse_read.IsReverseStrand())
+		{
+			both_strands = true;
+			if(!reverse_read.IsReverseStrand())
+			{
+				BamAlignment tmp_read = forward_read;
+				forward_read = reverse_read;
+				reverse_read = tmp_read;
+			}
+		}
+		int s1 = forward_read.Position+1;
+		int e1 = forward_read.GetEndPosition();
+		int s2 = reverse_read.Position+1;
+		int e2 = reverse_read.GetEndPosition();
+
+		//check if reads overlap
+		bool soft_clip = false;
+		if(forward_read.RefID==reverse_read.RefID)	// same chromosome
+		{
+			if(s1>=s2 && s1<=e2)	soft_clip = true;	// start read1 within read2
+			else if(e1>=s2 && e1<=e2)	soft_clip = true;	// end read1 within read2
+			else if(s1<=s2 && e1>=e2)	soft_clip = true;	// start and end read1 outisde of read2
+		}
+
+		//soft-clip overlapping reads
+		if(soft_clip)
+		{
+			int clip_forward_read = 0;
+			int clip_reverse_read = 0;
+			int overlap = 0;
+
+			if(s1<=s2 && e1<=e2)	// forward read left of reverse read
+			{
+				overlap = forward_read.GetEndPosition()-reverse_read.Position;
+				clip_forward_read = static_cast<int>(overlap/2);
+				clip_reverse_read = static_cast<int>(overlap/2);
+				if(forward_read.IsFirstMate())	clip_forward_read +=  overlap%2;
+				else	clip_reverse_read +=  overlap%2;
+			}
+			else if(s1>s2 && e1>e2)	// forward read right of reverse read
+			{
+				overlap = reverse_read.GetEndPosition()-forward_read.Position;
+				clip_forward_read = static_cast<int>(overlap/2) + (forward_read.GetEndPosition()-reverse_read.GetEndPosition());
+				clip_reverse_read = static_cast<int>(overlap/2) + (forward_read.Position-reverse_read.Position);
+				if(forward_read.IsFirstMate())	clip_forward_read +=  overlap%2;
+				else	clip_reverse_read +=  overlap%2;
+			}
+			else if(both_strands==true && s1>=s2 && e1<=e2)	// forward read within reverse read
+			{
+				overlap = forward_read.GetEndPosition()-forward_read.Position;
+				clip_forward_read = static_cast<int>(overlap/2);
+				clip_reverse_read = static_cast<int>(overlap/2) + (forward_read.Position-reverse_read.Position);
+				if(forward_read.IsFirstMate())	clip_forward_read +=  overlap%2;
+				else	clip_reverse_read +=  overlap%2;
+			}
+			else if(both_strands==true && s1<=s2 && e1>=e2)	//reverse read within forward read
+			{
+				overlap = reverse_read.GetEndPosition()-reverse_read.Position;
+				clip_forward_read = static_cast<int>(overlap/2) + (forward_read.GetEndPosition()-reverse_read.GetEndPosition());
+				clip_reverse_read = static_cast<int>(overlap/2);
+				if(forward_read.IsFirstMate())	clip_forward_read +=  overlap%2;
+				else	clip_reverse_read +=  overlap%2;
+			}
+			else if(both_strands==false && s1>=s2 && e1<=e2)	//forward read lies completely within reverse read
+			{
+				overlap = forward_read.GetEndPosition()-forward_read.Position;
+				clip_forward_read = overlap;
+				clip_reverse_read = 0;
+			}
+			else if(both_strands==false && s1<=s2 && e1>=e2)	//reverse read lies completely within foward read
+			{
+				overlap = reverse_read.GetEndPosition()-reverse_read.Position;
+				clip_forward_read = 0;
+				clip_reverse_read = overlap;
+			}
+			else
+			{
+				if(both_strands)
+				{
+					THROW(Exception, "Read orientation of forward read "+QString::fromStdString(forward_read.Name)+" (chr"+QString::number(forward_read.RefID)+":"+QString::number(forward_read.Position)+"-"+QString::number(forward_read.GetEndPosition())+") and reverse read "+QString::fromStdString(reverse_read.Name)+" (chr"+QString::number(reverse_read.RefID)+":"+QString::number(reverse_read.Position)+"-"+QString::number(reverse_read.GetEndPosition())+") was not identified.");
+				}
+				else
+				{
+					THROW(Exception, "Read orientation of read1 "+QString::fromStdString(forward_read.Name)+" (chr"+QString::number(forward_read.RefID)+":"+QString::number(forward_read.Position)+"-"+QString::number(forward_read.GetEndPosition())+") and read2 "+QString::fromStdString(reverse_read.Name)+" (chr"+QString::number(reverse_read.RefID)+":"+QString::number(reverse_read.Position)+"-"+QString::number(reverse_read.GetEndPosition())+") was not identified.");
+				}
+			}
+
+			//amplicon mode
+			if(getFlag("amplicon"))
+			{
+				bool read = qrand()%2;
+				if(read)
+				{
+					clip_forward_read = overlap;
+					clip_reverse_read = 0;
+				}
+				else
+				{
+					clip_forward_read = 0;
+					clip_reverse_read = overlap;
+				}
+			}
+
+			//verbose mode
+			if(verbose)	out << "forward read: name - " << QString::fromStdString(forward_read.Name) << ", region - chr" << forward_read.RefID << ":" << forward_read.Position << "-" << forward_read.GetEndPosition() << ", insert size: "  << forward_read.InsertSize << " bp; mate: " << forward_read.MatePosition << ", CIGAR " << NGSHelper::Cigar2QString(forward_read.CigarData) << ", overlap: " << overlap << " bp" << endl;
+			if(verbose)	out << "reverse read: name - " << QString::fromStdString(reverse_read.Name) << ", region - chr" << forward_read.RefID << ":" << reverse_read.Position << "-" << reverse_read.GetEndPosition() << ", insert size: "  << reverse_read.InsertSize << " bp; mate: " << reverse_read.MatePosition << ", CIGAR " << NGSHelper::Cigar2QString(reverse_read.CigarData) << ", overlap: " << overlap << " bp" << endl;
+			if(verbose)	out << "  clip forward read from position " << (forward_read.GetEndPosition()-clip_forward_read+1) << " to " << forward_read.GetEndPosition() << endl;
+			if(verbose)	out << "  clip reverse read from position " << (reverse_read.Position+1) << " to " << (reverse_read.Position+clip_reverse_read) << endl;
+
+			//check if bases in overlap match
+			int start = std::max(reverse_read.Position+1,forward_read.Position+1);
+			int end = std::min(forward_read.GetEndPosition(),reverse_read.GetEndPosition());	//min if forward read ends right of reverse read
+
+			QString forward_overlap = "";
+			for(int i=start;i<=end;++i)	forward_overlap += NGSHelper::extractBaseByCIGAR(forward_read,i).first;
+
+			QString reverse_overlap = "";
+			for(int i=start;i<=end;++i)	reverse_overlap += NGSHelper::extractBaseByCIGAR(reverse_read,i).first;
+
+			if(forward_overlap!=reverse_overlap)
+			{
+				forward_read.MapQuality = 0;
+				reverse_read.MapQuality = 0;
+				reads_mismatch_ += 2;
+				if(verbose) out << "  overlap mismatch for read pair " << QString::fromStdString(forward_read.Name) << " - " << forward_overlap << " != " << reverse_overlap << "." << endl;
+			}
+			else
+			{
+				if(verbose)	out << "  no overlap mismatch for read pair " << QString::fromStdString(forward_read.Name) << endl;
+
+			}
+
+			//actual soft clipping
+			if(clip_forward_read>0)	NGSHelper::softClipAlignment(forward_read,(forward_read.GetEndPosition()-clip_forward_read+1),forward_read.GetEndPosition());
+			if(clip_reverse_read>0)	NGSHelper::softClipAlignment(reverse_read,(reverse_read.Position+1),(reverse_read.Position+clip_reverse_read));
+
+			//set new insert size and mate position
+			forward_read.InsertSize = reverse_read.GetEndPosition()-forward_read.Position;	//positive value
+			forward_read.MatePosition = reverse_read.Position;
+			reverse_read.InsertSize = forward_read.Position-reverse_read.GetEndPosition();	//negative value
+			reverse_read.MatePosition = forward_read.Position;
+
+			if(verbose)	out << "  clipped forward read: name - " << QString::fromStdString(forward_read.Name) << ", region - chr" << forward_read.RefID << ":" << forward_read.Position << "-" << forward_read.GetEndPosition() << ", insert size: "  << forward_read.InsertSize << " bp; mate: " << forward_read.MatePosition << ", CIGAR " << NGSHelper::Cigar2QString(forward_read.CigarData) << ", overlap: " << overlap << " bp" << endl;
+			if(verbose)	out << "  clipped reverse read: name - " << QString::fromStdString(reverse_read.Name) << ", region - chr" << forward_read.RefID << ":" << reverse_read.Position << "-" << reverse_read.GetEndPosition() << ", insert size: "  << reverse_read.InsertSize << " bp; mate: " << reverse_read.MatePosition << ", CIGAR " << NGSHelper::Cigar2QString(reverse_read.CigarData) << ", overlap: " << overlap << " bp" << endl;
+			if(verbose)	out << endl;
+
+			//return reads
+			bases_clipped_ += overlap;
+			reads_clipped_ += 2;
+		}
+
+		//save reads
+		writer.SaveAlignment(forward_read);
+		writer.SaveAlignment(reverse_read);
+		reads_saved_+=2;
+	}
+
 	virtual void main()
 	{
 		//step 1: init
 		int reads_count = 0;
-		int reads_saved = 0;
-		int reads_clipped = 0;
-		int reads_mismatch = 0;
 		quint64 bases_count = 0;
-		quint64 bases_clipped = 0;
 		QTextStream out(stderr);
 		bool verbose = getFlag("v");
-		BamReader reader;
-		NGSHelper::openBAM(reader, getInfile("in"));
-		BamWriter writer;
-		writer.Open(getOutfile("out").toStdString(), reader.GetConstSamHeader(), reader.GetReferenceData());
+		BamInfileStream reader(getInfile("in"), getInt("threads"));
+		BamOutfileStream writer(getOutfile("out"), reader.GetConstSamHeader(), reader.GetReferenceData(), getInt("threads"));
 
 		//step 2: get alignments and softclip if necessary
 		BamAlignment al;
-		QHash<QString, BamAlignment> al_map;
+		BamMateCache al_cache(reader.GetConstSamHeader(), reader.GetReferenceData(), getInt("max_mem"));
 		while (reader.GetNextAlignment(al))
 		{
 			++reads_count;
@@ -72,218 +237,67 @@ public:
 			if(!al.IsPaired() || !al.IsPrimaryAlignment())
 			{
 				writer.SaveAlignment(al);
-				++reads_saved;
+				++reads_saved_;
 				continue;
 			}
 			if(!al.IsMapped() && !al.IsMateMapped())	// only mapped reads
 			{
 				writer.SaveAlignment(al);
-				++reads_saved;
+				++reads_saved_;
 				continue;
 			}
 			if(al.RefID!=al.MateRefID)	// different chromosomes
 			{
 				writer.SaveAlignment(al);
-				++reads_saved;
+				++reads_saved_;
 				continue;
 			}
 			if(al.CigarData.empty())	// only with CIGAR data
 			{
 				writer.SaveAlignment(al);
-				++reads_saved;
+				++reads_saved_;
 				continue;
 			}
 
-			if(al_map.contains(QString::fromStdString(al.Name)))
+			BamAlignment mate;
+			if(al_cache.takeMate(al, mate))
 			{
-				BamAlignment mate;
-				mate = al_map.take(QString::fromStdString(al.Name));
-
-				//check if reads are on different strands
-				BamAlignment forward_read = mate;
-				BamAlignment reverse_read = al;
-				bool both_strands = false;
-				if(forward_read.IsReverseStrand()!=reverse_read.IsReverseStrand())
-				{
-					both_strands = true;
-					if(!reverse_read.IsReverseStrand())
-					{
-						BamAlignment tmp_read = forward_read;
-						forward_read = reverse_read;
-						reverse_read = tmp_read;
-					}
-				}
-				int s1 = forward_read.Position+1;
-				int e1 = forward_read.GetEndPosition();
-				int s2 = reverse_read.Position+1;
-				int e2 = reverse_read.GetEndPosition();
-
-				//check if reads overlap
-				bool soft_clip = false;
-				if(forward_read.RefID==reverse_read.RefID)	// same chromosome
-				{
-					if(s1>=s2 && s1<=e2)	soft_clip = true;	// start read1 within read2
-					else if(e1>=s2 && e1<=e2)	soft_clip = true;	// end read1 within read2
-					else if(s1<=s2 && e1>=e2)	soft_clip = true;	// start and end read1 outisde of read2
-				}
-
-				//soft-clip overlapping reads
-				if(soft_clip)
-				{
-					int clip_forward_read = 0;
-					int clip_reverse_read = 0;
-					int overlap = 0;
-
-					if(s1<=s2 && e1<=e2)	// forward read left of reverse read
-					{
-						overlap = forward_read.GetEndPosition()-reverse_read.Position;
-						clip_forward_read = static_cast<int>(overlap/2);
-						clip_reverse_read = static_cast<int>(overlap/2);
-						if(forward_read.IsFirstMate())	clip_forward_read +=  overlap%2;
-						else	clip_reverse_read +=  overlap%2;
-					}
-					else if(s1>s2 && e1>e2)	// forward read right of reverse read
-					{
-						overlap = reverse_read.GetEndPosition()-forward_read.Position;
-						clip_forward_read = static_cast<int>(overlap/2) + (forward_read.GetEndPosition()-reverse_read.GetEndPosition());
-						clip_reverse_read = static_cast<int>(overlap/2) + (forward_read.Position-reverse_read.Position);
-						if(forward_read.IsFirstMate())	clip_forward_read +=  overlap%2;
-						else	clip_reverse_read +=  overlap%2;
-					}
-					else if(both_strands==true && s1>=s2 && e1<=e2)	// forward read within reverse read
-					{
-						overlap = forward_read.GetEndPosition()-forward_read.Position;
-						clip_forward_read = static_cast<int>(overlap/2);
-						clip_reverse_read = static_cast<int>(overlap/2) + (forward_read.Position-reverse_read.Position);
-						if(forward_read.IsFirstMate())	clip_forward_read +=  overlap%2;
-						else	clip_reverse_read +=  overlap%2;
-					}
-					else if(both_strands==true && s1<=s2 && e1>=e2)	//reverse read within forward read
-					{
-						overlap = reverse_read.GetEndPosition()-reverse_read.Position;
-						clip_forward_read = static_cast<int>(overlap/2) + (forward_read.GetEndPosition()-reverse_read.GetEndPosition());
-						clip_reverse_read = static_cast<int>(overlap/2);
-						if(forward_read.IsFirstMate())	clip_forward_read +=  overlap%2;
-						else	clip_reverse_read +=  overlap%2;
-					}
-					else if(both_strands==false && s1>=s2 && e1<=e2)	//forward read lies completely within reverse read
-					{
-						overlap = forward_read.GetEndPosition()-forward_read.Position;
-						clip_forward_read = overlap;
-						clip_reverse_read = 0;
-					}
-					else if(both_strands==false && s1<=s2 && e1>=e2)	//reverse read lies completely within foward read
-					{
-						overlap = reverse_read.GetEndPosition()-reverse_read.Position;
-						clip_forward_read = 0;
-						clip_reverse_read = overlap;
-					}
-					else
-					{
-						if(both_strands)
-						{
-							THROW(Exception, "Read orientation of forward read "+QString::fromStdString(forward_read.Name)+" (chr"+QString::number(forward_read.RefID)+":"+QString::number(forward_read.Position)+"-"+QString::number(forward_read.GetEndPosition())+") and reverse read "+QString::fromStdString(reverse_read.Name)+" (chr"+QString::number(reverse_read.RefID)+":"+QString::number(reverse_read.Position)+"-"+QString::number(reverse_read.GetEndPosition())+") was not identified.");
-						}
-						else
-						{
-							THROW(Exception, "Read orientation of read1 "+QString::fromStdString(forward_read.Name)+" (chr"+QString::number(forward_read.RefID)+":"+QString::number(forward_read.Position)+"-"+QString::number(forward_read.GetEndPosition())+") and read2 "+QString::fromStdString(reverse_read.Name)+" (chr"+QString::number(reverse_read.RefID)+":"+QString::number(reverse_read.Position)+"-"+QString::number(reverse_read.GetEndPosition())+") was not identified.");
-						}
-					}
-
-					//amplicon mode
-					if(getFlag("amplicon"))
-					{
-						bool read = qrand()%2;
-						if(read)
-						{
-							clip_forward_read = overlap;
-							clip_reverse_read = 0;
-						}
-						else
-						{
-							clip_forward_read = 0;
-							clip_reverse_read = overlap;
-						}
-					}
-
-					//verbose mode
-					if(verbose)	out << "forward read: name - " << QString::fromStdString(forward_read.Name) << ", region - chr" << forward_read.RefID << ":" << forward_read.Position << "-" << forward_read.GetEndPosition() << ", insert size: "  << forward_read.InsertSize << " bp; mate: " << forward_read.MatePosition << ", CIGAR " << NGSHelper::Cigar2QString(forward_read.CigarData) << ", overlap: " << overlap << " bp" << endl;
-					if(verbose)	out << "reverse read: name - " << QString::fromStdString(reverse_read.Name) << ", region - chr" << forward_read.RefID << ":" << reverse_read.Position << "-" << reverse_read.GetEndPosition() << ", insert size: "  << reverse_read.InsertSize << " bp; mate: " << reverse_read.MatePosition << ", CIGAR " << NGSHelper::Cigar2QString(reverse_read.CigarData) << ", overlap: " << overlap << " bp" << endl;
-					if(verbose)	out << "  clip forward read from position " << (forward_read.GetEndPosition()-clip_forward_read+1) << " to " << forward_read.GetEndPosition() << endl;
-					if(verbose)	out << "  clip reverse read from position " << (reverse_read.Position+1) << " to " << (reverse_read.Position+clip_reverse_read) << endl;
-
-					//check if bases in overlap match
-					int start = std::max(reverse_read.Position+1,forward_read.Position+1);
-					int end = std::min(forward_read.GetEndPosition(),reverse_read.GetEndPosition());	//min if forward read ends right of reverse read
-
-					QString forward_overlap = "";
-					for(int i=start;i<=end;++i)	forward_overlap += NGSHelper::extractBaseByCIGAR(forward_read,i).first;
-
-					QString reverse_overlap = "";
-					for(int i=start;i<=end;++i)	reverse_overlap += NGSHelper::extractBaseByCIGAR(reverse_read,i).first;
-
-					if(forward_overlap!=reverse_overlap)
-					{
-						forward_read.MapQuality = 0;
-						reverse_read.MapQuality = 0;
-						reads_mismatch += 2;
-						if(verbose) out << "  overlap mismatch for read pair " << QString::fromStdString(forward_read.Name) << " - " << forward_overlap << " != " << reverse_overlap << "." << endl;
-					}
-					else
-					{
-						if(verbose)	out << "  no overlap mismatch for read pair " << QString::fromStdString(forward_read.Name) << endl;
-
-					}
-
-					//actual soft clipping
-					if(clip_forward_read>0)	NGSHelper::softClipAlignment(forward_read,(forward_read.GetEndPosition()-clip_forward_read+1),forward_read.GetEndPosition());
-					if(clip_reverse_read>0)	NGSHelper::softClipAlignment(reverse_read,(reverse_read.Position+1),(reverse_read.Position+clip_reverse_read));
-
-					//set new insert size and mate position
-					forward_read.InsertSize = reverse_read.GetEndPosition()-forward_read.Position;	//positive value
-					forward_read.MatePosition = reverse_read.Position;
-					reverse_read.InsertSize = forward_read.Position-reverse_read.GetEndPosition();	//negative value
-					reverse_read.MatePosition = forward_read.Position;
-
-					if(verbose)	out << "  clipped forward read: name - " << QString::fromStdString(forward_read.Name) << ", region - chr" << forward_read.RefID << ":" << forward_read.Position << "-" << forward_read.GetEndPosition() << ", insert size: "  << forward_read.InsertSize << " bp; mate: " << forward_read.MatePosition << ", CIGAR " << NGSHelper::Cigar2QString(forward_read.CigarData) << ", overlap: " << overlap << " bp" << endl;
-					if(verbose)	out << "  clipped reverse read: name - " << QString::fromStdString(reverse_read.Name) << ", region - chr" << forward_read.RefID << ":" << reverse_read.Position << "-" << reverse_read.GetEndPosition() << ", insert size: "  << reverse_read.InsertSize << " bp; mate: " << reverse_read.MatePosition << ", CIGAR " << NGSHelper::Cigar2QString(reverse_read.CigarData) << ", overlap: " << overlap << " bp" << endl;
-					if(verbose)	out << endl;
-
-					//return reads
-					bases_clipped += overlap;
-					reads_clipped += 2;
-				}
-
-				//save reads
-				writer.SaveAlignment(forward_read);
-				writer.SaveAlignment(reverse_read);
-				reads_saved+=2;
-			}
-			else    //keep in map
-			{
-				al_map.insert(QString::fromStdString(al.Name), al);
+				processPair(al, mate, writer, out, verbose);
 			}
 		}
 
-		//step 3: save all remaining reads in QHash
-		QHash<QString, BamAlignment>::Iterator i;
-		for(i=al_map.begin(); i!=al_map.end(); ++i)
+		//step 3: process read pairs whose mates were spilled to disk and save all reads without mate
+		BamAlignment mate;
+		bool paired = false;
+		while (al_cache.nextRemaining(al, mate, paired))
 		{
-			writer.SaveAlignment(i.value());
-			++reads_saved;
+			if (paired)
+			{
+				processPair(al, mate, writer, out, verbose);
+			}
+			else
+			{
+				writer.SaveAlignment(al);
+				++reads_saved_;
+			}
 		}
 
 		//step 4: write out statistics
-		if(reads_saved!=reads_count)	THROW(ToolFailedException, "Lost Reads: "+QString::number(reads_count-reads_saved)+"/"+QString::number(reads_count));
-		out << "Mapping quality was set to zero for " << QString::number(reads_mismatch) << " of " << QString::number(reads_count) << " reads (" << QString::number((double)reads_mismatch/(double)reads_count*100,'f',2) << " %) due to overlap mismatch." << endl;
-		out << "Softclipped " << QString::number(reads_clipped) << " of " << QString::number(reads_count) << " reads (" << QString::number(((double)reads_clipped/(double)reads_count*100),'f',2) << " %)." << endl;
-		out << "Softclipped " << QString::number(bases_clipped) << " of " << QString::number(bases_count) << " basepairs (" << QString::number((double)bases_clipped/(double)bases_count*100,'f',2) << " %)." << endl;
+		if(reads_saved_!=reads_count)	THROW(ToolFailedException, "Lost Reads: "+QString::number(reads_count-reads_saved_)+"/"+QString::number(reads_count));
+		out << "Mapping quality was set to zero for " << QString::number(reads_mismatch_) << " of " << QString::number(reads_count) << " reads (" << QString::number((double)reads_mismatch_/(double)reads_count*100,'f',2) << " %) due to overlap mismatch." << endl;
+		out << "Softclipped " << QString::number(reads_clipped_) << " of " << QString::number(reads_count) << " reads (" << QString::number(((double)reads_clipped_/(double)reads_count*100),'f',2) << " %)." << endl;
+		out << "Softclipped " << QString::number(bases_clipped_) << " of " << QString::number(bases_count) << " basepairs (" << QString::number((double)bases_clipped_/(double)bases_count*100,'f',2) << " %)." << endl;
 
 		//done
 		reader.Close();
 		writer.Close();
 	}
 
+private:
+	int reads_saved_;
+	int reads_clipped_;
+	int reads_mismatch_;
+	quint64 bases_clipped_;
 };
 
 #include "main.moc"
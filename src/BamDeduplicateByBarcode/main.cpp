@@ -1,6 +1,5 @@
 #include "ToolBase.h"
-#include "api/BamReader.h"
-#include "api/BamWriter.h"
+#include "BamFileStream.h"
 #include "api/BamAlgorithms.h"
 #include "NGSHelper.h"
 #include "Helper.h"
@@ -672,7 +671,7 @@ private:
 		}
 	}
 
-	void writePairToBam(BamTools::BamWriter &writer, readPair read_pair)
+	void writePairToBam(BamOutfileStream& writer, readPair read_pair)
 	{
 		writer.SaveAlignment(read_pair.first);
 		writer.SaveAlignment(read_pair.second);
@@ -757,7 +756,7 @@ private:
 		return selected_read_info.most_freq_read;
 	}
 
-	void outputMip(QMap <Position,mip_info>  &position2mip_info, QHash <int,BarcodeCountInfo> &dup_count_histo, Position act_position, int read_count, int minimal_group_size, barcode_at_pos barcode_and_pos, QList <readPair> read_list, BamTools::BamWriter &writer, QTextStream &duplicate_out_stream, QTextStream &nomatch_out_stream,  bool test)
+	void outputMip(QMap <Position,mip_info>  &position2mip_info, QHash <int,BarcodeCountInfo> &dup_count_histo, Position act_position, int read_count, int minimal_group_size, barcode_at_pos barcode_and_pos, QList <readPair> read_list, BamOutfileStream& writer, QTextStream &duplicate_out_stream, QTextStream &nomatch_out_stream,  bool test)
 	{
 		if (position2mip_info.contains(act_position)&&(read_count>=minimal_group_size))
 		{
@@ -772,7 +771,7 @@ private:
 		}
 	}
 
-	void outputHS(QMap <Position,hs_info>  &position2hs_info, QHash <int,BarcodeCountInfo> &dup_count_histo, Position act_position, int read_count, int minimal_group_size, barcode_at_pos barcode_and_pos, QList <readPair> read_list, BamTools::BamWriter &writer, QTextStream &duplicate_out_stream, QTextStream &nomatch_out_stream,  bool test)
+	void outputHS(QMap <Position,hs_info>  &position2hs_info, QHash <int,BarcodeCountInfo> &dup_count_histo, Position act_position, int read_count, int minimal_group_size, barcode_at_pos barcode_and_pos, QList <readPair> read_list, BamOutfileStream& writer, QTextStream &duplicate_out_stream, QTextStream &nomatch_out_stream,  bool test)
 	{
 		if (position2hs_info.contains(act_position)&&(read_count>=minimal_group_size))//select and count reads that can be matched to haloplex hs barcodes
 		{
@@ -787,7 +786,7 @@ private:
 		}
 	}
 
-	void outputUnknown(Position act_position, barcode_at_pos barcode_and_pos, QList <readPair> read_list, BamTools::BamWriter &writer, QTextStream &duplicate_out_stream, bool test)
+	void outputUnknown(Position act_position, barcode_at_pos barcode_and_pos, QList <readPair> read_list, BamOutfileStream& writer, QTextStream &duplicate_out_stream, bool test)
 	{
 		most_frequent_read_selection read_selection = findHighestFreqRead(read_list);
 		writePairToBam(writer, read_selection.most_freq_read);
@@ -821,6 +820,7 @@ public:
 		addOutfile("stats","Output TSV file for statistics).", true, "");
 		addOutfile("nomatch_out","Output Bed file for reads not matching any amplicon).", true, "");
 		addOutfile("duplicate_out","Output Bed file for reads removed as duplicates).", true, "");
+		addInt("threads", "Number of threads used for BAM compression/decompression.", true, 1);
 	}
 
 	virtual void main()
@@ -870,11 +870,9 @@ public:
 		Chromosome new_ref=Chromosome("");
 		bool chrom_change=false;
 
-		BamReader reader;
-		NGSHelper::openBAM(reader, getInfile("bam"));
+		BamInfileStream reader(getInfile("bam"), getInt("threads"));
 
-		BamWriter writer;
-		writer.Open(getOutfile("out").toStdString(), reader.GetConstSamHeader(), reader.GetReferenceData());
+		BamOutfileStream writer(getOutfile("out"), reader.GetConstSamHeader(), reader.GetReferenceData(), getInt("threads"));
 
 		QHash<QString, BamAlignment> alignment_map;//map to store temporary unmatched reads
 		BamAlignment current_alignment; //loop variable to store a read
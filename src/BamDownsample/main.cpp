@@ -1,8 +1,8 @@
 #include "ToolBase.h"
-#include "api/BamReader.h"
-#include "api/BamWriter.h"
+#include "BamFileStream.h"
 #include "api/BamAlgorithms.h"
 #include "NGSHelper.h"
+#include "BamMateCache.h"
 #include "Helper.h"
 #include <QTime>
 #include <QString>
@@ -27,6 +27,22 @@ public:
 		addInt("percentage", "Percentage of reads from the input to the output file.", false, true);
 		addOutfile("out", "Output BAM file.", false, true);
 		addFlag("test", "fixed seed for random and text output");
+		addInt("max_mem", "Maximum memory (in MB) used to cache reads whose mate was not found yet. If exceeded, cached reads are written to temporary files.", true, 1000);
+		addInt("threads", "Number of threads used for BAM compression/decompression.", true, 1);
+
+		//changelog
+		changeLog(2017, 2, 1, "Added parameters 'max_mem' and 'threads'. Pairs whose first read was written to a temporary file (see 'max_mem') are written at the end of the output, sorted by name.");
+	}
+
+	void writePair(BamOutfileStream& writer, const BamAlignment& al, const BamAlignment& mate, bool test, QStringList& downsampled_read_names)
+	{
+		writer.SaveAlignment(al);
+		writer.SaveAlignment(mate);
+		if (test)
+		{
+			downsampled_read_names.append(QString::fromStdString(al.Name));
+			downsampled_read_names.append(QString::fromStdString(mate.Name));
+		}
 	}
 
 	void write_statistics(QString filename, int reads_count, QStringList downsampled_read_names)
@@ -55,23 +71,23 @@ public:
 			qsrand(QTime::currentTime().msec());
 		}
 		QTextStream out(stderr);
-		BamReader reader;
-		NGSHelper::openBAM(reader, getInfile("in"));
-		BamWriter writer;
-		writer.Open(getOutfile("out").toStdString(), reader.GetConstSamHeader(), reader.GetReferenceData());
+		BamInfileStream reader(getInfile("in"), getInt("threads"));
+		BamOutfileStream writer(getOutfile("out"), reader.GetConstSamHeader(), reader.GetReferenceData(), getInt("threads"));
 		int reads_count=0;
+		int percentage = getInt("percentage");
 		QStringList downsampled_read_names;
 
 		//step 2: iterate through reads, write specified percentage of reads (+mate) to output bam
 		BamAlignment al;
-		QHash<QString, BamAlignment> al_map;
+		BamAlignment mate;
+		BamMateCache al_cache(reader.GetConstSamHeader(), reader.GetReferenceData(), getInt("max_mem"));
 		while (reader.GetNextAlignment(al))
 		{
 			//skip secondary alinments
 			if(!al.IsPrimaryAlignment()) continue;
 
 			reads_count++;
-			if((!al.IsPaired())&&(qrand()%100)<getInt("percentage"))//if single end and should be saved
+			if((!al.IsPaired())&&(qrand()%100)<percentage)//if single end and should be saved
 			{
 				writer.SaveAlignment(al);
 				if (test)
@@ -80,31 +96,22 @@ public:
 				}
 				continue;
 			}
-			if((al_map.contains(QString::fromStdString(al.Name))))//if paired end and mate has been seen already
+			if(al.IsPaired() && al_cache.takeMate(al, mate))//if paired end and mate has been seen already (otherwise the read is cached)
 			{
-				if((qrand()%100)<getInt("percentage"))//if the pair should be saved
+				if((qrand()%100)<percentage)//if the pair should be saved
 				{
-					BamAlignment mate;
-					mate = al_map.take(QString::fromStdString(al.Name));
-					writer.SaveAlignment(al);
-					writer.SaveAlignment(mate);
-					if (test)
-					{
-						downsampled_read_names.append(QString::fromStdString(al.Name));
-						downsampled_read_names.append(QString::fromStdString(mate.Name));
-					}
-					continue;
-				}
-				else//if the pair should not be saved
-				{
-					al_map.take(QString::fromStdString(al.Name));
-					continue;
+					writePair(writer, al, mate, test, downsampled_read_names);
 				}
 			}
-			else//if paired end and mate has not been seen yet
+		}
+
+		//step 3: process pairs whose mates were spilled to disk (reads without mate are skipped)
+		bool paired = false;
+		while (al_cache.nextRemaining(al, mate, paired))
+		{
+			if (paired && (qrand()%100)<percentage)
 			{
-				al_map.insert(QString::fromStdString(al.Name), al);
-				continue;
+				writePair(writer, al, mate, test, downsampled_read_names);
 			}
 		}
 
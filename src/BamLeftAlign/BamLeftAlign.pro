@@ -12,9 +12,11 @@ CONFIG   -= app_bundle
 SOURCES += main.cpp \
     LeftAlign.cpp \
 	IndelAllele.cpp \
+	ReferenceWindow.cpp \
 
 include("../app_cli.pri")
 
 HEADERS += \
 	LeftAlign.h \
 	IndelAllele.h \
+	ReferenceWindow.h \
@@ -0,0 +1,38 @@
+#include "ReferenceWindow.h"
+#include <algorithm>
+
+ReferenceWindow::ReferenceWindow(const FastaFileIndex& reference, int window_size)
+	: reference_(reference)
+	, window_size_(window_size)
+	, chr_()
+	, chr_length_(0)
+	, start_(0)
+	, seq_()
+{
+}
+
+std::string ReferenceWindow::seq(const Chromosome& chr, int start, int length)
+{
+	//new chromosome
+	if (chr!=chr_ || seq_.isEmpty())
+	{
+		chr_ = chr;
+		chr_length_ = reference_.lengthOf(chr);
+		seq_.clear();
+	}
+
+	//invalid range => use the index directly (handles warnings/errors)
+	if (start<1 || length<1 || start+length-1>chr_length_)
+	{
+		return reference_.seq(chr, start, length).constData();
+	}
+
+	//move window
+	if (seq_.isEmpty() || start<start_ || start+length>start_+seq_.length())
+	{
+		start_ = start;
+		seq_ = reference_.seq(chr, start, std::min(std::max(window_size_, length), chr_length_-start+1));
+	}
+
+	return std::string(seq_.constData() + (start - start_), length);
+}
@@ -0,0 +1,27 @@
+#ifndef REFERENCEWINDOW_H
+#define REFERENCEWINDOW_H
+
+#include "FastaFileIndex.h"
+#include "Chromosome.h"
+#include <string>
+
+///Sliding window over the reference genome, which serves the reference sequences of coordinate-sorted alignments without one disk access per alignment.
+class ReferenceWindow
+{
+public:
+	///Constructor.
+	ReferenceWindow(const FastaFileIndex& reference, int window_size = 1000000);
+
+	///Returns the reference sequence of the given range (start is 1-based). If the range is not contained in the window, the window is moved to start at @p start.
+	std::string seq(const Chromosome& chr, int start, int length);
+
+protected:
+	const FastaFileIndex& reference_;
+	int window_size_;
+	Chromosome chr_;
+	int chr_length_;
+	int start_;
+	QByteArray seq_;
+};
+
+#endif // REFERENCEWINDOW_H
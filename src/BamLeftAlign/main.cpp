@@ -1,17 +1,164 @@
 #include <QTextStream>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QSemaphore>
+#include <QFile>
 #include "api/BamAlignment.h"
-#include "api/BamReader.h"
-#include "api/BamWriter.h"
+#include "BamFileStream.h"
+#include "BamIndexFile.h"
 #include "LeftAlign.h"
+#include "ReferenceWindow.h"
 #include "Settings.h"
 #include "ToolBase.h"
 #include "NGSHelper.h"
+#include "Helper.h"
 #include "Exceptions.h"
 #include "FastaFileIndex.h"
 #include "ChromosomeInfo.h"
 
 using namespace BamTools;
 
+///Left-alignment counts.
+struct LeftAlignCounts
+{
+	LeftAlignCounts()
+		: unchanged(0)
+		, changed(0)
+		, unstable(0)
+	{
+	}
+
+	long unchanged;
+	long changed;
+	long unstable;
+
+	void add(const LeftAlignCounts& rhs)
+	{
+		unchanged += rhs.unchanged;
+		changed += rhs.changed;
+		unstable += rhs.unstable;
+	}
+};
+
+///Left-aligns an alignment (unmapped alignments are skipped).
+static void leftAlignAlignment(BamAlignment& alignment, const ChromosomeInfo& chr_info, ReferenceWindow& reference, int max_iter, bool verbose, QTextStream& out, LeftAlignCounts& counts, const QString& in_file)
+{
+	// skip unmapped alignments, as they cannot be left-realigned without CIGAR data
+	if (!alignment.IsMapped()) return;
+
+	const Chromosome& chr = chr_info.chromosome(alignment.RefID);
+
+	//This should not happen - kept because it was in original code...
+	int length = alignment.GetEndPosition() - alignment.Position + 1;
+	if (alignment.Position < 0 || length <= 0)
+	{
+		THROW(ArgumentException, "Invalid aligment found in BAM file '" + in_file + "': " + QString::fromStdString(alignment.Name) + " (" + chr.str() + ":" + QString::number(alignment.Position) + ")");
+	}
+
+	//get reference sequence
+	std::string ref_seq = reference.seq(chr, alignment.Position+1, length);
+	if (ref_seq=="")
+	{
+		THROW(ArgumentException, "Empty reference sequence returned for chromosomal position '" + chr.str() + ":" + QString::number(alignment.Position) + "' with length '" + QString::number(length) + "!");
+	}
+
+	int iter = 0;
+	while (iter<max_iter)
+	{
+		if (!leftAlign(alignment, ref_seq)) break;
+		++iter;
+	}
+
+	if (iter==0)
+	{
+		++counts.unchanged;
+	}
+	else if (iter==max_iter)
+	{
+		++counts.unstable;
+		if (verbose) out << "Unstable alignment: " << QString::fromStdString(alignment.Name) << " (pos: " << chr.str() << ":" << alignment.Position << ")" << endl;
+	}
+	else
+	{
+		++counts.changed;
+		if (verbose) out << "Changed alignment: " << QString::fromStdString(alignment.Name)  << " (pos: " << chr.str() << ":" << alignment.Position << ", iterations: " << iter << ")" << endl;
+	}
+}
+
+///Shard of the BAM file that is processed in parallel.
+struct Shard
+{
+	int ref_id; //-1 for unplaced alignments
+	int start; //0-based
+	int end; //0-based, exclusive
+	qint64 offset; //virtual file offset to start from
+	QList<BamAlignment> alignments;
+	LeftAlignCounts counts;
+	QString messages;
+	QString error;
+	QSemaphore done; //released when the shard is processed
+};
+
+///Worker that left-aligns the alignments of one shard and keeps them in memory.
+class ShardWorker
+	: public QRunnable
+{
+public:
+	ShardWorker(Shard& shard, QString in_file, const FastaFileIndex& reference, const ChromosomeInfo& chr_info, int max_iter, bool verbose)
+		: QRunnable()
+		, shard_(shard)
+		, in_file_(in_file)
+		, reference_(reference)
+		, chr_info_(chr_info)
+		, max_iter_(max_iter)
+		, verbose_(verbose)
+	{
+	}
+
+	void run()
+	{
+		try
+		{
+			BamInfileStream reader(in_file_);
+			if (shard_.offset>0) reader.seek(shard_.offset);
+			ReferenceWindow window(reference_);
+			QTextStream out(&shard_.messages);
+
+			BamAlignment alignment;
+			while (reader.GetNextAlignment(alignment))
+			{
+				if (shard_.ref_id==-1)
+				{
+					if (alignment.RefID!=-1) continue;
+				}
+				else
+				{
+					if (alignment.RefID==-1 || alignment.RefID>shard_.ref_id || (alignment.RefID==shard_.ref_id && alignment.Position>=shard_.end)) break;
+					if (alignment.RefID<shard_.ref_id || alignment.Position<shard_.start) continue;
+				}
+
+				leftAlignAlignment(alignment, chr_info_, window, max_iter_, verbose_, out, shard_.counts, in_file_);
+				shard_.alignments.append(alignment);
+			}
+		}
+		catch(Exception& e)
+		{
+			shard_.error = e.message();
+		}
+
+		shard_.done.release();
+	}
+
+protected:
+	Shard& shard_;
+	QString in_file_;
+	const FastaFileIndex& reference_;
+	const ChromosomeInfo& chr_info_;
+	int max_iter_;
+	bool verbose_;
+};
+
 class ConcreteTool
 		: public ToolBase
 {
@@ -32,6 +179,7 @@ public:
 		addInfile("ref", "Reference genome FASTA file. If unset 'reference_genome' from the 'settings.ini' file is used.", true, false);
 		addInt("max_iter", "Maximum number of iterations per read.", true, 50);
 		addFlag("v", "Verbose mode: Prints changed/unstable alignment names to the command line.");
+		addInt("threads", "Number of threads. If bigger than 1 and the BAM index is present, the BAM file is split into shards based on the BAM index, which are processed in parallel. Otherwise, the threads are used for BAM compression/decompression only.", true, 1);
 	}
 
 	virtual void main()
@@ -39,6 +187,8 @@ public:
 		//init
 		int max_iter = getInt("max_iter");
 		bool verbose = getFlag("v");
+		int threads = getInt("threads");
+		QString in_file = getInfile("in");
 		QTextStream out(stdout);
 
 		//open refererence genome file
@@ -46,68 +196,78 @@ public:
 		if (ref_file=="") ref_file = Settings::string("reference_genome");
 		FastaFileIndex reference(ref_file);
 
-		//open BAM reader
-		BamReader reader;
-		NGSHelper::openBAM(reader, getInfile("in"));
-		ChromosomeInfo chr_info(reader);
+		//open BAM reader (shards are read by the workers, so the reader is used for the header only in that case)
+		bool use_shards = threads>1 && QFile::exists(in_file + ".bai");
+		BamInfileStream reader(in_file, use_shards ? 1 : threads);
+		ChromosomeInfo chr_info(reader.GetReferenceData(), reader.filename());
 
 		//open BAM writer
-		BamWriter writer;
-		if (!writer.Open(getOutfile("out").toStdString(), reader.GetHeaderText(), reader.GetReferenceData()))
-		{
-			THROW(CommandLineParsingException, "Could not open output file '" + getOutfile("out") + "' for writing!");
-		}
+		BamOutfileStream writer(getOutfile("out"), reader.GetHeaderText(), reader.GetReferenceData(), threads);
 
 		//align
-		long unchanged = 0;
-		long changed = 0;
-		long unstable = 0;
-		BamAlignment alignment;
-		while (reader.GetNextAlignment(alignment))
+		LeftAlignCounts counts;
+		if (use_shards)
 		{
-			// skip unmapped alignments, as they cannot be left-realigned without CIGAR data
-			if (alignment.IsMapped())
+			//create shards
+			QList<QSharedPointer<Shard> > shards;
+			BamIndexFile index(in_file + ".bai");
+			const RefVector& refs = reader.GetReferenceData();
+			for (int r=0; r<(int)refs.size(); ++r)
 			{
-				const Chromosome& chr = chr_info.chromosome(alignment.RefID);
-
-				//This should not happen - kept because it was in original code...
-				int length = alignment.GetEndPosition() - alignment.Position + 1;
-				if (alignment.Position < 0 || length <= 0)
+				for (int start=0; start<refs[r].RefLength; start+=SHARD_SIZE)
 				{
-                    THROW(ArgumentException, "Invalid aligment found in BAM file '" + getInfile("in") + "': " + QString::fromStdString(alignment.Name) + " (" + chr.str() + ":" + QString::number(alignment.Position) + ")");
+					qint64 offset = index.offset(r, start);
+					if (offset==-1) break;
+					shards << createShard(r, start, std::min(start+SHARD_SIZE, refs[r].RefLength), offset);
 				}
+			}
+			qint64 unplaced_offset = index.unplacedOffset();
+			if (unplaced_offset!=-1)
+			{
+				shards << createShard(-1, 0, 0, unplaced_offset);
+			}
 
-				//get reference sequence
-				std::string ref_seq = reference.seq(chr, alignment.Position+1, length).constData();
-				if (ref_seq=="")
-				{
-                    THROW(ArgumentException, "Empty reference sequence returned for chromosomal position '" + chr.str() + ":" + QString::number(alignment.Position) + "' with length '" + QString::number(length) + "!");
-				}
+			//process shards in parallel (the reference genome is memory-mapped and shared between the threads)
+			QThreadPool pool;
+			pool.setMaxThreadCount(reference.isMapped() ? threads : 1);
 
-				int iter = 0;
-				while (iter<max_iter)
+			//write shards in coordinate order (only a few shards per thread are started in advance to limit the memory usage)
+			int started = 0;
+			for (int i=0; i<shards.count(); ++i)
+			{
+				while (started<shards.count() && started<i+2*threads)
 				{
-					if (!leftAlign(alignment, ref_seq)) break;
-					++iter;
+					pool.start(new ShardWorker(*shards[started], in_file, reference, chr_info, max_iter, verbose));
+					++started;
 				}
 
-				if (iter==0)
-				{
-					++unchanged;
-				}
-				else if (iter==max_iter)
+				Shard& shard = *shards[i];
+				shard.done.acquire();
+				if (!shard.error.isEmpty())
 				{
-					++unstable;
-                    if (verbose) out << "Unstable alignment: " << QString::fromStdString(alignment.Name) << " (pos: " << chr.str() << ":" << alignment.Position << ")" << endl;
+					pool.clear();
+					pool.waitForDone();
+					THROW(Exception, shard.error);
 				}
-				else
+
+				foreach(const BamAlignment& alignment, shard.alignments)
 				{
-					++changed;
-                    if (verbose) out << "Changed alignment: " << QString::fromStdString(alignment.Name)  << " (pos: " << chr.str() << ":" << alignment.Position << ", iterations: " << iter << ")" << endl;
+					writer.SaveAlignment(alignment);
 				}
+				shard.alignments.clear();
+				counts.add(shard.counts);
+				out << shard.messages;
+			}
+		}
+		else
+		{
+			ReferenceWindow window(reference);
+			BamAlignment alignment;
+			while (reader.GetNextAlignment(alignment))
+			{
+				leftAlignAlignment(alignment, chr_info, window, max_iter, verbose, out, counts, in_file);
+				writer.SaveAlignment(alignment);
 			}
-
-			writer.SaveAlignment(alignment);
 		}
 
 		//close reader/writer
@@ -115,10 +275,24 @@ public:
 		writer.Close();
 
 		//summary output
-		long all = unchanged + changed + unstable;
+		long all = counts.unchanged + counts.changed + counts.unstable;
 		out << "Mapped alignments  : " << all << endl;
-		out << "Changed alignments : " << changed << " (" << QString::number(100.0*changed/all, 'f', 2) << "%)" << endl;
-		out << "Unstable alignments: " << unstable << " (" << QString::number(100.0*unstable/all, 'f', 2) << "%)" << endl;
+		out << "Changed alignments : " << counts.changed << " (" << QString::number(100.0*counts.changed/all, 'f', 2) << "%)" << endl;
+		out << "Unstable alignments: " << counts.unstable << " (" << QString::number(100.0*counts.unstable/all, 'f', 2) << "%)" << endl;
+	}
+
+private:
+	///Shard size in bases.
+	static const int SHARD_SIZE = 1000000;
+
+	QSharedPointer<Shard> createShard(int ref_id, int start, int end, qint64 offset)
+	{
+		QSharedPointer<Shard> shard(new Shard());
+		shard->ref_id = ref_id;
+		shard->start = start;
+		shard->end = end;
+		shard->offset = offset;
+		return shard;
 	}
 };
 
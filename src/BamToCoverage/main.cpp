@@ -0,0 +1,38 @@
+#include "ToolBase.h"
+#include "CoverageFile.h"
+
+class ConcreteTool
+		: public ToolBase
+{
+	Q_OBJECT
+
+public:
+	ConcreteTool(int& argc, char *argv[])
+		: ToolBase(argc, argv)
+	{
+	}
+
+	virtual void setup()
+	{
+		setDescription("Creates a coverage file with the per-base depth of a BAM file.");
+		setExtendedDescription(QStringList() << "The coverage file can be used instead of the BAM file in BedCoverage and BedLowCoverage, which is much faster for large BAM files." << "Duplicates, secondary alignments and unmapped reads are not counted.");
+		addInfile("in", "Input BAM file (sorted by coordinate).", false, true);
+		addOutfile("out", "Output coverage file (should have the extension '.cov').", false, true);
+		//optional
+		addInt("min_mapq", "Minimum mapping quality to consider a read. Tools using the coverage file have to be called with the same value.", true, 1);
+		addInt("threads", "Number of threads used for BAM decompression.", true, 1);
+	}
+
+	virtual void main()
+	{
+		CoverageFile::create(getInfile("in"), getOutfile("out"), getInt("min_mapq"), getInt("threads"));
+	}
+};
+
+#include "main.moc"
+
+int main(int argc, char *argv[])
+{
+	ConcreteTool tool(argc, argv);
+	return tool.execute();
+}
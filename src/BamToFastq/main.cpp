@@ -1,9 +1,9 @@
 #include "ToolBase.h"
-#include "api/BamReader.h"
-#include "api/BamWriter.h"
+#include "BamFileStream.h"
 #include "api/BamAlgorithms.h"
 #include "FastqFileStream.h"
 #include "NGSHelper.h"
+#include "BamMateCache.h"
 
 using namespace BamTools;
 
@@ -24,6 +24,26 @@ public:
 		addInfile("in", "Input BAM file.", false, true);
 		addOutfile("out1", "Read 1 output FASTQ.GZ file.", false);
 		addOutfile("out2", "Read 2 output FASTQ.GZ file.", false);
+		//optional
+		addInt("max_mem", "Maximum memory (in MB) used to cache reads whose mate was not found yet. If exceeded, cached reads are written to temporary files.", true, 1000);
+		addInt("threads", "Number of threads used for BAM compression/decompression.", true, 1);
+
+		//changelog
+		changeLog(2017, 2, 1, "Added parameters 'max_mem' and 'threads'. Pairs whose first read was written to a temporary file (see 'max_mem') are written at the end of the output, sorted by name.");
+	}
+
+	void writePair(FastqOutfileStream& out1, FastqOutfileStream& out2, const BamAlignment& al, const BamAlignment& mate)
+	{
+		if (al.IsFirstMate())
+		{
+			write(out1, al, al.IsReverseStrand());
+			write(out2, mate, mate.IsReverseStrand());
+		}
+		else
+		{
+			write(out1, mate, mate.IsReverseStrand());
+			write(out2, al, al.IsReverseStrand());
+		}
 	}
 
 	void write(FastqOutfileStream& out, const BamAlignment& al, bool rev_comp)
@@ -48,19 +68,20 @@ public:
 	{
 		//init
 		QTextStream out(stdout);
-		BamReader reader;
-		NGSHelper::openBAM(reader, getInfile("in"));
+		BamInfileStream reader(getInfile("in"), getInt("threads"));
 
 		FastqOutfileStream out1(getOutfile("out1"), false);
 		FastqOutfileStream out2(getOutfile("out2"), false);
 
 		long long c_unpaired = 0;
 		long long c_paired = 0;
+		long long c_unmatched = 0;
 		int max_cached = 0;
 
 		//iterate through reads
 		BamAlignment al;
-		QHash<QByteArray, BamAlignment> al_cache;
+		BamAlignment mate;
+		BamMateCache al_cache(reader.GetConstSamHeader(), reader.GetReferenceData(), getInt("max_mem"));
 		while (reader.GetNextAlignment(al))
 		{
 			//skip secondary alinments
@@ -73,33 +94,29 @@ public:
 				continue;
 			}
 
-			QByteArray name(al.Name.data()); //TODO use QByteArray::fromStdString (when upgraded to Qt5.4)
+			//store cached read when we encounter the mate (otherwise the read is cached for later retrieval)
+			if (al_cache.takeMate(al, mate))
+			{
+				writePair(out1, out2, al, mate);
+				++c_paired;
+			}
 
-			//store cached read when we encounter the mate
-			if (al_cache.contains(name))
+			max_cached = std::max(max_cached, al_cache.count());
+		}
+
+		//store pairs whose mates were spilled to disk
+		bool paired = false;
+		while (al_cache.nextRemaining(al, mate, paired))
+		{
+			if (paired)
 			{
-				BamAlignment mate = al_cache.take(name);
-				//out << name << " [AL] First: " << al.IsFirstMate() << " Reverse: " << al.IsReverseStrand() << " Seq: " << al.QueryBases.data() << endl;
-				//out << name << " [MA] First: " << mate.IsFirstMate() << " Reverse: " << mate.IsReverseStrand() << " Seq: " << mate.QueryBases.data() << endl;
-				if (al.IsFirstMate())
-				{
-					write(out1, al, al.IsReverseStrand());
-					write(out2, mate, mate.IsReverseStrand());
-				}
-				else
-				{
-					write(out1, mate, mate.IsReverseStrand());
-					write(out2, al, al.IsReverseStrand());
-				}
+				writePair(out1, out2, al, mate);
 				++c_paired;
 			}
-			//cache read for later retrieval
 			else
 			{
-				al_cache.insert(name, al);
+				++c_unmatched;
 			}
-
-			max_cached = std::max(max_cached, al_cache.size());
 		}
 		reader.Close();
 		out1.close();
@@ -108,9 +125,10 @@ public:
 		//write debug output
 		out << "Pair reads (written)            : " << c_paired << endl;
 		out << "Unpaired reads (skipped)        : " << c_unpaired << endl;
-		out << "Unmatched paired reads (skipped): " << al_cache.size() << endl;
+		out << "Unmatched paired reads (skipped): " << c_unmatched << endl;
 		out << endl;
 		out << "Maximum cached reads            : " << max_cached << endl;
+		out << "Reads spilled to disk           : " << al_cache.spilledCount() << endl;
 	}
 };
 #include "main.moc"
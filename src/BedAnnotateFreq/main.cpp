@@ -8,8 +8,53 @@
 #include <QTextStream>
 #include "Helper.h"
 #include "Exceptions.h"
+#include "BedChunkRunner.h"
+#include <QSharedPointer>
 using namespace BamTools;
 
+///Determines the base counts of a chunk of regions for all BAM files (appended as five annotations per BAM: A, C, G, T, total). The BAM files are opened once per thread.
+class FrequencyProcessor
+	: public BedChunkProcessor
+{
+public:
+	FrequencyProcessor(QStringList bams)
+		: bams_(bams)
+	{
+	}
+
+	BedChunkProcessor* clone() const
+	{
+		return new FrequencyProcessor(bams_);
+	}
+
+	void process(BedFile& chunk)
+	{
+		//open BAM files
+		if (readers_.isEmpty())
+		{
+			foreach(QString bam, bams_)
+			{
+				QSharedPointer<BamReader> reader(new BamReader());
+				NGSHelper::openBAM(*reader, bam);
+				readers_ << reader;
+			}
+		}
+
+		for(int i=0; i<chunk.count(); ++i)
+		{
+			foreach(const QSharedPointer<BamReader>& reader, readers_)
+			{
+				Pileup pileup = NGSHelper::getPileup(*reader, chunk[i].chr(), chunk[i].end());
+				chunk[i].annotations() << QString::number(pileup.a()) << QString::number(pileup.c()) << QString::number(pileup.g()) << QString::number(pileup.t()) << QString::number(pileup.depth(false));
+			}
+		}
+	}
+
+protected:
+	QStringList bams_;
+	QList<QSharedPointer<BamReader> > readers_;
+};
+
 class ConcreteTool
 		: public ToolBase
 {
@@ -28,7 +73,9 @@ public:
 		//optional
 		addInfile("in", "Input BED file. If unset, reads from STDIN.", true);
 		addOutfile("out", "Output TSV file. If unset, writes to STDOUT.", true);
+		addInt("threads", "Number of threads. If bigger than 1, chunks of regions are processed in parallel.", true, 1);
 
+		changeLog(2017, 2, 1, "Added parameter 'threads' for parallel processing.");
 	}
 
 	virtual void main()
@@ -42,7 +89,7 @@ public:
 		QTextStream outstream(outfile.data());
 		outstream << "#chr\tstart\tend\tsample\tA\tC\tG\tT\ttotal\n";
 
-		//extract base counts form BAMs
+		//check regions
 		BedFile file;
 		file.load(getInfile("in"));
 		for(int i=0; i<file.count(); ++i)
@@ -51,14 +98,19 @@ public:
 			{
 				THROW(ToolFailedException, "BED file contains region with length > 1, which is not supported: " + file[i].toString(true));
 			}
+		}
 
-			foreach(QString bam, bams)
-			{
-				BamReader reader;
-				NGSHelper::openBAM(reader, bam);
-				Pileup pileup = NGSHelper::getPileup(reader, file[i].chr(), file[i].end());
+		//extract base counts form BAMs
+		BedChunkRunner::run(file, FrequencyProcessor(bams), getInt("threads"));
 
-				outstream << file[i].toString(false)+"\t"+QFileInfo(bam).baseName()+"\t"+QString::number(pileup.a())+"\t"+QString::number(pileup.c())+"\t"+QString::number(pileup.g())+"\t"+QString::number(pileup.t())+"\t"+QString::number(pileup.depth(false)) + "\n";
+		//write output
+		for(int i=0; i<file.count(); ++i)
+		{
+			const QStringList& annos = file[i].annotations();
+			int offset = annos.count() - 5 * bams.count();
+			for (int j=0; j<bams.count(); ++j)
+			{
+				outstream << file[i].toString(false)+"\t"+QFileInfo(bams[j]).baseName()+"\t"+annos.mid(offset + 5*j, 5).join("\t") + "\n";
 			}
 		}
 	}
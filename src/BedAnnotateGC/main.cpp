@@ -1,4 +1,4 @@
-#include "BedFile.h"
+#include "BedFileStream.h"
 #include "ToolBase.h"
 #include "FastaFileIndex.h"
 #include "Helper.h"
@@ -32,16 +32,18 @@ public:
 		if (ref_file=="") ref_file = Settings::string("reference_genome");
 		FastaFileIndex reference(ref_file);
 
-		//load input
-		BedFile file;
-		file.load(getInfile("in"));
-		file.clearAnnotations();
-
-		//annotate
-		for (int i=0; i<file.count(); ++i)
+		//annotate line by line (constant memory) - existing annotations are replaced
+		BedInfileStream in(getInfile("in"));
+		BedOutfileStream out(getOutfile("out"));
+		while(in.next())
 		{
-			BedLine& r = file[i];
-			Sequence seq = reference.seq(r.chr(), r.start(), r.length(), true);
+			if (in.isHeader())
+			{
+				out.writeHeader(in.line());
+				continue;
+			}
+
+			Sequence seq = reference.seq(in.chr(), in.start(), in.end()-in.start()+1, true);
 			int gc = 0;
 			int at = 0;
 			for(int j=0; j<seq.length(); ++j)
@@ -51,16 +53,14 @@ public:
 			}
 			if (gc+at==0)
 			{
-				r.annotations().append("n/a");
+				out.write(in.chr(), in.start(), in.end(), "n/a");
 			}
 			else
 			{
-				r.annotations().append(QString::number((double)gc/(gc+at), 'f', 4));
+				out.write(in.chr(), in.start(), in.end(), QByteArray::number((double)gc/(gc+at), 'f', 4));
 			}
 		}
-
-		//store output
-		file.store(getOutfile("out"));
+		out.flush();
 	}
 };
 
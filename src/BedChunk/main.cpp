@@ -1,4 +1,4 @@
-#include "BedFile.h"
+#include "BedFileStream.h"
 #include "ToolBase.h"
 #include "Helper.h"
 #include "Exceptions.h"
@@ -25,10 +25,27 @@ public:
 
 	virtual void main()
 	{
-		BedFile file;
-		file.load(getInfile("in"));
-		file.chunk(getInt("n"));
-		file.store(getOutfile("out"));
+		int n = getInt("n");
+
+		//process line by line (constant memory)
+		BedInfileStream in(getInfile("in"));
+		BedOutfileStream out(getOutfile("out"));
+		while(in.next())
+		{
+			if (in.isHeader())
+			{
+				out.writeHeader(in.line());
+				continue;
+			}
+
+			int start = in.start();
+			foreach(int size, BedFile::chunkSizes(in.end()-in.start()+1, n))
+			{
+				out.write(in.chr(), start, start+size-1, in.annotationData());
+				start += size;
+			}
+		}
+		out.flush();
 	}
 };
 
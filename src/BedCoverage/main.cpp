@@ -1,7 +1,65 @@
 #include "BedFile.h"
 #include "ToolBase.h"
 #include "Statistics.h"
+#include "BedChunkRunner.h"
+#include "CoverageFile.h"
+#include "NGSHelper.h"
 #include <QFileInfo>
+#include <QSharedPointer>
+
+///Calculates the average coverage of a chunk of regions for all BAM files. The BAM files are opened once per thread.
+class CoverageProcessor
+	: public BedChunkProcessor
+{
+public:
+	CoverageProcessor(QStringList bams, int min_mapq, bool panel_mode)
+		: bams_(bams)
+		, min_mapq_(min_mapq)
+		, panel_mode_(panel_mode)
+	{
+	}
+
+	BedChunkProcessor* clone() const
+	{
+		return new CoverageProcessor(bams_, min_mapq_, panel_mode_);
+	}
+
+	void process(BedFile& chunk)
+	{
+		//open BAM files (random access)
+		if (readers_.isEmpty())
+		{
+			foreach(QString bam, bams_)
+			{
+				QSharedPointer<BamReader> reader;
+				if (!CoverageFile::isCoverageFile(bam))
+				{
+					reader = QSharedPointer<BamReader>(new BamReader());
+					NGSHelper::openBAM(*reader, bam);
+				}
+				readers_ << reader;
+			}
+		}
+
+		for (int i=0; i<bams_.count(); ++i)
+		{
+			if (readers_[i].isNull())
+			{
+				Statistics::avgCoverage(chunk, bams_[i], min_mapq_, panel_mode_);
+			}
+			else
+			{
+				Statistics::avgCoverage(chunk, *readers_[i], min_mapq_, panel_mode_);
+			}
+		}
+	}
+
+protected:
+	QStringList bams_;
+	int min_mapq_;
+	bool panel_mode_;
+	QList<QSharedPointer<BamReader> > readers_;
+};
 
 class ConcreteTool
 		: public ToolBase
@@ -17,12 +75,15 @@ public:
 	virtual void setup()
 	{
 		setDescription("Extracts the average coverage for input regions from one or several BAM file(s).");
-		addInfileList("bam", "Input BAM file(s).", false);
+		addInfileList("bam", "Input BAM file(s). Coverage files created with BamToCoverage can be used instead of BAM files.", false);
 		addInt("min_mapq", "Minimum mapping quality.", true, 1);
 		//optional
 		addInfile("in", "Input BED file (note that overlapping regions will be merged before processing). If unset, reads from STDIN.", true);
 		addEnum("mode", "Mode to optimize run time. Use 'panel' mode if only a small part of the data in the BAM file is accessed, e.g. a sub-panel of an exome.", true, QStringList() << "default" << "panel", "default");
 		addOutfile("out", "Output BED file. If unset, writes to STDOUT.", true);
+		addInt("threads", "Number of threads. If bigger than 1, chunks of regions are processed in parallel for all BAM files.", true, 1);
+
+		changeLog(2017, 2, 1, "Parameter 'threads' is used for parallel processing of chunks of regions.");
 	}
 
 	virtual void main()
@@ -37,9 +98,20 @@ public:
 		QStringList bams = getInfileList("bam");
 		foreach(QString bam, bams)
 		{
-			Statistics::avgCoverage(file, bam, getInt("min_mapq"), getEnum("mode")=="panel");
 			header += "\t" + QFileInfo(bam).baseName();
 		}
+		int threads = getInt("threads");
+		if (threads>1)
+		{
+			BedChunkRunner::run(file, CoverageProcessor(bams, getInt("min_mapq"), getEnum("mode")=="panel"), threads);
+		}
+		else
+		{
+			foreach(QString bam, bams)
+			{
+				Statistics::avgCoverage(file, bam, getInt("min_mapq"), getEnum("mode")=="panel");
+			}
+		}
 
 		//store
 		file.clearHeaders();
@@ -1,7 +1,8 @@
-#include "BedFile.h"
+#include "BedFileStream.h"
 #include "ToolBase.h"
 #include "Helper.h"
 #include "Exceptions.h"
+#include <QHash>
 
 class ConcreteTool
 		: public ToolBase
@@ -26,17 +27,19 @@ public:
 
 	virtual void main()
 	{
-		//load and extend file
-		BedFile file;
-		file.load(getInfile("in"));
-		file.extend(getInt("n"));
+		int n = getInt("n");
+		if (n<1)
+		{
+			THROW(ArgumentException, "Cannot extend BED file by '" + QString::number(n) + "' bases!");
+		}
 
-		//optional: fix position bounds using the FAI file
-		if (getInfile("fai")!="")
+		//optional: load position bounds from the FAI file
+		QString fai_file = getInfile("fai");
+		QHash<int, int> max;
+		if (fai_file!="")
 		{
 			//load maxima for each chromosome (store using chromosome number)
-			QMap<int, int> max;
-			QStringList fai = Helper::loadTextFile(getInfile("fai"), true, '~', true);
+			QStringList fai = Helper::loadTextFile(fai_file, true, '~', true);
 			foreach(QString line, fai)
 			{
 				QStringList parts = line.split("\t");
@@ -46,21 +49,32 @@ public:
 				if (!ok) continue;
 				max[Chromosome(parts[0]).num()] = value;
 			}
+		}
+
+		//extend line by line (constant memory)
+		BedInfileStream in(getInfile("in"));
+		BedOutfileStream out(getOutfile("out"));
+		while(in.next())
+		{
+			if (in.isHeader())
+			{
+				out.writeHeader(in.line());
+				continue;
+			}
 
-			//apply maxima
-			for (int i=0; i<file.count(); ++i)
+			int start = std::max(1, in.start() - n);
+			int end = in.end() + n;
+			if (fai_file!="")
 			{
-				BedLine& line = file[i];
-				if (!max.contains(line.chr().num()))
+				if (!max.contains(in.chr().num()))
 				{
-					THROW(ArgumentException, "Chromsome '" + line.chr().str() + "' not contained in FASTA index file '" + getInfile("fai") + "'!");
+					THROW(ArgumentException, "Chromsome '" + in.chr().str() + "' not contained in FASTA index file '" + fai_file + "'!");
 				}
-				line.setEnd(std::min(line.end(), max[line.chr().num()]));
+				end = std::min(end, max[in.chr().num()]);
 			}
+			out.write(in.chr(), start, end, in.annotationData());
 		}
-
-		//store file
-		file.store(getOutfile("out"));
+		out.flush();
 	}
 };
 
@@ -18,7 +18,7 @@ public:
 	virtual void setup()
 	{
 		setDescription("Detects low-coverage regions from a BAM file.");
-		addInfile("bam", "Input BAM file.", false);
+		addInfile("bam", "Input BAM file. A coverage file created with BamToCoverage can be used instead of a BAM file.", false);
 		addInt("cutoff", "Minimum depth to consider a base 'high coverage'.", false);
 		//optional
 		addInfile("in", "Input BED file containing the regions of interest. If unset, reads from STDIN.", true);
@@ -24,7 +24,7 @@ public:
 
 	virtual void main()
 	{
-		BedFile file;
+		BedFileCompact file;
 		file.load(getInfile("in"));
 		file.merge(!getFlag("keep_b2b"), getFlag("merge_names"));
 		file.store(getOutfile("out"));
@@ -9,6 +9,97 @@
 #include "api/BamAlgorithms.h"
 #include "NGSHelper.h"
 #include "ChromosomeInfo.h"
+#include "ChromosomalIndex.h"
+#include "BedChunkRunner.h"
+#include <QSharedPointer>
+#include <algorithm>
+
+///Counts the reads of a chunk of regions. The BAM file is opened once per thread.
+class ReadCountProcessor
+	: public BedChunkProcessor
+{
+public:
+	ReadCountProcessor(QString bam, int min_mapq)
+		: bam_(bam)
+		, min_mapq_(min_mapq)
+	{
+	}
+
+	BedChunkProcessor* clone() const
+	{
+		return new ReadCountProcessor(bam_, min_mapq_);
+	}
+
+	void process(BedFile& chunk)
+	{
+		//open BAM file (random access)
+		if (reader_.isNull())
+		{
+			reader_ = QSharedPointer<BamReader>(new BamReader());
+			NGSHelper::openBAM(*reader_, bam_);
+			chr_info_ = QSharedPointer<ChromosomeInfo>(new ChromosomeInfo(*reader_));
+		}
+
+		//init coverage statistics data structure
+		QVector<long> read_count;
+		read_count.fill(0, chunk.count());
+
+		//iterate through the alignments of the regions on each chromosome
+		ChromosomalIndex<BedFile> bed_idx(chunk);
+		int first = 0;
+		while (first<chunk.count())
+		{
+			const Chromosome& chr = chunk[first].chr();
+			int last = first;
+			while (last+1<chunk.count() && chunk[last+1].chr()==chr)
+			{
+				++last;
+			}
+
+			if (chr_info_->contains(chr))
+			{
+				//jump to regions (with margin because of a bamtools bug, see RegionSweep in Statistics.cpp)
+				int ref_id = chr_info_->refID(chr);
+				bool jump_ok = reader_->SetRegion(ref_id, std::max(0, chunk[first].start()-100), ref_id, chunk[last].end()+100);
+				if (!jump_ok) THROW(FileAccessException, QString::fromStdString(reader_->GetErrorString()));
+
+				BamAlignment al;
+				while (reader_->GetNextAlignmentCore(al))
+				{
+					countAlignment(al, chr, bed_idx, min_mapq_, read_count);
+				}
+			}
+
+			first = last + 1;
+		}
+
+		//append readcounts to bed file structure
+		for (int i=0; i<chunk.count(); ++i)
+		{
+			chunk[i].annotations().append(QString::number((double)(read_count[i])));
+		}
+	}
+
+	///Increases the read count of all regions overlapping the alignment.
+	static void countAlignment(const BamAlignment& al, const Chromosome& chr, const ChromosomalIndex<BedFile>& bed_idx, int min_mapq, QVector<long>& read_count)
+	{
+		if (al.IsDuplicate()) return;
+		if (!al.IsPrimaryAlignment()) return;
+		if (!al.IsMapped() || al.MapQuality<min_mapq) return;
+
+		QVector<int> indices = bed_idx.matchingIndices(chr, al.Position+1, al.GetEndPosition());
+		foreach(int index, indices)
+		{
+			read_count[index] += 1;
+		}
+	}
+
+protected:
+	QString bam_;
+	int min_mapq_;
+	QSharedPointer<BamReader> reader_;
+	QSharedPointer<ChromosomeInfo> chr_info_;
+};
 
 class ConcreteTool
 		: public ToolBase
@@ -29,6 +120,9 @@ public:
 		//optional
 		addInfile("in", "Input BED file (note that overlapping regions will be merged before processing). If unset, reads from STDIN.", true);
 		addOutfile("out", "Output BED file. If unset, writes to STDOUT.", true);
+		addInt("threads", "Number of threads. If bigger than 1, chunks of regions are processed in parallel.", true, 1);
+
+		changeLog(2017, 2, 1, "Added parameter 'threads' for parallel processing.");
 	}
 
 	void readCount(BedFile& bed_file, const QString& bam_file, int min_mapq)
@@ -53,17 +147,9 @@ public:
 		BamAlignment al;
 		while (reader.GetNextAlignmentCore(al))
 		{
-			if (al.IsDuplicate()) continue;
-			if (!al.IsPrimaryAlignment()) continue;
-			if (!al.IsMapped() || al.MapQuality<min_mapq) continue;
-
-			const Chromosome& chr = chr_info.chromosome(al.RefID);
-			int end_position = al.GetEndPosition();
-			QVector<int> indices = bed_idx.matchingIndices(chr, al.Position+1, end_position);
-			foreach(int index, indices)
-			{
-				read_count[index] += 1;
-			}
+			if (!al.IsMapped()) continue;
+
+			ReadCountProcessor::countAlignment(al, chr_info.chromosome(al.RefID), bed_idx, min_mapq, read_count);
 		}
 		reader.Close();
 
@@ -83,7 +169,19 @@ public:
 
 		//get coverage info for bam files
 		QString bam = getInfile("bam");
-		readCount(file, bam, getInt("min_mapq"));
+		int threads = getInt("threads");
+		if (threads>1)
+		{
+			if (!file.isMergedAndSorted())
+			{
+				THROW(ArgumentException, "Merged and sorted BED file required for coverage calculation!");
+			}
+			BedChunkRunner::run(file, ReadCountProcessor(bam, getInt("min_mapq")), threads);
+		}
+		else
+		{
+			readCount(file, bam, getInt("min_mapq"));
+		}
 
 		//store
 		file.clearHeaders();
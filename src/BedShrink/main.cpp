@@ -1,5 +1,6 @@
-#include "BedFile.h"
+#include "BedFileStream.h"
 #include "ToolBase.h"
+#include "Exceptions.h"
 
 class ConcreteTool
 		: public ToolBase
@@ -23,10 +24,29 @@ public:
 
 	virtual void main()
 	{
-		BedFile file;
-		file.load(getInfile("in"));
-		file.shrink(getInt("n"));
-		file.store(getOutfile("out"));
+		int n = getInt("n");
+		if (n<1)
+		{
+			THROW(ArgumentException, "Cannot shrink BED file by '" + QString::number(n) + "' bases!");
+		}
+
+		//shrink line by line (constant memory) - regions that become empty are removed
+		BedInfileStream in(getInfile("in"));
+		BedOutfileStream out(getOutfile("out"));
+		while(in.next())
+		{
+			if (in.isHeader())
+			{
+				out.writeHeader(in.line());
+				continue;
+			}
+
+			int start = in.start() + n;
+			int end = in.end() - n;
+			if (start>end) continue;
+			out.write(in.chr(), start, end, in.annotationData());
+		}
+		out.flush();
 	}
 };
 
@@ -23,7 +23,7 @@ public:
 
 	virtual void main()
 	{
-		BedFile file;
+		BedFileCompact file;
 		file.load(getInfile("in"));
 		file.sort(getFlag("uniq"));
 		file.store(getOutfile("out"));
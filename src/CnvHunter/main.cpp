@@ -6,6 +6,7 @@
 #include "NGSHelper.h"
 #include "NGSD.h"
 #include "Histogram.h"
+#include "Profiler.h"
 #include <QVector>
 #include <QFileInfo>
 #include <QDir>
@@ -542,6 +543,14 @@ public:
 		outstream << endl;
 	}
 
+	///Adds the time of a step to the timing output and to the run-time profile, and restarts the timer.
+	void addTiming(QList<QString>& timings, QTime& timer, QString step)
+	{
+		timings.append(step + ": " + Helper::elapsedTime(timer));
+		Profiler::addTime("CnvHunter " + step, 1000000ll * timer.elapsed());
+		timer.restart();
+	}
+
     virtual void main()
     {
         //init
@@ -641,8 +650,7 @@ public:
             }
 			samples.append(sample);
 		}
-		timings.append("loading input: " + Helper::elapsedTime(timer));
-		timer.restart();
+		addTiming(timings, timer, "loading input");
 
 		//count gonosome regions
 		outstream << "=== normalizing depth-of-coverage data ===" << endl;
@@ -735,8 +743,7 @@ public:
 				samples[s]->qc += "avg_depth_autosomes=" + QString::number(mean_auto) + " ";
 			}
 		}
-		timings.append("normalizing data: " + Helper::elapsedTime(timer));
-		timer.restart();
+		addTiming(timings, timer, "normalizing data");
 
 		//calculate overall average depth (of good samples)
 		QVector<double> tmp;
@@ -790,8 +797,7 @@ public:
         }
         outstream << "bad regions: " << c_bad_region << " of " << exons.count() << endl << endl;
         printRegionDistributionCV(exons, outstream);
-		timings.append("detecting bad regions: " + Helper::elapsedTime(timer));
-		timer.restart();
+		addTiming(timings, timer, "detecting bad regions");
 
         //calculate correlation between all samples
 		for (int i=0; i<samples.count(); ++i)
@@ -825,8 +831,7 @@ public:
 			std::sort(samples[i]->correl_all.begin(), samples[i]->correl_all.end(), [](const SampleCorrelation& a, const SampleCorrelation& b){return a.correlation > b.correlation;});
 		}
 		printCorrelationStatistics(samples, outstream);
-		timings.append("calculating sample correlations: " + Helper::elapsedTime(timer));
-		timer.restart();
+		addTiming(timings, timer, "calculating sample correlations");
 
         //construct reference from 'n' most similar samples
 		outstream << "=== checking for bad samples ===" << endl;
@@ -911,8 +916,7 @@ public:
         }
 		outstream << "bad samples: " << c_bad_sample << " of " << samples.count() << endl << endl;
         printSampleDistributionCorrelation(samples, outstream);
-		timings.append("constructing reference samples: " + Helper::elapsedTime(timer));
-		timer.restart();
+		addTiming(timings, timer, "constructing reference samples");
 
         //remove bad samples
         QVector<QSharedPointer<SampleData>> samples_removed;
@@ -963,8 +967,7 @@ public:
 			samples[s]->ref.resize(to);
 			samples[s]->ref_stdev.resize(to);
 		}
-		timings.append("removing bad samples: " + Helper::elapsedTime(timer));
-		timer.restart();
+		addTiming(timings, timer, "removing bad samples");
 
         //detect CNVs from DOC data
 		outstream << "=== CNV seed detection ===" << endl;
@@ -1002,9 +1005,8 @@ public:
 			}
         }
 		outstream << "detected " << ranges.count() << " seed regions" << endl << endl;
-		timings.append("CNV seed detection: " + Helper::elapsedTime(timer));
 		printZScoreDistribution(results, outstream);
-		timer.restart();
+		addTiming(timings, timer, "CNV seed detection");
 
         //extending initial CNVs in both directions
 		outstream << "=== CNV extension ===" << endl;
@@ -1067,8 +1069,7 @@ public:
             }
         }
 		outstream << "extended seeds to " << c_extended << " additional regions" << endl << endl;
-		timings.append("CNV seed extension: " + Helper::elapsedTime(timer));
-		timer.restart();
+		addTiming(timings, timer, "CNV seed extension");
 
 		//merge adjacent ranges
 		outstream << "=== merging adjacent CNV regions to larger events ===" << endl;
@@ -1135,8 +1136,7 @@ public:
 			}
 		}
 		outstream << "merged " << c_ranges_before_merge << " to " << ranges.count() << " ranges" << endl << endl;
-		timings.append("CNV merging: " + Helper::elapsedTime(timer));
-		timer.restart();
+		addTiming(timings, timer, "CNV merging");
 
 		//count CNVs per sample/region
 		QHash<QSharedPointer<ExonData>, int> cnvs_exon;
@@ -1203,7 +1203,7 @@ public:
         outstream << endl;
 
         //print timing output
-		timings.append("statistics and writing output: " + Helper::elapsedTime(timer));
+		addTiming(timings, timer, "statistics and writing output");
 		outstream << "=== timing ===" << endl;
 		foreach(const QString& line, timings)
 		{
@@ -0,0 +1,107 @@
+#include "BarcodeIndex.h"
+#include "Exceptions.h"
+
+PackedIndex::PackedIndex(const QByteArray& seq)
+	: bases(0)
+	, n_mask(0)
+	, length(seq.length())
+{
+	int encoded = qMin(length, MAX_LENGTH);
+	for (int i=0; i<encoded; ++i)
+	{
+		int shift = 2*i;
+		switch(seq[i])
+		{
+			case 'A':
+				break;
+			case 'C':
+				bases |= Q_UINT64_C(1) << shift;
+				break;
+			case 'G':
+				bases |= Q_UINT64_C(2) << shift;
+				break;
+			case 'T':
+				bases |= Q_UINT64_C(3) << shift;
+				break;
+			default:
+				n_mask |= Q_UINT64_C(1) << shift;
+		}
+	}
+}
+
+BarcodeIndex::BarcodeIndex(int i1_len, int i2_len, int max_mismatches)
+	: i1_len_(i1_len)
+	, i2_len_(i2_len)
+	, max_mismatches_(max_mismatches)
+{
+	if (i1_len>PackedIndex::MAX_LENGTH || i2_len>PackedIndex::MAX_LENGTH)
+	{
+		THROW(ArgumentException, "Barcodes longer than " + QString::number(PackedIndex::MAX_LENGTH) + " bases are not supported!");
+	}
+}
+
+void BarcodeIndex::add(const QByteArray& barcode1, const QByteArray& barcode2, int id)
+{
+	if (barcode1.length()!=i1_len_ || barcode2.length()!=i2_len_)
+	{
+		THROW(ProgrammingException, "Barcode " + barcode1 + "/" + barcode2 + " does not match barcode index lengths " + QString::number(i1_len_) + "/" + QString::number(i2_len_) + "!");
+	}
+
+	PackedIndex packed1(barcode1);
+	bases1_.append(packed1.bases);
+	n_mask1_.append(packed1.n_mask);
+	PackedIndex packed2(barcode2);
+	bases2_.append(packed2.bases);
+	n_mask2_.append(packed2.n_mask);
+	ids_.append(id);
+}
+
+int BarcodeIndex::match(const PackedIndex& read1, const PackedIndex& read2, int& id) const
+{
+	//index reads shorter than the barcodes cannot match
+	if (read1.length<i1_len_ || read2.length<i2_len_) return 0;
+
+	const quint64 mask1 = PackedIndex::mask(i1_len_);
+	const quint64 mask2 = PackedIndex::mask(i2_len_);
+	const quint64 r1 = read1.bases & mask1;
+	const quint64 n1 = read1.n_mask & mask1;
+	const quint64 r2 = read2.bases & mask2;
+	const quint64 n2 = read2.n_mask & mask2;
+
+	int hits = 0;
+	for (int i=0; i<ids_.count(); ++i)
+	{
+		if (PackedIndex::mismatches(r1, n1, bases1_[i], n_mask1_[i])>max_mismatches_) continue;
+		if (PackedIndex::mismatches(r2, n2, bases2_[i], n_mask2_[i])>max_mismatches_) continue;
+
+		id = ids_[i];
+		++hits;
+		if (hits>1) break; //ambiguous - no further searching is needed
+	}
+
+	return hits;
+}
+
+bool BarcodeIndex::matchesTruncated(const PackedIndex& read1, const PackedIndex& read2, int i1_len, int i2_len) const
+{
+	i1_len = qMin(i1_len, i1_len_);
+	i2_len = qMin(i2_len, i2_len_);
+	if (read1.length<i1_len || read2.length<i2_len) return false;
+
+	const quint64 mask1 = PackedIndex::mask(i1_len);
+	const quint64 mask2 = PackedIndex::mask(i2_len);
+	const quint64 r1 = read1.bases & mask1;
+	const quint64 n1 = read1.n_mask & mask1;
+	const quint64 r2 = read2.bases & mask2;
+	const quint64 n2 = read2.n_mask & mask2;
+
+	for (int i=0; i<ids_.count(); ++i)
+	{
+		if (PackedIndex::mismatches(r1, n1, bases1_[i] & mask1, n_mask1_[i] & mask1)>max_mismatches_) continue;
+		if (PackedIndex::mismatches(r2, n2, bases2_[i] & mask2, n_mask2_[i] & mask2)>max_mismatches_) continue;
+
+		return true;
+	}
+
+	return false;
+}
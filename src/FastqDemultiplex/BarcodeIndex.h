@@ -0,0 +1,92 @@
+#ifndef BARCODEINDEX_H
+#define BARCODEINDEX_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QtAlgorithms>
+
+///2-bit encoded index read sequence (up to 32 bases are encoded).
+struct PackedIndex
+{
+	///Constructor - encodes the given sequence. Bases other than A, C, G and T are treated as 'N'.
+	explicit PackedIndex(const QByteArray& seq = QByteArray());
+
+	///Bases (2 bits per base, first base in the lowest bits).
+	quint64 bases;
+	///Mask of 'N' bases (lower bit of the 2-bit slot of each base).
+	quint64 n_mask;
+	///Sequence length (can be larger than 32, but only the first 32 bases are encoded).
+	int length;
+
+	///Maximum number of bases that is encoded.
+	static const int MAX_LENGTH = 32;
+
+	///Returns the bit mask for the first @p length bases.
+	static quint64 mask(int length)
+	{
+		return length>=MAX_LENGTH ? ~Q_UINT64_C(0) : (Q_UINT64_C(1) << (2*length)) - 1;
+	}
+
+	///Returns the number of mismatching bases of two encoded sequences.
+	static int mismatches(quint64 bases1, quint64 n_mask1, quint64 bases2, quint64 n_mask2)
+	{
+		quint64 diff = bases1 ^ bases2;
+		diff = (diff | (diff >> 1)) & Q_UINT64_C(0x5555555555555555);
+		return qPopulationCount(diff | (n_mask1 ^ n_mask2));
+	}
+};
+
+/**
+  @brief Sample barcodes of one index length combination with bounded-Hamming lookup.
+
+  The barcodes are stored 2-bit encoded in contiguous arrays and each lookup compares the read index against all barcodes using XOR/popcount.
+  Memory usage and lookup time do not depend on the number of tolerated mismatches.
+*/
+class BarcodeIndex
+{
+public:
+	///Constructor.
+	BarcodeIndex(int i1_len=0, int i2_len=0, int max_mismatches=0);
+
+	///Returns the index 1 length.
+	int i1Length() const
+	{
+		return i1_len_;
+	}
+	///Returns the index 2 length (0 for single-indexed barcodes).
+	int i2Length() const
+	{
+		return i2_len_;
+	}
+	///Returns if the barcodes are double-indexed.
+	bool isDouble() const
+	{
+		return i2_len_!=0;
+	}
+	///Returns the number of barcodes.
+	int count() const
+	{
+		return ids_.count();
+	}
+
+	///Adds a barcode with the given ID. The barcodes have to match the index lengths.
+	void add(const QByteArray& barcode1, const QByteArray& barcode2, int id);
+
+	///Returns the number of barcodes (at most 2) within the mismatch limit of the (truncated) index reads. @p id is set to the ID of the match.
+	int match(const PackedIndex& read1, const PackedIndex& read2, int& id) const;
+
+	///Returns if the index reads match any barcode within the mismatch limit, when both are truncated to the given lengths.
+	bool matchesTruncated(const PackedIndex& read1, const PackedIndex& read2, int i1_len, int i2_len) const;
+
+protected:
+	int i1_len_;
+	int i2_len_;
+	int max_mismatches_;
+	QVector<quint64> bases1_;
+	QVector<quint64> n_mask1_;
+	QVector<quint64> bases2_;
+	QVector<quint64> n_mask2_;
+	QVector<int> ids_;
+};
+
+#endif
@@ -10,7 +10,8 @@ CONFIG   += console
 CONFIG   -= app_bundle
 
 SOURCES += main.cpp \
-        WriteWorker.cpp
+        WriteWorker.cpp \
+        BarcodeIndex.cpp
 
 include("../app_cli.pri")
 
@@ -18,4 +19,5 @@ include("../app_cli.pri")
 LIBS += -lz
 
 HEADERS += \
-    WriteWorker.h
+    WriteWorker.h \
+    BarcodeIndex.h
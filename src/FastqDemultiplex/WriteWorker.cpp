@@ -1,13 +1,70 @@
 #include "WriteWorker.h"
 
-WriteWorker::WriteWorker(FastqOutfileStream* outstream, FastqEntry& outentry)
+OutputQueue::OutputQueue(QString filename, QThreadPool& pool, QAtomicInt& pending)
+	: stream_(filename, false)
+	, pool_(pool)
+	, pending_(pending)
+	, mutex_()
+	, queue_()
+	, writing_(false)
+{
+}
+
+OutputQueue::~OutputQueue()
+{
+	close();
+}
+
+void OutputQueue::enqueue(const QList<FastqEntry>& entries)
+{
+	if (entries.isEmpty()) return;
+
+	QMutexLocker locker(&mutex_);
+	queue_.append(entries);
+
+	//start a worker if none is running (a running worker writes the new entries as well)
+	if (!writing_)
+	{
+		writing_ = true;
+		pool_.start(new WriteWorker(this));
+	}
+}
+
+void OutputQueue::writeQueued()
+{
+	while(true)
+	{
+		QList<FastqEntry> entries;
+		{
+			QMutexLocker locker(&mutex_);
+			if (queue_.isEmpty())
+			{
+				writing_ = false;
+				return;
+			}
+			entries = queue_.takeFirst();
+		}
+
+		foreach(const FastqEntry& entry, entries)
+		{
+			stream_.write(entry);
+		}
+		pending_.fetchAndAddOrdered(-entries.count());
+	}
+}
+
+void OutputQueue::close()
+{
+	stream_.close();
+}
+
+WriteWorker::WriteWorker(OutputQueue* queue)
     : QRunnable()
-    , outstream_(outstream)
-    , outentry_(outentry)
+	, queue_(queue)
 {
 }
 
 void WriteWorker::run()
 {
-    outstream_->write(outentry_);
+	queue_->writeQueued();
 }
@@ -4,24 +4,52 @@
 #include <QObject>
 #include <QString>
 #include <QRunnable>
+#include <QThreadPool>
+#include <QMutex>
+#include <QAtomicInt>
 #include "FastqFileStream.h"
 
+///Output stream with a queue of FASTQ entries waiting to be written.
+class OutputQueue
+{
+public:
+	///Constructor. @p pending is decreased by the number of written entries.
+	OutputQueue(QString filename, QThreadPool& pool, QAtomicInt& pending);
+	///Destructor.
+	~OutputQueue();
+
+	///Appends entries to the queue. Entries are written in the order they were queued by a worker of the write pool (at most one worker per queue at a time).
+	void enqueue(const QList<FastqEntry>& entries);
+	///Writes all queued entries (called by the write worker).
+	void writeQueued();
+	///Closes the output stream. All write workers have to be finished.
+	void close();
+
+protected:
+	FastqOutfileStream stream_;
+	QThreadPool& pool_;
+	QAtomicInt& pending_;
+	QMutex mutex_;
+	QList< QList<FastqEntry> > queue_;
+	bool writing_;
+
+	//declared away methods
+	OutputQueue(const OutputQueue&);
+	OutputQueue& operator=(const OutputQueue&);
+};
+
 ///Fastq Write worker.
 class WriteWorker
         : public QRunnable
 {
 public:
     ///Constructor.
-    WriteWorker(FastqOutfileStream* outstream, FastqEntry& outentry);
+	WriteWorker(OutputQueue* queue);
     void run();
 
 private:
     //input variables
-    FastqOutfileStream * outstream_;
-    FastqEntry outentry_;
-
+	OutputQueue* queue_;
 };
 
 #endif
-
-
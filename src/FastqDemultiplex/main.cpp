@@ -3,6 +3,7 @@
 #include "FastqFileStream.h"
 #include "math.h"
 #include "WriteWorker.h"
+#include "BarcodeIndex.h"
 #include "NGSHelper.h"
 #include "Log.h"
 #include <QFile>
@@ -13,6 +14,9 @@
 #include <QList>
 #include <algorithm>
 #include <QThreadPool>
+#include <QThread>
+#include <QMutex>
+#include <QAtomicInt>
 
 ///Forward/reverse output stream pair.
 struct StreamPair
@@ -22,13 +26,13 @@ struct StreamPair
 		, reverse(0)
 	{}
 
-	StreamPair(FastqOutfileStream* f, FastqOutfileStream* r)
+	StreamPair(OutputQueue* f, OutputQueue* r)
 		: forward(f)
 		, reverse(r)
 	{}
 
-	FastqOutfileStream* forward;
-	FastqOutfileStream* reverse;
+	OutputQueue* forward;
+	OutputQueue* reverse;
 };
 
 ///Sample datastructure
@@ -70,6 +74,42 @@ struct IndexStatistics
 	QList<int> g_at_pos2;
 	QList<int> t_at_pos2;
 	QList<int> n_at_pos2;
+
+	///Adds the counts of @p other.
+	void add(const IndexStatistics& other)
+	{
+		poly_a1 += other.poly_a1;
+		poly_c1 += other.poly_c1;
+		poly_g1 += other.poly_g1;
+		poly_t1 += other.poly_t1;
+		poly_n1 += other.poly_n1;
+		add(a_at_pos1, other.a_at_pos1);
+		add(c_at_pos1, other.c_at_pos1);
+		add(g_at_pos1, other.g_at_pos1);
+		add(t_at_pos1, other.t_at_pos1);
+		add(n_at_pos1, other.n_at_pos1);
+
+		poly_a2 += other.poly_a2;
+		poly_c2 += other.poly_c2;
+		poly_g2 += other.poly_g2;
+		poly_t2 += other.poly_t2;
+		poly_n2 += other.poly_n2;
+		add(a_at_pos2, other.a_at_pos2);
+		add(c_at_pos2, other.c_at_pos2);
+		add(g_at_pos2, other.g_at_pos2);
+		add(t_at_pos2, other.t_at_pos2);
+		add(n_at_pos2, other.n_at_pos2);
+	}
+
+	///Adds per-position counts.
+	static void add(QList<int>& counts, const QList<int>& other)
+	{
+		while (counts.count()<other.count()) counts.append(0);
+		for (int i=0; i<other.count(); ++i)
+		{
+			counts[i] += other[i];
+		}
+	}
 };
 
 ///Lane statistics
@@ -82,6 +122,18 @@ struct LaneStatistics
 	int ambigous_single;
 	int ambigous_double;
 	IndexStatistics index_stats;
+
+	///Adds the counts of @p other.
+	void add(const LaneStatistics& other)
+	{
+		read += other.read;
+		assigned_single += other.assigned_single;
+		assigned_double += other.assigned_double;
+		unassigned += other.unassigned;
+		ambigous_single += other.ambigous_single;
+		ambigous_double += other.ambigous_double;
+		index_stats.add(other.index_stats);
+	}
 };
 
 ///Global result statistics
@@ -89,14 +141,84 @@ struct ResultStatistics
 {
 	QMap<QString, int> samples; //sample name: project + tab + sample
 	QMap<int, LaneStatistics> lanes;
+
+	///Adds the counts of @p other (e.g. thread-local statistics of a batch).
+	void add(const ResultStatistics& other)
+	{
+		for (QMap<QString, int>::const_iterator it=other.samples.begin(); it!=other.samples.end(); ++it)
+		{
+			samples[it.key()] += it.value();
+		}
+		for (QMap<int, LaneStatistics>::const_iterator it=other.lanes.begin(); it!=other.lanes.end(); ++it)
+		{
+			if (lanes.contains(it.key()))
+			{
+				lanes[it.key()].add(it.value());
+			}
+			else
+			{
+				lanes[it.key()] = it.value();
+			}
+		}
+	}
+};
+
+///Batch of read pairs
+struct ReadPairBatch
+{
+	QList<FastqEntry> reads1;
+	QList<FastqEntry> reads2;
+};
+
+class ConcreteTool;
+
+///Input worker that reads a forward/reverse FASTQ file pair in batches and starts a demultiplexing worker for each batch.
+class ReadWorker
+		: public QRunnable
+{
+public:
+	ReadWorker(ConcreteTool& tool, QString in1, QString in2)
+		: QRunnable()
+		, tool_(tool)
+		, in1_(in1)
+		, in2_(in2)
+	{
+	}
+	void run();
+
+private:
+	ConcreteTool& tool_;
+	QString in1_;
+	QString in2_;
+};
+
+///Worker that assigns a batch of read pairs to samples and queues them for writing.
+class DemultiplexWorker
+		: public QRunnable
+{
+public:
+	DemultiplexWorker(ConcreteTool& tool, ReadPairBatch* batch)
+		: QRunnable()
+		, tool_(tool)
+		, batch_(batch)
+	{
+	}
+	~DemultiplexWorker()
+	{
+		delete batch_;
+	}
+	void run();
+
+private:
+	ConcreteTool& tool_;
+	ReadPairBatch* batch_;
 };
 
 ///Barcode group (with same barcode length)
 struct BarcodeGroup
 {
-	int i1_len;
-	int i2_len;
-	QHash<QByteArray, Sample*> barcode2sample;
+	BarcodeIndex barcodes;
+	QList<Sample*> samples;
 };
 
 //TODO: test with same/different sample/barcode on different lanes
@@ -106,27 +228,56 @@ class ConcreteTool
     Q_OBJECT
 
 private:
+	friend class ReadWorker;
+	friend class DemultiplexWorker;
 
 	ResultStatistics statistics_;
-	QList<FastqOutfileStream*> outstreams_;
+	QList<OutputQueue*> outstreams_;
 	QMap <int, QList<BarcodeGroup> > barcodes_;//lane specific barcode groups
 	bool all_single;//are all barcodes single indexed?
-
-	///Helper function to write output with worker pool
-	void writeWithThread(FastqOutfileStream* outstream, FastqEntry& outentry)
-	{
-        WriteWorker* worker = new WriteWorker(outstream ,outentry);
-		QThreadPool::globalInstance()->start(worker);
-    }
+	Sample ambigous_sample_;//marker for ambigous barcodes (empty name)
+	QString out_folder_;
+	StreamPair ambigous_outstreams_;
+	QHash<int, StreamPair> unassigned_outstreams_;//lane specific streams for unassigned reads
+
+	//threading
+	QThreadPool read_pool_;//decoding of input files (one worker per file pair)
+	QThreadPool analysis_pool_;//barcode assignment of read batches
+	QThreadPool write_pool_;//compression of output streams (at most one worker per stream)
+	QMutex mutex_;//protects statistics, stream creation and queueing of output
+	QAtomicInt reads_pending_;//reads that are read from input, but not written yet
+	int max_reads_pending_;
+	int batch_size_;
+	QStringList errors_;//errors that occured in worker threads
 
 	///Helper function that creates an output stream and adds it to the list of streams
-	FastqOutfileStream* createStream(QString filename)
+	OutputQueue* createStream(QString filename)
 	{
-		FastqOutfileStream* stream = new FastqOutfileStream(filename, false);
+		OutputQueue* stream = new OutputQueue(filename, write_pool_, reads_pending_);
 		outstreams_.append(stream);
 		return stream;
 	}
 
+	///Returns the streams for unassigned reads of a lane (created on first use).
+	StreamPair unassignedStreams(int lane)
+	{
+		QMutexLocker locker(&mutex_);
+		if (!unassigned_outstreams_.contains(lane))
+		{
+			OutputQueue* outstream_pointer1 = createStream(out_folder_+"/unassigned_L"+QString::number(lane).rightJustified(3, '0')+"_R1.fastq.gz");
+			OutputQueue* outstream_pointer2 = createStream(out_folder_+"/unassigned_L"+QString::number(lane).rightJustified(3, '0')+"_R2.fastq.gz");
+			unassigned_outstreams_[lane] = StreamPair(outstream_pointer1, outstream_pointer2);
+		}
+		return unassigned_outstreams_[lane];
+	}
+
+	///Stores an error that occured in a worker thread.
+	void addError(QString error)
+	{
+		QMutexLocker locker(&mutex_);
+		errors_ << error;
+	}
+
 	///Returns barcode read lengths
 	void getBarcodeReadLengths(QString input_file1, int& r1, int& r2)
 	{
@@ -145,67 +296,58 @@ private:
 		r2 = barcode_seqs[1].length();
 	}
 
-	QSet<QByteArray> makeBarcodesWithMismatch(QByteArray barcode, int max_mismatches)
+	///Returns if the index reads also match a barcode of another group of the same lane (with the same index type), when truncated to the shorter barcode lengths.
+	static bool matchesOtherGroup(const QList<BarcodeGroup>& groups, int group_index, const PackedIndex& index1, const PackedIndex& index2)
 	{
-		const QList<char> base_list = QList<char>() << 'A' << 'C'<< 'T'<< 'G' <<'N';//allowed bases
+		const BarcodeIndex& group = groups[group_index].barcodes;
+		for (int i=0; i<groups.count(); ++i)
+		{
+			if (i==group_index) continue;
 
-		QSet<QByteArray> barcodes_with_mismatches;//set of barcodes with at most [mismatch] mismatches
-		barcodes_with_mismatches.insert(barcode);//add original barcode for first cycle
+			const BarcodeIndex& other = groups[i].barcodes;
+			if (other.isDouble()!=group.isDouble()) continue; //single and double indexed barcodes can't be ambigous
 
-		for(int mis=0; mis<max_mismatches; ++mis)//[mismatch] cylces, introducing one mismatch in each cycle
-		{
-			QSet<QByteArray> barcodes = barcodes_with_mismatches;//results from previous cycles are original barcodes for this cycle
-			foreach(QByteArray bar, barcodes)//add mismatch to each barcode
-			{
-				for (int base = 0; base != bar.size(); ++base)//for each position of working copy
-				{
-					QByteArray barcode_with_mismatch = bar;//make working copy of original barcode
-					foreach(char mis, base_list)//use each allowed base once as mismatch
-					{
-						barcode_with_mismatch[base] = mis;//change base at act position
-						barcodes_with_mismatches.insert(barcode_with_mismatch);//insert modified barcode into set
-					}
-				}
-			}
+			if (other.matchesTruncated(index1, index2, group.i1Length(), group.i2Length())) return true;
 		}
-		return barcodes_with_mismatches;
+
+		return false;
 	}
 
-	void addIndexStatistics(const QByteArray &barcode_seq1, const QByteArray &barcode_seq2, int lane)
+	static void addIndexStatistics(const QByteArray &barcode_seq1, const QByteArray &barcode_seq2, IndexStatistics& stats)
 	{
 		bool is_poly1=true;//assume index is poly-base until contradiction is found
 		//read each position of index read 1
 		for(int iii=0; iii<barcode_seq1.size(); ++iii)
 		{
 			if (barcode_seq1[0]!=barcode_seq1[iii]) is_poly1=false;
-			if (barcode_seq1[iii]=='A') statistics_.lanes[lane].index_stats.a_at_pos1[iii]++;
-			if (barcode_seq1[iii]=='C') statistics_.lanes[lane].index_stats.c_at_pos1[iii]++;
-			if (barcode_seq1[iii]=='G') statistics_.lanes[lane].index_stats.g_at_pos1[iii]++;
-			if (barcode_seq1[iii]=='T') statistics_.lanes[lane].index_stats.t_at_pos1[iii]++;
-			if (barcode_seq1[iii]=='N') statistics_.lanes[lane].index_stats.n_at_pos1[iii]++;
+			if (barcode_seq1[iii]=='A') stats.a_at_pos1[iii]++;
+			if (barcode_seq1[iii]=='C') stats.c_at_pos1[iii]++;
+			if (barcode_seq1[iii]=='G') stats.g_at_pos1[iii]++;
+			if (barcode_seq1[iii]=='T') stats.t_at_pos1[iii]++;
+			if (barcode_seq1[iii]=='N') stats.n_at_pos1[iii]++;
 		}
 		if ((is_poly1)&&(barcode_seq1.size()>0))
 		{
 			switch(barcode_seq1[0])
 			{
 				case 'A':
-					statistics_.lanes[lane].index_stats.poly_a1++;
+					stats.poly_a1++;
 					break;
 
 				case 'C':
-					statistics_.lanes[lane].index_stats.poly_c1++;
+					stats.poly_c1++;
 					break;
 
 				case 'G':
-					statistics_.lanes[lane].index_stats.poly_g1++;
+					stats.poly_g1++;
 					break;
 
 				case 'T':
-					statistics_.lanes[lane].index_stats.poly_t1++;
+					stats.poly_t1++;
 					break;
 
 				case 'N':
-					statistics_.lanes[lane].index_stats.poly_n1++;
+					stats.poly_n1++;
 					break;
 
 				default://very unlikely
@@ -218,34 +360,34 @@ private:
 		for(int iii=0; iii<barcode_seq2.size(); ++iii)
 		{
 			if (barcode_seq2[0]!=barcode_seq2[iii]) is_poly2=false;
-			if (barcode_seq2[iii]=='A') statistics_.lanes[lane].index_stats.a_at_pos2[iii]++;
-			if (barcode_seq2[iii]=='C') statistics_.lanes[lane].index_stats.c_at_pos2[iii]++;
-			if (barcode_seq2[iii]=='G') statistics_.lanes[lane].index_stats.g_at_pos2[iii]++;
-			if (barcode_seq2[iii]=='T') statistics_.lanes[lane].index_stats.t_at_pos2[iii]++;
-			if (barcode_seq2[iii]=='N') statistics_.lanes[lane].index_stats.n_at_pos2[iii]++;
+			if (barcode_seq2[iii]=='A') stats.a_at_pos2[iii]++;
+			if (barcode_seq2[iii]=='C') stats.c_at_pos2[iii]++;
+			if (barcode_seq2[iii]=='G') stats.g_at_pos2[iii]++;
+			if (barcode_seq2[iii]=='T') stats.t_at_pos2[iii]++;
+			if (barcode_seq2[iii]=='N') stats.n_at_pos2[iii]++;
 		}
 		if ((is_poly2)&&(barcode_seq2.size()>0))
 		{
 			switch(barcode_seq2[0])
 			{
 				case 'A':
-					statistics_.lanes[lane].index_stats.poly_a2++;
+					stats.poly_a2++;
 					break;
 
 				case 'C':
-					statistics_.lanes[lane].index_stats.poly_c2++;
+					stats.poly_c2++;
 					break;
 
 				case 'G':
-					statistics_.lanes[lane].index_stats.poly_g2++;
+					stats.poly_g2++;
 					break;
 
 				case 'T':
-					statistics_.lanes[lane].index_stats.poly_t2++;
+					stats.poly_t2++;
 					break;
 
 				case 'N':
-					statistics_.lanes[lane].index_stats.poly_n2++;
+					stats.poly_n2++;
 					break;
 
 				default://very unlikely
@@ -254,9 +396,8 @@ private:
 		}
 	}
 
-	void parseBarcodes(QString sheet, int r1_length, int r2_length, int mms, int mmd, QString out_folder, bool rev2)
+	void parseBarcodes(QString sheet, int r1_length, int r2_length, int mms, int mmd, bool rev2)
 	{
-		Sample* ambigous_sample = new Sample;
 		all_single=true;
 		QFile inFile(sheet);
         if (!inFile.open(QIODevice::ReadOnly | QIODevice::Text))
@@ -265,14 +406,14 @@ private:
         }
 
 		//delete/create output folder
-		QDir out_dir(out_folder);
-		if (out_dir.exists() && !QDir(out_folder).removeRecursively())
+		QDir out_dir(out_folder_);
+		if (out_dir.exists() && !QDir(out_folder_).removeRecursively())
 		{
-			THROW(ArgumentException, "Output folder '" + out_folder + "' could not be deleted!");
+			THROW(ArgumentException, "Output folder '" + out_folder_ + "' could not be deleted!");
         }
 		if (!out_dir.mkpath("."))
 		{
-			THROW(ArgumentException, "Output folder '" + out_folder + "' could not be created!");
+			THROW(ArgumentException, "Output folder '" + out_folder_ + "' could not be created!");
 		}
 
         QTextStream in(&inFile);
@@ -314,12 +455,12 @@ private:
 			}
 
             //create sample directory
-			QDir project_dir(out_folder + "/Project_" + concrete_sample->project);
+			QDir project_dir(out_folder_ + "/Project_" + concrete_sample->project);
 			project_dir.mkdir("Sample_" + concrete_sample->name);
 
 			//open filestreams
-			FastqOutfileStream* outstream_pointer1 = createStream(concrete_sample->filename(out_folder, "1"));
-			FastqOutfileStream* outstream_pointer2 = createStream(concrete_sample->filename(out_folder, "2"));
+			OutputQueue* outstream_pointer1 = createStream(concrete_sample->filename(out_folder_, "1"));
+			OutputQueue* outstream_pointer2 = createStream(concrete_sample->filename(out_folder_, "2"));
 			concrete_sample->outstreams = StreamPair(outstream_pointer1,outstream_pointer2);
 
 			if (r1_length<barcode1.size())
@@ -340,27 +481,16 @@ private:
             }
 			used_barcodes[concrete_sample->lane].insert(barcode1 + "_" + barcode2);
 
-            //introduce mismatches to barcodes
-			QSet<QByteArray> barcodes_with_mismatches1;
-			QSet<QByteArray> barcodes_with_mismatches2;
-
-            if (barcode2.size()>0)//if this is a double-indexed read
-            {
+			if (barcode2.size()>0)//if this is a double-indexed read
+			{
 				all_single=false;
-				barcodes_with_mismatches1 = makeBarcodesWithMismatch(barcode1, mmd);
-				barcodes_with_mismatches2 = makeBarcodesWithMismatch(barcode2, mmd);
-            }
-            else
-            {
-				barcodes_with_mismatches1 = makeBarcodesWithMismatch(barcode1, mms);
-                barcodes_with_mismatches2.insert("");//barcode 2 is empty
-            }
+			}
 
 			//find barcode group
 			BarcodeGroup* group = 0;
 			for (int i=0; i<barcodes_[concrete_sample->lane].size(); ++i)
 			{
-				if (barcodes_[concrete_sample->lane][i].i1_len==barcode1.size() && barcodes_[concrete_sample->lane][i].i2_len==barcode2.size())
+				if (barcodes_[concrete_sample->lane][i].barcodes.i1Length()==barcode1.size() && barcodes_[concrete_sample->lane][i].barcodes.i2Length()==barcode2.size())
 				{
 					group = &barcodes_[concrete_sample->lane][i];
 				}
@@ -369,249 +499,209 @@ private:
 			if (group==0)
 			{
 				BarcodeGroup tmp;
-				tmp.i1_len = barcode1.size();
-				tmp.i2_len = barcode2.size();
+				tmp.barcodes = BarcodeIndex(barcode1.size(), barcode2.size(), barcode2.size()>0 ? mmd : mms);
 				barcodes_[concrete_sample->lane].append(tmp);
 				group = &(barcodes_[concrete_sample->lane].last());
 			}
 
-			//insert new barcodes
-			foreach(QByteArray bar1, barcodes_with_mismatches1)
-			{
-				foreach(QByteArray bar2, barcodes_with_mismatches2)
-				{
-					QByteArray barcode = bar1+"\t"+bar2;
-					if (group->barcode2sample.contains(barcode))
-                    {
-						group->barcode2sample[barcode] = ambigous_sample; //flag ambigous barcode with same length
-                    }
-                    else
-                    {
-						group->barcode2sample[barcode] = concrete_sample;
-                    }
-                }
-			}
+			//insert new barcode (mismatches and ambigous barcodes are resolved during lookup)
+			group->barcodes.add(barcode1, barcode2, group->samples.count());
+			group->samples.append(concrete_sample);
         }
 
-		//flag ambigious barcodes of different lengths
+		inFile.close();
+    }
 
-		foreach(const int lane_index, barcodes_.keys())//for each lane
+	///Reads a forward/reverse FASTQ file pair in batches and starts a demultiplexing worker for each batch.
+	void readFilePair(QString in1, QString in2)
+	{
+		FastqFileStream input_stream1(in1, false);
+		FastqFileStream input_stream2(in2, false);
+		while (!input_stream1.atEnd() && !input_stream2.atEnd())
 		{
-			for(int iii = 0; iii<barcodes_[lane_index].length(); ++iii) //compare every barcode group
+			//prevent caching of too many reads (waste of memory)
+			while (reads_pending_.load()>=max_reads_pending_)
 			{
-				BarcodeGroup groupi=barcodes_[lane_index][iii];
-				for(int jjj=iii+1 ; jjj<barcodes_[lane_index].length(); ++jjj)//compare with every remaining barcode group
-				{
-					BarcodeGroup groupj=barcodes_[lane_index][jjj];
-
-					//if one barcode group is double indexed and the other is single indexed, they can't be ambigous
-					if ((groupi.i2_len!=0)!=(groupj.i2_len!=0)) continue;
-
-					//if barcode i length is shorter than barcode j
-					if ((groupi.i1_len<=groupj.i1_len)&&(groupi.i2_len<=groupj.i2_len))
-					{
-						//iterate through barcodes of groupj's hash
-						foreach(const QByteArray barcode, groupj.barcode2sample.keys())
-						{
-							const QList <QByteArray> parts = barcode.split('\t');
-							//truncate groupj's barcode
-							QByteArray truncated_barcode = parts[0].left(groupj.i1_len)+"\t"+parts[1].left(groupj.i2_len);
-							//look it up in groupi's hash
-							if (groupi.barcode2sample.contains(truncated_barcode))
-							{
-								//set them to ambigous
-								barcodes_[lane_index][iii].barcode2sample[truncated_barcode]=ambigous_sample;
-								barcodes_[lane_index][jjj].barcode2sample[barcode]=ambigous_sample;
-							}
-						}
-					}
-
-					//if barcode j length is shorter than barcode i
-					else if ((groupj.i1_len<=groupi.i1_len)&&(groupj.i2_len<=groupi.i2_len))
-					{
-						//iterate through barcodes of groupi's hash
-						foreach(const QByteArray barcode, groupi.barcode2sample.keys())
-						{
-							QList <QByteArray> parts = barcode.split('\t');
-							//truncate groupi's barcode
-							QByteArray truncated_barcode = parts[0].left(groupj.i1_len)+"\t"+parts[1].left(groupj.i2_len);
-							//look it up in groupj's hash
-							if (groupj.barcode2sample.contains(truncated_barcode))
-							{
-								//set them to ambigous
-								barcodes_[lane_index][jjj].barcode2sample[truncated_barcode]=ambigous_sample;
-								barcodes_[lane_index][iii].barcode2sample[barcode]=ambigous_sample;
-							}
-						}
-					}
-
-					//if one barcode has a longer i5 and the other one a longer i7
-					else
-					{
-						//iterate through barcodes of groupi's hash
-						foreach(const QByteArray barcodei, groupi.barcode2sample.keys())
-						{
-							QList <QByteArray> partsi = barcodei.split('\t');
-							//iterate through barcodes of groupj's hash
-							foreach(const QByteArray barcodej, groupi.barcode2sample.keys())
-							{
-								int min_i1_size=qMin(groupi.i1_len,groupj.i1_len);
-								int min_i2_size=qMin(groupi.i2_len,groupj.i2_len);
-
-								QList <QByteArray> partsj = barcodej.split('\t');
-
-								//if truncated barcodes match
-								if((partsi[0].left(min_i1_size)==partsj[0].left(min_i1_size))&&(partsi[1].left(min_i2_size)==partsj[1].left(min_i2_size)))
-								{
-									//set them to ambigous
-									barcodes_[lane_index][jjj].barcode2sample[barcodej]=ambigous_sample;
-									barcodes_[lane_index][iii].barcode2sample[barcodei]=ambigous_sample;
-								}
-							}
-						}
-					}
-				}
+				QThread::msleep(1);
+			}
+
+			ReadPairBatch* batch = new ReadPairBatch();
+			while (batch->reads1.count()<batch_size_ && !input_stream1.atEnd() && !input_stream2.atEnd())//foreach input read
+			{
+				batch->reads1.append(FastqEntry());
+				input_stream1.readEntry(batch->reads1.last());
+				batch->reads2.append(FastqEntry());
+				input_stream2.readEntry(batch->reads2.last());
 			}
+			reads_pending_.fetchAndAddOrdered(2*batch->reads1.count());
+			analysis_pool_.start(new DemultiplexWorker(*this, batch));
 		}
-		inFile.close();
-    }
+	}
 
-	void demultiplex(QStringList in1, QStringList in2, QString out_folder)
+	///Assigns a batch of read pairs to samples, queues the reads for writing and adds the batch statistics.
+	void demultiplexBatch(const ReadPairBatch& batch)
 	{
-        //init filestreams for ambigous reads
-		FastqOutfileStream* ambigous_fastq1 = createStream(out_folder+"/ambigous_R1.fastq.gz");
-		FastqOutfileStream* ambigous_fastq2 = createStream(out_folder+"/ambigous_R2.fastq.gz");
-
-		//streams for unassigned reads
-		QHash< int, StreamPair > unassigned_outstreams;
+		//thread-local statistics and output (to avoid locking for each read)
+		ResultStatistics statistics;
+		QHash<int, StreamPair> unassigned_outstreams;
+		QHash<OutputQueue*, QList<FastqEntry> > output;
+		const QList<BarcodeGroup> no_groups;
 
-		//demultiplex
-		for (int i=0; i<in1.count(); ++i)
+		for (int i=0; i<batch.reads1.count(); ++i)
 		{
-			FastqFileStream input_stream1(in1[i], false);
-			FastqFileStream input_stream2(in2[i], false);
-			while (!input_stream1.atEnd() && !input_stream2.atEnd())//foreach input read
+			const FastqEntry& input_read1 = batch.reads1[i];
+			const FastqEntry& input_read2 = batch.reads2[i];
+
+			//extract lane
+			QList<QByteArray> header_parts = input_read1.header.split(':');
+			if (header_parts.count()<10) THROW(ArgumentException, "FASTQ header has less tham 10 ':'-separated parts: " + input_read1.header);
+			int lane = Helper::toInt(header_parts[3], "lane", input_read1.header);
+
+			//extract barcode(s)
+			QList<QByteArray> barcode_seqs = header_parts[9].split('+');
+			QByteArray barcode_seq1=barcode_seqs[0];
+			QByteArray barcode_seq2="";
+			if(barcode_seqs.length()>1) barcode_seq2=barcode_seqs[1];//could be that only one index read was used
+
+			//init unassigned streams and lane statistics (if not present yet)
+			if (!statistics.lanes.contains(lane))
 			{
-				FastqEntry input_read1;
-                input_stream1.readEntry(input_read1);
-				FastqEntry input_read2;
-                input_stream2.readEntry(input_read2);
-
-				//extract lane
-				QList<QByteArray> header_parts = input_read1.header.split(':');
-				if (header_parts.count()<10) THROW(ArgumentException, "FASTQ header has less tham 10 ':'-separated parts: " + input_read1.header);
-				int lane = Helper::toInt(header_parts[3], "lane", input_read1.header);
-
-				//extract barcode(s)
-				QList<QByteArray> barcode_seqs = header_parts[9].split('+');
-				QByteArray barcode_seq1=barcode_seqs[0];
-				QByteArray barcode_seq2="";
-				if(barcode_seqs.length()>1) barcode_seq2=barcode_seqs[1];//could be that only one index read was used
-
-				//init unassigned streams and lane statistics (if not present yet)
-				if (!unassigned_outstreams.contains(lane))
+				//streams
+				unassigned_outstreams[lane] = unassignedStreams(lane);
+
+				//statistics
+				statistics.lanes[lane] = LaneStatistics();
+
+				//index at_position statistics
+				for(int z=0; z<barcode_seq1.size(); ++z)
 				{
-					//streams
-					FastqOutfileStream* outstream_pointer1 = createStream(out_folder+"/unassigned_L"+QString::number(lane).rightJustified(3, '0')+"_R1.fastq.gz");
-					FastqOutfileStream* outstream_pointer2 = createStream(out_folder+"/unassigned_L"+QString::number(lane).rightJustified(3, '0')+"_R2.fastq.gz");
-					unassigned_outstreams[lane] = StreamPair(outstream_pointer1, outstream_pointer2);
-
-					//statistics
-					statistics_.lanes[lane] = LaneStatistics();
-
-					//index at_position statistics
-					for(int z=0; z<barcode_seq1.size(); ++z)
-					{
-						statistics_.lanes[lane].index_stats.a_at_pos1.append(0);
-						statistics_.lanes[lane].index_stats.c_at_pos1.append(0);
-						statistics_.lanes[lane].index_stats.g_at_pos1.append(0);
-						statistics_.lanes[lane].index_stats.t_at_pos1.append(0);
-						statistics_.lanes[lane].index_stats.n_at_pos1.append(0);
-					}
-
-					for(int z=0; z<barcode_seq2.size(); ++z)
-					{
-						statistics_.lanes[lane].index_stats.a_at_pos2.append(0);
-						statistics_.lanes[lane].index_stats.c_at_pos2.append(0);
-						statistics_.lanes[lane].index_stats.g_at_pos2.append(0);
-						statistics_.lanes[lane].index_stats.t_at_pos2.append(0);
-						statistics_.lanes[lane].index_stats.n_at_pos2.append(0);
-					}
+					statistics.lanes[lane].index_stats.a_at_pos1.append(0);
+					statistics.lanes[lane].index_stats.c_at_pos1.append(0);
+					statistics.lanes[lane].index_stats.g_at_pos1.append(0);
+					statistics.lanes[lane].index_stats.t_at_pos1.append(0);
+					statistics.lanes[lane].index_stats.n_at_pos1.append(0);
 				}
-				addIndexStatistics(barcode_seq1,barcode_seq2,lane);
 
-				bool found_single = false;
-				bool found_double = false;
-				Sample found_sample;
-				foreach(const BarcodeGroup& group, barcodes_[lane])
+				for(int z=0; z<barcode_seq2.size(); ++z)
 				{
-					bool is_double = group.i2_len!=0;
-					if (!is_double && found_double) continue; //a read matching a double index must not be assigned to a single index
-
-					QByteArray barcode = barcode_seq1.left(group.i1_len)+"\t"+barcode_seq2.left(group.i2_len);
-					if(group.barcode2sample.contains(barcode)) //check if (usable part) of index read seq 1 exists in barcodes
-                    {
-						if (is_double)
-						{
-							found_sample = *group.barcode2sample.value(barcode);
-							found_double = true;
-							break;//if a double index was matched, no further searching is needed
-						}
-						else
-						{
-							if (!found_single)//if the index reads haven't matched another barcode combination already
-							{
-								found_sample = *group.barcode2sample.value(barcode);
-								found_single = true;
-								if (all_single) break;//if a single index was matched, and there are no double indexes, no further searching is needed
-							}
-						}
-                    }
-                }
-
-				//write FASTQs and update statistics
-				statistics_.lanes[lane].read += 1;
-				if (found_double)
-                {
-					if (found_sample.name=="")
-                    {
-						statistics_.lanes[lane].ambigous_double += 1;
-						writeWithThread(ambigous_fastq1, input_read1);
-						writeWithThread(ambigous_fastq1, input_read2);
-                    }
-                    else
-                    {
-						writeWithThread(found_sample.outstreams.forward, input_read1);
-						writeWithThread(found_sample.outstreams.reverse, input_read2);
-						statistics_.lanes[lane].assigned_double += 1;
-						statistics_.samples[found_sample.project+"\t"+found_sample.name] += 1;
-                    }
-                }
-				else if (found_single)
-                {
-					if (found_sample.name=="")
-					{
-						statistics_.lanes[lane].ambigous_single += 1;
-						writeWithThread(ambigous_fastq1, input_read1);
-						writeWithThread(ambigous_fastq2, input_read2);
-                    }
-                    else
-                    {
-						writeWithThread(found_sample.outstreams.forward, input_read1);
-						writeWithThread(found_sample.outstreams.reverse, input_read2);
-						statistics_.lanes[lane].assigned_single += 1;
-						statistics_.samples[found_sample.project+"\t"+found_sample.name] += 1;
-                    }
-                }
-                else
-                {
-					writeWithThread(unassigned_outstreams[lane].forward, input_read1);
-					writeWithThread(unassigned_outstreams[lane].reverse, input_read2);
-					statistics_.lanes[lane].unassigned += 1;
-                }
+					statistics.lanes[lane].index_stats.a_at_pos2.append(0);
+					statistics.lanes[lane].index_stats.c_at_pos2.append(0);
+					statistics.lanes[lane].index_stats.g_at_pos2.append(0);
+					statistics.lanes[lane].index_stats.t_at_pos2.append(0);
+					statistics.lanes[lane].index_stats.n_at_pos2.append(0);
+				}
+			}
+			LaneStatistics& lane_stats = statistics.lanes[lane];
+			addIndexStatistics(barcode_seq1, barcode_seq2, lane_stats.index_stats);
+
+			bool found_single = false;
+			bool found_double = false;
+			const Sample* found_sample = 0;
+			PackedIndex index1(barcode_seq1);
+			PackedIndex index2(barcode_seq2);
+			QMap<int, QList<BarcodeGroup> >::const_iterator lane_it = barcodes_.constFind(lane);
+			const QList<BarcodeGroup>& groups = lane_it!=barcodes_.constEnd() ? lane_it.value() : no_groups;
+			for (int g=0; g<groups.count(); ++g)
+			{
+				const BarcodeGroup& group = groups[g];
+				bool is_double = group.barcodes.isDouble();
+				if (!is_double && found_double) continue; //a read matching a double index must not be assigned to a single index
+				if (!is_double && found_single) continue; //if the index reads haven't matched another barcode combination already
+
+				int sample_index = -1;
+				int hits = group.barcodes.match(index1, index2, sample_index);
+				if (hits==0) continue; //check if (usable part) of index reads match the barcodes
+
+				//flag barcodes matching several samples of the group or a sample of another group as ambigous
+				if (hits==1 && !matchesOtherGroup(groups, g, index1, index2))
+				{
+					found_sample = group.samples[sample_index];
+				}
+				else
+				{
+					found_sample = &ambigous_sample_;
+				}
+
+				if (is_double)
+				{
+					found_double = true;
+					break;//if a double index was matched, no further searching is needed
+				}
+				else
+				{
+					found_single = true;
+					if (all_single) break;//if a single index was matched, and there are no double indexes, no further searching is needed
+				}
+			}
+
+			//queue FASTQs and update statistics
+			lane_stats.read += 1;
+			if (found_double)
+			{
+				if (found_sample->name=="")
+				{
+					lane_stats.ambigous_double += 1;
+					output[ambigous_outstreams_.forward] << input_read1;
+					output[ambigous_outstreams_.reverse] << input_read2;
+				}
+				else
+				{
+					output[found_sample->outstreams.forward] << input_read1;
+					output[found_sample->outstreams.reverse] << input_read2;
+					lane_stats.assigned_double += 1;
+					statistics.samples[found_sample->project+"\t"+found_sample->name] += 1;
+				}
+			}
+			else if (found_single)
+			{
+				if (found_sample->name=="")
+				{
+					lane_stats.ambigous_single += 1;
+					output[ambigous_outstreams_.forward] << input_read1;
+					output[ambigous_outstreams_.reverse] << input_read2;
+				}
+				else
+				{
+					output[found_sample->outstreams.forward] << input_read1;
+					output[found_sample->outstreams.reverse] << input_read2;
+					lane_stats.assigned_single += 1;
+					statistics.samples[found_sample->project+"\t"+found_sample->name] += 1;
+				}
+			}
+			else
+			{
+				output[unassigned_outstreams[lane].forward] << input_read1;
+				output[unassigned_outstreams[lane].reverse] << input_read2;
+				lane_stats.unassigned += 1;
 			}
 		}
-    }
+
+		//add statistics and queue output (forward and reverse reads are queued together to keep read pairs in sync)
+		QMutexLocker locker(&mutex_);
+		statistics_.add(statistics);
+		for (QHash<OutputQueue*, QList<FastqEntry> >::const_iterator it=output.constBegin(); it!=output.constEnd(); ++it)
+		{
+			it.key()->enqueue(it.value());
+		}
+	}
+
+	void demultiplex(QStringList in1, QStringList in2)
+	{
+		//init filestreams for ambigous reads
+		ambigous_outstreams_ = StreamPair(createStream(out_folder_+"/ambigous_R1.fastq.gz"), createStream(out_folder_+"/ambigous_R2.fastq.gz"));
+
+		//demultiplex (file pairs are decoded in parallel, batches are assigned and written by worker pools)
+		for (int i=0; i<in1.count(); ++i)
+		{
+			read_pool_.start(new ReadWorker(*this, in1[i], in2[i]));
+		}
+
+		//wait till all threads are finished (otherwise closing the streams below leads to a crash)
+		read_pool_.waitForDone();
+		analysis_pool_.waitForDone();
+		write_pool_.waitForDone();
+		if (!errors_.isEmpty()) THROW(Exception, errors_.join("\n"));
+	}
 
 	QString writeSummaryPerPositionStat(int a, int c, int g, int t, int n)
 	{
@@ -720,6 +810,7 @@ public:
 		addInt("mmd", "Maximum tolerated mismatches for double barcode (per barcode read).", true, 2);
 		addFlag("rev2", "Use reverse complement of second barcode sequence.");
 		addString("summary", "Summary file name (created in output folder). If unset, summary is written to STDOUT.", true, "");
+		addInt("threads", "Number of threads used for barcode assignment and for compression of output files (input file pairs are decoded in additional threads). Note: with more than one thread, the read order in output files can differ from the input order.", true, 1);
     }
 
 	virtual void main()
@@ -728,28 +819,31 @@ public:
 		QStringList in1 = getInfileList("in1");
 		QStringList in2 = getInfileList("in2");
 		if (in1.size()!=in2.size()) THROW(ArgumentException, "FASTQ file count for forward/reverse reads differs!");
-		QString out_folder = getString("out");
+		out_folder_ = getString("out");
 		int mms = getInt("mms");
 		int mmd = getInt("mmd");
 		bool rev2 = getFlag("rev2");
 		QString summary = getString("summary");
-		QThreadPool::globalInstance()->setMaxThreadCount(1);
+		int threads = getInt("threads");
+		if (threads<1) THROW(CommandLineParsingException, "At least one thread is required!");
+		read_pool_.setMaxThreadCount(qMin(threads, in1.count()));
+		analysis_pool_.setMaxThreadCount(threads);
+		write_pool_.setMaxThreadCount(threads);
+		batch_size_ = 5000;
+		max_reads_pending_ = 8 * threads * 2 * batch_size_;
 
 		//get read lengths
 		int r1_length, r2_length;
 		getBarcodeReadLengths(in1[0], r1_length, r2_length);
 
 		//create barcodes with mismatches
-		parseBarcodes(getInfile("sheet"), r1_length, r2_length, mms, mmd, out_folder, rev2);
+		parseBarcodes(getInfile("sheet"), r1_length, r2_length, mms, mmd, rev2);
 
 		//demultiplex
-		demultiplex(in1, in2, out_folder);
-
-		//wait till all threads are finished (otherwise closing the streams below leads to a crash)
-		if (!QThreadPool::globalInstance()->waitForDone()) THROW(ProgrammingException, "Could not close all threads!");
+		demultiplex(in1, in2);
 
 		//close all output streams
-		foreach(FastqOutfileStream* stream, outstreams_)
+		foreach(OutputQueue* stream, outstreams_)
 		{
 			stream->close();
 		}
@@ -757,12 +851,38 @@ public:
 		//write statistics (STDOUT or in output folder)
 		if (summary!="")
 		{
-			summary = out_folder + QDir::separator() + summary;
+			summary = out_folder_ + QDir::separator() + summary;
 		}
 		writeSummary(summary);
     }
 };
 
+void ReadWorker::run()
+{
+	try
+	{
+		tool_.readFilePair(in1_, in2_);
+	}
+	catch(Exception& e)
+	{
+		tool_.addError(e.message());
+	}
+}
+
+void DemultiplexWorker::run()
+{
+	try
+	{
+		tool_.demultiplexBatch(*batch_);
+	}
+	catch(Exception& e)
+	{
+		//reads of the batch are not written - release them to unblock the input workers
+		tool_.reads_pending_.fetchAndAddOrdered(-2*batch_->reads1.count());
+		tool_.addError(e.message());
+	}
+}
+
 #include "main.moc"
 
 int main(int argc, char *argv[])
@@ -1,8 +1,79 @@
 #include "ToolBase.h"
 #include "Helper.h"
 #include "FastqFileStream.h"
-#include <QSet>
+#include "BgzfFileStream.h"
+#include "ReadIdIndex.h"
 #include <QFile>
+#include <QList>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QThread>
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include <cctype>
+
+///Batch of reads that is processed in parallel.
+struct ReadBatch
+{
+	FastqBatch reads;
+	QByteArray output;
+	QAtomicInt done;
+};
+
+///Worker that extracts the reads of a batch and formats the output.
+class BatchWorker
+	: public QRunnable
+{
+public:
+	BatchWorker(ReadBatch& batch, const ReadIdIndex& ids, bool v)
+		: QRunnable()
+		, batch_(batch)
+		, ids_(ids)
+		, v_(v)
+	{
+	}
+
+	void run()
+	{
+		FastqBatch& reads = batch_.reads;
+		for (int i=0; i<reads.count(); ++i)
+		{
+			//extract ID (without '@', trailing whitespaces and comment)
+			const char* header = reads.header(i);
+			int header_end = reads.headerLength(i);
+			while (header_end>1 && isspace(header[header_end-1])) --header_end;
+			int id_end = 1;
+			while (id_end<header_end && header[id_end]!=' ') ++id_end;
+
+			int length = ids_.value(header+1, id_end-1, -2);
+			if (length==-2) //id not in list
+			{
+				if (!v_) reads.discard(i);
+			}
+			else if (length==-1) //id is in list, but no length given
+			{
+				if (v_) reads.discard(i);
+			}
+			else if (length>=1) //id is in list and length given
+			{
+				if (v_) reads.discard(i);
+				else reads.trim(i, 0, length);
+			}
+			else //invalid length
+			{
+				reads.discard(i);
+			}
+		}
+		reads.toFastq(batch_.output);
+
+		batch_.done = 1;
+	}
+
+protected:
+	ReadBatch& batch_;
+	const ReadIdIndex& ids_;
+	bool v_;
+};
 
 class ConcreteTool
 		: public ToolBase
@@ -23,65 +94,70 @@ public:
 		addOutfile("out", "Output FASTQ file.", false);
 		//optional
 		addFlag("v", "Invert match: keep non-matching reads.");
+		addInt("threads", "Number of threads used for read extraction and output compression.", true, 1);
+
+		changeLog(2017,  2,  1, "Added parameter 'threads'. Reduced memory usage for large ID lists.");
 	}
 
 	virtual void main()
 	{
 		//init
 		bool v = getFlag("v");
+		int threads = getInt("threads");
+		if (threads<1) THROW(CommandLineParsingException, "At least one thread is required!");
 
-		//load ids and lengths
-		QHash<QByteArray, int> ids;
+		//load ids and lengths (the Bloom filter speeds up the lookup of reads that are not in the list, which are the majority in inverted mode)
+		ReadIdIndex ids(v);
 		QSharedPointer<QFile> file = Helper::openFileForReading(getInfile("ids"));
 		while (!file->atEnd())
 		{
 			QByteArray line = file->readLine().trimmed();
 			if (line.isEmpty() || line[0]=='#') continue;
-			QList<QByteArray> parts = line.split('\t');
+			int tab = line.indexOf('\t');
 			int length = -1;
-			if (parts.count()>1)
+			if (tab!=-1)
 			{
-				length = Helper::toInt(parts[1], "length value");
+				length = Helper::toInt(line.mid(tab+1).split('\t').first(), "length value");
 			}
-			ids.insert(parts[0], length);
+			ids.insert(line.constData(), tab==-1 ? line.length() : tab, length);
 		}
 
-		//open output stream
-		FastqOutfileStream outfile(getOutfile("out"), false);
-
-		//parse input and write output
+		//process batches in parallel and write them in input order
 		FastqFileStream stream(getInfile("in"));
-		FastqEntry entry;
+		BgzfOutfileStream outfile(getOutfile("out"), threads, Z_BEST_SPEED);
+		QList<QSharedPointer<ReadBatch> > batches;
+		QThreadPool pool; //declared after the batches, so that running workers are finished before the batches are deleted
+		pool.setMaxThreadCount(threads);
 		while (!stream.atEnd())
 		{
-			stream.readEntry(entry);
+			QSharedPointer<ReadBatch> batch(new ReadBatch());
+			stream.readBatch(batch->reads);
+			batch->done = 0;
+			batches << batch;
+			pool.start(new BatchWorker(*batch, ids, v));
 
-			QByteArray id = entry.header.trimmed();
-			id = id.mid(1);
-			int comment_start = id.indexOf(' ');
-			if (comment_start!=-1) id = id.left(comment_start);
-			int length = ids.value(id, -2);
-			if (length==-2) //id not in list
+			//limit number of batches in memory
+			while (batches.count()>2*threads)
 			{
-				if (!v) continue;
-
-				outfile.write(entry);
+				writeBatch(*(batches.takeFirst()), outfile);
 			}
-			else if (length==-1) //id is in list, but no length given
-			{
-				if (v) continue;
-
-				outfile.write(entry);
-			}
-			else if (length>=1) //id is in list and length given
-			{
-				if (v) continue;
+		}
+		while (!batches.isEmpty())
+		{
+			writeBatch(*(batches.takeFirst()), outfile);
+		}
+		outfile.close();
+	}
 
-				entry.bases.resize(length);
-				entry.qualities.resize(length);
-				outfile.write(entry);
-			}
+	///Waits until a batch is processed and writes it.
+	static void writeBatch(ReadBatch& batch, BgzfOutfileStream& outfile)
+	{
+		while (batch.done.load()==0)
+		{
+			QThread::msleep(1);
 		}
+
+		outfile.write(batch.output.constData(), batch.output.size());
 	}
 };
 
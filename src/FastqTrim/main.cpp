@@ -32,29 +32,32 @@ public:
 		const int end = getInt("end");
 		const int len = getInt("len");
 
-		//process
+		//process (in batches to avoid memory allocation per read)
 		FastqOutfileStream outstream(getOutfile("out"), false);
 		FastqFileStream stream( getInfile("in"), false);
-		FastqEntry entry;
+		FastqBatch batch;
 		while (!stream.atEnd())
 		{
-			stream.readEntry(entry);
-
-			if (start>0 || end>0)
+			stream.readBatch(batch);
+			for (int i=0; i<batch.count(); ++i)
 			{
-				const int len2 = entry.bases.count();
-				if (len2<=start+end) continue;
-				entry.bases = entry.bases.mid(start, len2-start-end);
-				entry.qualities = entry.qualities.mid(start, len2-start-end);
-			}
+				if (start>0 || end>0)
+				{
+					const int len2 = batch.length(i);
+					if (len2<=start+end)
+					{
+						batch.discard(i);
+						continue;
+					}
+					batch.trim(i, start, len2-start-end);
+				}
 
-			if (len>0 && entry.bases.count()>len)
-			{
-				entry.bases.resize(len);
-				entry.qualities.resize(len);
+				if (len>0 && batch.length(i)>len)
+				{
+					batch.trim(i, 0, len);
+				}
 			}
-
-			outstream.write(entry);
+			outstream.write(batch);
 		}
 	}
 };
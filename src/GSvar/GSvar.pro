@@ -31,7 +31,9 @@ SOURCES += main.cpp\
     GapDialog.cpp \
     GapValidationLabel.cpp \
     CnvWidget.cpp \
-    GeneSelectorDialog.cpp
+    GeneSelectorDialog.cpp \
+    VariantTableModel.cpp \
+    VariantListLoadWorker.cpp
 
 HEADERS  += MainWindow.h \
     FilterDockWidget.h \
@@ -57,7 +59,9 @@ HEADERS  += MainWindow.h \
     GapDialog.h \
     GapValidationLabel.h \
     CnvWidget.h \
-    GeneSelectorDialog.h
+    GeneSelectorDialog.h \
+    VariantTableModel.h \
+    VariantListLoadWorker.h
 
 
 FORMS    += MainWindow.ui \
@@ -2,6 +2,7 @@
 #include "ui_GapDialog.h"
 #include "NGSD.h"
 #include "Statistics.h"
+#include "CoverageFile.h"
 #include "ReportWorker.h"
 #include "Log.h"
 #include "Helper.h"
@@ -33,7 +34,7 @@ void GapDialog::process(QString bam_file, const BedFile& roi, QSet<QString> gene
 	if (!message.isEmpty())
 	{
 		Log::warn("Low-coverage statistics needs to be calculated. Pre-calulated gap file cannot be used because: " + message);
-		low_cov = Statistics::lowCoverage(roi, bam_file, cutoff);
+		low_cov = Statistics::lowCoverage(roi, CoverageFile::precalculated(bam_file), cutoff);
 	}
 
 	//show percentage of gaps
@@ -41,7 +42,7 @@ void GapDialog::process(QString bam_file, const BedFile& roi, QSet<QString> gene
 	ui->percentage->setText("Percentage of target region with depth&lt;" + QString::number(cutoff) + ": " + gap_perc + "%");
 
 	//calculate average coverage for gaps
-	Statistics::avgCoverage(low_cov, bam_file, 1, true);
+	Statistics::avgCoverage(low_cov, CoverageFile::precalculated(bam_file), 1, true);
 
 	//show gaps
 	ui->gaps->setRowCount(low_cov.count());
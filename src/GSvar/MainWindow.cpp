@@ -22,6 +22,7 @@
 #include <QProgressBar>
 #include <QToolButton>
 #include <QMimeData>
+#include <QHeaderView>
 #include "ReportWorker.h"
 #include "DBAnnotationWorker.h"
 #include "SampleInformationDialog.h"
@@ -52,6 +53,11 @@ MainWindow::MainWindow(QWidget *parent)
 	, filter_widget_(new FilterDockWidget(this))
 	, var_last_(-1)
 	, var_widget_(new VariantDetailsDockWidget(this))
+	, vars_model_(nullptr)
+	, vars_proxy_(nullptr)
+	, load_worker_(nullptr)
+	, load_progress_(new QProgressBar(this))
+	, load_cancel_(new QToolButton(this))
 	, busy_dialog_(nullptr)
 	, filename_()
 	, db_annos_updated_(false)
@@ -61,6 +67,21 @@ MainWindow::MainWindow(QWidget *parent)
 	//setup GUI
 	ui_.setupUi(this);
 	setWindowTitle(QCoreApplication::applicationName());
+	vars_model_ = new VariantTableModel(variants_, this);
+	vars_proxy_ = new VariantFilterProxyModel(this);
+	vars_proxy_->setSourceModel(vars_model_);
+	ui_.vars->setModel(vars_proxy_);
+	ui_.vars->verticalHeader()->setDefaultSectionSize(ui_.vars->fontMetrics().height() + 6);
+
+	//loading indicator (busy mode, as the progress of VariantList::load is unknown)
+	load_progress_->setRange(0, 0);
+	load_progress_->setMaximumWidth(150);
+	load_progress_->setVisible(false);
+	ui_.statusBar->addPermanentWidget(load_progress_);
+	load_cancel_->setText("Cancel");
+	load_cancel_->setVisible(false);
+	connect(load_cancel_, SIGNAL(clicked(bool)), this, SLOT(cancelLoading()));
+	ui_.statusBar->addPermanentWidget(load_cancel_);
 	addDockWidget(Qt::RightDockWidgetArea, filter_widget_);
 	filter_widget_->raise();
 	addDockWidget(Qt::BottomDockWidgetArea, var_widget_);
@@ -88,9 +109,9 @@ MainWindow::MainWindow(QWidget *parent)
 	connect(ui_.actionExit, SIGNAL(triggered()), this, SLOT(close()));
 	connect(ui_.vars, SIGNAL(customContextMenuRequested(QPoint)), this, SLOT(varsContextMenu(QPoint)));
 	connect(filter_widget_, SIGNAL(filtersChanged()), this, SLOT(filtersChanged()));
-	connect(ui_.vars, SIGNAL(itemSelectionChanged()), this, SLOT(updateVariantDetails()));
+	connect(ui_.vars->selectionModel(), SIGNAL(selectionChanged(QItemSelection,QItemSelection)), this, SLOT(updateVariantDetails()));
 	connect(&filewatcher_, SIGNAL(fileChanged()), this, SLOT(handleInputFileChange()));
-	connect(ui_.vars, SIGNAL(itemDoubleClicked(QTableWidgetItem*)), this, SLOT(variantDoubleClicked(QTableWidgetItem*)));
+	connect(ui_.vars, SIGNAL(doubleClicked(QModelIndex)), this, SLOT(variantDoubleClicked(QModelIndex)));
 	connect(ui_.actionDesignSubpanel, SIGNAL(triggered()), this, SLOT(openSubpanelDesignDialog()));
 
 	//misc initialization
@@ -230,11 +251,12 @@ void MainWindow::handleInputFileChange()
 	loadFile(filename_);
 }
 
-void MainWindow::variantDoubleClicked(QTableWidgetItem* item)
+void MainWindow::variantDoubleClicked(QModelIndex index)
 {
-	if (item==nullptr) return;
+	int row = variantIndex(index);
+	if (row==-1) return;
 
-	openInIGV(variants_[item->row()].toString());
+	openInIGV(variants_[row].toString());
 }
 
 void MainWindow::openInIGV(QString region)
@@ -390,9 +412,9 @@ QString MainWindow::targetFileName() const
 
 int MainWindow::guiColumnIndex(QString column) const
 {
-	for(int i=0; i<ui_.vars->columnCount(); ++i)
+	for(int i=0; i<vars_model_->columnCount(); ++i)
 	{
-		if (ui_.vars->horizontalHeaderItem(i)->text()==column)
+		if (vars_model_->headerData(i, Qt::Horizontal).toString()==column)
 		{
 			return i;
 		}
@@ -401,6 +423,13 @@ int MainWindow::guiColumnIndex(QString column) const
 	return -1;
 }
 
+int MainWindow::variantIndex(const QModelIndex& index) const
+{
+	if (!index.isValid()) return -1;
+
+	return vars_proxy_->mapToSource(index).row();
+}
+
 void MainWindow::addModelessDialog(QSharedPointer<QDialog> ptr)
 {
 	modeless_dialogs_.append(ptr);
@@ -498,19 +527,48 @@ void MainWindow::loadFile(QString filename)
 	filewatcher_.clearFile();
 	db_annos_updated_ = false;
 	igv_initialized_ = false;
-	ui_.vars->setRowCount(0);
-	ui_.vars->setColumnCount(0);
+	cancelLoading();
+	variants_.clear();
+	filter_cache_.clear();
+	vars_model_->variantListChanged();
 
 	if (filename=="") return;
 
-	//update recent files (before try block to remove non-existing files from the recent files menu)
+	//update recent files (before loading to remove non-existing files from the recent files menu)
 	addToRecentFiles(filename);
 
-	//load data
-	QApplication::setOverrideCursor(QCursor(Qt::BusyCursor));
+	//load data in background (the GUI stays responsive)
+	load_worker_ = new VariantListLoadWorker(filename);
+	connect(load_worker_, SIGNAL(finished(bool)), this, SLOT(loadingFinished(bool)));
+	ui_.statusBar->showMessage("Loading variant list " + filename + " ...");
+	load_progress_->setVisible(true);
+	load_cancel_->setVisible(true);
+	load_worker_->start();
+}
+
+void MainWindow::loadingFinished(bool success)
+{
+	VariantListLoadWorker* worker = qobject_cast<VariantListLoadWorker*>(sender());
+	worker->deleteLater();
+
+	//loading was cancelled or another file is loaded
+	if (worker!=load_worker_) return;
+	load_worker_ = nullptr;
+	load_progress_->setVisible(false);
+	load_cancel_->setVisible(false);
+
+	QString filename = worker->filename();
+	if (!success)
+	{
+		ui_.statusBar->clearMessage();
+		QMessageBox::warning(this, "Error", "Loading the file '" + filename + "' failed!\nError message:\n" + worker->errorMessage());
+		return;
+	}
+
 	try
 	{
-		variants_.load(filename);
+		variants_ = worker->variants();
+		filter_cache_.clear();
 		filter_widget_->setFilterColumns(variants_.filters());
 
 		//update data structures
@@ -523,12 +581,13 @@ void MainWindow::loadFile(QString filename)
 		ui_.statusBar->showMessage("Loaded variant list with " + QString::number(variants_.count()) + " variant.");
 
 		variantListChanged();
-		QApplication::restoreOverrideCursor();
 	}
 	catch(Exception& e)
 	{
-		QApplication::restoreOverrideCursor();
-		QMessageBox::warning(this, "Error", "Loading the file '" + filename + "' or displaying the contained variants failed!\nError message:\n" + e.message());
+		variants_.clear();
+		filter_cache_.clear();
+		vars_model_->variantListChanged();
+		QMessageBox::warning(this, "Error", "Displaying the variants of file '" + filename + "' failed!\nError message:\n" + e.message());
 	}
 
 	//warn if no 'filter' column is present
@@ -538,6 +597,17 @@ void MainWindow::loadFile(QString filename)
 	}
 }
 
+void MainWindow::cancelLoading()
+{
+	if (load_worker_==nullptr) return;
+
+	//the worker cannot be interrupted - it is deleted when finished and its result is discarded
+	load_worker_ = nullptr;
+	load_progress_->setVisible(false);
+	load_cancel_->setVisible(false);
+	ui_.statusBar->showMessage("Loading of variant list cancelled.");
+}
+
 void MainWindow::on_actionAbout_triggered()
 {
 	QMessageBox::about(this, "About " + QCoreApplication::applicationName(), QCoreApplication::applicationName()+ " " + QCoreApplication::applicationVersion()+ "\n\nA free viewing and filtering tool for genomic variants.\n\nInstitute of Medical Genetics and Applied Genomics\nUniversity Hospital Tübingen\nGermany\n\nMore information at:\nhttps://github.com/imgag/ngs-bits");
@@ -545,11 +615,11 @@ void MainWindow::on_actionAbout_triggered()
 
 void MainWindow::on_actionResize_triggered()
 {
+	//column widths are determined from a limited number of rows (see QHeaderView::resizeContentsPrecision), rows have a fixed height
 	ui_.vars->resizeColumnsToContents();
-	ui_.vars->resizeRowsToContents();
 
 	//limit column width
-	for (int i=0; i<ui_.vars->columnCount(); ++i)
+	for (int i=0; i<vars_model_->columnCount(); ++i)
 	{
 		int max = (i<6) ? 80 : 200;
 		if (ui_.vars->columnWidth(i)>max)
@@ -585,7 +655,7 @@ void MainWindow::on_actionReport_triggered()
 	QBitArray visible(variants_.count(), true);
 	for (int i=0; i<variants_.count(); ++i)
 	{
-		if(ui_.vars->isRowHidden(i))
+		if(!vars_proxy_->passing(i))
 		{
 			visible.setBit(i, false);
 		}
@@ -937,7 +1007,7 @@ void MainWindow::on_actionExportVCF_triggered()
 	output.copyMetaData(orig_vcf);
 	for(int i=0; i<variants_.count(); ++i)
 	{
-		if (!ui_.vars->isRowHidden(i))
+		if (vars_proxy_->passing(i))
 		{
 			int hit_count = 0;
 			const Variant& v = variants_[i];
@@ -999,7 +1069,7 @@ void MainWindow::on_actionExportGSvar_triggered()
 	output.copyMetaData(variants_);
 	for(int i=0; i<variants_.count(); ++i)
 	{
-		if (!ui_.vars->isRowHidden(i))
+		if (vars_proxy_->passing(i))
 		{
 			output.append(variants_[i]);
 		}
@@ -1139,8 +1209,9 @@ void MainWindow::on_actionCopySplit_triggered()
 void MainWindow::copyToClipboard(bool split_quality)
 {
 	//no selection
-	if (ui_.vars->selectedRanges().count()!=1) return;
-	QTableWidgetSelectionRange range = ui_.vars->selectedRanges()[0];
+	QItemSelection selection = ui_.vars->selectionModel()->selection();
+	if (selection.count()!=1) return;
+	QItemSelectionRange range = selection[0];
 
 	//check quality column is present
 	QStringList quality_keys;
@@ -1159,38 +1230,37 @@ void MainWindow::copyToClipboard(bool split_quality)
 
 	//copy header
 	QString selected_text = "";
-	if (range.rowCount()!=1)
+	if (range.height()!=1)
 	{
 		selected_text += "#";
-		for (int col=range.leftColumn(); col<=range.rightColumn(); ++col)
+		for (int col=range.left(); col<=range.right(); ++col)
 		{
-			if (col!=range.leftColumn()) selected_text.append("\t");
+			if (col!=range.left()) selected_text.append("\t");
 			if (split_quality && col==qual_index)
 			{
 				selected_text.append(quality_keys.join('\t'));
 			}
 			else
 			{
-				selected_text.append(ui_.vars->horizontalHeaderItem(col)->text());
+				selected_text.append(vars_model_->headerData(col, Qt::Horizontal).toString());
 			}
 		}
 	}
 
-	//copy rows
-	for (int row=range.topRow(); row<=range.bottomRow(); ++row)
+	//copy rows (filtered-out rows are not part of the view)
+	for (int view_row=range.top(); view_row<=range.bottom(); ++view_row)
 	{
-		//skip filtered-out rows
-		if (ui_.vars->isRowHidden(row)) continue;
+		int row = variantIndex(vars_proxy_->index(view_row, 0));
 
 		if (selected_text!="") selected_text.append("\n");
-		for (int col=range.leftColumn(); col<=range.rightColumn(); ++col)
+		for (int col=range.left(); col<=range.right(); ++col)
 		{
-			if (col!=range.leftColumn()) selected_text.append("\t");
+			if (col!=range.left()) selected_text.append("\t");
 			if (split_quality && col==qual_index)
 			{
 				QStringList quality_values;
 				for(int i=0; i<quality_keys.count(); ++i) quality_values.append("");
-				QStringList entries = ui_.vars->item(row, col)->text().split(';');
+				QStringList entries = vars_model_->data(vars_model_->index(row, col)).toString().split(';');
 				foreach(const QString& entry, entries)
 				{
 					QStringList key_value = entry.split('=');
@@ -1212,7 +1282,7 @@ void MainWindow::copyToClipboard(bool split_quality)
 			}
 			else
 			{
-				selected_text.append(ui_.vars->item(row, col)->text().replace('\n',' ').replace('\r',' '));
+				selected_text.append(vars_model_->data(vars_model_->index(row, col)).toString().replace('\n',' ').replace('\r',' '));
 			}
 		}
 	}
@@ -1308,149 +1378,11 @@ void MainWindow::variantListChanged()
 	//update variant details widget
 	var_last_ = -1;
 
-	//resize
-	ui_.vars->setRowCount(variants_.count());
-	ui_.vars->setColumnCount(5 + variants_.annotations().count());
-
-	//header
-	ui_.vars->setHorizontalHeaderItem(0, new QTableWidgetItem("chr"));
-	ui_.vars->setHorizontalHeaderItem(1, new QTableWidgetItem("start"));
-	ui_.vars->setHorizontalHeaderItem(2, new QTableWidgetItem("end"));
-	ui_.vars->setHorizontalHeaderItem(3, new QTableWidgetItem("ref"));
-	ui_.vars->setHorizontalHeaderItem(4, new QTableWidgetItem("obs"));
-	for (int i=0; i<variants_.annotations().count(); ++i)
-	{
-		QString anno = variants_.annotations()[i].name();
-		QTableWidgetItem* header = new QTableWidgetItem(anno);
-		QString add_desc = "";
-		if (anno=="filter")
-		{
-			auto it = variants_.filters().cbegin();
-			while (it!=variants_.filters().cend())
-			{
-				add_desc += "\n - "+it.key() + ": " + it.value();
-				++it;
-			}
-		}
-
-		QString header_desc = "";
-		VariantAnnotationDescription vad = variants_.annotationDescriptionByName(anno, false, false);
-		if(!vad.description().isNull())	header_desc = vad.description();
-
-		header->setToolTip(header_desc + add_desc);
-		ui_.vars->setHorizontalHeaderItem(i+5, header);
-	}
-
-	//content
-	int i_co_sp = variants_.annotationIndexByName("coding_and_splicing", true, false);
-	int i_validated = variants_.annotationIndexByName("validated", true, false);
-	int i_classification = variants_.annotationIndexByName("classification", true, false);
-	int i_comment = variants_.annotationIndexByName("comment", true, false);
-	int i_ihdb_hom = variants_.annotationIndexByName("ihdb_allsys_hom", true, false);
-	int i_ihdb_het = variants_.annotationIndexByName("ihdb_allsys_het", true, false);
-	int i_clinvar = variants_.annotationIndexByName("ClinVar", true, false);
-	int i_hgmd = variants_.annotationIndexByName("HGMD", true, false);
-	for (int i=0; i<variants_.count(); ++i)
-	{
-		const Variant& row = variants_[i];
-		ui_.vars->setItem(i, 0, new QTableWidgetItem(QString(row.chr().str())));
-		ui_.vars->setItem(i, 1, new QTableWidgetItem(QString::number(row.start())));
-		ui_.vars->setItem(i, 2, new QTableWidgetItem(QString::number(row.end())));
-		ui_.vars->setItem(i, 3, new QTableWidgetItem(row.ref(), 0));
-		ui_.vars->setItem(i, 4, new QTableWidgetItem(row.obs(), 0));
-		bool is_warning_line = false;
-		bool is_notice_line = false;
-		bool is_ok_line = false;
-		for (int j=0; j<row.annotations().count(); ++j)
-		{
-			QString anno = row.annotations().at(j);
-			QTableWidgetItem* item = new QTableWidgetItem(anno);
-
-			//warning
-			if (j==i_co_sp && anno.contains(":HIGH:"))
-			{
-				item->setBackgroundColor(Qt::red);
-				is_warning_line = true;
-			}
-			else if (j==i_classification && (anno=="3" || anno=="M"))
-			{
-				item->setBackgroundColor(QColor(255, 135, 60)); //orange
-				is_notice_line = true;
-			}
-			else if (j==i_classification && (anno=="4" || anno=="5"))
-			{
-				item->setBackgroundColor(Qt::red);
-				is_warning_line = true;
-			}
-			else if (j==i_clinvar && anno.contains("pathogenic")) //matches "pathogenic" and "likely pathogenic"
-			{
-				item->setBackgroundColor(Qt::red);
-				is_warning_line = true;
-			}
-			else if (j==i_hgmd && anno.contains("CLASS=DM")) //matches both "DM" and "DM?"
-			{
-				item->setBackgroundColor(Qt::red);
-				is_warning_line = true;
-			}
-
-			//non-pathogenic
-			if (j==i_classification && (anno=="0" || anno=="1" || anno=="2"))
-			{
-				item->setBackgroundColor(Qt::green);
-				is_ok_line = true;
-			}
-
-			//highlighed
-			if (j==i_validated && anno.contains("TP"))
-			{
-				item->setBackgroundColor(Qt::yellow);
-			}
-			else if (j==i_comment && anno!="")
-			{
-				item->setBackgroundColor(Qt::yellow);
-			}
-			else if (j==i_ihdb_hom && anno=="0")
-			{
-				item->setBackgroundColor(Qt::yellow);
-			}
-			else if (j==i_ihdb_het && anno=="0")
-			{
-				item->setBackgroundColor(Qt::yellow);
-			}
-			else if (j==i_clinvar && anno.contains("(confirmed)"))
-			{
-				item->setBackgroundColor(Qt::yellow);
-			}
+	//update table (cells are created on demand)
+	vars_model_->variantListChanged();
 
-
-			ui_.vars->setItem(i, 5+j, item);
-		}
-
-		//mark vertical header - warning (red), notice (orange)
-		if (is_notice_line && !is_ok_line)
-		{
-			QTableWidgetItem* item = new QTableWidgetItem(QString::number(i+1));
-			item->setForeground(QBrush(QColor(255, 135, 60)));
-			QFont font;
-			font.setWeight(QFont::Bold);
-			item->setFont(font);
-			ui_.vars->setVerticalHeaderItem(i, item);
-		}
-		else if (is_warning_line && !is_ok_line)
-		{
-			QTableWidgetItem* item = new QTableWidgetItem(QString::number(i+1));
-			item->setForeground(QBrush(Qt::red));
-			QFont font;
-			font.setWeight(QFont::Bold);
-			item->setFont(font);
-			ui_.vars->setVerticalHeaderItem(i, item);
-		}
-		else
-		{
-			QTableWidgetItem* item = ui_.vars->takeVerticalHeaderItem(i);
-			if (item) delete(item);
-		}
-	}
+	//annotations might have changed => cached filter results are invalid
+	filter_cache_.clear();
 
 	//resize cells
 	on_actionResize_triggered();
@@ -1465,9 +1397,9 @@ void MainWindow::variantListChanged()
 
 void MainWindow::varsContextMenu(QPoint pos)
 {
-	//get item
-	QTableWidgetItem* item = ui_.vars->itemAt(pos);
-	if (!item) return;
+	//get variant
+	int row = variantIndex(ui_.vars->indexAt(pos));
+	if (row==-1) return;
 
 	bool ngsd_enabled = Settings::boolean("NGSD_enabled", true);
 	bool primerdesign_enabled = (Settings::string("PrimerDesign")!="");
@@ -1484,7 +1416,7 @@ void MainWindow::varsContextMenu(QPoint pos)
 	sub_menu->addAction("Edit comment");
 
 	int i_gene = variants_.annotationIndexByName("gene", true, true);
-	QString gene_str = variants_[item->row()].annotations()[i_gene];
+	QString gene_str = variants_[row].annotations()[i_gene];
 	QStringList genes = gene_str.split(',', QString::SkipEmptyParts);
 	if (!genes.isEmpty())
 	{
@@ -1514,7 +1446,7 @@ void MainWindow::varsContextMenu(QPoint pos)
 	{
 		try
 		{
-			QString url = NGSD().url(filename_, variants_[item->row()]);
+			QString url = NGSD().url(filename_, variants_[row]);
 			QDesktopServices::openUrl(QUrl(url));
 		}
 		catch (DatabaseException& e)
@@ -1525,7 +1457,7 @@ void MainWindow::varsContextMenu(QPoint pos)
 	}
 	else if (text=="Search for position in NGSD")
 	{
-		const Variant& v = variants_[item->row()];
+		const Variant& v = variants_[row];
 		QString url = NGSD().urlSearch(v.chr().str() + ":" + QString::number(v.start()) + "-" + QString::number(v.end()));
 		QDesktopServices::openUrl(QUrl(url));
 	}
@@ -1533,17 +1465,17 @@ void MainWindow::varsContextMenu(QPoint pos)
 	{
 		try
 		{
-			ValidationDialog dlg(this, filename_, variants_[item->row()], variants_.annotationIndexByName("quality", true, true));
+			ValidationDialog dlg(this, filename_, variants_[row], variants_.annotationIndexByName("quality", true, true));
 
 			if (dlg.exec()) //update DB
 			{
-				NGSD().setValidationStatus(filename_, variants_[item->row()], dlg.info());
+				NGSD().setValidationStatus(filename_, variants_[row], dlg.info());
 
 				//update GUI
 				QByteArray status = dlg.info().status.toLatin1();
 				if (status=="true positive") status = "TP";
 				if (status=="false positive") status = "FP";
-				variants_[item->row()].annotations()[variants_.annotationIndexByName("validated", true, true)] = status;
+				variants_[row].annotations()[variants_.annotationIndexByName("validated", true, true)] = status;
 				variantListChanged();
 			}
 		}
@@ -1557,16 +1489,16 @@ void MainWindow::varsContextMenu(QPoint pos)
 	{
 		try
 		{
-			ClassificationDialog dlg(this, variants_[item->row()]);
+			ClassificationDialog dlg(this, variants_[row]);
 
 			if (dlg.exec())
 			{
 				//update DB
-					NGSD().setClassification(variants_[item->row()], dlg.classification(), dlg.comment());
+					NGSD().setClassification(variants_[row], dlg.classification(), dlg.comment());
 
 				//update GUI
-				variants_[item->row()].annotations()[variants_.annotationIndexByName("classification", true, true)] = dlg.classification().replace("n/a", "").toLatin1();
-				variants_[item->row()].annotations()[variants_.annotationIndexByName("classification_comment", true, true)] = dlg.comment().toLatin1();
+				variants_[row].annotations()[variants_.annotationIndexByName("classification", true, true)] = dlg.classification().replace("n/a", "").toLatin1();
+				variants_[row].annotations()[variants_.annotationIndexByName("classification_comment", true, true)] = dlg.comment().toLatin1();
 				variantListChanged();
 			}
 		}
@@ -1581,12 +1513,11 @@ void MainWindow::varsContextMenu(QPoint pos)
 		try
 		{
 			bool ok = true;
-			QByteArray text = QInputDialog::getMultiLineText(this, "Variant comment", "Text: ", NGSD().comment(filename_, variants_[item->row()]), &ok).toUtf8();
+			QByteArray text = QInputDialog::getMultiLineText(this, "Variant comment", "Text: ", NGSD().comment(filename_, variants_[row]), &ok).toUtf8();
 
 			if (ok)
 			{
 				//update DB
-				int row = item->row();
 				NGSD().setComment(filename_, variants_[row], text);
 
 				//get annotation text (from NGSD to get comments of other samples as well)
@@ -1595,18 +1526,12 @@ void MainWindow::varsContextMenu(QPoint pos)
 				NGSD().annotate(tmp, filename_);
 				text = tmp[0].annotations()[tmp.annotationIndexByName("comment", true, true)];
 
-				//update datastructure (if comment column is present)
+				//update datastructure and GUI (if comment column is present)
 				int col_index = variants_.annotationIndexByName("comment", true, false);
 				if (col_index!=-1)
 				{
 					variants_[row].annotations()[col_index] = text;
-				}
-
-				//update GUI (if column is present)
-				int gui_index = guiColumnIndex("comment");
-				if (gui_index!=-1)
-				{
-					ui_.vars->item(item->row(), gui_index)->setText(text);
+					vars_model_->variantChanged(row);
 					var_widget_->updateVariant(variants_, row);
 				}
 			}
@@ -1621,7 +1546,7 @@ void MainWindow::varsContextMenu(QPoint pos)
 	{
 		try
 		{
-			const Variant& v = variants_[item->row()];
+			const Variant& v = variants_[row];
 			QString url = Settings::string("PrimerDesign")+"/index.php?user="+Helper::userName()+"&sample="+NGSD::sampleName(filename_)+"&chr="+v.chr().str()+"&start="+QString::number(v.start())+"&end="+QString::number(v.end())+"";
 			QDesktopServices::openUrl(QUrl(url));
 		}
@@ -1635,7 +1560,7 @@ void MainWindow::varsContextMenu(QPoint pos)
 	{
 		try
 		{
-			uploadtoLovd(item->row());
+			uploadtoLovd(row);
 		}
 		catch (Exception& e)
 		{
@@ -1655,8 +1580,8 @@ void MainWindow::updateVariantDetails()
 	if (!var_widget_->isVisible()) return;
 
 	//determine variant (first in first range)
-	auto ranges = ui_.vars->selectedRanges();
-	if (ranges.count()!=1 || ranges[0].rowCount()!=1)
+	QItemSelection ranges = ui_.vars->selectionModel()->selection();
+	if (ranges.count()!=1 || ranges[0].height()!=1)
 	{
 		var_last_ = -1;
 		var_widget_->clear();
@@ -1664,7 +1589,7 @@ void MainWindow::updateVariantDetails()
 	}
 
 	//display variant details
-	int row = ranges[0].topRow();
+	int row = variantIndex(ranges[0].topLeft());
 	if (row!=var_last_)
 	{
 		var_widget_->updateVariant(variants_, row);
@@ -1775,103 +1700,152 @@ void MainWindow::filtersChanged()
 		QTime timer;
 		timer.start();
 
+		//the mask of each filter step is cached by its parameters, i.e. only changed steps are re-calculated
+		if (filter_cache_.count()>100) filter_cache_.clear();
+		QBitArray pass(variants_.count(), true);
+
 		//main filters
-		VariantFilter filter(variants_);
 		if (filter_widget_->applyMaf())
 		{
 			double max_af = filter_widget_->mafPerc() / 100.0;
-			filter.flagByAllelFrequency(max_af);
+			QString key = "maf=" + QString::number(max_af);
+			if (!filter_cache_.contains(key))
+			{
+				VariantFilter filter(variants_);
+				filter.flagByAllelFrequency(max_af);
+				filter_cache_[key] = filter.flags();
+			}
+			pass &= filter_cache_[key];
 		}
 		if (filter_widget_->applyImpact())
 		{
-			filter.flagByImpact(filter_widget_->impact());
+			QString key = "impact=" + filter_widget_->impact().join(",");
+			if (!filter_cache_.contains(key))
+			{
+				VariantFilter filter(variants_);
+				filter.flagByImpact(filter_widget_->impact());
+				filter_cache_[key] = filter.flags();
+			}
+			pass &= filter_cache_[key];
 		}
 		if (filter_widget_->applyIhdb())
 		{
-			filter.flagByIHDB(filter_widget_->ihdb(), filter_widget_->ihdbIgnoreGenotype());
+			QString key = "ihdb=" + QString::number(filter_widget_->ihdb()) + "/" + QString::number(filter_widget_->ihdbIgnoreGenotype());
+			if (!filter_cache_.contains(key))
+			{
+				VariantFilter filter(variants_);
+				filter.flagByIHDB(filter_widget_->ihdb(), filter_widget_->ihdbIgnoreGenotype());
+				filter_cache_[key] = filter.flags();
+			}
+			pass &= filter_cache_[key];
 		}
 		QStringList remove = filter_widget_->filterColumnsRemove();
 		if (remove.count()>0)
 		{
-			filter.flagByFilterColumnMatching(remove);
+			QString key = "filter_remove=" + remove.join(",");
+			if (!filter_cache_.contains(key))
+			{
+				VariantFilter filter(variants_);
+				filter.flagByFilterColumnMatching(remove);
+				filter_cache_[key] = filter.flags();
+			}
+			pass &= filter_cache_[key];
 		}
 
 		//filter columns (keep)
 		QStringList keep = filter_widget_->filterColumnsKeep();
 		if (keep.count()>0)
-        {
-			for(int i=0; i<variants_.count(); ++i)
+		{
+			QString key = "filter_keep=" + keep.join(",");
+			if (!filter_cache_.contains(key))
 			{
-				if (filter.flags()[i]) continue;
-
-				foreach(const QByteArray& f, variants_[i].filters())
+				QBitArray mask(variants_.count(), false);
+				for(int i=0; i<variants_.count(); ++i)
 				{
-					if (keep.contains(f)) filter.flags()[i] = true;
+					foreach(const QByteArray& f, variants_[i].filters())
+					{
+						if (keep.contains(f)) mask[i] = true;
+					}
 				}
+				filter_cache_[key] = mask;
 			}
+			pass |= filter_cache_[key];
 		}
 
 		//remove variants with low classification
 		if (filter_widget_->applyClassification())
 		{
-			filter.flagByClassification(filter_widget_->classification());
+			QString key = "class=" + QString::number(filter_widget_->classification());
+			if (!filter_cache_.contains(key))
+			{
+				VariantFilter filter(variants_);
+				filter.flagByClassification(filter_widget_->classification());
+				filter_cache_[key] = filter.flags();
+			}
+			pass &= filter_cache_[key];
 		}
 
 		//prevent class>=X variants from beeing filtered out by any filter (except region/gene filters)
 		if (filter_widget_->keepClassGreaterEqual()!=-1)
 		{
-			int i_class = variants_.annotationIndexByName("classification", true, true);
 			int min_class = filter_widget_->keepClassGreaterEqual();
-			for(int i=0; i<variants_.count(); ++i)
+			QString key = "class_keep=" + QString::number(min_class);
+			if (!filter_cache_.contains(key))
 			{
-				if (filter.flags()[i]) continue;
-
-				bool ok = false;
-				int classification_value = variants_[i].annotations()[i_class].toInt(&ok);
-				if (!ok) continue;
+				int i_class = variants_.annotationIndexByName("classification", true, true);
+				QBitArray mask(variants_.count(), false);
+				for(int i=0; i<variants_.count(); ++i)
+				{
+					bool ok = false;
+					int classification_value = variants_[i].annotations()[i_class].toInt(&ok);
+					if (!ok) continue;
 
-				filter.flags()[i] = (classification_value>=min_class);
+					mask[i] = (classification_value>=min_class);
+				}
+				filter_cache_[key] = mask;
 			}
+			pass |= filter_cache_[key];
 		}
 
 		//prevent class M variants from beeing filtered out by any filter (except region/gene filters)
 		if (filter_widget_->keepClassM())
 		{
-			int i_class = variants_.annotationIndexByName("classification", true, true);
-			for(int i=0; i<variants_.count(); ++i)
+			QString key = "class_keep=M";
+			if (!filter_cache_.contains(key))
 			{
-				if (filter.flags()[i]) continue;
-
-				filter.flags()[i] = (variants_[i].annotations()[i_class]=="M");
+				int i_class = variants_.annotationIndexByName("classification", true, true);
+				QBitArray mask(variants_.count(), false);
+				for(int i=0; i<variants_.count(); ++i)
+				{
+					mask[i] = (variants_[i].annotations()[i_class]=="M");
+				}
+				filter_cache_[key] = mask;
 			}
-        }
+			pass |= filter_cache_[key];
+		}
 
-        //filter columns (filter)
+		//filter columns (filter)
 		QStringList filter_cols = filter_widget_->filterColumnsFilter();
 		if (filter_cols.count()>0)
-        {
-            for(int i=0; i<variants_.count(); ++i)
-            {
-				if (!filter.flags()[i]) continue;
-
-                const QList<QByteArray>& filters = variants_[i].filters();
-                if(filters.isEmpty())
-                {
-					filter.flags()[i] = false;
-                    continue;
-                }
-
-                bool keep = false;
-                foreach(const QByteArray& f, filters)
-                {
-					if (filter_cols.contains(f)) keep = true;
-                }
-				filter.flags()[i] = keep;
-            }
-        }
+		{
+			QString key = "filter_filter=" + filter_cols.join(",");
+			if (!filter_cache_.contains(key))
+			{
+				QBitArray mask(variants_.count(), false);
+				for(int i=0; i<variants_.count(); ++i)
+				{
+					foreach(const QByteArray& f, variants_[i].filters())
+					{
+						if (filter_cols.contains(f)) mask[i] = true;
+					}
+				}
+				filter_cache_[key] = mask;
+			}
+			pass &= filter_cache_[key];
+		}
 
-        Log::perf("Applying annotation filter took ", timer);
-        timer.start();
+		Log::perf("Applying annotation filter took ", timer);
+		timer.start();
 
 		//roi changed
 		QString roi = filter_widget_->targetRegion();
@@ -1891,7 +1865,14 @@ void MainWindow::filtersChanged()
 		//roi filter
 		if (roi!="")
 		{
-			filter.flagByRegions(last_roi_);
+			QString key = "roi=" + roi;
+			if (!filter_cache_.contains(key))
+			{
+				VariantFilter filter(variants_);
+				filter.flagByRegions(last_roi_);
+				filter_cache_[key] = filter.flags();
+			}
+			pass &= filter_cache_[key];
 			Log::perf("Applying target region filter took ", timer);
 			timer.start();
 		}
@@ -1900,7 +1881,14 @@ void MainWindow::filtersChanged()
 		QStringList genes_filter = filter_widget_->genes();
 		if (!genes_filter.empty())
 		{
-			filter.flagByGenes(genes_filter);
+			QString key = "genes=" + genes_filter.join(",");
+			if (!filter_cache_.contains(key))
+			{
+				VariantFilter filter(variants_);
+				filter.flagByGenes(genes_filter);
+				filter_cache_[key] = filter.flags();
+			}
+			pass &= filter_cache_[key];
 			Log::perf("Applying gene filter took ", timer);
 			timer.start();
 		}
@@ -1909,15 +1897,25 @@ void MainWindow::filtersChanged()
 		BedLine region = BedLine::fromString(filter_widget_->region());
 		if (region.isValid())
 		{
-			filter.flagByRegion(region);
+			QString key = "region=" + filter_widget_->region();
+			if (!filter_cache_.contains(key))
+			{
+				VariantFilter filter(variants_);
+				filter.flagByRegion(region);
+				filter_cache_[key] = filter.flags();
+			}
+			pass &= filter_cache_[key];
 			Log::perf("Applying region filter took ", timer);
 			timer.start();
 		}
 
-		//apply compound-heterozygous filter
+		//apply compound-heterozygous filter (depends on the variants passing the previous filters, thus not cached)
 		if (filter_widget_->applyCompoundHet())
 		{
+			VariantFilter filter(variants_);
+			filter.flags() = pass;
 			filter.flagCompoundHeterozygous();
+			pass = filter.flags();
 			Log::perf("Applying compound-heterozygous filter took ", timer);
 			timer.start();
 		}
@@ -1925,28 +1923,23 @@ void MainWindow::filtersChanged()
 		//genotype filter
 		if (filter_widget_->applyGenotype())
 		{
-			filter.flagByGenotype(filter_widget_->genotype());
+			QString key = "genotype=" + filter_widget_->genotype();
+			if (!filter_cache_.contains(key))
+			{
+				VariantFilter filter(variants_);
+				filter.flagByGenotype(filter_widget_->genotype());
+				filter_cache_[key] = filter.flags();
+			}
+			pass &= filter_cache_[key];
 		}
 
 		//update GUI
 		timer.start();
-		ui_.vars->setUpdatesEnabled(false);
-		for(int i=0; i<variants_.count(); ++i)
-		{
-			if (filter.flags()[i])
-			{
-				ui_.vars->showRow(i);
-			}
-			else
-			{
-				ui_.vars->hideRow(i);
-			}
-		}
-		ui_.vars->setUpdatesEnabled(true);
+		vars_proxy_->setPassing(pass);
 		Log::perf("Applying filter results to GUI took ", timer);
 
 		//update status bar
-		QString status = QString::number(filter.countPassing()) + " of " + QString::number(variants_.count()) + " variants passed filters.";
+		QString status = QString::number(pass.count(true)) + " of " + QString::number(variants_.count()) + " variants passed filters.";
 		ui_.statusBar->showMessage(status);
 	}
 	catch(Exception& e)
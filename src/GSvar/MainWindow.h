@@ -3,6 +3,9 @@
 
 #include <QMainWindow>
 #include <QTimer>
+#include <QHash>
+#include <QProgressBar>
+#include <QToolButton>
 #include "ui_MainWindow.h"
 #include "VariantList.h"
 #include "FilterDockWidget.h"
@@ -12,6 +15,8 @@
 #include "NGSD.h"
 #include "FileWatcher.h"
 #include "BusyDialog.h"
+#include "VariantTableModel.h"
+#include "VariantListLoadWorker.h"
 
 ///Main window class
 class MainWindow
@@ -56,6 +61,8 @@ public:
 	QString targetFileName() const;
 	///Returns the index of a colum in the GUI (or -1 if the column does not exist)
 	int guiColumnIndex(QString column) const;
+	///Returns the variant index of a table index (or -1 if the index is invalid)
+	int variantIndex(const QModelIndex& index) const;
 
 public slots:
 	///Open dialog
@@ -135,6 +142,10 @@ public slots:
 	void reportGenerationFinished(bool success);
 	///Finished NGSD annotation
 	void databaseAnnotationFinished(bool success);
+	///Finished loading of a variant list in the background
+	void loadingFinished(bool success);
+	///Cancels the loading of a variant list (the result of the running worker is discarded)
+	void cancelLoading();
 	///Shows the variant list contect menu
 	void varsContextMenu(QPoint pos);
 	///Updated the variant context menu
@@ -148,7 +159,7 @@ public slots:
 	///Handles the re-loading the variant list when the file changes.
 	void handleInputFileChange();
 	///A variant has been double-clicked > open in IGV
-	void variantDoubleClicked(QTableWidgetItem* item);
+	void variantDoubleClicked(QModelIndex index);
 	///Open region in IGV
 	void openInIGV(QString region);
 
@@ -181,6 +192,11 @@ private:
 	FilterDockWidget* filter_widget_;
 	int var_last_;
 	VariantDetailsDockWidget* var_widget_;
+	VariantTableModel* vars_model_;
+	VariantFilterProxyModel* vars_proxy_;
+	VariantListLoadWorker* load_worker_;
+	QProgressBar* load_progress_;
+	QToolButton* load_cancel_;
 	BusyDialog* busy_dialog_;
 
 	//DATA
@@ -193,6 +209,7 @@ private:
 	QSet<int> link_indices_;
 	QString last_roi_filename_;
 	BedFile last_roi_;
+	QHash<QString, QBitArray> filter_cache_; //filter step masks by step parameters (cleared when the variant list changes)
 	QString last_report_path_;
 	QMap<QString, QString> preferred_transcripts_;
 	QList<QSharedPointer<QDialog>> modeless_dialogs_;
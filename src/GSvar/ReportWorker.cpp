@@ -6,6 +6,7 @@
 #include <QTextStream>
 #include <QFileInfo>
 #include "Statistics.h"
+#include "CoverageFile.h"
 #include "Settings.h"
 #include "BedFile.h"
 #include "ChromosomalIndex.h"
@@ -182,7 +183,7 @@ BedFile ReportWorker::writeCoverageReport(QTextStream& stream, QString bam_file,
 	if (!message.isEmpty())
 	{
 		Log::warn("Low-coverage statistics needs to be calculated. Pre-calulated gap file cannot be used because: " + message);
-		low_cov = Statistics::lowCoverage(roi, bam_file, min_cov);
+		low_cov = Statistics::lowCoverage(roi, CoverageFile::precalculated(bam_file), min_cov);
 	}
 
 	//annotate low-coverage regions with gene names
@@ -297,7 +298,7 @@ void ReportWorker::writeCoverageReportCCDS(QTextStream& stream, QString bam_file
 		if (!message.isEmpty())
 		{
 			Log::warn("Low-coverage statistics for transcript " + transcript.name() + " needs to be calculated. Pre-calulated gap file cannot be used because: " + message);
-			gaps = Statistics::lowCoverage(transcript.regions(), bam_file, min_cov);
+			gaps = Statistics::lowCoverage(transcript.regions(), CoverageFile::precalculated(bam_file), min_cov);
 		}
 
 		long long bases_transcipt = transcript.regions().baseCount();
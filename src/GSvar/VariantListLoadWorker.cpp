@@ -0,0 +1,29 @@
+#include "VariantListLoadWorker.h"
+#include "Exceptions.h"
+
+VariantListLoadWorker::VariantListLoadWorker(QString filename)
+	: WorkerBase("Variant list loading")
+	, filename_(filename)
+	, variants_()
+{
+}
+
+void VariantListLoadWorker::process()
+{
+	try
+	{
+		variants_.load(filename_);
+	}
+	catch (Exception& e)
+	{
+		error_message_ = e.message();
+	}
+	catch(std::exception& e)
+	{
+		error_message_ = e.what();
+	}
+	catch(...)
+	{
+		error_message_ = "Unknown exception!";
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef VARIANTLISTLOADWORKER_H
+#define VARIANTLISTLOADWORKER_H
+
+#include <QString>
+#include "VariantList.h"
+#include "WorkerBase.h"
+
+///Worker that loads a variant list in the background.
+class VariantListLoadWorker
+		: public WorkerBase
+{
+	Q_OBJECT
+
+public:
+	VariantListLoadWorker(QString filename);
+	virtual void process();
+
+	///Returns the input file name.
+	QString filename() const
+	{
+		return filename_;
+	}
+	///Returns the loaded variant list.
+	VariantList& variants()
+	{
+		return variants_;
+	}
+
+private:
+	QString filename_;
+	VariantList variants_;
+};
+
+#endif
+
+
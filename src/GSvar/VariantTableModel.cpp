@@ -0,0 +1,247 @@
+#include "VariantTableModel.h"
+#include <QColor>
+#include <QBrush>
+#include <QFont>
+
+VariantTableModel::VariantTableModel(const VariantList& variants, QObject* parent)
+	: QAbstractTableModel(parent)
+	, variants_(variants)
+	, i_co_sp_(-1)
+	, i_validated_(-1)
+	, i_classification_(-1)
+	, i_comment_(-1)
+	, i_ihdb_hom_(-1)
+	, i_ihdb_het_(-1)
+	, i_clinvar_(-1)
+	, i_hgmd_(-1)
+{
+}
+
+void VariantTableModel::variantListChanged()
+{
+	beginResetModel();
+	i_co_sp_ = variants_.annotationIndexByName("coding_and_splicing", true, false);
+	i_validated_ = variants_.annotationIndexByName("validated", true, false);
+	i_classification_ = variants_.annotationIndexByName("classification", true, false);
+	i_comment_ = variants_.annotationIndexByName("comment", true, false);
+	i_ihdb_hom_ = variants_.annotationIndexByName("ihdb_allsys_hom", true, false);
+	i_ihdb_het_ = variants_.annotationIndexByName("ihdb_allsys_het", true, false);
+	i_clinvar_ = variants_.annotationIndexByName("ClinVar", true, false);
+	i_hgmd_ = variants_.annotationIndexByName("HGMD", true, false);
+	endResetModel();
+}
+
+void VariantTableModel::variantChanged(int index)
+{
+	emit dataChanged(this->index(index, 0), this->index(index, columnCount()-1));
+	emit headerDataChanged(Qt::Vertical, index, index);
+}
+
+int VariantTableModel::rowCount(const QModelIndex& parent) const
+{
+	if (parent.isValid()) return 0;
+
+	return variants_.count();
+}
+
+int VariantTableModel::columnCount(const QModelIndex& parent) const
+{
+	if (parent.isValid() || variants_.count()==0) return 0;
+
+	return 5 + variants_.annotations().count();
+}
+
+QVariant VariantTableModel::data(const QModelIndex& index, int role) const
+{
+	if (!index.isValid()) return QVariant();
+
+	const Variant& v = variants_[index.row()];
+	const int col = index.column();
+
+	if (role==Qt::DisplayRole)
+	{
+		switch(col)
+		{
+			case 0: return QString(v.chr().str());
+			case 1: return QString::number(v.start());
+			case 2: return QString::number(v.end());
+			case 3: return QString(v.ref());
+			case 4: return QString(v.obs());
+			default: return QString(v.annotations()[col-5]);
+		}
+	}
+	else if (role==Qt::BackgroundRole && col>=5)
+	{
+		bool is_warning = false;
+		bool is_notice = false;
+		bool is_ok = false;
+		QColor color = annotationColor(col-5, v.annotations()[col-5], is_warning, is_notice, is_ok);
+		if (color.isValid()) return QBrush(color);
+	}
+
+	return QVariant();
+}
+
+QVariant VariantTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if (orientation==Qt::Horizontal)
+	{
+		if (section<0 || section>=columnCount()) return QVariant();
+
+		if (role==Qt::DisplayRole)
+		{
+			static const QStringList columns = QStringList() << "chr" << "start" << "end" << "ref" << "obs";
+			if (section<5) return columns[section];
+			return variants_.annotations()[section-5].name();
+		}
+		else if (role==Qt::ToolTipRole && section>=5)
+		{
+			QString anno = variants_.annotations()[section-5].name();
+			QString add_desc = "";
+			if (anno=="filter")
+			{
+				auto it = variants_.filters().cbegin();
+				while (it!=variants_.filters().cend())
+				{
+					add_desc += "\n - "+it.key() + ": " + it.value();
+					++it;
+				}
+			}
+
+			QString header_desc = "";
+			VariantAnnotationDescription vad = variants_.annotationDescriptionByName(anno, false, false);
+			if(!vad.description().isNull())	header_desc = vad.description();
+
+			return header_desc + add_desc;
+		}
+	}
+	else
+	{
+		if (section<0 || section>=rowCount()) return QVariant();
+
+		if (role==Qt::DisplayRole)
+		{
+			return QString::number(section+1);
+		}
+		else if (role==Qt::ForegroundRole)
+		{
+			//mark vertical header - warning (red), notice (orange)
+			LineState state = lineState(section);
+			if (state==NOTICE) return QBrush(QColor(255, 135, 60));
+			if (state==WARNING) return QBrush(Qt::red);
+		}
+		else if (role==Qt::FontRole)
+		{
+			if (lineState(section)!=NONE)
+			{
+				QFont font;
+				font.setWeight(QFont::Bold);
+				return font;
+			}
+		}
+	}
+
+	return QVariant();
+}
+
+QColor VariantTableModel::annotationColor(int j, const QByteArray& anno, bool& is_warning, bool& is_notice, bool& is_ok) const
+{
+	QColor color;
+
+	//warning
+	if (j==i_co_sp_ && anno.contains(":HIGH:"))
+	{
+		color = Qt::red;
+		is_warning = true;
+	}
+	else if (j==i_classification_ && (anno=="3" || anno=="M"))
+	{
+		color = QColor(255, 135, 60); //orange
+		is_notice = true;
+	}
+	else if (j==i_classification_ && (anno=="4" || anno=="5"))
+	{
+		color = Qt::red;
+		is_warning = true;
+	}
+	else if (j==i_clinvar_ && anno.contains("pathogenic")) //matches "pathogenic" and "likely pathogenic"
+	{
+		color = Qt::red;
+		is_warning = true;
+	}
+	else if (j==i_hgmd_ && anno.contains("CLASS=DM")) //matches both "DM" and "DM?"
+	{
+		color = Qt::red;
+		is_warning = true;
+	}
+
+	//non-pathogenic
+	if (j==i_classification_ && (anno=="0" || anno=="1" || anno=="2"))
+	{
+		color = Qt::green;
+		is_ok = true;
+	}
+
+	//highlighed
+	if (j==i_validated_ && anno.contains("TP"))
+	{
+		color = Qt::yellow;
+	}
+	else if (j==i_comment_ && anno!="")
+	{
+		color = Qt::yellow;
+	}
+	else if (j==i_ihdb_hom_ && anno=="0")
+	{
+		color = Qt::yellow;
+	}
+	else if (j==i_ihdb_het_ && anno=="0")
+	{
+		color = Qt::yellow;
+	}
+	else if (j==i_clinvar_ && anno.contains("(confirmed)"))
+	{
+		color = Qt::yellow;
+	}
+
+	return color;
+}
+
+VariantTableModel::LineState VariantTableModel::lineState(int row) const
+{
+	bool is_warning = false;
+	bool is_notice = false;
+	bool is_ok = false;
+
+	//only the columns used for coloring are checked
+	const QList<QByteArray>& annos = variants_[row].annotations();
+	QList<int> indices;
+	indices << i_co_sp_ << i_classification_ << i_clinvar_ << i_hgmd_;
+	foreach(int j, indices)
+	{
+		if (j<0 || j>=annos.count()) continue;
+		annotationColor(j, annos[j], is_warning, is_notice, is_ok);
+	}
+
+	if (is_ok) return NONE;
+	if (is_notice) return NOTICE;
+	if (is_warning) return WARNING;
+	return NONE;
+}
+
+VariantFilterProxyModel::VariantFilterProxyModel(QObject* parent)
+	: QSortFilterProxyModel(parent)
+{
+	setDynamicSortFilter(false);
+}
+
+void VariantFilterProxyModel::setPassing(const QBitArray& passing)
+{
+	passing_ = passing;
+	invalidateFilter();
+}
+
+bool VariantFilterProxyModel::filterAcceptsRow(int source_row, const QModelIndex& /*source_parent*/) const
+{
+	return passing(source_row);
+}
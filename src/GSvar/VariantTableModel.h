@@ -0,0 +1,85 @@
+#ifndef VARIANTTABLEMODEL_H
+#define VARIANTTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QSortFilterProxyModel>
+#include <QBitArray>
+#include "VariantList.h"
+
+///Table model of a variant list. Cell texts and colors are created on demand, i.e. only for visible cells.
+class VariantTableModel
+	: public QAbstractTableModel
+{
+	Q_OBJECT
+
+public:
+	///Constructor. The variant list has to exist as long as the model.
+	VariantTableModel(const VariantList& variants, QObject* parent = 0);
+
+	///Resets the model after the variant list was loaded or modified.
+	void variantListChanged();
+	///Updates the view after the annotations of one variant were modified.
+	void variantChanged(int index);
+
+	int rowCount(const QModelIndex& parent = QModelIndex()) const;
+	int columnCount(const QModelIndex& parent = QModelIndex()) const;
+	QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+protected:
+	///Line highlighting in the vertical header.
+	enum LineState
+	{
+		NONE,
+		NOTICE,
+		WARNING
+	};
+
+	const VariantList& variants_;
+
+	//annotation indices used for coloring
+	int i_co_sp_;
+	int i_validated_;
+	int i_classification_;
+	int i_comment_;
+	int i_ihdb_hom_;
+	int i_ihdb_het_;
+	int i_clinvar_;
+	int i_hgmd_;
+
+	///Returns the background color of an annotation cell (invalid color if not highlighted). The flags are set if the cell implies the corresponding line state.
+	QColor annotationColor(int anno_index, const QByteArray& anno, bool& is_warning, bool& is_notice, bool& is_ok) const;
+	///Returns the highlighting of a variant in the vertical header.
+	LineState lineState(int row) const;
+};
+
+///Proxy model that shows only the variants that passed the filters.
+class VariantFilterProxyModel
+	: public QSortFilterProxyModel
+{
+	Q_OBJECT
+
+public:
+	///Constructor.
+	VariantFilterProxyModel(QObject* parent = 0);
+
+	///Sets the filter result, i.e. the variants that are shown.
+	void setPassing(const QBitArray& passing);
+	///Returns if a variant (source row) passed the filters. Variants not covered by the filter result are shown.
+	bool passing(int source_row) const
+	{
+		return source_row>=passing_.count() || passing_.testBit(source_row);
+	}
+	///Returns the filter result.
+	const QBitArray& passing() const
+	{
+		return passing_;
+	}
+
+protected:
+	QBitArray passing_;
+
+	bool filterAcceptsRow(int source_row, const QModelIndex& source_parent) const;
+};
+
+#endif // VARIANTTABLEMODEL_H
@@ -28,6 +28,7 @@ public:
 		addFlag("txt", "Writes TXT format instead of qcML.");
 		addInt("min_mapq", "Minmum mapping quality to consider a read mapped.", true, 1);
 		addFlag("3exons", "Adds special QC terms estimating the sequencing error on reads from three exons.");
+		addInt("threads", "Number of threads used for BAM decompression.", true, 1);
 
 		//changelog
 		changeLog(2016, 12, 20, "Added support for spliced RNA reads (relevant e.g. for insert size)");
@@ -41,6 +42,7 @@ public:
         bool rna = getFlag("rna");
 		QString in = getInfile("in");
 		int min_maqp = getInt("min_mapq");
+		int threads = getInt("threads");
 
         // check that just one of roi_file, wgs, rna is set
         int parameters_set =  (roi_file!="" ? 1 : 0) +  wgs + rna;
@@ -53,14 +55,14 @@ public:
 		QCCollection metrics;
 		if (wgs)
         {
-			metrics = Statistics::mapping(in, min_maqp);
+			metrics = Statistics::mapping(in, min_maqp, threads);
 
 			//parameters
 			parameters << "-wgs";
 		}
         else if(rna)
 		{
-            metrics = Statistics::mapping_rna(in, min_maqp);
+            metrics = Statistics::mapping_rna(in, min_maqp, threads);
 
             //parameters
             parameters << "-rna";
@@ -73,7 +75,7 @@ public:
 			roi.merge();
 
 			//calculate metrics
-			metrics = Statistics::mapping(roi, in, min_maqp);
+			metrics = Statistics::mapping(roi, in, min_maqp, threads);
 
 			//parameters
 			parameters << "-roi" << QFileInfo(roi_file).fileName();
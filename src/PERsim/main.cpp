@@ -3,14 +3,225 @@
 #include "Helper.h"
 #include "NGSHelper.h"
 #include "FastqFileStream.h"
+#include "BgzfFileStream.h"
 #include "BedFile.h"
 #include "Settings.h"
 #include "FastaFileIndex.h"
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QThread>
+#include <QThreadPool>
 #include <chrono>
 #include <random>
 
-#include "api/BamReader.h"
-using namespace BamTools;
+///Simulation parameters shared by all jobs.
+struct SimulationParameters
+{
+	int length;
+	int ins_mean;
+	int ins_stdev;
+	double error;
+	int max_n;
+	QByteArray a1;
+	QByteArray a2;
+	QByteArray qualities;
+	bool verbose;
+	unsigned seed;
+};
+
+///Simulation job: read pairs that overlap one tile of a target region.
+struct SimulationJob
+{
+	BedLine tile;
+	long count;
+	int index; //job index (used to seed the random number generator of the job)
+	int region; //index of the target region
+	bool region_first; //first job of the target region
+	bool region_last; //last job of the target region
+	QByteArray out1;
+	QByteArray out2;
+	QByteArray log;
+	int skipped_n;
+	QString error;
+	QAtomicInt done;
+};
+
+///Worker that simulates the read pairs of a job. Each job has its own random number generator seeded with the seed and the job index, so the output does not depend on the number of threads.
+class SimulationWorker
+	: public QRunnable
+{
+public:
+	SimulationWorker(SimulationJob& job, const SimulationParameters& params, const FastaFileIndex& reference)
+		: QRunnable()
+		, job_(job)
+		, params_(params)
+		, reference_(reference)
+	{
+	}
+
+	void run()
+	{
+		try
+		{
+			simulate();
+		}
+		catch(Exception& e)
+		{
+			job_.error = e.message();
+		}
+
+		job_.done = 1;
+	}
+
+	void simulate()
+	{
+		const BedLine& tile = job_.tile;
+		const Chromosome& chr = tile.chr();
+		const int chr_length = reference_.lengthOf(chr);
+		job_.skipped_n = 0;
+
+		//independent random number stream of the job
+		std::seed_seq seq_seed{params_.seed, (unsigned)job_.index};
+		std::mt19937 gen(seq_seed);
+		std::normal_distribution<> insert_dist(params_.ins_mean, params_.ins_stdev);
+
+		//determine inserts (the read should overlap with the tile)
+		QVector<QPair<int, int> > inserts;
+		inserts.reserve(job_.count);
+		int window_start = chr_length;
+		int window_end = 1;
+		for (long i=0; i<job_.count; ++i)
+		{
+			int is = std::max((int)insert_dist(gen), 0);
+			std::uniform_int_distribution<int> start_dist(tile.start()-is/2, tile.end()-is/2);
+			int start = start_dist(gen);
+			int end = start + is;
+			if (start<1) start = 1;
+			if (end>chr_length) end = chr_length;
+			if (end<start) end = start;
+			inserts.append(qMakePair(start, end));
+
+			window_start = std::min(window_start, start);
+			window_end = std::max(window_end, end);
+		}
+		if (inserts.isEmpty()) return;
+
+		//load reference sequence of all inserts at once
+		Sequence window = reference_.seq(chr, window_start, window_end-window_start);
+
+		for (int i=0; i<inserts.count(); ++i)
+		{
+			int start = inserts[i].first;
+			int end = inserts[i].second;
+
+			//get insert sequence;
+			Sequence seq = window.mid(start-window_start, end-start);
+			if (params_.verbose) job_.log += "  Insert: " + chr.str() + ":" + QByteArray::number(start) + "-" + QByteArray::number(end-1) + " length=" + QByteArray::number(seq.length()) + "\n";
+
+			//get read seqence
+			FastqEntry r1;
+			FastqEntry r2;
+			r1.bases = seq.left(params_.length);
+			r2.bases = seq.right(params_.length);
+			r2.bases = NGSHelper::changeSeq(r2.bases, true, true);
+
+			//skip read pairs with too many N bases
+			if (r1.bases.count('N')>params_.max_n || r2.bases.count('N')>params_.max_n)
+			{
+				++job_.skipped_n;
+				continue;
+			}
+
+			//append sequencing adapers (if too short)
+			int a_length = params_.length - r1.bases.length();
+			if (a_length>0)
+			{
+				r1.bases.append(params_.a1.left(a_length));
+				r2.bases.append(params_.a2.left(a_length));
+			}
+
+			//append random sequence with overrepresended 'A' (if still too short)
+			int r_length = params_.length - r1.bases.length();
+			r1.bases.append(randomString(r_length, "AACGT", gen));
+			r2.bases.append(randomString(r_length, "AACGT", gen));
+
+			//add noise
+			int ec1 = addNoise(r1.bases, params_.error, gen);
+			int ec2 = addNoise(r2.bases, params_.error, gen);
+			if (params_.verbose) job_.log += "    Read 1: errors=" + QByteArray::number(ec1) + " seq=" + r1.bases + "\n";
+			if (params_.verbose) job_.log += "    Read 2: errors=" + QByteArray::number(ec2) + " seq=" + r2.bases + "\n";
+
+			//set headers and qualities
+			r1.header = "@PERsim:1:ABCDEF:1:" + chr.str() + ":" + QByteArray::number(start) + ":" + QByteArray::number(end-1) + " 1:N:0:AACGTGAT";
+			r2.header = "@PERsim:1:ABCDEF:1:" + chr.str() + ":" + QByteArray::number(start) + ":" + QByteArray::number(end-1) + " 2:N:0:AACGTGAT";
+			r1.header2 = "+";
+			r2.header2 = "+";
+			r1.qualities = params_.qualities;
+			r2.qualities = params_.qualities;
+
+			//validate data
+			r1.validate();
+			r2.validate();
+			if (r1.bases.length()!=params_.length) THROW(ProgrammingException, "Read 1 is only " + QString::number(r1.bases.length()) + " bases long!");
+			if (r2.bases.length()!=params_.length) THROW(ProgrammingException, "Read 2 is only " + QString::number(r2.bases.length()) + " bases long!");
+
+			//append to output
+			job_.out1 += r1.header + "\n" + r1.bases + "\n" + r1.header2 + "\n" + r1.qualities + "\n";
+			job_.out2 += r2.header + "\n" + r2.bases + "\n" + r2.header2 + "\n" + r2.qualities + "\n";
+		}
+	}
+
+	///Replaces bases at random with a different base. Returns the number of replaced bases.
+	static int addNoise(QByteArray& sequence, double error_probabilty, std::mt19937& gen)
+	{
+		int ec = 0;
+
+		//uniform distribution
+		std::uniform_real_distribution<double> error_dist(0, 1);
+
+		//bases vector
+		const QByteArray bases = "ACGT";
+		for(int i=0; i<sequence.length(); ++i)
+		{
+			//base error?
+			bool error = error_dist(gen) < error_probabilty;
+
+			//replace base at random (by a different base)
+			if (error)
+			{
+				QByteArray others = bases;
+				others.replace(sequence[i], "");
+				std::uniform_int_distribution<int> base_dist(0, others.length()-1);
+				sequence[i] = others[base_dist(gen)];
+
+				++ec;
+			}
+		}
+
+		return ec;
+	}
+
+	///Returns a random string of the given length with characters from @p chars.
+	static QByteArray randomString(int length, const QByteArray& chars, std::mt19937& gen)
+	{
+		QByteArray output;
+		if (length<=0) return output;
+
+		std::uniform_int_distribution<int> char_dist(0, chars.length()-1);
+		output.reserve(length);
+		for (int i=0; i<length; ++i)
+		{
+			output.append(chars[char_dist(gen)]);
+		}
+		return output;
+	}
+
+protected:
+	SimulationJob& job_;
+	const SimulationParameters& params_;
+	const FastaFileIndex& reference_;
+};
 
 class ConcreteTool
 		: public ToolBase
@@ -30,6 +241,7 @@ public:
 											 << " - insert size is modelled using a gaussian distribution."
 											 << " - read-through into the sequencing adapters is modelled."
 											 << " - sequencing errors are modelled using a simple uniform distribution."
+											 << "The output is reproducible for a given seed, independent of the number of threads."
 							   );
 		addInfile("roi", "Target region BED file (the corresponding reference genome is taken from the settings.ini file).", false);
 		addInt("count", "Number of read pairs to generate.", false);
@@ -44,157 +256,135 @@ public:
 		addString("a1", "Forward read sequencing adapter sequence (for read-through).", true, "AGATCGGAAGAGCACACGTCTGAACTCCAGTCACGAGTTA");
 		addString("a2", "Reverse read sequencing adapter sequence (for read-through).", true, "AGATCGGAAGAGCGTCGTGTAGGGAAAGAGTGTAGATCTC");
 		addInfile("ref", "Reference genome FASTA file. If unset 'reference_genome' from the 'settings.ini' file is used.", true, false);
+		addInt("seed", "Random number generator seed. If 0, a time-based seed is used.", true, 0);
+		addInt("threads", "Number of threads used for simulation and compression.", true, 1);
 		addFlag("v", "Enable verbose debug output.");
-	}
-
-	int addNoise(QByteArray& sequence, double error_probabilty, std::mt19937& gen)
-	{
-		int ec = 0;
 
-		//uniform distribution
-		std::uniform_real_distribution<double> error_dist(0, 1);
-
-		//bases vector
-		QByteArray bases = "ACGT";
-		for(int i=0; i<sequence.length(); ++i)
-		{
-			//base error?
-			bool error = error_dist(gen) < error_probabilty;
-
-			//replace base at random
-			if (error)
-			{
-				do
-				{
-					std::random_shuffle(bases.begin(), bases.end());
-				}
-				while (sequence[i]==bases[0]);
-				sequence[i] = bases[0];
-
-				++ec;
-			}
-		}
-
-		return ec;
+		changeLog(2017, 2, 1, "Added parameters 'seed' and 'threads'. Read pairs are simulated in parallel jobs and are reproducible for a given seed.");
 	}
 
 	virtual void main()
 	{
 		//init
 		QTextStream out(stdout);
-		FastqOutfileStream out1(getOutfile("out1"), false);
-		FastqOutfileStream out2(getOutfile("out2"), false);
 		BedFile roi;
 		roi.load(getInfile("roi"));
 		long count = getInt("count");
-		int length = getInt("length");
-		int ins_mean = getInt("ins_mean");
-		int ins_stdev = getInt("ins_stdev");
-		QString a1 = getString("a1");
-		QString a2 = getString("a2");
-		bool verbose = getFlag("v");
-		double error = getFloat("error");
-		int max_n = getInt("max_n");
+		SimulationParameters params;
+		params.length = getInt("length");
+		params.ins_mean = getInt("ins_mean");
+		params.ins_stdev = getInt("ins_stdev");
+		params.a1 = getString("a1").toLatin1();
+		params.a2 = getString("a2").toLatin1();
+		params.verbose = getFlag("v");
+		params.error = getFloat("error");
+		params.max_n = getInt("max_n");
+		params.seed = getInt("seed");
+		if (params.seed==0) params.seed = std::chrono::system_clock::now().time_since_epoch().count();
+		int threads = getInt("threads");
 
 		//set qualities
 		QByteArray qualities = "AAAAAFFFFFFFGGGGGGFFFFFFFFFFEEEEEEEEEEEEEEEEEEEEEDDDDDDDDDDDDDDDDDDDDDDDDCCCCCCCCCCCCCCCCCCBBBBBBBBBBBBBBBBBBBBBBBBBAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA";
-		qualities = qualities.left(length);
+		params.qualities = qualities.left(params.length);
 
 		//open refererence genome file
 		QString ref_file = getInfile("ref");
 		if (ref_file=="") ref_file = Settings::string("reference_genome");
 		FastaFileIndex reference(ref_file);
 
-		//normal distribution for insert size
-		unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-		std::mt19937 gen(seed);
-		std::normal_distribution<> insert_dist(ins_mean, ins_stdev);
+		//parallel simulation is only possible if the reference genome is memory-mapped
+		int sim_threads = reference.isMapped() ? threads : 1;
+
+		//open output streams (compression uses all threads)
+		BgzfOutfileStream out1(getOutfile("out1"), threads, Z_BEST_SPEED);
+		BgzfOutfileStream out2(getOutfile("out2"), threads, Z_BEST_SPEED);
 
 		//determine overall ROI size
 		roi.merge();
 		double overall_bases = roi.baseCount();
 
-		//simulate reads (for each target region)
+		//create jobs: split target regions into tiles (the read pairs of a region are distributed to the tiles according to their length)
+		QList<QSharedPointer<SimulationJob> > jobs;
+		QVector<long> region_counts(roi.count());
 		for (int r=0; r<roi.count(); ++r)
 		{
 			const BedLine& reg = roi[r];
-			const Chromosome& chr = reg.chr();
 
 			//determine how many reads to generate for this region
 			long r_count = std::round((double)count * reg.length() / overall_bases);
-			out << "Region: " << chr.str() << ":" << reg.start() << "-" << reg.end() << " length=" << reg.length() << " read_pairs=" << r_count << endl;
-			int skipped_n = 0;
-			for (long i=0; i<r_count; ++i)
+			region_counts[r] = r_count;
+
+			int tiles = (reg.length() + TILE_SIZE - 1) / TILE_SIZE;
+			long done = 0;
+			for (int t=0; t<tiles; ++t)
 			{
-				//determine insert size
-				int is = std::max((int)insert_dist(gen), 0);
-
-				//determine start and end position (the read should overlap with the region)
-				std::uniform_int_distribution<int> start_dist(reg.start()-is/2, reg.end()-is/2);
-				int start = start_dist(gen);
-				int end = start + is;
-				if (start<0) start=0;
-				if (end>reference.lengthOf(chr)) end = reference.lengthOf(chr);
-
-				//get insert sequence;
-				Sequence seq = reference.seq(chr, start, end-start);
-				if (verbose) out << "  Insert: " << chr.str() << ":" << start << "-" << (end-1) << " length=" << seq.length() << endl;
-
-				//get read seqence
-				FastqEntry r1;
-				FastqEntry r2;
-				r1.bases = seq.left(length);
-				r2.bases = seq.right(length);
-				r2.bases = NGSHelper::changeSeq(r2.bases, true, true);
-
-				//skip read pairs with too many N bases
-				if (r1.bases.count('N')>max_n || r2.bases.count('N')>max_n)
-				{
-					++skipped_n;
-					continue;
-				}
-
-				//append sequencing adapers (if too short)
-				int a_length = length - r1.bases.length();
-				if (a_length>0)
-				{
-					r1.bases.append(a1.left(a_length));
-					r2.bases.append(a2.left(a_length));
-				}
-
-				//append random sequence with overrepresended 'A' (if still too short)
-				int r_length = length - r1.bases.length();
-				r1.bases.append(Helper::randomString(r_length, "AACGT"));
-				r2.bases.append(Helper::randomString(r_length, "AACGT"));
-
-				//add noise
-				int ec1 = addNoise(r1.bases, error, gen);
-				int ec2 = addNoise(r2.bases, error, gen);
-				if (verbose) out << "    Read 1: errors=" << ec1 << " seq=" << r1.bases << endl;
-				if (verbose) out << "    Read 2: errors=" << ec2 << " seq=" << r2.bases << endl;
-
-				//set headers and qualities
-				r1.header = "@PERsim:1:ABCDEF:1:" + chr.str() + ":" + QByteArray::number(start) + ":" + QByteArray::number(end-1) + " 1:N:0:AACGTGAT";
-				r2.header = "@PERsim:1:ABCDEF:1:" + chr.str() + ":" + QByteArray::number(start) + ":" + QByteArray::number(end-1) + " 2:N:0:AACGTGAT";
-				r1.header2 = "+";
-				r2.header2 = "+";
-				r1.qualities = qualities;
-				r2.qualities = qualities;
-
-				//validate data
-				r1.validate();
-				r2.validate();
-				if (r1.bases.length()!=length) THROW(ProgrammingException, "Read 1 is only " + QString::number(r1.bases.length()) + " bases long!");
-				if (r2.bases.length()!=length) THROW(ProgrammingException, "Read 2 is only " + QString::number(r2.bases.length()) + " bases long!");
-
-				//write output
-				out1.write(r1);
-				out2.write(r2);
+				int tile_start = reg.start() + t * TILE_SIZE;
+				int tile_end = std::min(tile_start + TILE_SIZE - 1, reg.end());
+				long t_count = std::round((double)r_count * (tile_end - reg.start() + 1) / reg.length()) - done;
+				done += t_count;
+
+				QSharedPointer<SimulationJob> job(new SimulationJob());
+				job->tile = BedLine(reg.chr(), tile_start, tile_end);
+				job->count = t_count;
+				job->index = jobs.count();
+				job->region = r;
+				job->region_first = (t==0);
+				job->region_last = (t==tiles-1);
+				jobs << job;
 			}
+		}
 
-			if (skipped_n>0) out << "  Skipped read pairs (too many Ns): " << skipped_n << endl;
+		//simulate reads: jobs are processed in parallel and written in order
+		QThreadPool pool;
+		pool.setMaxThreadCount(sim_threads);
+		int skipped_n = 0;
+		int next_start = 0;
+		for (int j=0; j<jobs.count(); ++j)
+		{
+			//start jobs (limit number of jobs in memory)
+			while (next_start<jobs.count() && next_start<j+2*sim_threads)
+			{
+				jobs[next_start]->done = 0;
+				pool.start(new SimulationWorker(*jobs[next_start], params, reference));
+				++next_start;
+			}
+
+			//wait for job
+			SimulationJob& job = *jobs[j];
+			while (job.done.load()==0)
+			{
+				QThread::msleep(1);
+			}
+			if (!job.error.isEmpty())
+			{
+				pool.clear();
+				pool.waitForDone();
+				THROW(Exception, job.error);
+			}
+
+			//write output
+			if (job.region_first)
+			{
+				const BedLine& reg = roi[job.region];
+				out << "Region: " << reg.chr().str() << ":" << reg.start() << "-" << reg.end() << " length=" << reg.length() << " read_pairs=" << region_counts[job.region] << endl;
+				skipped_n = 0;
+			}
+			out << job.log;
+			out1.write(job.out1.constData(), job.out1.size());
+			out2.write(job.out2.constData(), job.out2.size());
+			skipped_n += job.skipped_n;
+			if (job.region_last && skipped_n>0) out << "  Skipped read pairs (too many Ns): " << skipped_n << endl;
+
+			//release memory
+			jobs[j].clear();
 		}
+		out1.close();
+		out2.close();
 	}
+
+private:
+	///Maximum length of target region tiles, which are simulated in one job.
+	static const int TILE_SIZE = 100000;
 };
 
 /*
@@ -202,7 +392,6 @@ TODO:
 - more realistic error model (high at beginning of read/index, higher for later cycles, higher for read 2)
 - model to add variants (SNVs, indels)
 - model to add N bases
-- implement test!
 */
 
 #include "main.moc"
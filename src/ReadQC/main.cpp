@@ -1,15 +1,122 @@
 #include "ToolBase.h"
 #include "StatisticsReads.h"
 #include "Helper.h"
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QAtomicInt>
+#include <QVector>
+
+class ConcreteTool;
+
+///Input worker that reads a FASTQ file in batches and starts a statistics worker for each batch.
+class ReadWorker
+		: public QRunnable
+{
+public:
+	ReadWorker(ConcreteTool& tool, QString filename, StatisticsReads::ReadDirection direction, int& read_count)
+		: QRunnable()
+		, tool_(tool)
+		, filename_(filename)
+		, direction_(direction)
+		, read_count_(read_count)
+	{
+	}
+	void run();
+
+private:
+	ConcreteTool& tool_;
+	QString filename_;
+	StatisticsReads::ReadDirection direction_;
+	int& read_count_;
+};
+
+///Worker that calculates the statistics of a batch of reads.
+class StatisticsWorker
+		: public QRunnable
+{
+public:
+	StatisticsWorker(ConcreteTool& tool, FastqBatch* batch, StatisticsReads::ReadDirection direction)
+		: QRunnable()
+		, tool_(tool)
+		, batch_(batch)
+		, direction_(direction)
+	{
+	}
+	~StatisticsWorker()
+	{
+		delete batch_;
+	}
+	void run();
+
+private:
+	ConcreteTool& tool_;
+	FastqBatch* batch_;
+	StatisticsReads::ReadDirection direction_;
+};
 
 class ConcreteTool
 		: public ToolBase
 {
 	Q_OBJECT
 
+private:
+	friend class ReadWorker;
+	friend class StatisticsWorker;
+
+	StatisticsReads stats_;
+
+	//threading
+	QThreadPool read_pool_;//decoding of input files (one worker per file)
+	QThreadPool statistics_pool_;//statistics of read batches
+	QMutex mutex_;//protects the error list
+	QAtomicInt reads_pending_;//reads that are read from input, but not processed yet
+	int max_reads_pending_;
+	QStringList errors_;//errors that occured in worker threads
+
+	///Adds an error that occured in a worker thread
+	void addError(QString error)
+	{
+		QMutexLocker locker(&mutex_);
+		errors_ << error;
+	}
+
+	///Reads a FASTQ file in batches and queues the batches for the statistics workers. Returns the number of reads.
+	int readFile(QString filename, StatisticsReads::ReadDirection direction)
+	{
+		int read_count = 0;
+		FastqFileStream stream(filename);
+		while(!stream.atEnd())
+		{
+			//prevent caching of too many reads (waste of memory)
+			while (reads_pending_.load()>=max_reads_pending_)
+			{
+				QThread::msleep(1);
+			}
+
+			FastqBatch* batch = new FastqBatch();
+			stream.readBatch(*batch);
+			read_count += batch->count();
+			reads_pending_.fetchAndAddOrdered(batch->count());
+			statistics_pool_.start(new StatisticsWorker(*this, batch, direction));
+		}
+		return read_count;
+	}
+
+	///Calculates the statistics of a batch using thread-local statistics, which are then merged into the overall statistics.
+	void updateStatistics(const FastqBatch& batch, StatisticsReads::ReadDirection direction)
+	{
+		StatisticsReads stats;
+		stats.update(batch, direction);
+		stats_.merge(stats);
+	}
+
 public:
 	ConcreteTool(int& argc, char *argv[])
 		: ToolBase(argc, argv)
+		, max_reads_pending_(0)
 	{
 	}
 
@@ -21,57 +128,58 @@ public:
 		//optional
 		addOutfile("out", "Output qcML file. If unset, writes to STDOUT.", true);
 		addFlag("txt", "Writes TXT format instead of qcML.");
+		addInt("threads", "Number of threads used for statistics calculation (input files are decoded in additional threads).", true, 1);
 
+		changeLog(2017,  2,  1, "Added parameter 'threads'. Forward and reverse files are decoded in parallel.");
 		changeLog(2016,  8, 19, "Added support for multiple input files.");
 	}
 
 	virtual void main()
 	{
 		//init
-		StatisticsReads stats;
-		FastqEntry entry;
-		QStringList infiles;
 		QStringList in1 = getInfileList("in1");
 		QStringList in2 = getInfileList("in2");
 		if (in2.count()!=0 && in1.count()!=in2.count())
 		{
 			THROW(CommandLineParsingException, "Input file lists 'in1' and 'in2' differ in counts!");
 		}
+		int threads = getInt("threads");
+		if (threads<1) THROW(CommandLineParsingException, "At least one thread is required!");
+		read_pool_.setMaxThreadCount(qMin(threads, in1.count() + in2.count()));
+		statistics_pool_.setMaxThreadCount(threads);
+		max_reads_pending_ = 4 * threads * FastqBatch().capacity();
 
 		//process
+		QStringList infiles;
+		QVector<int> read_counts1(in1.count(), 0);
+		QVector<int> read_counts2(in2.count(), 0);
 		for (int i=0; i<in1.count(); ++i)
 		{
-			//forward
-			FastqFileStream stream(in1[i]);
-			while(!stream.atEnd())
-			{
-				stream.readEntry(entry);
-				stats.update(entry, StatisticsReads::FORWARD);
-			}
+			read_pool_.start(new ReadWorker(*this, in1[i], StatisticsReads::FORWARD, read_counts1[i]));
 			infiles << in1[i];
 
 			//reverse (optional)
 			if (i<in2.count())
 			{
-				FastqFileStream stream2(in2[i]);
-				while(!stream2.atEnd())
-				{
-					 stream2.readEntry(entry);
-					 stats.update(entry, StatisticsReads::REVERSE);
-				}
-
-				//check read counts matches
-				if (stream.index()!=stream2.index())
-				{
-					THROW(ArgumentException, "Differing number of reads in file '" + in1[i] + "' and '" + in2[i] + "'!");
-				}
-
+				read_pool_.start(new ReadWorker(*this, in2[i], StatisticsReads::REVERSE, read_counts2[i]));
 				infiles << in2[i];
 			}
 		}
+		read_pool_.waitForDone();
+		statistics_pool_.waitForDone();
+		if (!errors_.isEmpty()) THROW(Exception, errors_.join("\n"));
+
+		//check read counts matches
+		for (int i=0; i<in2.count(); ++i)
+		{
+			if (read_counts1[i]!=read_counts2[i])
+			{
+				THROW(ArgumentException, "Differing number of reads in file '" + in1[i] + "' and '" + in2[i] + "'!");
+			}
+		}
 
 		//store output
-		QCCollection metrics = stats.getResult();
+		QCCollection metrics = stats_.getResult();
 		if (getFlag("txt"))
 		{
 			QStringList output;
@@ -85,6 +193,24 @@ public:
 	}
 };
 
+void ReadWorker::run()
+{
+	try
+	{
+		read_count_ = tool_.readFile(filename_, direction_);
+	}
+	catch(Exception& e)
+	{
+		tool_.addError(e.message());
+	}
+}
+
+void StatisticsWorker::run()
+{
+	tool_.updateStatistics(*batch_, direction_);
+	tool_.reads_pending_.fetchAndAddOrdered(-batch_->count());
+}
+
 #include "main.moc"
 
 int main(int argc, char *argv[])
@@ -92,4 +218,3 @@ int main(int argc, char *argv[])
 	ConcreteTool tool(argc, argv);
 	return tool.execute();
 }
-
@@ -5,10 +5,12 @@
 
 QVector<double> AnalysisWorker::fak_cache = QVector<double>();
 
-AnalysisWorker::AnalysisWorker(QSharedPointer<FastqEntry> e1, QSharedPointer<FastqEntry> e2, TrimmingParameters& params, TrimmingStatistics& stats, ErrorCorrectionStatistics& ecstats, TrimmingData& data)
+AnalysisWorker::AnalysisWorker(QSharedPointer<FastqBatch> batch1, QSharedPointer<FastqBatch> batch2, TrimmingParameters& params, TrimmingStatistics& stats, ErrorCorrectionStatistics& ecstats, TrimmingData& data)
     : QRunnable()
-	, e1_(e1)
-	, e2_(e2)
+	, batch1_(batch1)
+	, batch2_(batch2)
+	, e1_()
+	, e2_()
 	, params_(params)
 	, stats_(stats)
 	, ecstats_(ecstats)
@@ -77,52 +79,52 @@ double AnalysisWorker::matchProbability(int matches, int mismatches)
 void AnalysisWorker::correctErrors(QTextStream& debug_out)
 {
 	int mm_count = 0;
-	const int count = e1_->bases.count();
+	const int count = e1_.bases.count();
 	for (int i=0; i<count; ++i)
 	{
 		const int i2 = count-i-1;
 
 		//error detected
-		if (e1_->bases[i]!=NGSHelper::complement(e2_->bases[i2]))
+		if (e1_.bases[i]!=NGSHelper::complement(e2_.bases[i2]))
 		{
 			++mm_count;
-			int q1 = e1_->quality(i, params_.qoff);
-			int q2 = e2_->quality(i2, params_.qoff);
+			int q1 = e1_.quality(i, params_.qoff);
+			int q2 = e2_.quality(i2, params_.qoff);
 
 			//debug output
 			if (params_.debug)
 			{
 				if (mm_count!=0)
 				{
-					debug_out << "R1: " << e1_->bases << endl;
-					debug_out << "Q1: "<< e1_->qualities << endl;
-					debug_out << "R2: "<< e2_->bases << endl;
-					debug_out << "Q2: "<< e2_->qualities << endl;
+					debug_out << "R1: " << e1_.bases << endl;
+					debug_out << "Q1: "<< e1_.qualities << endl;
+					debug_out << "R2: "<< e2_.bases << endl;
+					debug_out << "Q2: "<< e2_.qualities << endl;
 				}
-				debug_out << "  MISMATCH index=" << i << " R1=" << e1_->bases[i] << "/" << q1 << " R2=" << e2_->bases[i2]<< "/" << q2 << endl;
+				debug_out << "  MISMATCH index=" << i << " R1=" << e1_.bases[i] << "/" << q1 << " R2=" << e2_.bases[i2]<< "/" << q2 << endl;
 			}
 
 			//correct error
 			if (q1>q2)
 			{
-				char replacement = NGSHelper::complement(e1_->bases[i]);
+				char replacement = NGSHelper::complement(e1_.bases[i]);
 				if (params_.debug)
 				{
-					debug_out << "    CORRECTED R2: " << e2_->bases[i2] << " => " << replacement << endl;
+					debug_out << "    CORRECTED R2: " << e2_.bases[i2] << " => " << replacement << endl;
 				}
-				e2_->bases[i2] = replacement;
-				e2_->qualities[i2] = e1_->qualities[i];
+				e2_.bases[i2] = replacement;
+				e2_.qualities[i2] = e1_.qualities[i];
 				++ecstats_.mismatch_r2[i2];
 			}
 			else if(q1<q2)
 			{
-				char replacement = NGSHelper::complement(e2_->bases[i2]);
+				char replacement = NGSHelper::complement(e2_.bases[i2]);
 				if (params_.debug)
 				{
-					debug_out << "    CORRECTED R1: " << e1_->bases[i] << " => " << replacement << endl;
+					debug_out << "    CORRECTED R1: " << e1_.bases[i] << " => " << replacement << endl;
 				}
-				e1_->bases[i] = replacement;
-				e1_->qualities[i] = e2_->qualities[i2];
+				e1_.bases[i] = replacement;
+				e1_.qualities[i] = e2_.qualities[i2];
 				++ecstats_.mismatch_r1[i];
 			}
 		}
@@ -135,12 +137,30 @@ void AnalysisWorker::correctErrors(QTextStream& debug_out)
 }
 
 void AnalysisWorker::run()
-{	
+{
+	//update QC statistics (has to be done before trimming)
+	if (!params_.qc.isEmpty())
+	{
+		stats_.qc.update(*batch1_, StatisticsReads::FORWARD);
+		stats_.qc.update(*batch2_, StatisticsReads::REVERSE);
+	}
+
+	//process read pairs (the entries are re-used, so that no memory is allocated per read)
+	for (int i=0; i<batch1_->count(); ++i)
+	{
+		batch1_->entry(i, e1_);
+		batch2_->entry(i, e2_);
+		processPair();
+	}
+}
+
+void AnalysisWorker::processPair()
+{
 	QTextStream debug_out(stdout);
 
 	//check that headers match
-	QByteArray h1 = e1_->header.split(' ').at(0);
-	QByteArray h2 = e2_->header.split(' ').at(0);
+	QByteArray h1 = e1_.header.split(' ').at(0);
+	QByteArray h2 = e2_.header.split(' ').at(0);
 	if (h1!=h2)
 	{
 		if (h1.endsWith("/1") && h2.endsWith("/2"))
@@ -158,15 +178,15 @@ void AnalysisWorker::run()
 	{
 		debug_out << "#############################################################################" << endl;
 		debug_out << "Header:     " << h1 << endl;
-		debug_out << "Read 1 in:  " << e1_->bases << endl;
-		debug_out << "Read 2 in:  " << e2_->bases << endl;
-		debug_out << "Quality 1:  " << e1_->qualities << endl;
-		debug_out << "Quality 2:  " << e2_->qualities << endl;
+		debug_out << "Read 1 in:  " << e1_.bases << endl;
+		debug_out << "Read 2 in:  " << e2_.bases << endl;
+		debug_out << "Quality 1:  " << e1_.qualities << endl;
+		debug_out << "Quality 2:  " << e2_.qualities << endl;
 	}
 
 	//make sure the sequences have the same length
-	QByteArray seq1 = e1_->bases;
-	QByteArray seq2 = NGSHelper::changeSeq(e2_->bases, true, true);
+	QByteArray seq1 = e1_.bases;
+	QByteArray seq2 = NGSHelper::changeSeq(e2_.bases, true, true);
 	int length_s1_orig = seq1.count();
 	int length_s2_orig = seq2.count();
 	int min_length = std::min(length_s1_orig, length_s2_orig);
@@ -178,13 +198,6 @@ void AnalysisWorker::run()
 		THROW(ProgrammingException, "Read length unsupported! A maximum read length of " + QString::number(MAXLEN) + " is supported!");
 	}
 
-	//update QC statistics (has to be done before trimming)
-	if (!params_.qc.isEmpty())
-	{
-		stats_.qc.update(*e1_, StatisticsReads::FORWARD);
-		stats_.qc.update(*e2_, StatisticsReads::REVERSE);
-	}
-
 	//init statistics
 	int reads_trimmed_insert = 0;
 	int reads_trimmed_adapter = 0;
@@ -330,10 +343,10 @@ void AnalysisWorker::run()
 	{
 		//update sequence data
 		int new_length = length_s2_orig-best_offset;
-		e1_->bases.resize(new_length);
-		e1_->qualities.resize(new_length);
-		e2_->bases.resize(new_length);
-		e2_->qualities.resize(new_length);
+		e1_.bases.resize(new_length);
+		e1_.qualities.resize(new_length);
+		e2_.bases.resize(new_length);
+		e2_.qualities.resize(new_length);
 
 		//update consensus adapter sequence
 		QByteArray adapter1 = seq1.mid(new_length);
@@ -399,14 +412,14 @@ void AnalysisWorker::run()
 			//debug output
 			if (params_.debug)
 			{
-				QByteArray adapter = e1_->bases.right(length_s1_orig-offset);
+				QByteArray adapter = e1_.bases.right(length_s1_orig-offset);
 				adapter.truncate(20);
 				debug_out << "###Adapter 1 hit - offset=" << offset << " prob=" << p << " matches=" << matches << " mismatches=" << mismatches << " invalid=" << invalid << " adapter=" << adapter << endl;
 			}
 
 			//trim read
-			e1_->bases.resize(offset);
-			e1_->qualities.resize(offset);
+			e1_.bases.resize(offset);
+			e1_.qualities.resize(offset);
 			offset_forward = offset;
 
 			break;
@@ -414,7 +427,7 @@ void AnalysisWorker::run()
 
 		//step 3: trim by adapter match - reverse read
 		int offset_reverse = -1;
-		seq2 = e2_->bases;
+		seq2 = e2_.bases;
 		seq2_data = seq2.constData();
 		const char* a2_data = params_.a2.constData();
 		for (int offset=0; offset<length_s2_orig; ++offset)
@@ -451,14 +464,14 @@ void AnalysisWorker::run()
 			//debug output
 			if (params_.debug)
 			{
-				QByteArray adapter = e2_->bases.right(length_s2_orig-offset);
+				QByteArray adapter = e2_.bases.right(length_s2_orig-offset);
 				adapter.truncate(20);
 				debug_out << "###Adapter 2 hit - offset=" << offset << " prob=" << p << " matches=" << matches << " mismatches=" << mismatches << " invalid=" << invalid << " adapter=" << adapter << endl;
 			}
 
 			//trim read
-			e2_->bases.resize(offset);
-			e2_->qualities.resize(offset);
+			e2_.bases.resize(offset);
+			e2_.qualities.resize(offset);
 
 			//update statistics
 			offset_reverse = offset;
@@ -475,13 +488,13 @@ void AnalysisWorker::run()
 			//if only one adapter has been trimmed => trim the other read as well
 			if (offset_forward==-1)
 			{
-				e1_->bases.resize(offset_reverse);
-				e1_->qualities.resize(offset_reverse);
+				e1_.bases.resize(offset_reverse);
+				e1_.qualities.resize(offset_reverse);
 			}
 			if (offset_reverse==-1)
 			{
-				e2_->bases.resize(offset_forward);
-				e2_->qualities.resize(offset_forward);
+				e2_.bases.resize(offset_forward);
+				e2_.qualities.resize(offset_forward);
 			}
 		}
 	}
@@ -489,40 +502,40 @@ void AnalysisWorker::run()
 	//quality trimming
 	if (params_.qcut>0)
 	{
-		if (e1_->trimQuality(params_.qcut, params_.qwin, params_.qoff)>0) ++reads_trimmed_q;
-		if (e2_->trimQuality(params_.qcut, params_.qwin, params_.qoff)>0) ++reads_trimmed_q;
+		if (e1_.trimQuality(params_.qcut, params_.qwin, params_.qoff)>0) ++reads_trimmed_q;
+		if (e2_.trimQuality(params_.qcut, params_.qwin, params_.qoff)>0) ++reads_trimmed_q;
 	}
 
 	//N trimming
 	if (params_.ncut>0)
 	{
-		if (e1_->trimN(params_.ncut)>0) ++reads_trimmed_n;
-		if (e2_->trimN(params_.ncut)>0) ++reads_trimmed_n;
+		if (e1_.trimN(params_.ncut)>0) ++reads_trimmed_n;
+		if (e2_.trimN(params_.ncut)>0) ++reads_trimmed_n;
 	}
 
 	if (params_.debug)
 	{
-		debug_out << "Read 1 out: " << e1_->bases << endl;
-		debug_out << "Read 2 out: " << e2_->bases << endl;
+		debug_out << "Read 1 out: " << e1_.bases << endl;
+		debug_out << "Read 2 out: " << e2_.bases << endl;
 	}
 
 	//write output
-	if (e1_->bases.count()>=params_.min_len && e2_->bases.count()>=params_.min_len)
+	if (e1_.bases.count()>=params_.min_len && e2_.bases.count()>=params_.min_len)
 	{
 		data_.out1_out2_mutex.lock();
-		data_.out1->write(*e1_);
-		data_.out2->write(*e2_);
+		data_.out1->write(e1_);
+		data_.out2->write(e2_);
 		data_.out1_out2_mutex.unlock();
 	}
-	else if (data_.out3 && e1_->bases.count()>=params_.min_len)
+	else if (data_.out3 && e1_.bases.count()>=params_.min_len)
 	{
 		reads_removed += 1;
-		data_.out3->write(*e1_);
+		data_.out3->write(e1_);
 	}
-	else if (data_.out4 && e2_->bases.count()>=params_.min_len)
+	else if (data_.out4 && e2_.bases.count()>=params_.min_len)
 	{
 		reads_removed += 1;
-		data_.out4->write(*e2_);
+		data_.out4->write(e2_);
 	}
 	else
 	{
@@ -537,9 +550,9 @@ void AnalysisWorker::run()
 	stats_.reads_trimmed_n += reads_trimmed_n;
 	stats_.reads_trimmed_q += reads_trimmed_q;
 	stats_.reads_removed += reads_removed;
-	stats_.bases_remaining[e1_->bases.length()] += 1;
-	stats_.bases_remaining[e2_->bases.length()] += 1;
-	stats_.bases_perc_trim_sum += (double)(length_s1_orig - e1_->bases.count()) / length_s1_orig;
-	stats_.bases_perc_trim_sum += (double)(length_s2_orig - e2_->bases.count()) / length_s2_orig;
+	stats_.bases_remaining[e1_.bases.length()] += 1;
+	stats_.bases_remaining[e2_.bases.length()] += 1;
+	stats_.bases_perc_trim_sum += (double)(length_s1_orig - e1_.bases.count()) / length_s1_orig;
+	stats_.bases_perc_trim_sum += (double)(length_s2_orig - e2_.bases.count()) / length_s2_orig;
 	stats_.mutex.unlock();
 }
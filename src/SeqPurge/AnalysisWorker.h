@@ -10,7 +10,7 @@ class AnalysisWorker
         : public QRunnable
 {
 public:
-	AnalysisWorker(QSharedPointer<FastqEntry> e1, QSharedPointer<FastqEntry> e2, TrimmingParameters& params, TrimmingStatistics& stats, ErrorCorrectionStatistics& ecstats, TrimmingData& data);
+	AnalysisWorker(QSharedPointer<FastqBatch> batch1, QSharedPointer<FastqBatch> batch2, TrimmingParameters& params, TrimmingStatistics& stats, ErrorCorrectionStatistics& ecstats, TrimmingData& data);
 	~AnalysisWorker();
 	void run();
 
@@ -18,8 +18,10 @@ public:
 	static void precalculateFactorials();
 
 private:
-	QSharedPointer<FastqEntry> e1_;
-	QSharedPointer<FastqEntry> e2_;
+	QSharedPointer<FastqBatch> batch1_;
+	QSharedPointer<FastqBatch> batch2_;
+	FastqEntry e1_;
+	FastqEntry e2_;
 	TrimmingParameters& params_;
 	TrimmingStatistics& stats_;
 	ErrorCorrectionStatistics& ecstats_;
@@ -32,6 +34,9 @@ private:
 	///Match probability calulation
 	static double matchProbability(int matches, int mismatches);
 
+	///Processes the read pair in e1_ and e2_.
+	void processPair();
+
 	///Helper function for writing output in threads
 	void writeWithThread(FastqOutfileStream* stream, FastqEntry& entry);
 
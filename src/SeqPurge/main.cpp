@@ -107,6 +107,9 @@ public:
 		//init pre-calculation of faktorials
 		AnalysisWorker::precalculateFactorials();
 
+		//read pairs are processed in batches (one thread per batch) - at least two batches per thread fit into the pre-fetch queue
+		const int batch_size = std::max(1, std::min(1000, params_.max_reads_queued / 4 / getInt("threads")));
+
 		//process
 		for (int i=0; i<in1_files.count(); ++i)
 		{
@@ -133,14 +136,22 @@ public:
 					out << Helper::dateTime() << " reading - processing now: " << processingReadPairs() << " total processed: " << data_.reads_queued << endl;
 					timer.restart();
 				}
-				data_.reads_queued += 2;
 
-				QSharedPointer<FastqEntry> e1(new FastqEntry());
-				in1.readEntry(*e1);
-				QSharedPointer<FastqEntry> e2(new FastqEntry());
-				in2.readEntry(*e2);
+				QSharedPointer<FastqBatch> batch1(new FastqBatch(batch_size));
+				in1.readBatch(*batch1);
+				QSharedPointer<FastqBatch> batch2(new FastqBatch(batch_size));
+				in2.readBatch(*batch2);
+				if (batch1->count()>batch2->count())
+				{
+					THROW(FileParseException, "File " + in1_files[i] + " has more entries than " + in2_files[i] + "!");
+				}
+				if (batch2->count()>batch1->count())
+				{
+					THROW(FileParseException, "File " + in2_files[i] + " has more entries than " + in1_files[i] + "!");
+				}
+				data_.reads_queued += 2 * batch1->count();
 
-				data_.analysis_pool.start(new AnalysisWorker(e1, e2, params_, stats_, ecstats_, data_));
+				data_.analysis_pool.start(new AnalysisWorker(batch1, batch2, params_, stats_, ecstats_, data_));
 			}
 
 			//check that forward and reverse read file are both at the end
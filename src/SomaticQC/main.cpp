@@ -31,9 +31,11 @@ public:
 		addInfileList("links","Files that appear in the link part of the qcML file.",true);
 		addInfile("target_bed", "Target file used for tumor and normal experiment.", true);
 		addFlag("skip_plots", "Skip plots (intended to increase speed of automated tests).");
+		addInt("threads", "Number of threads used for counting trinucleotides of the genome/target region.", true, 1);
 		setExtendedDescription(QStringList() << "SomaticQC integrates the output of the other QC tools and adds several metrics specific for tumor-normal pairs. The genome build form the settings file will be used during calcuation of QC metrics. All tools produce qcML, a generic XML format for QC of -omics experiments, which we adapted for NGS.");
 
 		//changelog
+		changeLog(2017,2,1,"Trinucleotide counts for the mutation profile are counted in one pass and cached, added parameter 'threads'.");
 		changeLog(2017,1,16,"Increased speed for mutation profile, removed genome build switch.");
 		changeLog(2016,8,25,"Version used in the application note.");
 	}
@@ -64,7 +66,7 @@ public:
 		}
 
 		QCCollection metrics;
-		metrics = Statistics::somatic(tumor_bam, normal_bam, somatic_vcf, target_bed, skip_plots);
+		metrics = Statistics::somatic(tumor_bam, normal_bam, somatic_vcf, target_bed, skip_plots, getInt("threads"));
 
 		//store output
 		QString parameters = "";
@@ -25,6 +25,9 @@ public:
 		addOutfile("out", "Output variant list.", false, true);
 		//optional
 		addInfile("ref", "Reference genome FASTA file. If unset 'reference_genome' from the 'settings.ini' file is used.", true, false);
+		addInt("threads", "Number of threads used for left-alignment.", true, 1);
+
+		changeLog(2017, 2, 1, "Added parameter 'threads' for parallel processing.");
 	}
 
 	virtual void main()
@@ -36,7 +39,7 @@ public:
 		//left align
 		VariantList vl;
 		vl.load(getInfile("in"));
-        vl.leftAlign(ref_file);
+		vl.leftAlign(ref_file, getInt("threads"));
 		vl.store(getOutfile("out"));
     }
 };
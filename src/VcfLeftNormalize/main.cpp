@@ -6,64 +6,229 @@
 #include <QFile>
 #include <QTextStream>
 #include <QList>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QThread>
+#include <QAtomicInt>
+#include <QSharedPointer>
 
-class ConcreteTool
-		: public ToolBase
+///Appends a VCF line with changed position, reference and alternative sequence.
+static void appendLine(QByteArray& output, const QList<QByteArray>& parts, int pos, const QByteArray& ref, const QByteArray& alt)
 {
-	Q_OBJECT
+	output.append(parts[0]);
+	output.append('\t');
+	output.append(QByteArray::number(pos));
+	output.append('\t');
+	output.append(parts[2]);
+	output.append('\t');
+	output.append(ref);
+	output.append('\t');
+	output.append(alt);
+	for(int i=5; i<parts.count(); ++i)
+	{
+		output.append('\t');
+		output.append(parts[i]);
+	}
+}
 
-public:
-	ConcreteTool(int& argc, char *argv[])
-		: ToolBase(argc, argv)
+///Removes common prefix and suffix of reference and alternative sequence.
+static void normalize(int& start, Sequence& ref, Sequence& alt)
+{
+	//remove common prefix
+	while(ref.length()>0 && alt.length()>0 && ref[0]==alt[0])
 	{
+		ref = ref.mid(1);
+		alt = alt.mid(1);
+		start += 1;
 	}
 
-	virtual void setup()
+	//remove common suffix
+	while(ref.length()>0 && alt.length()>0 && ref[ref.length()-1]==alt[alt.length()-1])
 	{
-		setDescription("Normalizes all variants and shifts indels to the left in a VCF file. Multi-allelic and complex variant are not changed!");
-		//optional
-		addInfile("in", "Input VCF file. If unset, reads from STDIN.", true, true);
-		addOutfile("out", "Output VCF list. If unset, writes to STDOUT.", true, true);
-		addInfile("ref", "Reference genome FASTA file. If unset 'reference_genome' from the 'settings.ini' file is used.", true, false);
+		ref.resize(ref.length()-1);
+		alt.resize(alt.length()-1);
+	}
+}
 
-		changeLog(2016, 06, 24, "Initial implementation.");
+///Normalizes and left-aligns the variant of a VCF line and appends the resulting line to @p output. Empty lines are skipped, headers are appended unchanged.
+static void normalizeLine(const QByteArray& line, const FastaFileIndex& reference, QByteArray& output)
+{
+	//skip empty lines
+	if (line.trimmed().isEmpty()) return;
+
+	//write out headers unchanged
+	if (line.startsWith('#'))
+	{
+		output.append(line);
+		return;
+	}
+
+	//split line and extract variant infos
+	QList<QByteArray> parts = line.split('\t');
+	if (parts.count()<5) THROW(FileParseException, "VCF with too few columns: " + line);
+
+	Chromosome chr = parts[0];
+	int pos = Helper::toInt(parts[1], "variant position");
+	Sequence ref = parts[3].toUpper();
+	Sequence alt = parts[4].toUpper();
+
+	//write out multi-allelic variants unchanged
+	if (alt.contains(','))
+	{
+		appendLine(output, parts, pos, ref, alt);
+		return;
+	}
+
+	//write out SNVs unchanged
+	if (ref.length()==1 && alt.length()==1)
+	{
+		appendLine(output, parts, pos, ref, alt);
+		return;
+	}
+
+	//skip all variants starting at first base of chromosome
+	if (pos==1)
+	{
+		appendLine(output, parts, pos, ref, alt);
+		return;
+	}
+
+	//skip SNVs disguised as indels (e.g. ACGT => AXGT)
+	normalize(pos, ref, alt);
+	if (ref.length()==1 && alt.length()==1)
+	{
+		appendLine(output, parts, pos, ref, alt);
+		return;
+	}
+
+	//skip complex indels (e.g. ACGT => CA)
+	if (ref.length()!=0 && alt.length()!=0)
+	{
+		appendLine(output, parts, pos, ref, alt);
+		return;
 	}
 
-	void writeLine(QSharedPointer<QFile>& out_p, const QList<QByteArray>& parts, int pos, const QByteArray& ref, const QByteArray& alt)
+	//left-align INSERTION
+	if (ref.length()==0)
 	{
-		char tab = '\t';
-		out_p->write(parts[0]);
-		out_p->write(&tab, 1);
-		out_p->write(QByteArray::number(pos));
-		out_p->write(&tab, 1);
-		out_p->write(parts[2]);
-		out_p->write(&tab, 1);
-		out_p->write(ref);
-		out_p->write(&tab, 1);
-		out_p->write(alt);
-		for(int i=5; i<parts.count(); ++i)
+		//shift block to the left
+		Sequence block = Variant::minBlock(alt);
+		pos -= block.length();
+		while(pos>0 && reference.seq(chr, pos, block.length())==block)
+		{
+			pos -= block.length();
+		}
+		pos += block.length();
+
+		//prepend prefix base
+		pos -= 1;
+		ref = reference.seq(chr, pos, 1);
+		alt = ref + alt;
+
+		//shift single-base to the left
+		while(ref[0]==alt[alt.count()-1])
 		{
-			out_p->write(&tab, 1);
-			out_p->write(parts[i]);
+			pos -= 1;
+			ref = reference.seq(chr, pos, 1);
+			alt = ref + alt.left(alt.length()-1);
 		}
 	}
 
-	void normalize(int& start, Sequence& ref, Sequence& alt)
+	//left-align DELETION
+	else
 	{
-		//remove common prefix
-		while(ref.length()>0 && alt.length()>0 && ref[0]==alt[0])
+		//shift block to the left
+		Sequence block = Variant::minBlock(ref);
+		while(pos>=1 && reference.seq(chr, pos, block.length())==block)
 		{
-			ref = ref.mid(1);
-			alt = alt.mid(1);
-			start += 1;
+			pos -= block.length();
 		}
+		pos += block.length();
+
+		//prepend prefix base
+		pos -= 1;
+		alt = reference.seq(chr, pos, 1);
+		ref = alt + ref;
+
+		//shift single-base to the left
+		while(ref[ref.count()-1]==alt[0])
+		{
+			pos -= 1;
+			alt = reference.seq(chr, pos, 1);
+			ref = alt + ref.left(ref.length()-1);
+		}
+	}
+
+	appendLine(output, parts, pos, ref, alt);
+}
+
+///Batch of VCF lines that is processed in parallel.
+struct LineBatch
+{
+	QList<QByteArray> lines;
+	QByteArray output;
+	QString error;
+	QAtomicInt done;
+};
 
-		//remove common suffix
-		while(ref.length()>0 && alt.length()>0 && ref[ref.length()-1]==alt[alt.length()-1])
+///Worker that normalizes the lines of a batch.
+class BatchWorker
+	: public QRunnable
+{
+public:
+	BatchWorker(LineBatch& batch, const FastaFileIndex& reference)
+		: QRunnable()
+		, batch_(batch)
+		, reference_(reference)
+	{
+	}
+
+	void run()
+	{
+		try
 		{
-			ref.resize(ref.length()-1);
-			alt.resize(alt.length()-1);
+			foreach(const QByteArray& line, batch_.lines)
+			{
+				normalizeLine(line, reference_, batch_.output);
+			}
+		}
+		catch(Exception& e)
+		{
+			batch_.error = e.message();
 		}
+		batch_.lines.clear();
+
+		batch_.done = 1;
+	}
+
+protected:
+	LineBatch& batch_;
+	const FastaFileIndex& reference_;
+};
+
+class ConcreteTool
+		: public ToolBase
+{
+	Q_OBJECT
+
+public:
+	ConcreteTool(int& argc, char *argv[])
+		: ToolBase(argc, argv)
+	{
+	}
+
+	virtual void setup()
+	{
+		setDescription("Normalizes all variants and shifts indels to the left in a VCF file. Multi-allelic and complex variant are not changed!");
+		//optional
+		addInfile("in", "Input VCF file. If unset, reads from STDIN.", true, true);
+		addOutfile("out", "Output VCF list. If unset, writes to STDOUT.", true, true);
+		addInfile("ref", "Reference genome FASTA file. If unset 'reference_genome' from the 'settings.ini' file is used.", true, false);
+		addInt("threads", "Number of threads. If bigger than 1, batches of variants are normalized in parallel and written in input order.", true, 1);
+		addInt("batch_size", "Number of lines per batch (only used if 'threads' is bigger than 1).", true, 10000);
+
+		changeLog(2017, 2, 1, "Added parameters 'threads' and 'batch_size' for parallel processing.");
+		changeLog(2016, 06, 24, "Initial implementation.");
 	}
 
 	virtual void main()
@@ -73,6 +238,15 @@ public:
 		if (ref_file=="") ref_file = Settings::string("reference_genome");
 		FastaFileIndex reference(ref_file);
 
+		//parallel processing is only possible if the reference genome is memory-mapped
+		int threads = getInt("threads");
+		if (!reference.isMapped()) threads = 1;
+		int batch_size = getInt("batch_size");
+		if (batch_size<1)
+		{
+			THROW(CommandLineParsingException, "Parameter 'batch_size' must be at least 1!");
+		}
+
 		//open input/output streams
 		QString in = getInfile("in");
 		QString out = getOutfile("out");
@@ -83,119 +257,64 @@ public:
 		QSharedPointer<QFile> in_p = Helper::openFileForReading(in, true);
 		QSharedPointer<QFile> out_p = Helper::openFileForWriting(out, true);
 
-		while(!in_p->atEnd())
+		//single-threaded
+		if (threads<=1)
 		{
-			QByteArray line = in_p->readLine();
-
-			//skip empty lines
-			if (line.trimmed().isEmpty()) continue;
-
-			//write out headers unchanged
-			if (line.startsWith('#'))
-			{
-				out_p->write(line);
-				continue;
-			}
-
-			//split line and extract variant infos
-			QList<QByteArray> parts = line.split('\t');
-			if (parts.count()<5) THROW(FileParseException, "VCF with too few columns: " + line);
-
-			Chromosome chr = parts[0];
-			int pos = Helper::toInt(parts[1], "variant position");
-			Sequence ref = parts[3].toUpper();
-			Sequence alt = parts[4].toUpper();
-
-			//write out multi-allelic variants unchanged
-			if (alt.contains(','))
-			{
-				writeLine(out_p, parts, pos, ref, alt);
-				continue;
-			}
-
-			//write out SNVs unchanged
-			if (ref.length()==1 && alt.length()==1)
+			QByteArray output;
+			while(!in_p->atEnd())
 			{
-				writeLine(out_p, parts, pos, ref, alt);
-				continue;
-			}
-
-			//skip all variants starting at first base of chromosome
-			if (pos==1)
-			{
-				writeLine(out_p, parts, pos, ref, alt);
-				continue;
-			}
-
-			//skip SNVs disguised as indels (e.g. ACGT => AXGT)
-			normalize(pos, ref, alt);
-			if (ref.length()==1 && alt.length()==1)
-			{
-				writeLine(out_p, parts, pos, ref, alt);
-				continue;
-			}
-
-			//skip complex indels (e.g. ACGT => CA)
-			if (ref.length()!=0 && alt.length()!=0)
-			{
-				writeLine(out_p, parts, pos, ref, alt);
-				continue;
+				normalizeLine(in_p->readLine(), reference, output);
+				out_p->write(output);
+				output.clear();
 			}
+			return;
+		}
 
-			//left-align INSERTION
-			if (ref.length()==0)
+		//multi-threaded: process batches in parallel and write them in input order
+		QThreadPool pool;
+		pool.setMaxThreadCount(threads);
+		QList<QSharedPointer<LineBatch> > batches;
+		QSharedPointer<LineBatch> batch(new LineBatch());
+		while(!in_p->atEnd())
+		{
+			batch->lines.append(in_p->readLine());
+			if (batch->lines.count()>=batch_size || in_p->atEnd())
 			{
-				//shift block to the left
-				Sequence block = Variant::minBlock(alt);
-				pos -= block.length();
-				while(pos>0 && reference.seq(chr, pos, block.length())==block)
-				{
-					pos -= block.length();
-				}
-				pos += block.length();
-
-				//prepend prefix base
-				pos -= 1;
-				ref = reference.seq(chr, pos, 1);
-				alt = ref + alt;
+				batch->done = 0;
+				batches << batch;
+				pool.start(new BatchWorker(*batch, reference));
+				batch = QSharedPointer<LineBatch>(new LineBatch());
 
-				//shift single-base to the left
-				while(ref[0]==alt[alt.count()-1])
+				//limit number of batches in memory
+				while (batches.count()>2*threads)
 				{
-					pos -= 1;
-					ref = reference.seq(chr, pos, 1);
-					alt = ref + alt.left(alt.length()-1);
+					writeBatch(pool, *(batches.takeFirst()), out_p);
 				}
 			}
+		}
+		while (!batches.isEmpty())
+		{
+			writeBatch(pool, *(batches.takeFirst()), out_p);
+		}
+	}
 
-			//left-align DELETION
-			else
-			{
-				//shift block to the left
-				Sequence block = Variant::minBlock(ref);
-				while(pos>=1 && reference.seq(chr, pos, block.length())==block)
-				{
-					pos -= block.length();
-				}
-				pos += block.length();
-
-				//prepend prefix base
-				pos -= 1;
-				alt = reference.seq(chr, pos, 1);
-				ref = alt + ref;
-
-				//shift single-base to the left
-				while(ref[ref.count()-1]==alt[0])
-				{
-					pos -= 1;
-					alt = reference.seq(chr, pos, 1);
-					ref = alt + ref.left(ref.length()-1);
-				}
-			}
+	///Waits until a batch is processed and writes it.
+	static void writeBatch(QThreadPool& pool, LineBatch& batch, QSharedPointer<QFile>& out_p)
+	{
+		while (batch.done.load()==0)
+		{
+			QThread::msleep(1);
+		}
 
-			writeLine(out_p, parts, pos, ref, alt);
+		if (!batch.error.isEmpty())
+		{
+			pool.clear();
+			pool.waitForDone();
+			THROW(Exception, batch.error);
 		}
-    }
+
+		out_p->write(batch.output);
+	}
 };
 
 #include "main.moc"
@@ -1,5 +1,6 @@
 #include "ToolBase.h"
 #include "VariantList.h"
+#include "VcfExternalSort.h"
 
 class ConcreteTool
 		: public ToolBase
@@ -20,6 +21,8 @@ public:
 		//optional
 		addFlag("qual", "Also sort according to variant quality. Ignored if 'fai' file is given.");
 		addInfile("fai", "FAI file defining different chromosome order.", true, true);
+		addInt("max_mem", "If bigger than 0, an external merge sort with the given memory budget in MB is used. Sorted runs are written to compressed temporary files and merged. The input lines are kept unchanged, which makes this mode suited for large VCF files. Variants are sorted by chromosome and position only.", true, 0);
+		addInt("threads", "Number of threads used to sort and compress runs (external merge sort only).", true, 1);
 	}
 
 	virtual void main()
@@ -28,6 +31,15 @@ public:
 		QString fai = getInfile("fai");
 		bool qual = getFlag("qual");
 
+		//external merge sort
+		int max_mem = getInt("max_mem");
+		if (max_mem>0)
+		{
+			VcfExternalSort sorter(fai, max_mem, getInt("threads"));
+			sorter.sort(getInfile("in"), getOutfile("out"));
+			return;
+		}
+
 		//sort
 		VariantList vl;
 		vl.load(getInfile("in"));
@@ -0,0 +1,273 @@
+#include "BenchmarkData.h"
+#include "Exceptions.h"
+#include "Helper.h"
+#include "FastqFileStream.h"
+#include "VariantList.h"
+#include "api/BamWriter.h"
+#include <QDir>
+#include <QVector>
+#include <algorithm>
+#include <zlib.h>
+
+using namespace BamTools;
+
+///Genomic position used to create sorted variants and alignments.
+struct GenomePosition
+{
+	int chr;
+	int pos;
+
+	bool operator<(const GenomePosition& rhs) const
+	{
+		if (chr!=rhs.chr) return chr<rhs.chr;
+		return pos<rhs.pos;
+	}
+};
+
+BenchmarkData::BenchmarkData(QString folder, int size, unsigned int seed)
+	: folder(folder)
+	, reads(200000 * size)
+	, variants(200000 * size)
+	, regions(100000 * size)
+	, gen_(seed)
+	, sequences_()
+{
+	QDir dir(folder);
+	if (!dir.mkpath("."))
+	{
+		THROW(FileAccessException, "Could not create benchmark data folder '" + folder + "'!");
+	}
+	ref_file = dir.absoluteFilePath("reference.fa");
+	fastq_file = dir.absoluteFilePath("reads.fastq.gz");
+	vcf_file = dir.absoluteFilePath("variants.vcf");
+	vcf_gz_file = dir.absoluteFilePath("variants.vcf.gz");
+	vcf_unsorted_file = dir.absoluteFilePath("variants_unsorted.vcf");
+	tsv_file = dir.absoluteFilePath("variants.tsv");
+	bed_file1 = dir.absoluteFilePath("regions1.bed");
+	bed_file2 = dir.absoluteFilePath("regions2.bed");
+	bam_file = dir.absoluteFilePath("reads.bam");
+
+	//the order of creation matters, because all data sets are created from the same random number generator
+	createReference();
+	createFastq();
+	createVariants();
+	createRegions().store(bed_file1);
+	createRegions().store(bed_file2);
+	createBam();
+	createUnsortedVariants();
+}
+
+QByteArray BenchmarkData::randomSequence(int length)
+{
+	QByteArray output(length, 'N');
+	for (int i=0; i<length; ++i)
+	{
+		output[i] = "ACGT"[gen_() % 4];
+	}
+	return output;
+}
+
+int BenchmarkData::randomInt(int min, int max)
+{
+	//no std::uniform_int_distribution: its output depends on the standard library implementation
+	return min + (int)(gen_() % (unsigned int)(max - min + 1));
+}
+
+void BenchmarkData::createReference()
+{
+	const int line_length = 60;
+
+	QSharedPointer<QFile> fasta = Helper::openFileForWriting(ref_file);
+	QSharedPointer<QFile> index = Helper::openFileForWriting(ref_file + ".fai");
+	for (int c=0; c<CHROMOSOMES; ++c)
+	{
+		//chromosome starts with a stretch of N bases like real reference genomes
+		QByteArray seq = QByteArray(10000, 'N') + randomSequence(CHROMOSOME_LENGTH - 10000);
+		sequences_ << seq;
+
+		QByteArray header = ">" + chromosome(c) + "\n";
+		fasta->write(header);
+		index->write(chromosome(c) + "\t" + QByteArray::number(seq.length()) + "\t" + QByteArray::number(fasta->pos()) + "\t" + QByteArray::number(line_length) + "\t" + QByteArray::number(line_length+1) + "\n");
+		for (int i=0; i<seq.length(); i+=line_length)
+		{
+			fasta->write(seq.mid(i, line_length) + "\n");
+		}
+	}
+}
+
+void BenchmarkData::createFastq()
+{
+	FastqOutfileStream stream(fastq_file, false);
+	FastqEntry entry;
+	for (int i=0; i<reads; ++i)
+	{
+		const QByteArray& chr_seq = sequences_[randomInt(0, CHROMOSOMES-1)];
+		entry.header = "@read_" + QByteArray::number(i) + " 1:N:0:ACGTACGT";
+		entry.bases = chr_seq.mid(randomInt(10000, chr_seq.length()-READ_LENGTH), READ_LENGTH);
+		entry.header2 = "+";
+		entry.qualities = QByteArray(READ_LENGTH, 'F');
+		for (int j=0; j<READ_LENGTH; ++j)
+		{
+			//sequencing errors and low-quality bases (mostly towards the read end)
+			if (randomInt(0, 999)<5) entry.bases[j] = 'N';
+			if (randomInt(0, 2*READ_LENGTH)<j) entry.qualities[j] = (char)(33 + randomInt(2, 30));
+		}
+		stream.write(entry);
+	}
+	stream.close();
+}
+
+void BenchmarkData::createVariants()
+{
+	//create sorted variant positions
+	QVector<GenomePosition> positions(variants);
+	for (int i=0; i<variants; ++i)
+	{
+		positions[i].chr = randomInt(0, CHROMOSOMES-1);
+		positions[i].pos = randomInt(10001, CHROMOSOME_LENGTH-10);
+	}
+	std::sort(positions.begin(), positions.end());
+
+	//create VCF content (SNVs and short indels)
+	QByteArray vcf;
+	vcf += "##fileformat=VCFv4.2\n";
+	vcf += "##INFO=<ID=DP,Number=1,Type=Integer,Description=\"Total depth\">\n";
+	vcf += "##INFO=<ID=AF,Number=1,Type=Float,Description=\"Allele frequency\">\n";
+	vcf += "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n";
+	vcf += "##FORMAT=<ID=GQ,Number=1,Type=Integer,Description=\"Genotype quality\">\n";
+	vcf += "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\tSAMPLE\n";
+	foreach(const GenomePosition& p, positions)
+	{
+		const QByteArray& chr_seq = sequences_[p.chr];
+		QByteArray ref = chr_seq.mid(p.pos-1, 1);
+		QByteArray obs;
+		int type = randomInt(0, 9);
+		if (type==0) //insertion
+		{
+			obs = ref + randomSequence(randomInt(1, 5));
+		}
+		else if (type==1) //deletion
+		{
+			ref = chr_seq.mid(p.pos-1, randomInt(2, 6));
+			obs = ref.left(1);
+		}
+		else //SNV
+		{
+			obs = ref;
+			while (obs==ref) obs = randomSequence(1);
+		}
+
+		vcf += chromosome(p.chr) + "\t" + QByteArray::number(p.pos) + "\t.\t" + ref + "\t" + obs + "\t" + QByteArray::number(randomInt(20, 5000)) + "\tPASS";
+		vcf += "\tDP=" + QByteArray::number(randomInt(10, 500)) + ";AF=0." + QByteArray::number(randomInt(10, 99));
+		vcf += "\tGT:GQ\t" + QByteArray(randomInt(0, 1)==0 ? "0/1" : "1/1") + ":" + QByteArray::number(randomInt(1, 99)) + "\n";
+	}
+
+	//store VCF
+	QSharedPointer<QFile> file = Helper::openFileForWriting(vcf_file);
+	file->write(vcf);
+	file->close();
+
+	//store gzipped VCF
+	gzFile gz = gzopen(vcf_gz_file.toLatin1().data(), "wb");
+	if (gz==NULL || gzwrite(gz, vcf.constData(), vcf.length())!=vcf.length())
+	{
+		THROW(FileAccessException, "Could not write gzipped VCF file '" + vcf_gz_file + "'!");
+	}
+	gzclose(gz);
+
+	//store TSV
+	VariantList list;
+	list.load(vcf_file, VariantList::VCF);
+	list.store(tsv_file, VariantList::TSV);
+}
+
+void BenchmarkData::createUnsortedVariants()
+{
+	QSharedPointer<QFile> in = Helper::openFileForReading(vcf_file);
+	QList<QByteArray> lines = in->readAll().split('\n');
+	in->close();
+	if (lines.last().isEmpty()) lines.removeLast();
+
+	//move about 2% of the variants up to 50 lines back (within the same chromosome)
+	for (int i=0; i<lines.count(); ++i)
+	{
+		if (lines[i].startsWith('#') || randomInt(0, 49)!=0) continue;
+
+		QByteArray chr = lines[i].left(lines[i].indexOf('\t')+1);
+		int target = i;
+		int distance = randomInt(1, 50);
+		while (target>0 && i-target<distance && lines[target-1].startsWith(chr))
+		{
+			--target;
+		}
+		lines.move(i, target);
+	}
+
+	QSharedPointer<QFile> out = Helper::openFileForWriting(vcf_unsorted_file);
+	foreach(const QByteArray& line, lines)
+	{
+		out->write(line + "\n");
+	}
+	out->close();
+}
+
+BedFile BenchmarkData::createRegions()
+{
+	BedFile output;
+	for (int i=0; i<regions; ++i)
+	{
+		int start = randomInt(1, CHROMOSOME_LENGTH-500);
+		output.append(BedLine(chromosome(randomInt(0, CHROMOSOMES-1)), start, start + randomInt(50, 500)));
+	}
+	return output;
+}
+
+void BenchmarkData::createBam()
+{
+	//header
+	RefVector references;
+	std::string header = "@HD\tVN:1.4\tSO:coordinate\n";
+	for (int c=0; c<CHROMOSOMES; ++c)
+	{
+		references.push_back(RefData(chromosome(c).toStdString(), sequences_[c].length()));
+		header += "@SQ\tSN:" + chromosome(c).toStdString() + "\tLN:" + QByteArray::number(sequences_[c].length()).toStdString() + "\n";
+	}
+	header += "@RG\tID:bench\tSM:bench\n";
+
+	//read starts (sorted)
+	QVector<GenomePosition> starts(reads);
+	for (int i=0; i<reads; ++i)
+	{
+		starts[i].chr = randomInt(0, CHROMOSOMES-1);
+		starts[i].pos = randomInt(10000, CHROMOSOME_LENGTH-READ_LENGTH);
+	}
+	std::sort(starts.begin(), starts.end());
+
+	//write alignments
+	BamWriter writer;
+	if (!writer.Open(bam_file.toStdString(), header, references))
+	{
+		THROW(FileAccessException, "Could not open BAM file " + bam_file + " for writing!");
+	}
+	for (int i=0; i<starts.count(); ++i)
+	{
+		const GenomePosition& start = starts[i];
+
+		BamAlignment al;
+		al.Name = "read_" + QByteArray::number(i).toStdString();
+		al.QueryBases = sequences_[start.chr].mid(start.pos, READ_LENGTH).toStdString();
+		al.Qualities = std::string(READ_LENGTH, 'F');
+		al.Length = READ_LENGTH;
+		al.RefID = start.chr;
+		al.Position = start.pos;
+		al.MapQuality = randomInt(0, 9)==0 ? 0 : 60;
+		al.CigarData.push_back(CigarOp('M', READ_LENGTH));
+		al.MateRefID = -1;
+		al.MatePosition = -1;
+		al.InsertSize = 0;
+		al.AlignmentFlag = 0;
+		al.SetIsDuplicate(randomInt(0, 19)==0);
+		writer.SaveAlignment(al);
+	}
+	writer.Close();
+}
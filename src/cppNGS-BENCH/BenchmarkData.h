@@ -0,0 +1,79 @@
+#ifndef BENCHMARKDATA_H
+#define BENCHMARKDATA_H
+
+#include "BedFile.h"
+#include <QList>
+#include <QString>
+#include <random>
+
+/**
+  @brief Synthetic benchmark data sets.
+
+  All data sets are generated from a fixed seed, i.e. they are identical for the same seed and size factor.
+  This makes timings of different commits comparable without shipping large test data.
+*/
+class BenchmarkData
+{
+public:
+	///Generates all data sets in @p folder. The size factor @p size scales the number of reads, variants and regions.
+	BenchmarkData(QString folder, int size, unsigned int seed);
+
+	///Chromosome count of the reference genome.
+	static const int CHROMOSOMES = 5;
+	///Chromosome length of the reference genome (in bases).
+	static const int CHROMOSOME_LENGTH = 2000000;
+	///Read length of FASTQ and BAM files.
+	static const int READ_LENGTH = 100;
+
+	///Folder containing the data files.
+	QString folder;
+	///Reference genome FASTA file (with index).
+	QString ref_file;
+	///FASTQ file (gzipped).
+	QString fastq_file;
+	///Variant list in VCF format.
+	QString vcf_file;
+	///Variant list in gzipped VCF format.
+	QString vcf_gz_file;
+	///Variant list in VCF format with local disorder (positions out of order by up to 50 lines like in freebayes output).
+	QString vcf_unsorted_file;
+	///Variant list in TSV format.
+	QString tsv_file;
+	///Unsorted BED file with random regions.
+	QString bed_file1;
+	///Unsorted BED file with random regions (different from bed_file1).
+	QString bed_file2;
+	///BAM file sorted by coordinate.
+	QString bam_file;
+
+	///Number of reads in the FASTQ and BAM files.
+	int reads;
+	///Number of variants.
+	int variants;
+	///Number of regions in each BED file.
+	int regions;
+
+	///Returns the name of the chromosome with the given index (0-based).
+	static QByteArray chromosome(int index)
+	{
+		return "chr" + QByteArray::number(index+1);
+	}
+
+protected:
+	std::mt19937 gen_;
+	QList<QByteArray> sequences_;
+
+	///Returns a random sequence of the given length.
+	QByteArray randomSequence(int length);
+	///Returns a random integer in the range [min, max].
+	int randomInt(int min, int max);
+
+	void createReference();
+	void createFastq();
+	void createVariants();
+	void createUnsortedVariants();
+	BedFile createRegions();
+	void createBam();
+};
+
+#endif // BENCHMARKDATA_H
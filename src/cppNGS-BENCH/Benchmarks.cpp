@@ -0,0 +1,311 @@
+#include "Benchmarks.h"
+#include "ChromosomalIndex.h"
+#include "FastaFileIndex.h"
+#include "FastqFileStream.h"
+#include "Statistics.h"
+#include "StatisticsReads.h"
+#include "VcfStreamSort.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QPair>
+#include <QVector>
+#include <random>
+
+///Returns the elapsed time of the timer in seconds.
+static double seconds(const QElapsedTimer& timer)
+{
+	return timer.nsecsElapsed() / 1000000000.0;
+}
+
+QList<Benchmark> Benchmarks::all()
+{
+	QList<Benchmark> output;
+	Benchmark benchmarks[] =
+	{
+		{"FastqFileStream::readEntry", fastqReadEntry},
+		{"VariantList::load(TSV)", variantListLoadTsv},
+		{"VariantList::load(VCF)", variantListLoadVcf},
+		{"VariantList::load(VCF_GZ)", variantListLoadVcfGz},
+		{"VariantList::store(TSV)", variantListStoreTsv},
+		{"VariantList::store(VCF)", variantListStoreVcf},
+		{"VcfStreamSort::sort", vcfStreamSort},
+		{"BedFile::merge", bedFileMerge},
+		{"BedFile::intersect", bedFileIntersect},
+		{"ChromosomalIndex::createIndex", chromosomalIndexCreate},
+		{"ChromosomalIndex::matchingIndices", chromosomalIndexQuery},
+		{"FastaFileIndex::seq", fastaFileIndexSeq},
+		{"Statistics::mapping", statisticsMapping},
+		{"StatisticsReads::update", statisticsReadsUpdate}
+	};
+	for (unsigned int i=0; i<sizeof(benchmarks)/sizeof(Benchmark); ++i)
+	{
+		output << benchmarks[i];
+	}
+	return output;
+}
+
+BenchmarkResult Benchmarks::fastqReadEntry(const BenchmarkData& data)
+{
+	BenchmarkResult result;
+	result.items = 0;
+	result.bytes = QFileInfo(data.fastq_file).size();
+
+	long long bases = 0;
+	QElapsedTimer timer;
+	timer.start();
+	FastqFileStream stream(data.fastq_file);
+	FastqEntry entry;
+	while(!stream.atEnd())
+	{
+		stream.readEntry(entry);
+		bases += entry.bases.length();
+		++result.items;
+	}
+	result.seconds = seconds(timer);
+	result.check = QString::number(bases);
+
+	return result;
+}
+
+BenchmarkResult Benchmarks::variantListLoad(QString filename, VariantList::Format format)
+{
+	BenchmarkResult result;
+	result.bytes = QFileInfo(filename).size();
+
+	QElapsedTimer timer;
+	timer.start();
+	VariantList list;
+	list.load(filename, format);
+	result.seconds = seconds(timer);
+	result.items = list.count();
+	result.check = QString::number(list.count()) + "x" + QString::number(list.annotations().count());
+
+	return result;
+}
+
+BenchmarkResult Benchmarks::variantListLoadTsv(const BenchmarkData& data)
+{
+	return variantListLoad(data.tsv_file, VariantList::TSV);
+}
+
+BenchmarkResult Benchmarks::variantListLoadVcf(const BenchmarkData& data)
+{
+	return variantListLoad(data.vcf_file, VariantList::VCF);
+}
+
+BenchmarkResult Benchmarks::variantListLoadVcfGz(const BenchmarkData& data)
+{
+	return variantListLoad(data.vcf_gz_file, VariantList::VCF_GZ);
+}
+
+BenchmarkResult Benchmarks::variantListStore(const BenchmarkData& data, VariantList::Format format)
+{
+	//setup
+	VariantList list;
+	list.load(data.vcf_file, VariantList::VCF);
+	QString filename = QDir(data.folder).absoluteFilePath(format==VariantList::TSV ? "store.tsv" : "store.vcf");
+
+	BenchmarkResult result;
+	QElapsedTimer timer;
+	timer.start();
+	list.store(filename, format);
+	result.seconds = seconds(timer);
+	result.items = list.count();
+	result.bytes = QFileInfo(filename).size();
+	result.check = QString::number(result.bytes);
+
+	QFile::remove(filename);
+	return result;
+}
+
+BenchmarkResult Benchmarks::variantListStoreTsv(const BenchmarkData& data)
+{
+	return variantListStore(data, VariantList::TSV);
+}
+
+BenchmarkResult Benchmarks::variantListStoreVcf(const BenchmarkData& data)
+{
+	return variantListStore(data, VariantList::VCF);
+}
+
+BenchmarkResult Benchmarks::vcfStreamSort(const BenchmarkData& data)
+{
+	QString filename = QDir(data.folder).absoluteFilePath("sorted.vcf");
+
+	BenchmarkResult result;
+	result.items = data.variants;
+	result.bytes = QFileInfo(data.vcf_unsorted_file).size();
+	QElapsedTimer timer;
+	timer.start();
+	VcfStreamSort sorter(10);
+	sorter.sort(data.vcf_unsorted_file, filename);
+	result.seconds = seconds(timer);
+	result.check = QString::number(sorter.cacheSize()) + ":" + QString::number(QFileInfo(filename).size());
+
+	QFile::remove(filename);
+	return result;
+}
+
+BenchmarkResult Benchmarks::bedFileMerge(const BenchmarkData& data)
+{
+	//setup
+	BedFile file;
+	file.load(data.bed_file1);
+
+	BenchmarkResult result;
+	result.items = file.count();
+	result.bytes = QFileInfo(data.bed_file1).size();
+	QElapsedTimer timer;
+	timer.start();
+	file.merge();
+	result.seconds = seconds(timer);
+	result.check = QString::number(file.count()) + ":" + QString::number(file.baseCount());
+
+	return result;
+}
+
+BenchmarkResult Benchmarks::bedFileIntersect(const BenchmarkData& data)
+{
+	//setup
+	BedFile file;
+	file.load(data.bed_file1);
+	BedFile file2;
+	file2.load(data.bed_file2);
+	file2.merge();
+
+	BenchmarkResult result;
+	result.items = file.count();
+	result.bytes = QFileInfo(data.bed_file1).size();
+	QElapsedTimer timer;
+	timer.start();
+	file.intersect(file2);
+	result.seconds = seconds(timer);
+	result.check = QString::number(file.count()) + ":" + QString::number(file.baseCount());
+
+	return result;
+}
+
+BenchmarkResult Benchmarks::chromosomalIndexCreate(const BenchmarkData& data)
+{
+	//setup
+	BedFile file;
+	file.load(data.bed_file1);
+	file.sort();
+
+	BenchmarkResult result;
+	result.items = file.count();
+	result.bytes = QFileInfo(data.bed_file1).size();
+	QElapsedTimer timer;
+	timer.start();
+	ChromosomalIndex<BedFile> index(file);
+	result.seconds = seconds(timer);
+	result.check = QString::number(index.matchingIndices(file[0].chr(), file[0].start(), file[0].end()).count());
+
+	return result;
+}
+
+BenchmarkResult Benchmarks::chromosomalIndexQuery(const BenchmarkData& data)
+{
+	//setup
+	BedFile file;
+	file.load(data.bed_file1);
+	file.sort();
+	ChromosomalIndex<BedFile> index(file);
+	BedFile queries;
+	queries.load(data.bed_file2);
+
+	BenchmarkResult result;
+	result.items = queries.count();
+	result.bytes = queries.baseCount();
+	long long hits = 0;
+	QElapsedTimer timer;
+	timer.start();
+	for (int i=0; i<queries.count(); ++i)
+	{
+		const BedLine& query = queries[i];
+		hits += index.matchingIndices(query.chr(), query.start(), query.end()).count();
+	}
+	result.seconds = seconds(timer);
+	result.check = QString::number(hits);
+
+	return result;
+}
+
+BenchmarkResult Benchmarks::fastaFileIndexSeq(const BenchmarkData& data)
+{
+	//setup (fixed seed, so that the queries are the same in each run)
+	FastaFileIndex reference(data.ref_file);
+	std::mt19937 gen(1);
+	QVector<QPair<Chromosome, int> > queries(data.reads);
+	for (int i=0; i<queries.count(); ++i)
+	{
+		queries[i].first = BenchmarkData::chromosome(gen() % BenchmarkData::CHROMOSOMES);
+		queries[i].second = 1 + gen() % (BenchmarkData::CHROMOSOME_LENGTH - BenchmarkData::READ_LENGTH);
+	}
+
+	BenchmarkResult result;
+	result.items = queries.count();
+	result.bytes = (long long)queries.count() * BenchmarkData::READ_LENGTH;
+	long long gc = 0;
+	QElapsedTimer timer;
+	timer.start();
+	for (int i=0; i<queries.count(); ++i)
+	{
+		Sequence seq = reference.seq(queries[i].first, queries[i].second, BenchmarkData::READ_LENGTH);
+		gc += seq.count('G') + seq.count('C');
+	}
+	result.seconds = seconds(timer);
+	result.check = QString::number(gc);
+
+	return result;
+}
+
+BenchmarkResult Benchmarks::statisticsMapping(const BenchmarkData& data)
+{
+	//setup
+	BedFile roi;
+	roi.load(data.bed_file1);
+	roi.merge();
+
+	BenchmarkResult result;
+	result.items = data.reads;
+	result.bytes = QFileInfo(data.bam_file).size();
+	QElapsedTimer timer;
+	timer.start();
+	QCCollection qc = Statistics::mapping(roi, data.bam_file);
+	result.seconds = seconds(timer);
+	result.check = qc.value("target region read depth").toString(4);
+
+	return result;
+}
+
+BenchmarkResult Benchmarks::statisticsReadsUpdate(const BenchmarkData& data)
+{
+	//setup
+	QVector<FastqEntry> entries;
+	entries.reserve(data.reads);
+	FastqFileStream stream(data.fastq_file);
+	while(!stream.atEnd())
+	{
+		FastqEntry entry;
+		stream.readEntry(entry);
+		entries.append(entry);
+	}
+
+	BenchmarkResult result;
+	result.items = entries.count();
+	result.bytes = (long long)entries.count() * BenchmarkData::READ_LENGTH;
+	QElapsedTimer timer;
+	timer.start();
+	StatisticsReads statistics;
+	foreach(const FastqEntry& entry, entries)
+	{
+		statistics.update(entry, StatisticsReads::FORWARD);
+	}
+	QCCollection qc = statistics.getResult();
+	result.seconds = seconds(timer);
+	result.check = qc.value("read count").toString() + ":" + qc.value("Q30 base percentage").toString(4);
+
+	return result;
+}
@@ -0,0 +1,64 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include "BenchmarkData.h"
+#include "VariantList.h"
+#include <QList>
+#include <QString>
+
+///Result of one benchmark run.
+struct BenchmarkResult
+{
+	///Run time of the benchmarked code in seconds (without setup).
+	double seconds;
+	///Number of processed items (reads, variants, regions, queries).
+	long long items;
+	///Number of processed bytes (file size or sequence length).
+	long long bytes;
+	///Value derived from the output, used to check that runs of different commits do the same work.
+	QString check;
+};
+
+///Benchmark function.
+typedef BenchmarkResult (*BenchmarkFunction)(const BenchmarkData& data);
+
+///Named benchmark.
+struct Benchmark
+{
+	QString name;
+	BenchmarkFunction function;
+};
+
+///Benchmarks of cppNGS hot paths.
+class Benchmarks
+{
+public:
+	///Returns all benchmarks in execution order.
+	static QList<Benchmark> all();
+
+protected:
+	///No default constructor
+	Benchmarks();
+
+	static BenchmarkResult fastqReadEntry(const BenchmarkData& data);
+	static BenchmarkResult variantListLoadTsv(const BenchmarkData& data);
+	static BenchmarkResult variantListLoadVcf(const BenchmarkData& data);
+	static BenchmarkResult variantListLoadVcfGz(const BenchmarkData& data);
+	static BenchmarkResult variantListStoreTsv(const BenchmarkData& data);
+	static BenchmarkResult variantListStoreVcf(const BenchmarkData& data);
+	static BenchmarkResult vcfStreamSort(const BenchmarkData& data);
+	static BenchmarkResult bedFileMerge(const BenchmarkData& data);
+	static BenchmarkResult bedFileIntersect(const BenchmarkData& data);
+	static BenchmarkResult chromosomalIndexCreate(const BenchmarkData& data);
+	static BenchmarkResult chromosomalIndexQuery(const BenchmarkData& data);
+	static BenchmarkResult fastaFileIndexSeq(const BenchmarkData& data);
+	static BenchmarkResult statisticsMapping(const BenchmarkData& data);
+	static BenchmarkResult statisticsReadsUpdate(const BenchmarkData& data);
+
+	///Loads a variant list and returns the benchmark result.
+	static BenchmarkResult variantListLoad(QString filename, VariantList::Format format);
+	///Stores a variant list and returns the benchmark result.
+	static BenchmarkResult variantListStore(const BenchmarkData& data, VariantList::Format format);
+};
+
+#endif // BENCHMARKS_H
@@ -0,0 +1,122 @@
+#include "Benchmarks.h"
+#include "Exceptions.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QStringList>
+#include <QTextStream>
+#include <algorithm>
+#include <limits>
+
+///Prints the command line help.
+static void printHelp(QTextStream& out)
+{
+	out << "cppNGS-BENCH - Benchmarks of cppNGS hot paths on synthetic data." << endl;
+	out << "" << endl;
+	out << "Output is a TSV table with the best run time of each benchmark (written to STDOUT)." << endl;
+	out << "The 'check' column depends on the benchmark output only, i.e. it must not change between commits unless the behaviour changes." << endl;
+	out << "" << endl;
+	out << "Options:" << endl;
+	out << "  -size [int]    Size factor of the synthetic data sets (default: 1)." << endl;
+	out << "  -repeats [int] Number of runs of each benchmark (default: 3)." << endl;
+	out << "  -seed [int]    Seed used to generate the data sets (default: 42)." << endl;
+	out << "  -filter [str]  Runs only benchmarks whose name contains the given string." << endl;
+	out << "  -folder [str]  Folder for the data sets (default: a temporary folder that is removed at the end)." << endl;
+	out << "  -help          Shows this help and exits." << endl;
+}
+
+///Returns the integer value of the argument following the argument with index @p i.
+static int intArgument(const QStringList& args, int i)
+{
+	bool ok = false;
+	int value = i+1<args.count() ? args[i+1].toInt(&ok) : 0;
+	if (!ok || value<1)
+	{
+		THROW(CommandLineParsingException, "Argument '" + args[i] + "' requires a positive integer value!");
+	}
+	return value;
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+
+	try
+	{
+		//parse arguments
+		int size = 1;
+		int repeats = 3;
+		int seed = 42;
+		QString filter;
+		QString folder;
+		QStringList args = app.arguments();
+		for (int i=1; i<args.count(); ++i)
+		{
+			QString arg = args[i];
+			if (arg=="-size") size = intArgument(args, i++);
+			else if (arg=="-repeats") repeats = intArgument(args, i++);
+			else if (arg=="-seed") seed = intArgument(args, i++);
+			else if (arg=="-filter" && i+1<args.count()) filter = args[++i];
+			else if (arg=="-folder" && i+1<args.count()) folder = args[++i];
+			else if (arg=="-help" || arg=="--help")
+			{
+				printHelp(out);
+				return 0;
+			}
+			else
+			{
+				THROW(CommandLineParsingException, "Invalid argument '" + arg + "'! Use '-help' to show the available arguments.");
+			}
+		}
+		bool remove_folder = folder.isEmpty();
+		if (remove_folder)
+		{
+			folder = QDir::temp().absoluteFilePath("cppNGS-BENCH_" + QString::number(QCoreApplication::applicationPid()));
+		}
+
+		//generate data
+		err << "Generating synthetic data sets in " << folder << endl;
+		BenchmarkData data(folder, size, seed);
+
+		//run benchmarks
+		out << "##size=" << size << endl;
+		out << "##repeats=" << repeats << endl;
+		out << "##seed=" << seed << endl;
+		out << "#benchmark\titems\tbytes\tseconds\titems_per_second\tmb_per_second\tcheck" << endl;
+		foreach(const Benchmark& benchmark, Benchmarks::all())
+		{
+			if (!benchmark.name.contains(filter)) continue;
+
+			err << "Running " << benchmark.name << endl;
+			BenchmarkResult best;
+			best.seconds = std::numeric_limits<double>::max();
+			for (int r=0; r<repeats; ++r)
+			{
+				BenchmarkResult result = benchmark.function(data);
+				if (r>0 && result.check!=best.check)
+				{
+					THROW(ProgrammingException, "Benchmark " + benchmark.name + " is not deterministic: check value '" + result.check + "' differs from '" + best.check + "'!");
+				}
+				if (result.seconds<best.seconds) best = result;
+			}
+
+			double seconds = std::max(best.seconds, 0.000001);
+			out << benchmark.name << "\t" << best.items << "\t" << best.bytes << "\t" << QString::number(seconds, 'f', 4);
+			out << "\t" << QString::number(best.items / seconds, 'f', 0) << "\t" << QString::number(best.bytes / seconds / 1000000.0, 'f', 2) << "\t" << best.check << endl;
+		}
+
+		//clean up
+		if (remove_folder)
+		{
+			QDir(folder).removeRecursively();
+		}
+	}
+	catch(Exception& e)
+	{
+		err << "Benchmark failed: " << e.message() << endl;
+		return 1;
+	}
+
+	return 0;
+}
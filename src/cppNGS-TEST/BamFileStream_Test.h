@@ -0,0 +1,112 @@
+#include "TestFramework.h"
+#include "BamFileStream.h"
+#include "NGSHelper.h"
+
+TEST_CLASS(BamFileStream_Test)
+{
+Q_OBJECT
+private:
+
+	//compares all alignments of a BAM file read with BamTools and BamInfileStream
+	void compareWithBamTools(QString bam_file, int threads)
+	{
+		BamReader reader;
+		IS_TRUE(reader.Open(bam_file.toStdString()));
+		BamInfileStream stream(bam_file, threads);
+		S_EQUAL(QString::fromStdString(stream.GetHeaderText()), QString::fromStdString(reader.GetHeaderText()));
+		I_EQUAL((int)stream.GetReferenceData().size(), (int)reader.GetReferenceData().size());
+
+		int count = 0;
+		BamAlignment al;
+		BamAlignment al2;
+		while (reader.GetNextAlignment(al))
+		{
+			IS_TRUE(stream.GetNextAlignment(al2));
+			S_EQUAL(QString::fromStdString(al2.Name), QString::fromStdString(al.Name));
+			I_EQUAL(al2.RefID, al.RefID);
+			I_EQUAL(al2.Position, al.Position);
+			I_EQUAL(al2.AlignmentFlag, al.AlignmentFlag);
+			I_EQUAL(al2.MapQuality, al.MapQuality);
+			I_EQUAL(al2.MateRefID, al.MateRefID);
+			I_EQUAL(al2.MatePosition, al.MatePosition);
+			I_EQUAL(al2.InsertSize, al.InsertSize);
+			I_EQUAL((int)al2.CigarData.size(), (int)al.CigarData.size());
+			S_EQUAL(QString::fromStdString(al2.QueryBases), QString::fromStdString(al.QueryBases));
+			S_EQUAL(QString::fromStdString(al2.AlignedBases), QString::fromStdString(al.AlignedBases));
+			S_EQUAL(QString::fromStdString(al2.Qualities), QString::fromStdString(al.Qualities));
+			IS_TRUE(al2.TagData==al.TagData);
+			++count;
+		}
+		IS_FALSE(stream.GetNextAlignment(al2));
+		IS_TRUE(count>0);
+	}
+
+private slots:
+
+	void read()
+	{
+		compareWithBamTools(TESTDATA("data_in/panel.bam"), 1);
+		compareWithBamTools(TESTDATA("data_in/panel.bam"), 4);
+	}
+
+	void read_core()
+	{
+		BamInfileStream stream(TESTDATA("data_in/panel.bam"), 2);
+		BamInfileStream stream2(TESTDATA("data_in/panel.bam"), 1);
+		BamAlignment al;
+		BamAlignment al2;
+		int count = 0;
+		while (stream.GetNextAlignmentCore(al))
+		{
+			IS_TRUE(al.Name.empty());
+			IS_TRUE(al.QueryBases.empty());
+
+			//string data is decoded on demand
+			IS_TRUE(stream2.GetNextAlignment(al2));
+			stream.BuildCharData(al);
+			S_EQUAL(QString::fromStdString(al.Name), QString::fromStdString(al2.Name));
+			S_EQUAL(QString::fromStdString(al.QueryBases), QString::fromStdString(al2.QueryBases));
+			S_EQUAL(QString::fromStdString(al.AlignedBases), QString::fromStdString(al2.AlignedBases));
+			S_EQUAL(QString::fromStdString(al.Qualities), QString::fromStdString(al2.Qualities));
+			IS_TRUE(al.TagData==al2.TagData);
+			++count;
+		}
+		IS_TRUE(count>0);
+	}
+
+	void write()
+	{
+		//write with several threads
+		{
+			BamInfileStream stream(TESTDATA("data_in/panel.bam"), 4);
+			BamOutfileStream writer("out/BamFileStream_out1.bam", stream.GetConstSamHeader(), stream.GetReferenceData(), 4);
+			BamAlignment al;
+			while (stream.GetNextAlignment(al))
+			{
+				writer.SaveAlignment(al);
+			}
+			writer.Close();
+		}
+
+		//read output with BamTools and compare it to the input
+		BamReader reader;
+		IS_TRUE(reader.Open("out/BamFileStream_out1.bam"));
+		BamInfileStream stream(TESTDATA("data_in/panel.bam"), 1);
+		BamAlignment al;
+		BamAlignment al2;
+		int count = 0;
+		while (stream.GetNextAlignment(al))
+		{
+			IS_TRUE(reader.GetNextAlignment(al2));
+			S_EQUAL(QString::fromStdString(al2.Name), QString::fromStdString(al.Name));
+			I_EQUAL(al2.Position, al.Position);
+			I_EQUAL(al2.AlignmentFlag, al.AlignmentFlag);
+			S_EQUAL(QString::fromStdString(al2.QueryBases), QString::fromStdString(al.QueryBases));
+			S_EQUAL(QString::fromStdString(al2.Qualities), QString::fromStdString(al.Qualities));
+			IS_TRUE(al2.TagData==al.TagData);
+			++count;
+		}
+		IS_FALSE(reader.GetNextAlignment(al2));
+		IS_TRUE(count>0);
+	}
+};
@@ -0,0 +1,77 @@
+#include "TestFramework.h"
+#include "BamMateCache.h"
+#include "NGSHelper.h"
+
+TEST_CLASS(BamMateCache_Test)
+{
+Q_OBJECT
+private:
+
+	//pairs the primary paired alignments of a BAM file and returns the number of read pairs and unmatched reads
+	void pairReads(QString bam_file, int max_memory_mb, int& pairs, int& pairs_spilled, int& unmatched, long long& spilled)
+	{
+		pairs = 0;
+		pairs_spilled = 0;
+		unmatched = 0;
+
+		BamReader reader;
+		NGSHelper::openBAM(reader, bam_file);
+		BamMateCache cache(reader.GetConstSamHeader(), reader.GetReferenceData(), max_memory_mb);
+		BamAlignment al;
+		BamAlignment mate;
+		while (reader.GetNextAlignment(al))
+		{
+			if (!al.IsPrimaryAlignment() || !al.IsPaired()) continue;
+
+			if (cache.takeMate(al, mate))
+			{
+				IS_TRUE(al.Name==mate.Name);
+				++pairs;
+			}
+		}
+
+		bool paired = false;
+		while (cache.nextRemaining(al, mate, paired))
+		{
+			if (paired)
+			{
+				IS_TRUE(al.Name==mate.Name);
+				IS_TRUE(mate.RefID<al.RefID || (mate.RefID==al.RefID && mate.Position<=al.Position));
+				++pairs_spilled;
+			}
+			else
+			{
+				++unmatched;
+			}
+		}
+		spilled = cache.spilledCount();
+	}
+
+private slots:
+
+	void in_memory()
+	{
+		int pairs, pairs_spilled, unmatched;
+		long long spilled;
+		pairReads(TESTDATA("data_in/bamclipoverlap.bam"), 1000, pairs, pairs_spilled, unmatched, spilled);
+		IS_TRUE(pairs>0);
+		I_EQUAL(pairs_spilled, 0);
+		IS_TRUE(spilled==0);
+	}
+
+	void spill_to_disk()
+	{
+		int pairs, pairs_spilled, unmatched;
+		long long spilled;
+		pairReads(TESTDATA("data_in/bamclipoverlap.bam"), 1000, pairs, pairs_spilled, unmatched, spilled);
+
+		//no memory => every cached alignment is spilled and all pairs are found during merging
+		int pairs2, pairs_spilled2, unmatched2;
+		long long spilled2;
+		pairReads(TESTDATA("data_in/bamclipoverlap.bam"), 0, pairs2, pairs_spilled2, unmatched2, spilled2);
+		I_EQUAL(pairs2, 0);
+		I_EQUAL(pairs_spilled2, pairs);
+		I_EQUAL(unmatched2, unmatched);
+		IS_TRUE(spilled2>0);
+	}
+};
@@ -0,0 +1,63 @@
+#include "TestFramework.h"
+#include "BedChunkRunner.h"
+
+///Test processor that annotates the length of each region.
+class LengthProcessor
+	: public BedChunkProcessor
+{
+public:
+	BedChunkProcessor* clone() const
+	{
+		return new LengthProcessor();
+	}
+
+	void process(BedFile& chunk)
+	{
+		for (int i=0; i<chunk.count(); ++i)
+		{
+			chunk[i].annotations().append(QString::number(chunk[i].length()));
+		}
+	}
+};
+
+TEST_CLASS(BedChunkRunner_Test)
+{
+Q_OBJECT
+private slots:
+
+	void split()
+	{
+		BedFile file;
+		file.append(BedLine("chr1", 1, 100));
+		file.append(BedLine("chr1", 201, 300));
+		file.append(BedLine("chr2", 1, 1000));
+		file.append(BedLine("chr3", 1, 100));
+
+		QList<BedFile> chunks = BedChunkRunner::split(file, 2);
+		I_EQUAL(chunks.count(), 2);
+		I_EQUAL(chunks[0].count(), 3);
+		I_EQUAL(chunks[1].count(), 1);
+		S_EQUAL(chunks[1][0].chr().str(), QString("chr3"));
+
+		chunks = BedChunkRunner::split(file, 1);
+		I_EQUAL(chunks.count(), 1);
+		I_EQUAL(chunks[0].count(), 4);
+
+		chunks = BedChunkRunner::split(BedFile(), 4);
+		I_EQUAL(chunks.count(), 0);
+	}
+
+	void run()
+	{
+		BedFile file;
+		file.load(TESTDATA("data_in/panel.bed"));
+		file.merge();
+
+		BedChunkRunner::run(file, LengthProcessor(), 4);
+		for (int i=0; i<file.count(); ++i)
+		{
+			I_EQUAL(file[i].annotations().count(), 1);
+			S_EQUAL(file[i].annotations()[0], QString::number(file[i].length()));
+		}
+	}
+};
@@ -0,0 +1,86 @@
+#include "TestFramework.h"
+#include "BedFileStream.h"
+#include "Helper.h"
+
+TEST_CLASS(BedFileStream_Test)
+{
+Q_OBJECT
+private slots:
+
+	void read_write()
+	{
+		BedInfileStream in(TESTDATA("data_in/demo.bed"));
+		BedOutfileStream out("out/BedFileStream_out1.bed");
+		int headers = 0;
+		int lines = 0;
+		while(in.next())
+		{
+			if (in.isHeader())
+			{
+				++headers;
+				out.writeHeader(in.line());
+				continue;
+			}
+
+			if (lines==0)
+			{
+				X_EQUAL(in.chr(), Chromosome("chr4"));
+				I_EQUAL(in.start(), 843451);
+				I_EQUAL(in.end(), 843572);
+				I_EQUAL(in.annotationCount(), 0);
+			}
+			++lines;
+			out.write(in.chr(), in.start(), in.end(), in.annotationData());
+		}
+		out.flush();
+		I_EQUAL(headers, 2);
+		I_EQUAL(lines, 591);
+		X_EQUAL(in.chr(), Chromosome("chr22"));
+		I_EQUAL(in.start(), 38565215);
+		I_EQUAL(in.end(), 38565443);
+
+		COMPARE_FILES("out/BedFileStream_out1.bed", TESTDATA("data_out/BedFile_store01_out.bed"));
+	}
+
+	void annotations()
+	{
+		QString filename = Helper::tempFileName(".bed");
+		Helper::storeTextFile(filename, QStringList() << "#header" << "chr1\t10\t20" << "" << "chr1\t30\t40\tbla\t\tbluff" << "chrX\t0\t1\tbli");
+
+		BedInfileStream in(filename);
+		IS_TRUE(in.next());
+		IS_TRUE(in.isHeader());
+		S_EQUAL(in.line(), QByteArray("#header"));
+
+		IS_TRUE(in.next());
+		IS_FALSE(in.isHeader());
+		I_EQUAL(in.annotationCount(), 0);
+		S_EQUAL(in.annotationData(), QByteArray());
+
+		IS_TRUE(in.next());
+		X_EQUAL(in.chr(), Chromosome("chr1"));
+		I_EQUAL(in.start(), 31);
+		I_EQUAL(in.end(), 40);
+		I_EQUAL(in.annotationCount(), 3);
+		S_EQUAL(in.annotation(0), QByteArray("bla"));
+		S_EQUAL(in.annotation(1), QByteArray(""));
+		S_EQUAL(in.annotation(2), QByteArray("bluff"));
+		S_EQUAL(in.annotationData(), QByteArray("bla\t\tbluff"));
+		BedLine line = in.toBedLine();
+		I_EQUAL(line.start(), 31);
+		I_EQUAL(line.end(), 40);
+		I_EQUAL(line.annotations().count(), 3);
+		S_EQUAL(line.annotations()[2], QString("bluff"));
+		I_EQUAL(in.toBedLine(false).annotations().count(), 0);
+
+		IS_TRUE(in.next());
+		X_EQUAL(in.chr(), Chromosome("chrX"));
+		I_EQUAL(in.start(), 1);
+		I_EQUAL(in.end(), 1);
+		S_EQUAL(in.annotationData(), QByteArray("bli"));
+
+		IS_FALSE(in.next());
+
+		QFile::remove(filename);
+	}
+};
@@ -1,5 +1,6 @@
 #include "TestFramework.h"
 #include "BedFile.h"
+#include <algorithm>
 
 
 TEST_CLASS(BedFile_Test)
@@ -69,6 +70,31 @@ private slots:
 		I_EQUAL(file[4].start(), 15);
 	}
 
+	void sort_large()
+	{
+		//positions with several radix digits, same start and non-numeric chromosomes (stable order of identical regions)
+		BedFile file;
+		file.append(BedLine("chrX", 70000, 80000));
+		file.append(BedLine("chr1", 200000000, 200000010, QStringList() << "a"));
+		file.append(BedLine("chr1", 65536, 65540));
+		file.append(BedLine("chr1", 65535, 131072));
+		file.append(BedLine("chr1", 65535, 65536));
+		file.append(BedLine("chr1", 200000000, 200000010, QStringList() << "b"));
+		file.append(BedLine("chrM", 1, 10));
+		file.sort();
+		IS_TRUE(file.isSorted());
+		I_EQUAL(file.count(), 7);
+		I_EQUAL(file[0].start(), 65535);
+		I_EQUAL(file[0].end(), 65536);
+		I_EQUAL(file[1].start(), 65535);
+		I_EQUAL(file[1].end(), 131072);
+		I_EQUAL(file[2].start(), 65536);
+		S_EQUAL(file[3].annotations()[0], QString("a"));
+		S_EQUAL(file[4].annotations()[0], QString("b"));
+		X_EQUAL(file[5].chr(), Chromosome("chrX"));
+		X_EQUAL(file[6].chr(), Chromosome("chrM"));
+	}
+
 	void sort_uniq()
 	{
 		BedFile file;
@@ -537,4 +563,96 @@ private slots:
 		expected.insert(Chromosome("chr3"));
 		X_EQUAL(f.chromosomes(), expected);
 	}
+
+	void compact_sort()
+	{
+		//compare radix sort of large files with comparison-based sort
+		QStringList chrs;
+		chrs << "chr1" << "chr2" << "chrX" << "chr10" << "chrM" << "chr1_gl000191_random";
+		BedFile file;
+		BedFileCompact compact;
+		QVector<BedLine> expected;
+		for (int i=0; i<10000; ++i)
+		{
+			int start = 1 + (i * 7919) % 300000;
+			BedLine line(chrs[(i * 31) % chrs.count()], start, start + i % 97, QStringList() << QString::number(i));
+			file.append(line);
+			compact.append(line);
+			expected.append(line);
+		}
+		std::stable_sort(expected.begin(), expected.end());
+		file.sort();
+		compact.sort();
+		IS_TRUE(compact.isSorted());
+		I_EQUAL(file.count(), 10000);
+		I_EQUAL(compact.count(), 10000);
+		int errors = 0;
+		for (int i=0; i<expected.count(); ++i)
+		{
+			if (!(file[i]==expected[i]) || file[i].annotations()!=expected[i].annotations()) ++errors;
+			if (!(compact[i]==expected[i]) || compact[i].annotations()!=expected[i].annotations()) ++errors;
+		}
+		I_EQUAL(errors, 0);
+
+		//uniq
+		compact.clear();
+		compact.append("chr2", 5, 10, "a");
+		compact.append("chr1", 7, 23, "b\tc");
+		compact.append("chr2", 5, 10, "d");
+		compact.append("chr1", 7, 23);
+		compact.sort(true);
+		I_EQUAL(compact.count(), 2);
+		X_EQUAL(compact.chr(0), Chromosome("chr1"));
+		I_EQUAL(compact.start(0), 7);
+		S_EQUAL(compact.annotationData(0), QByteArray("b\tc"));
+		I_EQUAL(compact[0].annotations().count(), 2);
+		X_EQUAL(compact.chr(1), Chromosome("chr2"));
+		S_EQUAL(compact.annotationData(1), QByteArray("a"));
+	}
+
+	void compact_merge()
+	{
+		BedFileCompact file;
+		file.append(BedLine("chr2", 1, 2));
+		file.append(BedLine("chr2", 5, 10));
+		file.append(BedLine("chr2", 10, 20));
+		file.append(BedLine("chr1", 7, 23));
+		file.append(BedLine("chr1", 1, 6));
+		file.append(BedLine("chr1", 24, 30));
+		file.merge(false);
+		I_EQUAL(file.count(), 5);
+		I_EQUAL(file.start(0), 1);
+		I_EQUAL(file.end(0), 6);
+		I_EQUAL(file.start(4), 5);
+		I_EQUAL(file.end(4), 20);
+		I_EQUAL(file[4].annotations().count(), 0);
+
+		//merge_names
+		file.append(BedLine("chr1", 2, 31, QStringList() << "bli" << "x"));
+		file.append(BedLine("chr2", 2, 7, QStringList() << "bla"));
+		file.append(BedLine("chr2", 19, 25, QStringList() << "bluff"));
+		file.merge(true, true);
+		I_EQUAL(file.count(), 2);
+		X_EQUAL(file.chr(0), Chromosome("chr1"));
+		I_EQUAL(file.start(0), 1);
+		I_EQUAL(file.end(0), 31);
+		I_EQUAL(file[0].annotations().count(), 1);
+		S_EQUAL(file[0].annotations()[0], QString(",bli"));
+		X_EQUAL(file.chr(1), Chromosome("chr2"));
+		I_EQUAL(file.start(1), 1);
+		I_EQUAL(file.end(1), 25);
+		S_EQUAL(file[1].annotations()[0], QString(",bla,,bluff"));
+	}
+
+	void compact_load_store()
+	{
+		BedFileCompact file;
+		file.load(TESTDATA("data_in/demo.bed"));
+		I_EQUAL(file.count(), 591);
+		X_EQUAL(file.chr(590), Chromosome("chr22"));
+		I_EQUAL(file.start(590), 38565215);
+		I_EQUAL(file.end(590), 38565443);
+		file.store("out/BedFile_store02_out.bed");
+		COMPARE_FILES("out/BedFile_store02_out.bed", TESTDATA("data_out/BedFile_store01_out.bed"));
+	}
 };
@@ -399,4 +399,95 @@ private slots:
 		QFile::remove(tmp_file);
 	}
 
+	void batch_read_write()
+	{
+		QString tmp_file = Helper::tempFileName(".fastq.gz");
+		FastqOutfileStream out(tmp_file, false);
+
+		//read in batches, trim first entry and discard second entry
+		FastqFileStream stream(TESTDATA("data_in/example1.fastq.gz"));
+		FastqBatch batch(4);
+		QList<int> counts;
+		while(!stream.atEnd())
+		{
+			stream.readBatch(batch);
+			if (batch.count()==0) break;
+			counts << batch.count();
+			if (counts.count()==1)
+			{
+				S_EQUAL(QByteArray(batch.header(0), batch.headerLength(0)), QByteArray("@NG-5232_4_1_1022_17823#0/1"));
+				I_EQUAL(batch.length(0), 108);
+				batch.trim(0, 1, 5);
+				I_EQUAL(batch.length(0), 5);
+				batch.discard(1);
+				IS_TRUE(batch.isDiscarded(1));
+				IS_FALSE(batch.isDiscarded(2));
+			}
+			out.write(batch);
+		}
+		out.close();
+		I_EQUAL(counts.count(), 3);
+		I_EQUAL(counts[0], 4);
+		I_EQUAL(counts[1], 4);
+		I_EQUAL(counts[2], 2);
+
+		//check written entries
+		FastqFileStream stream2(tmp_file);
+		FastqEntry entry;
+		stream2.readEntry(entry);
+		S_EQUAL(entry.header, QByteArray("@NG-5232_4_1_1022_17823#0/1"));
+		S_EQUAL(entry.bases, QByteArray("ACTCC"));
+		S_EQUAL(entry.header2, QByteArray("+NG-5232_4_1_1022_17823#0/1"));
+		S_EQUAL(entry.qualities, QByteArray("'''')"));
+		stream2.readEntry(entry);
+		S_EQUAL(entry.header, QByteArray("@NG-5232_4_1_1026_21154#0/1"));
+		I_EQUAL(entry.bases.count(), 108);
+		int count = 2;
+		while(!stream2.atEnd())
+		{
+			stream2.readEntry(entry);
+			if (entry.header.isEmpty()) break;
+			++count;
+			S_EQUAL(entry.header.left(15), QByteArray("@NG-5232_4_1_10"));
+		}
+		I_EQUAL(count, 9);
+
+		QFile::remove(tmp_file);
+	}
+
+	void batch_trim()
+	{
+		FastqFileStream stream(TESTDATA("data_in/example1.fastq.gz"));
+		FastqBatch batch;
+		stream.readBatch(batch);
+		I_EQUAL(batch.count(), 10);
+		FastqBatch batch2 = batch;
+
+		//batch trimming gives the same result as entry trimming
+		I_EQUAL(batch.trimQuality(15), 10);
+		I_EQUAL(batch2.trimN(7), 10);
+		FastqFileStream stream2(TESTDATA("data_in/example1.fastq.gz"));
+		FastqEntry entry;
+		FastqEntry entry2;
+		FastqEntry batch_entry;
+		for (int i=0; i<10; ++i)
+		{
+			stream2.readEntry(entry);
+			entry2 = entry;
+
+			entry.trimQuality(15);
+			batch.entry(i, batch_entry);
+			S_EQUAL(batch_entry.header, entry.header);
+			S_EQUAL(batch_entry.bases, entry.bases);
+			S_EQUAL(batch_entry.qualities, entry.qualities);
+
+			entry2.trimN(7);
+			batch2.entry(i, batch_entry);
+			S_EQUAL(batch_entry.bases, entry2.bases);
+			S_EQUAL(batch_entry.qualities, entry2.qualities);
+		}
+		I_EQUAL(batch.length(0), 20);
+		I_EQUAL(batch2.length(0), 60);
+	}
+
 };
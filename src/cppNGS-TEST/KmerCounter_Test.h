@@ -0,0 +1,71 @@
+#include "TestFramework.h"
+#include "KmerCounter.h"
+#include <QDir>
+
+TEST_CLASS(KmerCounter_Test)
+{
+Q_OBJECT
+private slots:
+
+	void add()
+	{
+		KmerCounter counter;
+		counter.add("ACGTNacgTA");
+		I_EQUAL(counter.count("ACG"), 2);
+		I_EQUAL(counter.count("CGT"), 2);
+		I_EQUAL(counter.count("GTA"), 1);
+		I_EQUAL(counter.count("GTN"), 0);
+		I_EQUAL(counter.count("TNA"), 0);
+		I_EQUAL(counter.count("AAA"), 0);
+
+		KmerCounter counter2;
+		counter2.add("AAAA");
+		counter.add(counter2);
+		I_EQUAL(counter.count("AAA"), 2);
+		I_EQUAL(counter.count("ACG"), 2);
+	}
+
+	void store_load()
+	{
+		KmerCounter counter(2);
+		counter.add("ACGTACGT");
+		counter.store("out/KmerCounter_out1.tsv");
+
+		KmerCounter counter2(2);
+		counter2.load("out/KmerCounter_out1.tsv");
+		I_EQUAL(counter2.count("AC"), 2);
+		I_EQUAL(counter2.count("TA"), 1);
+		I_EQUAL(counter2.count("AA"), 0);
+	}
+
+	void countGenome()
+	{
+		KmerCounter counter = KmerCounter::countGenome(TESTDATA("data_in/example.fa"));
+		I_EQUAL(counter.count("CAG"), 130);
+		I_EQUAL(counter.count("AAA"), 38);
+		I_EQUAL(counter.count("TTT"), 63);
+		I_EQUAL(counter.count("ACG"), 4);
+
+		//multi-threaded with cache
+		QDir("out/KmerCounter_cache").removeRecursively();
+		for (int i=0; i<2; ++i)
+		{
+			counter = KmerCounter::countGenome(TESTDATA("data_in/example.fa"), 3, 4, "out/KmerCounter_cache");
+			I_EQUAL(counter.count("CAG"), 130);
+			I_EQUAL(counter.count("AAA"), 38);
+			I_EQUAL(QDir("out/KmerCounter_cache").entryList(QDir::Files).count(), 1);
+		}
+	}
+
+	void countRegions()
+	{
+		BedFile regions;
+		regions.append(BedLine("chr14", 100, 400));
+
+		KmerCounter counter = KmerCounter::countRegions(TESTDATA("data_in/example.fa"), regions);
+		I_EQUAL(counter.count("CAG"), 6);
+		I_EQUAL(counter.count("AAA"), 5);
+		I_EQUAL(counter.count("TTT"), 9);
+		I_EQUAL(counter.count("ACG"), 1);
+	}
+};
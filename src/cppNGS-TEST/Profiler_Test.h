@@ -0,0 +1,47 @@
+#include "TestFramework.h"
+#include "Profiler.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+TEST_CLASS(Profiler_Test)
+{
+Q_OBJECT
+private slots:
+
+	void timers_and_counters()
+	{
+		Profiler::setOutput("out/Profiler_out1.json");
+		IS_TRUE(Profiler::enabled());
+
+		ProfilerTimer timer("Profiler_Test load");
+		timer.restart("Profiler_Test query");
+		timer.restart("Profiler_Test query");
+		timer.stop();
+		timer.stop(); //stopping twice has no effect
+		Profiler::addCount("Profiler_Test items", 5);
+		Profiler::addCount("Profiler_Test items");
+
+		QJsonObject root = QJsonDocument::fromJson(Profiler::toJson()).object();
+		I_EQUAL(root["counters"].toObject()["Profiler_Test items"].toInt(), 6);
+		int load_calls = 0;
+		int query_calls = 0;
+		foreach(const QJsonValue& value, root["stages"].toArray())
+		{
+			QJsonObject stage = value.toObject();
+			if (stage["name"].toString()=="Profiler_Test load") load_calls = stage["calls"].toInt();
+			if (stage["name"].toString()=="Profiler_Test query") query_calls = stage["calls"].toInt();
+			IS_TRUE(stage["seconds"].toDouble()>=0.0);
+		}
+		I_EQUAL(load_calls, 1);
+		I_EQUAL(query_calls, 2);
+		IS_TRUE(root["peak_memory_mb"].toDouble()!=0.0); //-1 if not available
+
+		//disabled profiler
+		Profiler::setOutput("");
+		IS_FALSE(Profiler::enabled());
+		Profiler::addCount("Profiler_Test items");
+		root = QJsonDocument::fromJson(Profiler::toJson()).object();
+		I_EQUAL(root["counters"].toObject()["Profiler_Test items"].toInt(), 6);
+	}
+};
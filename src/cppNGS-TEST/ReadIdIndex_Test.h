@@ -0,0 +1,85 @@
+#include "TestFramework.h"
+#include "ReadIdIndex.h"
+
+TEST_CLASS(ReadIdIndex_Test)
+{
+Q_OBJECT
+private slots:
+
+	void insert_value()
+	{
+		ReadIdIndex index;
+		index.insert("read1", 5, 101);
+		index.insert("read2", 5, 102);
+		I_EQUAL(index.count(), 2);
+		I_EQUAL(index.value("read1", 5, -1), 101);
+		I_EQUAL(index.value("read2", 5, -1), 102);
+		I_EQUAL(index.value("read3", 5, -1), -1);
+		I_EQUAL(index.value("read", 4, -1), -1);
+		I_EQUAL(index.value("read12", 6, -1), -1);
+
+		//value is replaced
+		index.insert("read1", 5, 201);
+		I_EQUAL(index.count(), 2);
+		I_EQUAL(index.value("read1", 5, -1), 201);
+		I_EQUAL(index.value("read2", 5, -1), 102);
+
+		//empty ID and prefix of other ID
+		index.insert("", 0, 300);
+		index.insert("rea", 3, 301);
+		I_EQUAL(index.count(), 4);
+		I_EQUAL(index.value("", 0, -1), 300);
+		I_EQUAL(index.value("rea", 3, -1), 301);
+		I_EQUAL(index.value("read1", 5, -1), 201);
+	}
+
+	void growth_and_collisions()
+	{
+		for (int prefilter=0; prefilter<2; ++prefilter)
+		{
+			ReadIdIndex index(prefilter==1);
+			qint64 slots = index.slotCount();
+
+			//similar IDs of different length, so that there are many collisions of neighboring slots
+			for (int i=0; i<20000; ++i)
+			{
+				QByteArray id = "@M00123:45:000000000-A1B2C:1:1101:" + QByteArray::number(i);
+				index.insert(id.constData(), id.length(), i);
+			}
+			I_EQUAL(index.count(), 20000);
+			IS_TRUE(index.slotCount()>slots);
+			IS_TRUE(index.count()*100 <= index.slotCount()*70);
+
+			//all IDs are found after growing
+			int errors = 0;
+			for (int i=0; i<20000; ++i)
+			{
+				QByteArray id = "@M00123:45:000000000-A1B2C:1:1101:" + QByteArray::number(i);
+				if (index.value(id.constData(), id.length(), -1)!=i) ++errors;
+			}
+			I_EQUAL(errors, 0);
+
+			//IDs that are not contained are not found (with and without prefilter)
+			for (int i=20000; i<40000; ++i)
+			{
+				QByteArray id = "@M00123:45:000000000-A1B2C:1:1101:" + QByteArray::number(i);
+				if (index.value(id.constData(), id.length(), -1)!=-1) ++errors;
+			}
+			I_EQUAL(errors, 0);
+
+			//replacing values after growing
+			for (int i=0; i<20000; i+=2)
+			{
+				QByteArray id = "@M00123:45:000000000-A1B2C:1:1101:" + QByteArray::number(i);
+				index.insert(id.constData(), id.length(), -i);
+			}
+			I_EQUAL(index.count(), 20000);
+			for (int i=0; i<20000; ++i)
+			{
+				QByteArray id = "@M00123:45:000000000-A1B2C:1:1101:" + QByteArray::number(i);
+				if (index.value(id.constData(), id.length(), 1)!=(i%2==0 ? -i : i)) ++errors;
+			}
+			I_EQUAL(errors, 0);
+		}
+	}
+};
@@ -0,0 +1,32 @@
+#include "TestFramework.h"
+#include "VcfExternalSort.h"
+
+TEST_CLASS(VcfExternalSort_Test)
+{
+Q_OBJECT
+private slots:
+
+	void in_memory()
+	{
+		VcfExternalSort sorter;
+		sorter.sort(TESTDATA("data_in/sort_in.vcf"), "out/VcfExternalSort_out1.vcf");
+		I_EQUAL(sorter.runCount(), 0);
+		COMPARE_FILES("out/VcfExternalSort_out1.vcf", TESTDATA("data_out/VcfExternalSort_out.vcf"));
+	}
+
+	void spilled()
+	{
+		VcfExternalSort sorter("", 0);
+		sorter.sort(TESTDATA("data_in/sort_in.vcf"), "out/VcfExternalSort_out2.vcf");
+		IS_TRUE(sorter.runCount()>1);
+		COMPARE_FILES("out/VcfExternalSort_out2.vcf", TESTDATA("data_out/VcfExternalSort_out.vcf"));
+	}
+
+	void spilled_multithreaded()
+	{
+		VcfExternalSort sorter("", 0, 4);
+		sorter.sort(TESTDATA("data_in/sort_in.vcf"), "out/VcfExternalSort_out3.vcf");
+		IS_TRUE(sorter.runCount()>1);
+		COMPARE_FILES("out/VcfExternalSort_out3.vcf", TESTDATA("data_out/VcfExternalSort_out.vcf"));
+	}
+};
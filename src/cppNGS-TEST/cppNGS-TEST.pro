@@ -50,7 +50,15 @@ HEADERS += \
         FastqFileStream_Test.h \
         FastaFileIndex_Test.h \
         QCCollection_Test.h \
-        StatisticsReads_Test.h
+        StatisticsReads_Test.h \
+        BamMateCache_Test.h \
+        BamFileStream_Test.h \
+        VcfExternalSort_Test.h \
+        BedChunkRunner_Test.h \
+        KmerCounter_Test.h \
+        Profiler_Test.h \
+        BedFileStream_Test.h \
+        ReadIdIndex_Test.h
 
 SOURCES += \
         main.cpp
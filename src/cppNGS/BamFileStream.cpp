@@ -0,0 +1,376 @@
+#include "BamFileStream.h"
+#include "Exceptions.h"
+#include <cstring>
+#include <cctype>
+
+using namespace BamTools;
+
+static qint32 toInt32(const char* p)
+{
+	qint32 value;
+	memcpy(&value, p, 4);
+	return value;
+}
+
+static quint16 toUInt16(const char* p)
+{
+	quint16 value;
+	memcpy(&value, p, 2);
+	return value;
+}
+
+static void appendInt32(QByteArray& data, qint32 value)
+{
+	data.append((const char*)&value, 4);
+}
+
+static void appendUInt16(QByteArray& data, quint16 value)
+{
+	data.append((const char*)&value, 2);
+}
+
+static const char* CIGAR_OPS = "MIDNSHP=X";
+static const char* SEQ_BASES = "=ACMGRSVTWYHKDBN";
+
+///Lookup table from base character to 4-bit code (case-insensitive, 15='N' for invalid characters).
+class SeqBaseCodes
+{
+public:
+	SeqBaseCodes()
+	{
+		for (int i=0; i<256; ++i) codes_[i] = 15;
+		for (int i=0; i<16; ++i)
+		{
+			codes_[(uchar)SEQ_BASES[i]] = i;
+			codes_[(uchar)tolower(SEQ_BASES[i])] = i;
+		}
+	}
+
+	int code(char base) const
+	{
+		return codes_[(uchar)base];
+	}
+
+protected:
+	int codes_[256];
+};
+static const SeqBaseCodes SEQ_CODES;
+
+BamInfileStream::BamInfileStream(QString filename, int threads)
+	: filename_(filename)
+	, stream_(filename, threads)
+	, core_only_(false)
+{
+	//magic
+	char magic[4];
+	readData(magic, 4);
+	if (memcmp(magic, "BAM\1", 4)!=0)
+	{
+		THROW(FileParseException, "File '" + filename + "' is not a BAM file!");
+	}
+
+	//header text
+	qint32 l_text = readInt32();
+	if (l_text<0) THROW(FileParseException, "Invalid header length in BAM file '" + filename + "'!");
+	QByteArray text(l_text, '\0');
+	readData(text.data(), l_text);
+	header_text_ = std::string(text.constData(), qstrnlen(text.constData(), l_text));
+	header_.SetHeaderText(header_text_);
+
+	//references
+	qint32 n_ref = readInt32();
+	if (n_ref<0) THROW(FileParseException, "Invalid reference count in BAM file '" + filename + "'!");
+	references_.reserve(n_ref);
+	for (int i=0; i<n_ref; ++i)
+	{
+		qint32 l_name = readInt32();
+		if (l_name<1) THROW(FileParseException, "Invalid reference name length in BAM file '" + filename + "'!");
+		QByteArray name(l_name, '\0');
+		readData(name.data(), l_name);
+		qint32 l_ref = readInt32();
+		references_.push_back(RefData(std::string(name.constData(), l_name-1), l_ref));
+	}
+}
+
+bool BamInfileStream::GetNextAlignment(BamAlignment& al)
+{
+	return readAlignment(al, false);
+}
+
+bool BamInfileStream::GetNextAlignmentCore(BamAlignment& al)
+{
+	return readAlignment(al, true);
+}
+
+void BamInfileStream::readData(char* data, int size)
+{
+	if (stream_.read(data, size)!=size)
+	{
+		THROW(FileParseException, "Unexpected end of BAM file '" + filename_ + "'!");
+	}
+}
+
+qint32 BamInfileStream::readInt32()
+{
+	char data[4];
+	readData(data, 4);
+	return toInt32(data);
+}
+
+bool BamInfileStream::readAlignment(BamAlignment& al, bool core_only)
+{
+	//block size
+	char size_data[4];
+	int read = stream_.read(size_data, 4);
+	if (read==0) return false;
+	if (read!=4) THROW(FileParseException, "Unexpected end of BAM file '" + filename_ + "'!");
+	qint32 block_size = toInt32(size_data);
+	if (block_size<32) THROW(FileParseException, "Invalid alignment record size in BAM file '" + filename_ + "'!");
+
+	//record
+	record_.resize(block_size);
+	readData(record_.data(), block_size);
+	const char* data = record_.constData();
+	const char* end = data + block_size;
+
+	//core data
+	al.RefID = toInt32(data);
+	al.Position = toInt32(data+4);
+	int l_read_name = (uchar)data[8];
+	al.MapQuality = (uchar)data[9];
+	al.Bin = toUInt16(data+10);
+	int n_cigar = toUInt16(data+12);
+	al.AlignmentFlag = toUInt16(data+14);
+	int l_seq = toInt32(data+16);
+	al.MateRefID = toInt32(data+20);
+	al.MatePosition = toInt32(data+24);
+	al.InsertSize = toInt32(data+28);
+	al.Length = l_seq;
+
+	//variable-length data
+	const char* name = data + 32;
+	const char* cigar = name + l_read_name;
+	const char* seq = cigar + 4 * n_cigar;
+	const char* qual = seq + (l_seq + 1) / 2;
+	const char* tags = qual + l_seq;
+	if (l_seq<0 || tags>end)
+	{
+		THROW(FileParseException, "Invalid alignment record in BAM file '" + filename_ + "'!");
+	}
+
+	//CIGAR
+	al.CigarData.clear();
+	al.CigarData.reserve(n_cigar);
+	for (int i=0; i<n_cigar; ++i)
+	{
+		quint32 op = (quint32)toInt32(cigar + 4*i);
+		if ((op & 0xf)>8) THROW(FileParseException, "Invalid CIGAR operation in BAM file '" + filename_ + "'!");
+		al.CigarData.push_back(CigarOp(CIGAR_OPS[op & 0xf], op >> 4));
+	}
+
+	core_only_ = core_only;
+	if (core_only)
+	{
+		al.Name.clear();
+		al.QueryBases.clear();
+		al.AlignedBases.clear();
+		al.Qualities.clear();
+		al.TagData.clear();
+		return true;
+	}
+
+	parseCharData(al);
+	return true;
+}
+
+void BamInfileStream::BuildCharData(BamAlignment& al)
+{
+	if (!core_only_)
+	{
+		THROW(ProgrammingException, "BamInfileStream::BuildCharData can only be called for the last alignment read with GetNextAlignmentCore!");
+	}
+	core_only_ = false;
+
+	parseCharData(al);
+}
+
+void BamInfileStream::parseCharData(BamAlignment& al)
+{
+	//variable-length data (the record was checked in readAlignment)
+	const char* data = record_.constData();
+	const char* end = data + record_.size();
+	int l_read_name = (uchar)data[8];
+	int n_cigar = toUInt16(data+12);
+	int l_seq = toInt32(data+16);
+	const char* name = data + 32;
+	const char* seq = name + l_read_name + 4 * n_cigar;
+	const char* qual = seq + (l_seq + 1) / 2;
+	const char* tags = qual + l_seq;
+
+	//name
+	al.Name.assign(name, l_read_name>0 ? l_read_name-1 : 0);
+
+	//bases and qualities
+	al.QueryBases.resize(l_seq);
+	al.Qualities.resize(l_seq);
+	for (int i=0; i<l_seq; ++i)
+	{
+		al.QueryBases[i] = SEQ_BASES[(seq[i/2] >> (i%2==0 ? 4 : 0)) & 0xf];
+		al.Qualities[i] = (char)(qual[i] + 33);
+	}
+
+	//aligned bases (same representation as in BamTools)
+	al.AlignedBases.clear();
+	if (l_seq>0)
+	{
+		al.AlignedBases.reserve(l_seq);
+		int pos = 0;
+		for (int i=0; i<n_cigar; ++i)
+		{
+			const CigarOp& op = al.CigarData[i];
+			switch(op.Type)
+			{
+				case 'M':
+				case '=':
+				case 'X':
+				case 'I':
+					al.AlignedBases.append(al.QueryBases, pos, op.Length);
+					pos += op.Length;
+					break;
+				case 'S':
+					pos += op.Length;
+					break;
+				case 'D':
+					al.AlignedBases.append(op.Length, '-');
+					break;
+				case 'P':
+					al.AlignedBases.append(op.Length, '*');
+					break;
+				case 'N':
+					al.AlignedBases.append(op.Length, 'N');
+					break;
+			}
+		}
+	}
+
+	//tags
+	al.TagData.assign(tags, end - tags);
+}
+
+BamOutfileStream::BamOutfileStream(QString filename, const std::string& header_text, const RefVector& references, int threads, int level)
+	: filename_(filename)
+	, stream_(filename, threads, level)
+{
+	writeHeader(header_text, references);
+}
+
+BamOutfileStream::BamOutfileStream(QString filename, const SamHeader& header, const RefVector& references, int threads, int level)
+	: filename_(filename)
+	, stream_(filename, threads, level)
+{
+	writeHeader(header.ToString(), references);
+}
+
+void BamOutfileStream::SaveAlignment(const BamAlignment& al)
+{
+	int l_read_name = (int)al.Name.size() + 1;
+	if (l_read_name>255) THROW(ArgumentException, "Alignment name too long: " + QString::fromStdString(al.Name));
+	int n_cigar = (int)al.CigarData.size();
+	if (n_cigar>65535) THROW(ArgumentException, "Too many CIGAR operations in alignment " + QString::fromStdString(al.Name));
+	int l_seq = al.QueryBases=="*" ? 0 : (int)al.QueryBases.size();
+	bool has_qualities = (int)al.Qualities.size()==l_seq && al.Qualities!="*";
+
+	//bin (calculated from the reference end position)
+	int end = al.Position;
+	for (int i=0; i<n_cigar; ++i)
+	{
+		const CigarOp& op = al.CigarData[i];
+		if (op.Type=='M' || op.Type=='D' || op.Type=='N' || op.Type=='=' || op.Type=='X') end += op.Length;
+	}
+	if (end==al.Position) end += 1;
+
+	//core data
+	int block_size = 32 + l_read_name + 4*n_cigar + (l_seq+1)/2 + l_seq + (int)al.TagData.size();
+	record_.resize(0);
+	appendInt32(record_, block_size);
+	appendInt32(record_, al.RefID);
+	appendInt32(record_, al.Position);
+	record_.append((char)l_read_name);
+	record_.append((char)al.MapQuality);
+	appendUInt16(record_, reg2bin(al.Position, end));
+	appendUInt16(record_, n_cigar);
+	appendUInt16(record_, al.AlignmentFlag);
+	appendInt32(record_, l_seq);
+	appendInt32(record_, al.MateRefID);
+	appendInt32(record_, al.MatePosition);
+	appendInt32(record_, al.InsertSize);
+
+	//name
+	record_.append(al.Name.data(), l_read_name-1);
+	record_.append('\0');
+
+	//CIGAR
+	for (int i=0; i<n_cigar; ++i)
+	{
+		const CigarOp& op = al.CigarData[i];
+		const char* type = strchr(CIGAR_OPS, op.Type);
+		if (type==nullptr || op.Type=='\0') THROW(ArgumentException, "Invalid CIGAR operation '" + QString(QChar(op.Type)) + "' in alignment " + QString::fromStdString(al.Name));
+		appendInt32(record_, (qint32)((op.Length << 4) | (quint32)(type - CIGAR_OPS)));
+	}
+
+	//bases (4 bits per base)
+	for (int i=0; i<l_seq; i+=2)
+	{
+		int code = SEQ_CODES.code(al.QueryBases[i]) << 4;
+		if (i+1<l_seq)
+		{
+			code |= SEQ_CODES.code(al.QueryBases[i+1]);
+		}
+		record_.append((char)code);
+	}
+
+	//qualities
+	for (int i=0; i<l_seq; ++i)
+	{
+		record_.append(has_qualities ? (char)(al.Qualities[i] - 33) : (char)0xff);
+	}
+
+	//tags
+	record_.append(al.TagData.data(), (int)al.TagData.size());
+
+	stream_.write(record_.constData(), record_.size());
+}
+
+void BamOutfileStream::Close()
+{
+	stream_.close();
+}
+
+void BamOutfileStream::writeHeader(const std::string& header_text, const RefVector& references)
+{
+	record_.resize(0);
+	record_.append("BAM\1", 4);
+	appendInt32(record_, (qint32)header_text.size());
+	record_.append(header_text.data(), (int)header_text.size());
+	appendInt32(record_, (qint32)references.size());
+	for (unsigned int i=0; i<references.size(); ++i)
+	{
+		const RefData& ref = references[i];
+		appendInt32(record_, (qint32)ref.RefName.size() + 1);
+		record_.append(ref.RefName.data(), (int)ref.RefName.size());
+		record_.append('\0');
+		appendInt32(record_, ref.RefLength);
+	}
+	stream_.write(record_.constData(), record_.size());
+}
+
+int BamOutfileStream::reg2bin(int start, int end)
+{
+	--end;
+	if (start>>14 == end>>14) return ((1<<15)-1)/7 + (start>>14);
+	if (start>>17 == end>>17) return ((1<<12)-1)/7 + (start>>17);
+	if (start>>20 == end>>20) return ((1<<9)-1)/7 + (start>>20);
+	if (start>>23 == end>>23) return ((1<<6)-1)/7 + (start>>23);
+	if (start>>26 == end>>26) return ((1<<3)-1)/7 + (start>>26);
+	return 0;
+}
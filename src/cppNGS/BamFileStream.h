@@ -0,0 +1,119 @@
+#ifndef BAMFILESTREAM_H
+#define BAMFILESTREAM_H
+
+#include "cppNGS_global.h"
+#include "BgzfFileStream.h"
+#include "api/BamAlignment.h"
+#include "api/BamAux.h"
+#include "api/SamHeader.h"
+#include <string>
+
+/**
+  @brief Sequential BAM file reader with multi-threaded decompression.
+
+  Provides the part of the BamTools::BamReader interface used for streaming through a BAM file.
+  Random access (SetRegion) is not supported - use BamTools::BamReader for that.
+*/
+class CPPNGSSHARED_EXPORT BamInfileStream
+{
+public:
+	///Constructor. @p threads is the number of threads used for decompression.
+	BamInfileStream(QString filename, int threads = 1);
+
+	///Reads the next alignment including string data (name, bases, qualities, tags). Returns 'false' at the end of the file.
+	bool GetNextAlignment(BamTools::BamAlignment& al);
+	///Reads the next alignment without string data (core data and CIGAR only). Returns 'false' at the end of the file.
+	///@note BamTools::BamAlignment::BuildCharData() does nothing for these alignments (the BamTools support data is not accessible). Use BuildCharData() of the stream instead.
+	bool GetNextAlignmentCore(BamTools::BamAlignment& al);
+	///Decodes the string data (name, bases, qualities, tags) of the last alignment, which must have been read with GetNextAlignmentCore. Throws ProgrammingException otherwise.
+	void BuildCharData(BamTools::BamAlignment& al);
+
+	///Returns the header text.
+	std::string GetHeaderText() const
+	{
+		return header_text_;
+	}
+	///Returns the header.
+	const BamTools::SamHeader& GetConstSamHeader() const
+	{
+		return header_;
+	}
+	///Returns the reference sequences.
+	const BamTools::RefVector& GetReferenceData() const
+	{
+		return references_;
+	}
+	///Returns the file name.
+	const QString& filename() const
+	{
+		return filename_;
+	}
+	///Jumps to a virtual file offset taken from the BAM index (see BamIndexFile).
+	void seek(qint64 virtual_offset)
+	{
+		stream_.seek(virtual_offset);
+	}
+
+	///Closes the file (for compatibility with BamTools::BamReader - the file is closed on destruction).
+	void Close()
+	{
+	}
+
+protected:
+	QString filename_;
+	BgzfInfileStream stream_;
+	std::string header_text_;
+	BamTools::SamHeader header_;
+	BamTools::RefVector references_;
+	QByteArray record_;
+	bool core_only_;
+
+	///Reads @p size bytes or throws an exception.
+	void readData(char* data, int size);
+	///Reads a 32-bit integer.
+	qint32 readInt32();
+	///Reads and parses the next record.
+	bool readAlignment(BamTools::BamAlignment& al, bool core_only);
+	///Parses the string data of the current record.
+	void parseCharData(BamTools::BamAlignment& al);
+
+	//declared away methods
+	BamInfileStream(const BamInfileStream&);
+	BamInfileStream& operator=(const BamInfileStream&);
+};
+
+/**
+  @brief Sequential BAM file writer with multi-threaded compression.
+
+  Provides the part of the BamTools::BamWriter interface used for writing a BAM file.
+  @note The alignments have to contain string data, i.e. alignments read with GetNextAlignmentCore cannot be written.
+*/
+class CPPNGSSHARED_EXPORT BamOutfileStream
+{
+public:
+	///Constructor. @p threads is the number of threads used for compression.
+	BamOutfileStream(QString filename, const std::string& header_text, const BamTools::RefVector& references, int threads = 1, int level = Z_DEFAULT_COMPRESSION);
+	///Constructor. @p threads is the number of threads used for compression.
+	BamOutfileStream(QString filename, const BamTools::SamHeader& header, const BamTools::RefVector& references, int threads = 1, int level = Z_DEFAULT_COMPRESSION);
+
+	///Writes an alignment.
+	void SaveAlignment(const BamTools::BamAlignment& al);
+	///Writes remaining data and closes the file.
+	void Close();
+
+protected:
+	QString filename_;
+	BgzfOutfileStream stream_;
+	QByteArray record_;
+
+	///Writes the BAM header.
+	void writeHeader(const std::string& header_text, const BamTools::RefVector& references);
+	///Returns the BAI bin of the region [@p start, @p end).
+	static int reg2bin(int start, int end);
+
+	//declared away methods
+	BamOutfileStream(const BamOutfileStream&);
+	BamOutfileStream& operator=(const BamOutfileStream&);
+};
+
+#endif // BAMFILESTREAM_H
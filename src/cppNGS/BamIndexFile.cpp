@@ -0,0 +1,138 @@
+#include "BamIndexFile.h"
+#include "Exceptions.h"
+#include "Helper.h"
+#include <cstring>
+#include <algorithm>
+
+//parser for the little-endian binary BAI format
+class BaiParser
+{
+public:
+	BaiParser(const QByteArray& data, QString filename)
+		: data_(data)
+		, filename_(filename)
+		, pos_(0)
+	{
+	}
+
+	bool atEnd() const
+	{
+		return pos_>=data_.size();
+	}
+
+	qint32 readInt32()
+	{
+		qint32 value;
+		read(&value, 4);
+		return value;
+	}
+
+	qint64 readInt64()
+	{
+		qint64 value;
+		read(&value, 8);
+		return value;
+	}
+
+	void skip(qint64 size)
+	{
+		if (size<0 || pos_+size>data_.size()) THROW(FileParseException, "Truncated BAM index file '" + filename_ + "'!");
+		pos_ += size;
+	}
+
+protected:
+	const QByteArray& data_;
+	QString filename_;
+	qint64 pos_;
+
+	void read(void* value, int size)
+	{
+		if (pos_+size>data_.size()) THROW(FileParseException, "Truncated BAM index file '" + filename_ + "'!");
+		memcpy(value, data_.constData()+pos_, size);
+		pos_ += size;
+	}
+};
+
+BamIndexFile::BamIndexFile(QString filename)
+	: filename_(filename)
+	, max_end_(0)
+	, unplaced_count_(-1)
+{
+	QByteArray data = Helper::openFileForReading(filename)->readAll();
+	if (!data.startsWith(QByteArray("BAI\1", 4)))
+	{
+		THROW(FileParseException, "File '" + filename + "' is not a BAM index file!");
+	}
+
+	BaiParser parser(data, filename);
+	parser.skip(4);
+	int n_ref = parser.readInt32();
+	linear_.resize(n_ref);
+	ref_begin_.fill(-1, n_ref);
+	for (int r=0; r<n_ref; ++r)
+	{
+		//bins
+		int n_bin = parser.readInt32();
+		for (int b=0; b<n_bin; ++b)
+		{
+			quint32 bin = (quint32)parser.readInt32();
+			int n_chunk = parser.readInt32();
+
+			//pseudo-bin with meta data (no alignment chunks)
+			if (bin==37450)
+			{
+				parser.skip(16ll * n_chunk);
+				continue;
+			}
+
+			for (int c=0; c<n_chunk; ++c)
+			{
+				qint64 chunk_begin = parser.readInt64();
+				qint64 chunk_end = parser.readInt64();
+				if (ref_begin_[r]==-1 || chunk_begin<ref_begin_[r]) ref_begin_[r] = chunk_begin;
+				max_end_ = std::max(max_end_, chunk_end);
+			}
+		}
+
+		//linear index
+		int n_intv = parser.readInt32();
+		linear_[r].resize(n_intv);
+		for (int i=0; i<n_intv; ++i)
+		{
+			linear_[r][i] = parser.readInt64();
+		}
+	}
+
+	//optional number of unplaced alignments
+	if (!parser.atEnd())
+	{
+		unplaced_count_ = parser.readInt64();
+	}
+}
+
+qint64 BamIndexFile::offset(int ref_id, int pos) const
+{
+	if (ref_id<0 || ref_id>=linear_.count())
+	{
+		THROW(ArgumentException, "Invalid reference ID '" + QString::number(ref_id) + "' for BAM index file '" + filename_ + "'!");
+	}
+
+	//no alignments in/after the 16kb window
+	const QVector<qint64>& linear = linear_[ref_id];
+	int window = std::max(0, pos) >> 14;
+	if (window>=linear.count()) return -1;
+
+	//empty windows have offset 0 => use the closest preceding window or the reference start
+	for (int w=window; w>=0; --w)
+	{
+		if (linear[w]>0) return linear[w];
+	}
+	return ref_begin_[ref_id];
+}
+
+qint64 BamIndexFile::unplacedOffset() const
+{
+	if (unplaced_count_==0) return -1;
+
+	return max_end_;
+}
@@ -0,0 +1,37 @@
+#ifndef BAMINDEXFILE_H
+#define BAMINDEXFILE_H
+
+#include "cppNGS_global.h"
+#include <QString>
+#include <QVector>
+
+/**
+  @brief BAM index (BAI) file reader.
+
+  Provides virtual file offsets from the linear index, e.g. to split a BAM file into shards that are processed in parallel using BamInfileStream::seek().
+*/
+class CPPNGSSHARED_EXPORT BamIndexFile
+{
+public:
+	///Constructor - loads the BAI file.
+	BamIndexFile(QString filename);
+
+	///Returns the number of references.
+	int referenceCount() const
+	{
+		return linear_.count();
+	}
+	///Returns a virtual file offset before all alignments of reference @p ref_id that start at or after the 0-based position @p pos. Returns -1 if there are no such alignments.
+	qint64 offset(int ref_id, int pos) const;
+	///Returns the virtual file offset after all alignments with reference, i.e. the offset of the unplaced alignments. Returns 0 if there are no alignments with reference (i.e. the unplaced alignments directly follow the header) and -1 if it is known that there are no unplaced alignments.
+	qint64 unplacedOffset() const;
+
+protected:
+	QString filename_;
+	QVector<QVector<qint64> > linear_;
+	QVector<qint64> ref_begin_;
+	qint64 max_end_;
+	qint64 unplaced_count_;
+};
+
+#endif // BAMINDEXFILE_H
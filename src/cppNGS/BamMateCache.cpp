@@ -0,0 +1,297 @@
+#include "BamMateCache.h"
+#include "Exceptions.h"
+#include "Helper.h"
+#include "api/BamWriter.h"
+#include <QFile>
+#include <QSharedPointer>
+#include <QVector>
+#include <algorithm>
+
+using namespace BamTools;
+
+static bool nameLessThan(const BamAlignment* a, const BamAlignment* b)
+{
+	return a->Name < b->Name;
+}
+
+static bool positionLessThan(const BamAlignment* a, const BamAlignment* b)
+{
+	if (a->RefID!=b->RefID) return a->RefID < b->RefID;
+	return a->Position < b->Position;
+}
+
+///Opens a temporary BAM file for reading. Throws FileAccessException.
+static void openRun(BamReader& reader, QString filename)
+{
+	if (!reader.Open(filename.toStdString()))
+	{
+		THROW(FileAccessException, "Could not open temporary BAM file " + filename + "!");
+	}
+}
+
+BamMateCache::BamMateCache(const SamHeader& header, const RefVector& references, int max_memory_mb)
+	: header_(header)
+	, references_(references)
+	, max_memory_(1024ll * 1024ll * max_memory_mb)
+	, memory_(0)
+	, cache_()
+	, runs_()
+	, spilled_(0)
+	, merging_(false)
+	, remaining_index_(0)
+	, has_peeked_(false)
+{
+}
+
+BamMateCache::~BamMateCache()
+{
+	foreach(BamReader* run_reader, run_readers_)
+	{
+		run_reader->Close();
+		delete run_reader;
+	}
+	foreach(QString run, runs_)
+	{
+		QFile::remove(run);
+	}
+}
+
+bool BamMateCache::takeMate(const BamAlignment& al, BamAlignment& mate)
+{
+	if (merging_) THROW(ProgrammingException, "Alignments cannot be added to BamMateCache after merging was started!");
+
+	QByteArray name(al.Name.data(), (int)al.Name.size());
+	QHash<QByteArray, BamAlignment>::iterator it = cache_.find(name);
+	if (it!=cache_.end())
+	{
+		mate = it.value();
+		memory_ -= memoryUsage(mate);
+		cache_.erase(it);
+		return true;
+	}
+
+	cache_.insert(name, al);
+	memory_ += memoryUsage(al);
+	if (memory_>max_memory_)
+	{
+		spill();
+	}
+
+	return false;
+}
+
+bool BamMateCache::nextRemaining(BamAlignment& al, BamAlignment& mate, bool& paired)
+{
+	if (!merging_) startMerge();
+
+	//get next alignment (peeked alignment of the last call first)
+	if (has_peeked_)
+	{
+		al = peeked_;
+		has_peeked_ = false;
+	}
+	else if (!nextMerged(al))
+	{
+		return false;
+	}
+
+	//check if the next alignment is the mate
+	has_peeked_ = nextMerged(peeked_);
+	paired = has_peeked_ && peeked_.Name==al.Name;
+	if (paired)
+	{
+		has_peeked_ = false;
+		if (peeked_.RefID<al.RefID || (peeked_.RefID==al.RefID && peeked_.Position<al.Position))
+		{
+			mate = peeked_;
+		}
+		else
+		{
+			mate = al;
+			al = peeked_;
+		}
+	}
+
+	return true;
+}
+
+void BamMateCache::spill()
+{
+	//determine the oldest alignments (the input is coordinate-sorted, i.e. the mates of the newest alignments are likely to follow soon)
+	QVector<const BamAlignment*> alignments;
+	alignments.reserve(cache_.count());
+	for (QHash<QByteArray, BamAlignment>::const_iterator it=cache_.constBegin(); it!=cache_.constEnd(); ++it)
+	{
+		alignments.append(&(it.value()));
+	}
+	std::sort(alignments.begin(), alignments.end(), positionLessThan);
+
+	//spill the oldest alignments until half of the memory budget is free
+	qint64 memory_spilled = 0;
+	int count = 0;
+	while (count<alignments.count() && memory_ - memory_spilled > max_memory_ / 2)
+	{
+		memory_spilled += memoryUsage(*alignments[count]);
+		++count;
+	}
+	alignments.resize(count);
+	std::sort(alignments.begin(), alignments.end(), nameLessThan);
+
+	//write run
+	QString filename = Helper::tempFileName(".bam");
+	BamWriter writer;
+	if (!writer.Open(filename.toStdString(), header_, references_))
+	{
+		THROW(FileAccessException, "Could not open temporary BAM file " + filename + " for writing!");
+	}
+	foreach(const BamAlignment* al, alignments)
+	{
+		writer.SaveAlignment(*al);
+	}
+	writer.Close();
+	runs_ << filename;
+	spilled_ += alignments.count();
+
+	//remove spilled alignments from cache
+	QList<QByteArray> names;
+	foreach(const BamAlignment* al, alignments)
+	{
+		names << QByteArray(al->Name.data(), (int)al->Name.size());
+	}
+	foreach(const QByteArray& name, names)
+	{
+		cache_.remove(name);
+	}
+	memory_ -= memory_spilled;
+}
+
+QString BamMateCache::mergeRuns(const QStringList& runs)
+{
+	//open runs
+	QList<QSharedPointer<BamReader> > readers;
+	QList<BamAlignment> heads;
+	QList<bool> valid;
+	foreach(QString run, runs)
+	{
+		readers.append(QSharedPointer<BamReader>(new BamReader()));
+		openRun(*readers.last(), run);
+		heads.append(BamAlignment());
+		valid.append(readers.last()->GetNextAlignment(heads.last()));
+	}
+
+	//merge by name
+	QString filename = Helper::tempFileName(".bam");
+	BamWriter writer;
+	if (!writer.Open(filename.toStdString(), header_, references_))
+	{
+		THROW(FileAccessException, "Could not open temporary BAM file " + filename + " for writing!");
+	}
+	while (true)
+	{
+		int best = -1;
+		for (int i=0; i<heads.count(); ++i)
+		{
+			if (valid[i] && (best==-1 || heads[i].Name<heads[best].Name)) best = i;
+		}
+		if (best==-1) break;
+
+		writer.SaveAlignment(heads[best]);
+		valid[best] = readers[best]->GetNextAlignment(heads[best]);
+	}
+	writer.Close();
+
+	return filename;
+}
+
+void BamMateCache::startMerge()
+{
+	merging_ = true;
+
+	//sort remaining cached alignments by name
+	QVector<const BamAlignment*> alignments;
+	alignments.reserve(cache_.count());
+	for (QHash<QByteArray, BamAlignment>::const_iterator it=cache_.constBegin(); it!=cache_.constEnd(); ++it)
+	{
+		alignments.append(&(it.value()));
+	}
+	std::sort(alignments.begin(), alignments.end(), nameLessThan);
+	foreach(const BamAlignment* al, alignments)
+	{
+		remaining_.append(*al);
+	}
+	cache_.clear();
+	memory_ = 0;
+
+	//merge runs in several passes if there are too many runs to open them at once (the in-memory alignments count as one run)
+	while (runs_.count()>MAX_MERGE_RUNS-1)
+	{
+		QStringList merged;
+		for (int i=0; i<runs_.count(); i+=MAX_MERGE_RUNS)
+		{
+			QStringList runs = runs_.mid(i, MAX_MERGE_RUNS);
+			if (runs.count()==1)
+			{
+				merged << runs;
+				continue;
+			}
+			merged << mergeRuns(runs);
+			foreach(QString run, runs)
+			{
+				QFile::remove(run);
+			}
+		}
+		runs_ = merged;
+	}
+
+	//open runs
+	foreach(QString run, runs_)
+	{
+		BamReader* run_reader = new BamReader();
+		run_readers_.append(run_reader);
+		openRun(*run_reader, run);
+		run_heads_.append(BamAlignment());
+		run_valid_.append(run_reader->GetNextAlignment(run_heads_.last()));
+	}
+}
+
+bool BamMateCache::nextMerged(BamAlignment& al)
+{
+	//determine source with the smallest name (-1 is the in-memory list)
+	int best = -2;
+	const BamAlignment* best_al = 0;
+	if (remaining_index_<remaining_.count())
+	{
+		best = -1;
+		best_al = &(remaining_[remaining_index_]);
+	}
+	for (int i=0; i<run_heads_.count(); ++i)
+	{
+		if (!run_valid_[i]) continue;
+
+		if (best_al==0 || run_heads_[i].Name<best_al->Name)
+		{
+			best = i;
+			best_al = &(run_heads_[i]);
+		}
+	}
+	if (best==-2) return false;
+
+	//take alignment and advance source
+	al = *best_al;
+	if (best==-1)
+	{
+		++remaining_index_;
+	}
+	else
+	{
+		run_valid_[best] = run_readers_[best]->GetNextAlignment(run_heads_[best]);
+	}
+
+	return true;
+}
+
+qint64 BamMateCache::memoryUsage(const BamAlignment& al)
+{
+	//alignment + string data + hash key + hash node overhead
+	return sizeof(BamAlignment) + al.Name.capacity() + al.QueryBases.capacity() + al.AlignedBases.capacity() + al.Qualities.capacity() + al.TagData.capacity() + al.CigarData.capacity() * sizeof(CigarOp) + al.Name.size() + 64;
+}
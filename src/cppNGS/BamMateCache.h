@@ -0,0 +1,86 @@
+#ifndef BAMMATECACHE_H
+#define BAMMATECACHE_H
+
+#include "cppNGS_global.h"
+#include "api/BamReader.h"
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+
+/**
+  @brief Cache for pairing mates while streaming a coordinate-sorted BAM file.
+
+  Alignments are cached by read name until their mate is found.
+  If the cached alignments exceed the memory budget, the oldest alignments (lowest position) are written to a name-sorted temporary BAM file (run) and removed from memory until half of the budget is free.
+  After the last alignment was added, the runs and the remaining cached alignments are merged by name to pair the spilled mates. If there are many runs, they are merged in several passes.
+*/
+class CPPNGSSHARED_EXPORT BamMateCache
+{
+public:
+	///Constructor. The header and references are used for temporary files.
+	BamMateCache(const BamTools::SamHeader& header, const BamTools::RefVector& references, int max_memory_mb = 1000);
+	///Destructor - removes temporary files.
+	~BamMateCache();
+
+	///Returns the cached mate of @p al and removes it from the cache. If the mate is not cached, @p al is cached and 'false' is returned.
+	bool takeMate(const BamTools::BamAlignment& al, BamTools::BamAlignment& mate);
+
+	///Returns the number of alignments cached in memory.
+	int count() const
+	{
+		return cache_.count();
+	}
+	///Returns the number of alignments spilled to temporary files.
+	long long spilledCount() const
+	{
+		return spilled_;
+	}
+
+	/**
+	  @brief Returns the next remaining alignment after the last alignment was added (sorted by name).
+	  @param paired Set to 'true' if the mate was found in the spilled alignments. In that case @p mate is set to the mate with the lower position. If 'false', @p al is an alignment whose mate was not found.
+	  @return 'false' if there are no remaining alignments.
+	  @note No alignments can be added once this method was called.
+	*/
+	bool nextRemaining(BamTools::BamAlignment& al, BamTools::BamAlignment& mate, bool& paired);
+
+protected:
+	BamTools::SamHeader header_;
+	BamTools::RefVector references_;
+	qint64 max_memory_;
+	qint64 memory_;
+	QHash<QByteArray, BamTools::BamAlignment> cache_;
+	QStringList runs_;
+	long long spilled_;
+
+	//merging of runs
+	bool merging_;
+	QList<BamTools::BamAlignment> remaining_;
+	int remaining_index_;
+	QList<BamTools::BamReader*> run_readers_;
+	QList<BamTools::BamAlignment> run_heads_;
+	QList<bool> run_valid_;
+	bool has_peeked_;
+	BamTools::BamAlignment peeked_;
+
+	///Writes the oldest cached alignments to a name-sorted temporary file.
+	void spill();
+	///Merges name-sorted runs into a new name-sorted temporary file and returns its name.
+	QString mergeRuns(const QStringList& runs);
+	///Starts merging of runs and remaining cached alignments.
+	void startMerge();
+	///Returns the alignment with the smallest name of all runs and the remaining cached alignments.
+	bool nextMerged(BamTools::BamAlignment& al);
+	///Returns the approximate memory used to cache an alignment.
+	static qint64 memoryUsage(const BamTools::BamAlignment& al);
+
+	///Maximum number of runs that are merged at once.
+	static const int MAX_MERGE_RUNS = 64;
+
+	//declared away methods
+	BamMateCache(const BamMateCache&);
+	BamMateCache& operator=(const BamMateCache&);
+};
+
+#endif // BAMMATECACHE_H
@@ -0,0 +1,125 @@
+#include "BedChunkRunner.h"
+#include "Exceptions.h"
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QVector>
+#include <algorithm>
+
+///Worker thread that processes chunks until all chunks are done.
+class BedChunkWorker
+	: public QRunnable
+{
+public:
+	BedChunkWorker(QList<BedFile>& chunks, QAtomicInt& next, QAtomicInt& failed, const BedChunkProcessor& processor, QString& error)
+		: QRunnable()
+		, chunks_(chunks)
+		, next_(next)
+		, failed_(failed)
+		, processor_(processor.clone())
+		, error_(error)
+	{
+	}
+
+	void run()
+	{
+		try
+		{
+			while (failed_.load()==0)
+			{
+				int index = next_.fetchAndAddOrdered(1);
+				if (index>=chunks_.count()) break;
+
+				processor_->process(chunks_[index]);
+			}
+		}
+		catch(Exception& e)
+		{
+			error_ = e.message();
+			failed_ = 1;
+		}
+
+		//close resources in the worker thread
+		processor_.clear();
+	}
+
+protected:
+	QList<BedFile>& chunks_;
+	QAtomicInt& next_;
+	QAtomicInt& failed_;
+	QSharedPointer<BedChunkProcessor> processor_;
+	QString& error_;
+};
+
+QList<BedFile> BedChunkRunner::split(const BedFile& regions, int count)
+{
+	count = std::max(1, std::min(count, regions.count()));
+
+	//determine base count
+	long long bases = 0;
+	for (int i=0; i<regions.count(); ++i)
+	{
+		bases += regions[i].length();
+	}
+
+	//create chunks
+	QList<BedFile> output;
+	BedFile chunk;
+	long long chunk_bases = 0;
+	for (int i=0; i<regions.count(); ++i)
+	{
+		chunk.append(regions[i]);
+		chunk_bases += regions[i].length();
+		if (output.count()<count-1 && chunk_bases * count >= bases * (output.count()+1))
+		{
+			output << chunk;
+			chunk.clear();
+		}
+	}
+	if (chunk.count()>0) output << chunk;
+
+	return output;
+}
+
+void BedChunkRunner::run(BedFile& regions, const BedChunkProcessor& processor, int threads)
+{
+	threads = std::max(1, threads);
+
+	//single thread > no chunks needed
+	if (threads==1)
+	{
+		QSharedPointer<BedChunkProcessor> single(processor.clone());
+		single->process(regions);
+		return;
+	}
+
+	//scatter
+	QList<BedFile> chunks = split(regions, threads * CHUNKS_PER_THREAD);
+	threads = std::min(threads, chunks.count());
+	QAtomicInt next(0);
+	QAtomicInt failed(0);
+	QVector<QString> errors(threads);
+	QThreadPool pool;
+	pool.setMaxThreadCount(threads);
+	for (int i=0; i<threads; ++i)
+	{
+		pool.start(new BedChunkWorker(chunks, next, failed, processor, errors[i]));
+	}
+	pool.waitForDone();
+	foreach(const QString& error, errors)
+	{
+		if (!error.isEmpty()) THROW(Exception, error);
+	}
+
+	//gather
+	int index = 0;
+	foreach(const BedFile& chunk, chunks)
+	{
+		for (int i=0; i<chunk.count(); ++i)
+		{
+			regions[index] = chunk[i];
+			++index;
+		}
+	}
+}
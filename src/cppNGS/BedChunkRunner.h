@@ -0,0 +1,50 @@
+#ifndef BEDCHUNKRUNNER_H
+#define BEDCHUNKRUNNER_H
+
+#include "cppNGS_global.h"
+#include "BedFile.h"
+#include <QList>
+
+/**
+  @brief Processor for chunks of regions used by BedChunkRunner.
+
+  The runner creates one processor per worker thread using clone().
+  Resources that must not be shared between threads (e.g. BAM readers) should be opened in process() and kept open for the next chunk.
+*/
+class CPPNGSSHARED_EXPORT BedChunkProcessor
+{
+public:
+	virtual ~BedChunkProcessor()
+	{
+	}
+
+	///Returns a new processor with the same settings (resources are not shared).
+	virtual BedChunkProcessor* clone() const = 0;
+	///Processes a chunk of regions, e.g. by appending annotations to the lines.
+	virtual void process(BedFile& chunk) = 0;
+};
+
+/**
+  @brief Scatter/gather runner for regions of a BED file.
+
+  The regions are split into chunks of consecutive lines with about the same number of bases.
+  The chunks are processed in parallel by worker threads and the processed lines are written back in the original order.
+  The regions should be sorted, so that each chunk accesses only a small part of a BAM file.
+*/
+class CPPNGSSHARED_EXPORT BedChunkRunner
+{
+public:
+	///Splits @p regions into at most @p count chunks of consecutive lines with about the same number of bases.
+	static QList<BedFile> split(const BedFile& regions, int count);
+	///Processes @p regions using @p threads threads. The processed lines replace the lines of @p regions.
+	static void run(BedFile& regions, const BedChunkProcessor& processor, int threads);
+
+	///Number of chunks per thread (several chunks per thread balance differences in read depth between chunks).
+	static const int CHUNKS_PER_THREAD = 8;
+
+protected:
+	///No default constructor
+	BedChunkRunner();
+};
+
+#endif // BEDCHUNKRUNNER_H
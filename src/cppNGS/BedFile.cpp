@@ -1,7 +1,9 @@
 #include "BedFile.h"
+#include "BedFileStream.h"
 #include "Exceptions.h"
 #include "ChromosomalIndex.h"
 #include "Helper.h"
+#include "Profiler.h"
 #include <QFile>
 #include <QStringList>
 #include <QTextStream>
@@ -95,54 +97,32 @@ QSet<Chromosome> BedFile::chromosomes() const
 
 void BedFile::load(QString filename)
 {
+	ProfilerTimer timer("BedFile::load");
+
 	clear();
 
 	//parse from stream
-	QSharedPointer<QFile> file = Helper::openFileForReading(filename, true);
-	while(!file->atEnd())
+	BedInfileStream stream(filename);
+	while(stream.next())
 	{
-		QByteArray line = file->readLine();
-		while (line.endsWith('\n') || line.endsWith('\r')) line.chop(1);
-
-		//skip empty lines
-		if(line.length()==0) continue;
-
 		//store headers
-		if (line.startsWith("#") || line.startsWith("track ") || line.startsWith("browser "))
+		if (stream.isHeader())
 		{
-			headers_.append(line);
+			headers_.append(QByteArray(stream.line().constData(), stream.line().size()));
 			continue;
 		}
 
-		//error when less than 3 fields
-		QList<QByteArray> fields = line.split('\t');
-		if (fields.count()<3)
-		{
-			THROW(FileParseException, "BED file line with less than three fields found: '" + line.trimmed() + "'");
-		}
-
-		//error when chromosome is empty
-		if (fields[0]=="")
-		{
-			THROW(FileParseException, "Empty BED file chromosome field '" + fields[0] + "'!");
-		}
-
-		//error on position converion
-		int start_pos = Helper::toInt(fields[1], "start position", line);
-		int end_pos = Helper::toInt(fields[2], "end position", line);
-
-		//create line
-		QStringList annos;
-		for (int i=3; i<fields.count(); ++i)
-		{
-			annos.append(fields[i]);
-		}
-		append(BedLine(fields[0], start_pos+1, end_pos, annos));
+		lines_.append(stream.toBedLine());
 	}
+
+	Profiler::addCount("BedFile::load lines", lines_.count());
 }
 
 void BedFile::store(QString filename) const
 {
+	ProfilerTimer timer("BedFile::store");
+	Profiler::addCount("BedFile::store lines", lines_.count());
+
 	//open stream
 	QSharedPointer<QFile> file = Helper::openFileForWriting(filename, true);
 	QTextStream stream(file.data());
@@ -197,9 +177,96 @@ void BedFile::clearHeaders()
 	headers_.clear();
 }
 
+///Converts a signed integer to an unsigned key with the same order.
+static inline quint32 sortKey(int value)
+{
+	return (quint32)value ^ 0x80000000u;
+}
+
+///Minimum number of lines for radix sort (for less lines, the histograms cost more than comparison-based sorting).
+static const int RADIX_SORT_MIN_LINES = 4096;
+
+///One pass of a stable LSD radix sort: sorts @p indices by the 16-bit digit of @p keys at @p shift. The pass is skipped if all keys have the same digit.
+static void radixSortPass(QVector<int>& indices, QVector<int>& tmp, QVector<int>& offsets, const QVector<quint32>& keys, int shift)
+{
+	const int n = indices.count();
+	offsets.fill(0, 65537);
+	for (int i=0; i<n; ++i)
+	{
+		++offsets[((keys[i] >> shift) & 0xFFFF) + 1];
+	}
+	for (int d=1; d<=65536; ++d)
+	{
+		if (offsets[d]==n) return;
+	}
+	for (int d=1; d<=65536; ++d)
+	{
+		offsets[d] += offsets[d-1];
+	}
+	for (int i=0; i<n; ++i)
+	{
+		int index = indices[i];
+		tmp[offsets[(keys[index] >> shift) & 0xFFFF]++] = index;
+	}
+	indices.swap(tmp);
+}
+
+///Stable radix sort of line indices by chromosome, start and end. The positions are given as arrays, the chromosomes as array of numeric representations.
+static QVector<int> radixSortIndices(const QVector<int>& chr_nums, const QVector<int>& starts, const QVector<int>& ends)
+{
+	//the last pass determines the major order
+	const int n = starts.count();
+	QVector<int> indices(n);
+	QVector<int> tmp(n);
+	QVector<int> offsets;
+	for (int i=0; i<n; ++i) indices[i] = i;
+	QVector<quint32> keys(n);
+	for (int pass=0; pass<3; ++pass)
+	{
+		const QVector<int>& values = pass==0 ? ends : (pass==1 ? starts : chr_nums);
+		for (int i=0; i<n; ++i)
+		{
+			keys[i] = sortKey(values[i]);
+		}
+		radixSortPass(indices, tmp, offsets, keys, 0);
+		radixSortPass(indices, tmp, offsets, keys, 16);
+	}
+	return indices;
+}
+
 void BedFile::sort(bool uniq)
 {
-	std::sort(lines_.begin(), lines_.end());
+	ProfilerTimer timer("BedFile::sort");
+
+	const int n = lines_.count();
+	if (n<RADIX_SORT_MIN_LINES)
+	{
+		std::stable_sort(lines_.begin(), lines_.end());
+	}
+	else
+	{
+		//sort line indices using radix sort
+		QVector<int> chr_nums(n);
+		QVector<int> starts(n);
+		QVector<int> ends(n);
+		for (int i=0; i<n; ++i)
+		{
+			const BedLine& line = lines_[i];
+			chr_nums[i] = line.chr().num();
+			starts[i] = line.start();
+			ends[i] = line.end();
+		}
+		QVector<int> indices = radixSortIndices(chr_nums, starts, ends);
+
+		//reorder lines
+		QVector<BedLine> sorted;
+		sorted.reserve(n);
+		for (int i=0; i<n; ++i)
+		{
+			sorted.append(lines_[indices[i]]);
+		}
+		lines_.swap(sorted);
+	}
 
 	//remove duplicates
 	if (uniq)
@@ -210,59 +277,55 @@ void BedFile::sort(bool uniq)
 
 void BedFile::merge(bool merge_back_to_back, bool merge_names)
 {
+	ProfilerTimer timer("BedFile::merge");
+
 	//in the following code, we assume that at least one line is present...
 	if (lines_.count()==0) return;
 
 	//remove annotations data
 	for(int i=0; i<lines_.count(); ++i)
 	{
+		QStringList& annos = lines_[i].annotations();
 		if (merge_names)
 		{
-			QString name = lines_[i].annotations().count() ? lines_[i].annotations()[0] : "";
-			lines_[i].annotations().clear();
-			lines_[i].annotations().append(name);
+			if (annos.isEmpty()) annos.append("");
+			else if (annos.count()>1) annos.erase(annos.begin()+1, annos.end());
 		}
 		else
 		{
-			lines_[i].annotations().clear();
+			annos.clear();
 		}
 	}
 
 	//sort if necessary
 	if (!isSorted()) sort();
 
-	//merge lines
-	BedLine next_output_line = lines_.first();
+	//merge lines in place (lines are sorted, i.e. a line overlaps the current output line if it starts before its end)
+	int max_gap = merge_back_to_back ? 1 : 0;
 	int next_output_index = 0;
 	for (int i=1; i<lines_.count(); ++i)
 	{
+		BedLine& output_line = lines_[next_output_index];
 		const BedLine& line = lines_[i];
 
-		if ( next_output_line.overlapsWith(line.chr(), line.start(), line.end())
-			 ||
-			 (merge_back_to_back && next_output_line.adjacentTo(line.chr(), line.start(), line.end()))
-			)
+		if (line.chr()==output_line.chr() && line.start()<=output_line.end()+max_gap)
 		{
-			if (line.end()>next_output_line.end())
+			if (line.end()>output_line.end())
 			{
-				next_output_line.setEnd(line.end());
+				output_line.setEnd(line.end());
 				if (merge_names)
 				{
-					next_output_line.annotations()[0] += "," + line.annotations()[0];
+					output_line.annotations()[0] += "," + line.annotations()[0];
 				}
 			}
 		}
 		else
 		{
-			lines_[next_output_index] = next_output_line;
 			++next_output_index;
-			next_output_line = line;
+			if (next_output_index!=i) lines_[next_output_index] = line;
 		}
 	}
 
-	//add last line
-	lines_[next_output_index] = next_output_line;
-
 	//remove excess lines
 	lines_.resize(next_output_index+1);
 }
@@ -365,6 +428,8 @@ void BedFile::subtract(const BedFile& file2)
 
 void BedFile::intersect(const BedFile& file2)
 {
+	ProfilerTimer timer("BedFile::intersect");
+
 	//check target region is merged/sorted and create index
 	if (!file2.isMergedAndSorted())
 	{
@@ -428,6 +493,36 @@ void BedFile::overlapping(const BedFile& file2)
 	removeInvalidLines();
 }
 
+QVector<int> BedFile::chunkSizes(int length, int chunk_size)
+{
+	if (length<=chunk_size)
+	{
+		return QVector<int>(1, length);
+	}
+
+	//determine how many chunks are optimal
+	int n = floor((double)length/chunk_size);
+	if (fabs(chunk_size-((double)length/n)) > fabs(chunk_size-((double)length/(n+1))))
+	{
+		n += 1;
+	}
+
+	//calculate actual chunk sizes
+	QVector<int> chunk_sizes(n, chunk_size);
+	int rest = length-n*chunk_size;
+	int current_chunk = 0;
+	while (rest!=0)
+	{
+		int sign = BasicStatistics::sign(rest);
+		chunk_sizes[current_chunk] += sign;
+		rest -= sign;
+		++current_chunk;
+		if (current_chunk==n) current_chunk = 0;
+	}
+
+	return chunk_sizes;
+}
+
 void BedFile::chunk(int chunk_size)
 {
 	QVector<BedLine> new_lines;
@@ -438,29 +533,12 @@ void BedFile::chunk(int chunk_size)
 		const BedLine& line = lines_[i];
 		if (line.length()>chunk_size)
 		{
-			//determine how many chunks are optimal
-			double length = line.length();
-			int n = floor(length/chunk_size);
-			if (fabs(chunk_size-(length/n)) > fabs(chunk_size-(length/(n+1))))
-			{
-				n += 1;
-			}
-			//calculate actual chunk sizes
-			QVector<int> chunk_sizes(n, chunk_size);
-			int rest = line.length()-n*chunk_size;
-			int current_chunk = 0;
-			while (rest!=0)
-			{
-				int sign = BasicStatistics::sign(rest);
-				chunk_sizes[current_chunk] += sign;
-				rest -= sign;
-				++current_chunk;
-				if (current_chunk==n) current_chunk = 0;
-			}
+			QVector<int> chunk_sizes = chunkSizes(line.length(), chunk_size);
+
 			//create new lines
 			int start = line.start();
 			BedLine new_line = line;
-			for (int i=0; i<n; ++i)
+			for (int i=0; i<chunk_sizes.count(); ++i)
 			{
 				int end = start+chunk_sizes[i]-1;
 				new_line.setStart(start);
@@ -567,3 +645,355 @@ bool BedFile::overlapsWith(const Chromosome& chr, int start, int end) const
 
 	return false;
 }
+
+BedFileCompact::BedFileCompact()
+	: headers_()
+	, chrs_()
+	, chr_index_()
+	, chr_ids_()
+	, starts_()
+	, ends_()
+	, annotations_()
+	, annotation_offsets_(1, 0)
+{
+}
+
+int BedFileCompact::chrId(const Chromosome& chr)
+{
+	QHash<QByteArray, int>::const_iterator it = chr_index_.constFind(chr.str());
+	if (it!=chr_index_.constEnd()) return it.value();
+
+	chrs_.append(chr);
+	chr_index_.insert(chr.str(), chrs_.count()-1);
+	return chrs_.count()-1;
+}
+
+void BedFileCompact::appendRaw(int chr_id, int start, int end, const char* annotations, int length)
+{
+	//check input data (see BedFile::append)
+	if (!chrs_[chr_id].isValid())
+	{
+		THROW(ArgumentException, "Invalid BED line chromosome - empty string!");
+	}
+	if (start<1 || end<1 || start>end)
+	{
+		THROW(ArgumentException, "Invalid BED line range '" + QString::number(start) + " to " + QString::number(end) + "'!");
+	}
+
+	chr_ids_.append(chr_id);
+	starts_.append(start);
+	ends_.append(end);
+	annotations_.insert(annotations_.end(), annotations, annotations + length);
+	annotation_offsets_.append(annotations_.size());
+}
+
+void BedFileCompact::append(const BedLine& line)
+{
+	QByteArray data;
+	if (!line.annotations().isEmpty()) data = "\t" + line.annotations().join("\t").toUtf8();
+	appendRaw(chrId(line.chr()), line.start(), line.end(), data.constData(), data.size());
+}
+
+void BedFileCompact::append(const Chromosome& chr, int start, int end, const QByteArray& annotations)
+{
+	QByteArray data;
+	if (!annotations.isEmpty()) data = "\t" + annotations;
+	appendRaw(chrId(chr), start, end, data.constData(), data.size());
+}
+
+BedLine BedFileCompact::operator[](int index) const
+{
+	QStringList annos;
+	QByteArray data = annotationDataRaw(index);
+	if (!data.isEmpty())
+	{
+		foreach(const QByteArray& anno, data.mid(1).split('\t'))
+		{
+			annos.append(QString::fromUtf8(anno));
+		}
+	}
+	return BedLine(chr(index), start(index), end(index), annos);
+}
+
+QByteArray BedFileCompact::annotationData(int index) const
+{
+	QByteArray data = annotationDataRaw(index);
+	if (data.isEmpty()) return QByteArray();
+	return QByteArray(data.constData() + 1, data.size() - 1);
+}
+
+void BedFileCompact::load(QString filename)
+{
+	ProfilerTimer timer("BedFileCompact::load");
+
+	clear();
+
+	//parse from stream
+	BedInfileStream stream(filename);
+	int chr_id = -1;
+	while(stream.next())
+	{
+		//store headers
+		if (stream.isHeader())
+		{
+			headers_.append(QByteArray(stream.line().constData(), stream.line().size()));
+			continue;
+		}
+
+		//chromosome lookup is only necessary if the chromosome changes
+		if (chr_id==-1 || stream.chr().str()!=chrs_[chr_id].str())
+		{
+			chr_id = chrId(stream.chr());
+		}
+
+		//annotation data is stored including the tab before the fourth column
+		QByteArray data = stream.annotationData();
+		if (stream.annotationCount()==0)
+		{
+			appendRaw(chr_id, stream.start(), stream.end(), nullptr, 0);
+		}
+		else
+		{
+			appendRaw(chr_id, stream.start(), stream.end(), data.constData() - 1, data.size() + 1);
+		}
+	}
+
+	Profiler::addCount("BedFileCompact::load lines", count());
+}
+
+///Writes a buffer to a file. Throws FileAccessException.
+static void writeBuffer(QFile& file, QByteArray& buffer)
+{
+	if (file.write(buffer)!=buffer.size())
+	{
+		THROW(FileAccessException, "Could not write to BED file '" + file.fileName() + "'!");
+	}
+	buffer.resize(0);
+}
+
+void BedFileCompact::store(QString filename) const
+{
+	ProfilerTimer timer("BedFileCompact::store");
+
+	QSharedPointer<QFile> file = Helper::openFileForWriting(filename, true);
+	QByteArray buffer;
+	buffer.reserve(1048576 + 4096);
+
+	//write headers
+	foreach(const QByteArray& header, headers_)
+	{
+		buffer.append(header.trimmed());
+		buffer.append('\n');
+	}
+
+	//write contents
+	for (int i=0; i<count(); ++i)
+	{
+		buffer.append(chr(i).str());
+		buffer.append('\t');
+		buffer.append(QByteArray::number(starts_[i]-1));
+		buffer.append('\t');
+		buffer.append(QByteArray::number(ends_[i]));
+		buffer.append(annotationDataRaw(i));
+		buffer.append('\n');
+		if (buffer.size()>=1048576) writeBuffer(*file, buffer);
+	}
+	writeBuffer(*file, buffer);
+}
+
+void BedFileCompact::clear()
+{
+	headers_.clear();
+	chrs_.clear();
+	chr_index_.clear();
+	chr_ids_.clear();
+	starts_.clear();
+	ends_.clear();
+	std::vector<char>().swap(annotations_);
+	annotation_offsets_.fill(0, 1);
+}
+
+///Less-than comparator for line indices (by chromosome, start and end).
+class LineIndexLessComparator
+{
+public:
+	LineIndexLessComparator(const QVector<int>& chr_nums, const QVector<int>& starts, const QVector<int>& ends)
+		: chr_nums_(chr_nums)
+		, starts_(starts)
+		, ends_(ends)
+	{
+	}
+
+	bool operator()(int a, int b) const
+	{
+		if (chr_nums_[a]!=chr_nums_[b]) return chr_nums_[a]<chr_nums_[b];
+		if (starts_[a]!=starts_[b]) return starts_[a]<starts_[b];
+		return ends_[a]<ends_[b];
+	}
+
+protected:
+	const QVector<int>& chr_nums_;
+	const QVector<int>& starts_;
+	const QVector<int>& ends_;
+};
+
+void BedFileCompact::sort(bool uniq)
+{
+	ProfilerTimer timer("BedFileCompact::sort");
+
+	//sort line indices
+	const int n = count();
+	QVector<int> chr_nums(n);
+	for (int i=0; i<n; ++i)
+	{
+		chr_nums[i] = chrs_[chr_ids_[i]].num();
+	}
+	QVector<int> indices;
+	if (n<RADIX_SORT_MIN_LINES)
+	{
+		indices.resize(n);
+		for (int i=0; i<n; ++i) indices[i] = i;
+		std::stable_sort(indices.begin(), indices.end(), LineIndexLessComparator(chr_nums, starts_, ends_));
+	}
+	else
+	{
+		indices = radixSortIndices(chr_nums, starts_, ends_);
+	}
+
+	//remove duplicates (the first line is kept, annotations are not compared - see BedLine::operator==)
+	if (uniq && n>0)
+	{
+		int next_output_index = 0;
+		for (int i=1; i<n; ++i)
+		{
+			int index = indices[i];
+			int previous = indices[next_output_index];
+			if (chr_nums[index]!=chr_nums[previous] || starts_[index]!=starts_[previous] || ends_[index]!=ends_[previous])
+			{
+				++next_output_index;
+				indices[next_output_index] = index;
+			}
+		}
+		indices.resize(next_output_index+1);
+	}
+
+	reorder(indices);
+}
+
+void BedFileCompact::reorder(const QVector<int>& indices)
+{
+	const int n = indices.count();
+	QVector<int> chr_ids(n);
+	QVector<int> starts(n);
+	QVector<int> ends(n);
+	std::vector<char> annotations;
+	annotations.reserve(annotations_.size());
+	QVector<qint64> annotation_offsets;
+	annotation_offsets.reserve(n+1);
+	annotation_offsets.append(0);
+	for (int i=0; i<n; ++i)
+	{
+		int index = indices[i];
+		chr_ids[i] = chr_ids_[index];
+		starts[i] = starts_[index];
+		ends[i] = ends_[index];
+		annotations.insert(annotations.end(), annotations_.begin() + annotation_offsets_[index], annotations_.begin() + annotation_offsets_[index+1]);
+		annotation_offsets.append(annotations.size());
+	}
+
+	chr_ids_.swap(chr_ids);
+	starts_.swap(starts);
+	ends_.swap(ends);
+	annotations_.swap(annotations);
+	annotation_offsets_.swap(annotation_offsets);
+}
+
+///Returns the first annotation column of annotation data including leading tab (empty string if there are no annotations).
+static QByteArray firstAnnotation(const QByteArray& data)
+{
+	if (data.isEmpty()) return QByteArray();
+	int end = data.indexOf('\t', 1);
+	if (end==-1) end = data.size();
+	return QByteArray(data.constData() + 1, end - 1);
+}
+
+void BedFileCompact::merge(bool merge_back_to_back, bool merge_names)
+{
+	ProfilerTimer timer("BedFileCompact::merge");
+
+	//in the following code, we assume that at least one line is present...
+	if (count()==0) return;
+
+	//sort if necessary
+	if (!isSorted()) sort();
+
+	//merge lines in place (see BedFile::merge) - names are stored in a new annotation arena
+	std::vector<char> names;
+	QVector<qint64> name_offsets;
+	name_offsets.append(0);
+	QByteArray name = firstAnnotation(annotationDataRaw(0));
+	int max_gap = merge_back_to_back ? 1 : 0;
+	int next_output_index = 0;
+	for (int i=1; i<count(); ++i)
+	{
+		if (chr(i)==chr(next_output_index) && starts_[i]<=ends_[next_output_index]+max_gap)
+		{
+			if (ends_[i]>ends_[next_output_index])
+			{
+				ends_[next_output_index] = ends_[i];
+				if (merge_names)
+				{
+					name += "," + firstAnnotation(annotationDataRaw(i));
+				}
+			}
+		}
+		else
+		{
+			if (merge_names)
+			{
+				names.push_back('\t');
+				names.insert(names.end(), name.constData(), name.constData() + name.size());
+				name_offsets.append(names.size());
+				name = firstAnnotation(annotationDataRaw(i));
+			}
+
+			++next_output_index;
+			chr_ids_[next_output_index] = chr_ids_[i];
+			starts_[next_output_index] = starts_[i];
+			ends_[next_output_index] = ends_[i];
+		}
+	}
+	if (merge_names)
+	{
+		names.push_back('\t');
+		names.insert(names.end(), name.constData(), name.constData() + name.size());
+		name_offsets.append(names.size());
+	}
+
+	//remove excess lines
+	chr_ids_.resize(next_output_index+1);
+	starts_.resize(next_output_index+1);
+	ends_.resize(next_output_index+1);
+	annotations_.swap(names);
+	if (merge_names)
+	{
+		annotation_offsets_.swap(name_offsets);
+	}
+	else
+	{
+		annotation_offsets_.fill(0, next_output_index+2);
+	}
+}
+
+bool BedFileCompact::isSorted() const
+{
+	for (int i=1; i<count(); ++i)
+	{
+		const Chromosome& chr1 = chr(i-1);
+		const Chromosome& chr2 = chr(i);
+		if (chr2<chr1) return false;
+		if (chr2==chr1 && (starts_[i]<starts_[i-1] || (starts_[i]==starts_[i-1] && ends_[i]<ends_[i-1]))) return false;
+	}
+
+	return true;
+}
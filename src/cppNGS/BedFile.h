@@ -7,6 +7,8 @@
 #include <QStringList>
 #include <QVector>
 #include <QSet>
+#include <QHash>
+#include <vector>
 
 ///Representation of a BED file line (1-based)
 class CPPNGSSHARED_EXPORT BedLine
@@ -196,6 +198,8 @@ public:
     void overlapping(const BedFile& file2);
     ///Splits all regions to chunks of an approximate size.
     void chunk(int size);
+	///Returns the sizes of the chunks a region of length @p length is split into by chunk().
+	static QVector<int> chunkSizes(int length, int chunk_size);
 
     ///Returns if the lines are sorted. See sort().
     bool isSorted() const;
@@ -214,4 +218,89 @@ protected:
 	QVector<BedLine> lines_;
 };
 
+/**
+  @brief Compact representation of a BED file for large files (1-based in memory, 0-based in the file like BedFile).
+
+  The lines are stored as struct-of-arrays: chromosome IDs (index into a chromosome table), start and end positions.
+  The annotation columns are stored unparsed in one shared byte arena and are only converted to strings when a line is accessed.
+  This takes a fraction of the memory of BedFile, e.g. for genome-wide BED files with tens of millions of lines.
+*/
+class CPPNGSSHARED_EXPORT BedFileCompact
+{
+public:
+	///Default constructor
+	BedFileCompact();
+	///Adds a line. Throws ArgumentException.
+	void append(const BedLine& line);
+	///Adds a line with annotation columns separated by tabs (without leading tab). Throws ArgumentException.
+	void append(const Chromosome& chr, int start, int end, const QByteArray& annotations = QByteArray());
+	///Returns a line (converted to BedLine).
+	BedLine operator[](int index) const;
+	///Returns the line count.
+	int count() const
+	{
+		return starts_.count();
+	}
+	///Returns the chromosome of a line.
+	const Chromosome& chr(int index) const
+	{
+		return chrs_[chr_ids_[index]];
+	}
+	///Returns the start position of a line (1-based).
+	int start(int index) const
+	{
+		return starts_[index];
+	}
+	///Returns the end position of a line (1-based).
+	int end(int index) const
+	{
+		return ends_[index];
+	}
+	///Returns the annotation columns of a line separated by tabs (without leading tab).
+	QByteArray annotationData(int index) const;
+	///Returns the headers.
+	const QVector<QByteArray>& headers() const
+	{
+		return headers_;
+	}
+
+	///Loads a 0-based BED file and converts it to 1-based positions. Throws ParseException.
+	void load(QString filename);
+	///Stores the lines to a BED file with 0-based coordinates. If no filename is given, the output goes to the console. Throws FileException.
+	void store(QString filename) const;
+	///Removes all content.
+	void clear();
+
+	///Sorts the lines by chromosome, start and end position (like BedFile::sort). If the @p uniq is @em true, duplicate entries are removed after sorting.
+	void sort(bool uniq = false);
+	///Merges overlapping regions (like BedFile::merge).
+	void merge(bool merge_back_to_back = true, bool merge_names = false);
+	///Returns if the lines are sorted. See sort().
+	bool isSorted() const;
+
+protected:
+	QVector<QByteArray> headers_;
+	QVector<Chromosome> chrs_;
+	QHash<QByteArray, int> chr_index_;
+	QVector<int> chr_ids_;
+	QVector<int> starts_;
+	QVector<int> ends_;
+	//annotation arena: the annotation data of a line is stored with a leading tab (to distinguish an empty annotation from no annotation)
+	std::vector<char> annotations_;
+	QVector<qint64> annotation_offsets_;
+
+	///Returns the ID of a chromosome (adds it to the chromosome table if necessary).
+	int chrId(const Chromosome& chr);
+	///Adds a line with annotation data including leading tab (or empty). Throws ArgumentException.
+	void appendRaw(int chr_id, int start, int end, const char* annotations, int length);
+	///Returns the annotation data of a line including leading tab (or empty).
+	QByteArray annotationDataRaw(int index) const
+	{
+		qint64 offset = annotation_offsets_[index];
+		return QByteArray::fromRawData(annotations_.data() + offset, (int)(annotation_offsets_[index+1] - offset));
+	}
+	///Reorders the lines according to the given line indices (lines not contained are removed).
+	void reorder(const QVector<int>& indices);
+};
+
 #endif // BEDFILE_H
@@ -0,0 +1,186 @@
+#include "BedFileStream.h"
+#include "Exceptions.h"
+#include "Helper.h"
+#include <cstring>
+
+BedInfileStream::BedInfileStream(QString filename)
+	: file_(Helper::openFileForReading(filename, true))
+	, buffer_(4096, Qt::Uninitialized)
+	, line_()
+	, is_header_(false)
+	, fields_()
+	, chr_()
+	, chromosomes_()
+	, start_(0)
+	, end_(-1)
+{
+}
+
+bool BedInfileStream::readLine()
+{
+	int size = 0;
+	while (true)
+	{
+		if (buffer_.size()-size<2) buffer_.resize(2*buffer_.size());
+		qint64 read = file_->readLine(buffer_.data() + size, buffer_.size() - size);
+		if (read<=0) break;
+		size += read;
+		if (buffer_[size-1]=='\n') break;
+	}
+	if (size==0) return false;
+
+	while (size>0 && (buffer_[size-1]=='\n' || buffer_[size-1]=='\r')) --size;
+	line_ = QByteArray::fromRawData(buffer_.constData(), size);
+	return true;
+}
+
+int BedInfileStream::parsePosition(int i, QString name) const
+{
+	QByteArray value = field(i);
+
+	//fast path for plain numbers
+	if (value.size()>0 && value.size()<10)
+	{
+		int output = 0;
+		const char* data = value.constData();
+		int j = 0;
+		for (; j<value.size(); ++j)
+		{
+			if (data[j]<'0' || data[j]>'9') break;
+			output = 10 * output + (data[j] - '0');
+		}
+		if (j==value.size()) return output;
+	}
+
+	return Helper::toInt(QByteArray(value.constData(), value.size()), name, line_);
+}
+
+bool BedInfileStream::next()
+{
+	while(readLine())
+	{
+		//skip empty lines
+		if (line_.length()==0) continue;
+
+		//headers
+		fields_.resize(0);
+		is_header_ = line_.startsWith("#") || line_.startsWith("track ") || line_.startsWith("browser ");
+		if (is_header_) return true;
+
+		//split fields
+		const char* data = line_.constData();
+		int size = line_.size();
+		fields_.append(0);
+		const char* tab = (const char*)memchr(data, '\t', size);
+		while (tab!=nullptr)
+		{
+			int pos = tab - data + 1;
+			fields_.append(pos);
+			tab = (const char*)memchr(data + pos, '\t', size - pos);
+		}
+
+		//error when less than 3 fields
+		if (fields_.count()<3)
+		{
+			THROW(FileParseException, "BED file line with less than three fields found: '" + line_.trimmed() + "'");
+		}
+
+		//chromosome (interned, i.e. all lines of a chromosome share the same string data)
+		QByteArray chr = field(0);
+		if (chr=="")
+		{
+			THROW(FileParseException, "Empty BED file chromosome field '" + chr + "'!");
+		}
+		if (chr!=chr_.str())
+		{
+			QHash<QByteArray, Chromosome>::const_iterator it = chromosomes_.constFind(chr);
+			if (it!=chromosomes_.constEnd())
+			{
+				chr_ = it.value();
+			}
+			else
+			{
+				QByteArray chr_copy(chr.constData(), chr.size());
+				chr_ = Chromosome(chr_copy);
+				chromosomes_.insert(chr_copy, chr_);
+			}
+		}
+
+		//positions
+		start_ = parsePosition(1, "start position") + 1;
+		end_ = parsePosition(2, "end position");
+
+		//check input data (see BedFile::append)
+		if (!chr_.isValid())
+		{
+			THROW(ArgumentException, "Invalid BED line chromosome - empty string!");
+		}
+		if (start_<1 || end_<1 || start_>end_)
+		{
+			THROW(ArgumentException, "Invalid BED line range '" + QString::number(start_) + " to " + QString::number(end_) + "'!");
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+BedLine BedInfileStream::toBedLine(bool with_annotations) const
+{
+	QStringList annos;
+	if (with_annotations)
+	{
+		for (int i=0; i<annotationCount(); ++i)
+		{
+			QByteArray anno = annotation(i);
+			annos.append(QString::fromUtf8(anno.constData(), anno.size()));
+		}
+	}
+	return BedLine(chr_, start_, end_, annos);
+}
+
+BedOutfileStream::BedOutfileStream(QString filename)
+	: file_(Helper::openFileForWriting(filename, true))
+	, buffer_()
+{
+	buffer_.reserve(BUFFER_SIZE + 4096);
+}
+
+BedOutfileStream::~BedOutfileStream()
+{
+	//no exceptions in the destructor
+	if (!buffer_.isEmpty()) file_->write(buffer_);
+}
+
+void BedOutfileStream::writeHeader(const QByteArray& header)
+{
+	buffer_.append(header.trimmed());
+	buffer_.append('\n');
+	if (buffer_.size()>=BUFFER_SIZE) flush();
+}
+
+void BedOutfileStream::write(const Chromosome& chr, int start, int end, const QByteArray& annotations)
+{
+	buffer_.append(chr.str());
+	buffer_.append('\t');
+	buffer_.append(QByteArray::number(start-1));
+	buffer_.append('\t');
+	buffer_.append(QByteArray::number(end));
+	if (!annotations.isEmpty())
+	{
+		buffer_.append('\t');
+		buffer_.append(annotations);
+	}
+	buffer_.append('\n');
+	if (buffer_.size()>=BUFFER_SIZE) flush();
+}
+
+void BedOutfileStream::flush()
+{
+	if (file_->write(buffer_)!=buffer_.size())
+	{
+		THROW(FileAccessException, "Could not write to BED file '" + file_->fileName() + "'!");
+	}
+	buffer_.resize(0);
+}
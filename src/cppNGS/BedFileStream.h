@@ -0,0 +1,131 @@
+#ifndef BEDFILESTREAM_H
+#define BEDFILESTREAM_H
+
+#include "cppNGS_global.h"
+#include "BedFile.h"
+#include <QFile>
+#include <QSharedPointer>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+#include <algorithm>
+
+/**
+  @brief Streaming BED file reader that keeps only the current line in memory (0-based in the file, 1-based in memory like BedFile).
+
+  The fields of the current line are parsed in place. Annotations are only converted to strings when requested.
+  Data returned as QByteArray (line and annotations) is only valid until the next line is read.
+*/
+class CPPNGSSHARED_EXPORT BedInfileStream
+{
+public:
+	///Constructor. If @p filename is empty, reads from STDIN.
+	BedInfileStream(QString filename);
+
+	///Reads the next non-empty line. Returns 'false' at the end of the file. Throws FileParseException and ArgumentException.
+	bool next();
+
+	///Returns if the current line is a header line (starting with '#', 'track ' or 'browser ').
+	bool isHeader() const
+	{
+		return is_header_;
+	}
+	///Returns the current line (without newline).
+	const QByteArray& line() const
+	{
+		return line_;
+	}
+
+	///Returns the chromosome of the current line.
+	const Chromosome& chr() const
+	{
+		return chr_;
+	}
+	///Returns the start position of the current line (1-based).
+	int start() const
+	{
+		return start_;
+	}
+	///Returns the end position of the current line (1-based).
+	int end() const
+	{
+		return end_;
+	}
+
+	///Returns the number of annotation columns of the current line.
+	int annotationCount() const
+	{
+		return std::max(0, fields_.count() - 3);
+	}
+	///Returns the annotation column with the index @p i (the fourth column of the file has index 0).
+	QByteArray annotation(int i) const
+	{
+		return field(i+3);
+	}
+	///Returns all annotation columns of the current line separated by tabs (without leading tab).
+	QByteArray annotationData() const
+	{
+		if (annotationCount()==0) return QByteArray();
+		return QByteArray::fromRawData(line_.constData() + fields_[3], line_.size() - fields_[3]);
+	}
+	///Converts the current line to a BedLine. If @p with_annotations is 'false', annotations are not converted.
+	BedLine toBedLine(bool with_annotations = true) const;
+
+protected:
+	QSharedPointer<QFile> file_;
+	QByteArray buffer_;
+	QByteArray line_;
+	bool is_header_;
+	QVector<int> fields_;
+	Chromosome chr_;
+	QHash<QByteArray, Chromosome> chromosomes_;
+	int start_;
+	int end_;
+
+	///Reads the next line into the buffer. Returns 'false' at the end of the file.
+	bool readLine();
+	///Returns the field with the index @p i.
+	QByteArray field(int i) const
+	{
+		int end = i+1<fields_.count() ? fields_[i+1]-1 : line_.size();
+		return QByteArray::fromRawData(line_.constData() + fields_[i], end - fields_[i]);
+	}
+	///Parses a position field.
+	int parsePosition(int i, QString name) const;
+
+	//declared away methods
+	BedInfileStream(const BedInfileStream&);
+	BedInfileStream& operator=(const BedInfileStream&);
+};
+
+/**
+  @brief Buffered BED file writer (1-based in memory, 0-based in the file like BedFile).
+*/
+class CPPNGSSHARED_EXPORT BedOutfileStream
+{
+public:
+	///Constructor. If @p filename is empty, writes to STDOUT.
+	BedOutfileStream(QString filename);
+	///Destructor, writes buffered data.
+	~BedOutfileStream();
+
+	///Writes a header line.
+	void writeHeader(const QByteArray& header);
+	///Writes a region with optional annotation columns (separated by tabs, without leading tab).
+	void write(const Chromosome& chr, int start, int end, const QByteArray& annotations = QByteArray());
+	///Writes buffered data to the file. Throws FileAccessException.
+	void flush();
+
+protected:
+	QSharedPointer<QFile> file_;
+	QByteArray buffer_;
+
+	///Buffer size after which data is written to the file.
+	static const int BUFFER_SIZE = 1048576;
+
+	//declared away methods
+	BedOutfileStream(const BedOutfileStream&);
+	BedOutfileStream& operator=(const BedOutfileStream&);
+};
+
+#endif // BEDFILESTREAM_H
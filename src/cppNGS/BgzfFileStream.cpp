@@ -0,0 +1,426 @@
+#include "BgzfFileStream.h"
+#include "Exceptions.h"
+#include <cstring>
+#include <algorithm>
+
+static quint16 readUInt16(const char* p)
+{
+	return (quint16)((uchar)p[0] | ((uchar)p[1] << 8));
+}
+
+static quint32 readUInt32(const char* p)
+{
+	return (quint32)(uchar)p[0] | ((quint32)(uchar)p[1] << 8) | ((quint32)(uchar)p[2] << 16) | ((quint32)(uchar)p[3] << 24);
+}
+
+static void writeUInt16(char* p, quint16 value)
+{
+	p[0] = (char)(value & 0xff);
+	p[1] = (char)(value >> 8);
+}
+
+static void writeUInt32(char* p, quint32 value)
+{
+	p[0] = (char)(value & 0xff);
+	p[1] = (char)((value >> 8) & 0xff);
+	p[2] = (char)((value >> 16) & 0xff);
+	p[3] = (char)(value >> 24);
+}
+
+void BgzfBlock::inflate()
+{
+	data.clear();
+	error.clear();
+
+	//check sizes
+	if (compressed.size()<26)
+	{
+		error = "Block too short";
+		return;
+	}
+	const char* raw = compressed.constData();
+	int header_size = 12 + readUInt16(raw+10);
+	int footer_pos = compressed.size() - 8;
+	quint32 crc_expected = readUInt32(raw+footer_pos);
+	quint32 isize = readUInt32(raw+footer_pos+4);
+	if (header_size>footer_pos || isize>65536)
+	{
+		error = "Invalid block size";
+		return;
+	}
+	if (isize==0) return;
+
+	//inflate
+	data.resize(isize);
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	if (inflateInit2(&zs, -15)!=Z_OK)
+	{
+		error = "Could not initialize zlib";
+		return;
+	}
+	zs.next_in = (Bytef*)(raw + header_size);
+	zs.avail_in = footer_pos - header_size;
+	zs.next_out = (Bytef*)data.data();
+	zs.avail_out = isize;
+	int res = ::inflate(&zs, Z_FINISH);
+	inflateEnd(&zs);
+	if (res!=Z_STREAM_END || zs.avail_out!=0)
+	{
+		error = "Inflating failed";
+		return;
+	}
+
+	//check CRC
+	if (crc32(crc32(0L, Z_NULL, 0), (const Bytef*)data.constData(), isize)!=crc_expected)
+	{
+		error = "CRC32 checksum mismatch";
+	}
+}
+
+void BgzfBlock::deflate(int level)
+{
+	compressed.clear();
+	error.clear();
+
+	//deflate
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY)!=Z_OK)
+	{
+		error = "Could not initialize zlib";
+		return;
+	}
+	int bound = (int)deflateBound(&zs, data.size());
+	compressed.resize(18 + bound + 8);
+	zs.next_in = (Bytef*)data.data();
+	zs.avail_in = data.size();
+	zs.next_out = (Bytef*)(compressed.data() + 18);
+	zs.avail_out = bound;
+	int res = ::deflate(&zs, Z_FINISH);
+	deflateEnd(&zs);
+	if (res!=Z_STREAM_END)
+	{
+		error = "Deflating failed";
+		return;
+	}
+	int block_size = 18 + (bound - zs.avail_out) + 8;
+	if (block_size>65536)
+	{
+		error = "Compressed block too large";
+		return;
+	}
+	compressed.resize(block_size);
+
+	//header (gzip with 'BC' extra subfield containing the block size)
+	char* raw = compressed.data();
+	const char header[16] = {31, (char)139, 8, 4, 0, 0, 0, 0, 0, (char)255, 6, 0, 'B', 'C', 2, 0};
+	memcpy(raw, header, 16);
+	writeUInt16(raw+16, block_size - 1);
+
+	//footer
+	writeUInt32(raw+block_size-8, crc32(crc32(0L, Z_NULL, 0), (const Bytef*)data.constData(), data.size()));
+	writeUInt32(raw+block_size-4, data.size());
+}
+
+BgzfWorker::BgzfWorker(BgzfBlock* block, bool compress, int level)
+	: QRunnable()
+	, block_(block)
+	, compress_(compress)
+	, level_(level)
+{
+}
+
+void BgzfWorker::run()
+{
+	if (compress_)
+	{
+		block_->deflate(level_);
+	}
+	else
+	{
+		block_->inflate();
+	}
+}
+
+BgzfInfileStream::BgzfInfileStream(QString filename, int threads)
+	: filename_(filename)
+	, file_(filename)
+	, batch_size_(8 * std::max(1, threads))
+	, current_(0)
+	, block_index_(0)
+	, offset_(0)
+{
+	if (!file_.open(QIODevice::ReadOnly))
+	{
+		THROW(FileAccessException, "Could not open file '" + filename + "' for reading!");
+	}
+	pool_[0].setMaxThreadCount(std::max(1, threads));
+	pool_[1].setMaxThreadCount(std::max(1, threads));
+
+	readBatch(0);
+	readBatch(1);
+	pool_[0].waitForDone();
+}
+
+BgzfInfileStream::~BgzfInfileStream()
+{
+	pool_[0].waitForDone();
+	pool_[1].waitForDone();
+	clearBatch(0);
+	clearBatch(1);
+}
+
+int BgzfInfileStream::read(char* data, int size)
+{
+	int done = 0;
+	while (done<size && nextData())
+	{
+		const BgzfBlock* block = batch_[current_][block_index_];
+		int n = std::min(size - done, block->data.size() - offset_);
+		memcpy(data + done, block->data.constData() + offset_, n);
+		offset_ += n;
+		done += n;
+	}
+	return done;
+}
+
+bool BgzfInfileStream::atEnd()
+{
+	return !nextData();
+}
+
+void BgzfInfileStream::seek(qint64 virtual_offset)
+{
+	//discard batches
+	pool_[0].waitForDone();
+	pool_[1].waitForDone();
+	clearBatch(0);
+	clearBatch(1);
+
+	//jump to compressed block
+	if (!file_.seek(virtual_offset >> 16))
+	{
+		THROW(FileAccessException, "Could not seek in file '" + filename_ + "'!");
+	}
+	current_ = 0;
+	block_index_ = 0;
+	readBatch(0);
+	readBatch(1);
+	pool_[0].waitForDone();
+
+	//jump inside uncompressed block
+	offset_ = virtual_offset & 0xffff;
+}
+
+void BgzfInfileStream::readBatch(int i)
+{
+	clearBatch(i);
+	for (int b=0; b<batch_size_; ++b)
+	{
+		BgzfBlock* block = new BgzfBlock();
+		if (!readBlock(block->compressed))
+		{
+			delete block;
+			break;
+		}
+		batch_[i].append(block);
+		pool_[i].start(new BgzfWorker(block, false, 0));
+	}
+}
+
+bool BgzfInfileStream::readBlock(QByteArray& compressed)
+{
+	//fixed header
+	char header[12];
+	qint64 read = file_.read(header, 12);
+	if (read==0) return false;
+	if (read!=12 || (uchar)header[0]!=31 || (uchar)header[1]!=139 || (uchar)header[2]!=8 || ((uchar)header[3] & 4)==0)
+	{
+		THROW(FileParseException, "Invalid BGZF block header in file '" + filename_ + "'!");
+	}
+
+	//extra subfields (search for block size)
+	int xlen = readUInt16(header+10);
+	QByteArray extra = file_.read(xlen);
+	if (extra.size()!=xlen)
+	{
+		THROW(FileParseException, "Truncated BGZF block header in file '" + filename_ + "'!");
+	}
+	int block_size = -1;
+	int pos = 0;
+	while (pos+4<=xlen)
+	{
+		int slen = readUInt16(extra.constData()+pos+2);
+		if (extra[pos]=='B' && extra[pos+1]=='C' && slen==2 && pos+6<=xlen)
+		{
+			block_size = readUInt16(extra.constData()+pos+4) + 1;
+		}
+		pos += 4 + slen;
+	}
+	int rest = block_size - 12 - xlen;
+	if (block_size==-1 || rest<8)
+	{
+		THROW(FileParseException, "Missing BGZF block size in file '" + filename_ + "'!");
+	}
+
+	//compressed data and footer
+	compressed.resize(block_size);
+	memcpy(compressed.data(), header, 12);
+	memcpy(compressed.data()+12, extra.constData(), xlen);
+	if (file_.read(compressed.data()+12+xlen, rest)!=rest)
+	{
+		THROW(FileParseException, "Truncated BGZF block in file '" + filename_ + "'!");
+	}
+
+	return true;
+}
+
+bool BgzfInfileStream::nextData()
+{
+	while(true)
+	{
+		const QList<BgzfBlock*>& batch = batch_[current_];
+		while (block_index_<batch.count())
+		{
+			const BgzfBlock* block = batch[block_index_];
+			if (!block->error.isEmpty())
+			{
+				THROW(FileParseException, "Could not decompress BGZF block of file '" + filename_ + "': " + block->error);
+			}
+			if (offset_<block->data.size()) return true;
+
+			++block_index_;
+			offset_ = 0;
+		}
+
+		//current batch is consumed => switch to next batch and refill the current slot in the background
+		int next = 1 - current_;
+		pool_[next].waitForDone();
+		if (batch_[next].isEmpty()) return false;
+		readBatch(current_);
+		current_ = next;
+		block_index_ = 0;
+		offset_ = 0;
+	}
+}
+
+void BgzfInfileStream::clearBatch(int i)
+{
+	qDeleteAll(batch_[i]);
+	batch_[i].clear();
+}
+
+BgzfOutfileStream::BgzfOutfileStream(QString filename, int threads, int level)
+	: filename_(filename)
+	, file_(filename)
+	, batch_size_(8 * std::max(1, threads))
+	, current_(0)
+	, level_(level)
+{
+	if (!file_.open(QIODevice::WriteOnly))
+	{
+		THROW(FileAccessException, "Could not open file '" + filename + "' for writing!");
+	}
+	pool_[0].setMaxThreadCount(std::max(1, threads));
+	pool_[1].setMaxThreadCount(std::max(1, threads));
+	buffer_.reserve(BgzfBlock::MAX_DATA_SIZE);
+}
+
+BgzfOutfileStream::~BgzfOutfileStream()
+{
+	if (file_.isOpen())
+	{
+		try
+		{
+			close();
+		}
+		catch(...)
+		{
+			//exceptions must not leave the destructor
+		}
+	}
+
+	pool_[0].waitForDone();
+	pool_[1].waitForDone();
+	qDeleteAll(batch_[0]);
+	qDeleteAll(batch_[1]);
+}
+
+void BgzfOutfileStream::write(const char* data, int size)
+{
+	while (size>0)
+	{
+		int n = std::min(size, BgzfBlock::MAX_DATA_SIZE - buffer_.size());
+		buffer_.append(data, n);
+		data += n;
+		size -= n;
+
+		if (buffer_.size()==BgzfBlock::MAX_DATA_SIZE) flushBuffer();
+	}
+}
+
+void BgzfOutfileStream::flush()
+{
+	flushBuffer();
+	submitBatch();
+	writeBatch(1 - current_);
+}
+
+void BgzfOutfileStream::close()
+{
+	if (!file_.isOpen()) return;
+
+	//compress and write remaining data
+	flush();
+
+	//EOF marker block
+	const char eof[28] = {31, (char)139, 8, 4, 0, 0, 0, 0, 0, (char)255, 6, 0, 'B', 'C', 2, 0, 27, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+	if (file_.write(eof, 28)!=28)
+	{
+		THROW(FileAccessException, "Could not write to file '" + filename_ + "'!");
+	}
+	file_.close();
+}
+
+void BgzfOutfileStream::flushBuffer()
+{
+	if (buffer_.isEmpty()) return;
+
+	BgzfBlock* block = new BgzfBlock();
+	block->data.swap(buffer_);
+	buffer_.reserve(BgzfBlock::MAX_DATA_SIZE);
+	batch_[current_].append(block);
+
+	if (batch_[current_].count()>=batch_size_) submitBatch();
+}
+
+void BgzfOutfileStream::submitBatch()
+{
+	foreach(BgzfBlock* block, batch_[current_])
+	{
+		pool_[current_].start(new BgzfWorker(block, true, level_));
+	}
+
+	//the other slot contains the previous batch => write it while the current batch is compressed
+	current_ = 1 - current_;
+	writeBatch(current_);
+}
+
+void BgzfOutfileStream::writeBatch(int i)
+{
+	pool_[i].waitForDone();
+	foreach(const BgzfBlock* block, batch_[i])
+	{
+		if (!block->error.isEmpty())
+		{
+			THROW(FileAccessException, "Could not compress BGZF block of file '" + filename_ + "': " + block->error);
+		}
+		if (file_.write(block->compressed)!=block->compressed.size())
+		{
+			THROW(FileAccessException, "Could not write to file '" + filename_ + "'!");
+		}
+	}
+	qDeleteAll(batch_[i]);
+	batch_[i].clear();
+}
@@ -0,0 +1,135 @@
+#ifndef BGZFFILESTREAM_H
+#define BGZFFILESTREAM_H
+
+#include "cppNGS_global.h"
+#include <zlib.h>
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QRunnable>
+#include <QString>
+#include <QThreadPool>
+
+///BGZF block (compressed and uncompressed data).
+struct CPPNGSSHARED_EXPORT BgzfBlock
+{
+	///Complete compressed block including header and footer.
+	QByteArray compressed;
+	///Uncompressed data.
+	QByteArray data;
+	///Error message if (de)compression failed.
+	QString error;
+
+	///Maximum number of uncompressed bytes per block.
+	static const int MAX_DATA_SIZE = 0xff00;
+
+	///Inflates 'compressed' into 'data'. Sets 'error' on failure.
+	void inflate();
+	///Deflates 'data' into 'compressed'. Sets 'error' on failure.
+	void deflate(int level);
+};
+
+///Worker that (de)compresses one BGZF block.
+class BgzfWorker
+	: public QRunnable
+{
+public:
+	BgzfWorker(BgzfBlock* block, bool compress, int level);
+	void run();
+
+protected:
+	BgzfBlock* block_;
+	bool compress_;
+	int level_;
+};
+
+/**
+  @brief BGZF input stream that inflates blocks on a thread pool.
+
+  Compressed blocks are read in batches.
+  While one batch is consumed, the next batch is inflated in the background.
+*/
+class CPPNGSSHARED_EXPORT BgzfInfileStream
+{
+public:
+	///Constructor. @p threads is the number of threads used for decompression.
+	BgzfInfileStream(QString filename, int threads = 1);
+	///Destructor.
+	~BgzfInfileStream();
+
+	///Reads up to @p size bytes into @p data. Returns the number of bytes read, which is smaller than @p size only at the end of the file.
+	int read(char* data, int size);
+	///Checks if the end of the file is reached.
+	bool atEnd();
+	///Jumps to a virtual file offset (compressed block offset in the upper 48 bits, offset inside the uncompressed block in the lower 16 bits).
+	void seek(qint64 virtual_offset);
+
+protected:
+	QString filename_;
+	QFile file_;
+	QThreadPool pool_[2];
+	QList<BgzfBlock*> batch_[2];
+	int batch_size_;
+	int current_;
+	int block_index_;
+	int offset_;
+
+	///Reads the next batch of compressed blocks into slot @p i and starts inflating it.
+	void readBatch(int i);
+	///Reads one compressed block. Returns 'false' at the end of the file.
+	bool readBlock(QByteArray& compressed);
+	///Makes sure the current block has unread data. Returns 'false' at the end of the file.
+	bool nextData();
+	///Deletes the blocks of slot @p i.
+	void clearBatch(int i);
+
+	//declared away methods
+	BgzfInfileStream(const BgzfInfileStream&);
+	BgzfInfileStream& operator=(const BgzfInfileStream&);
+};
+
+/**
+  @brief BGZF output stream that deflates blocks on a thread pool.
+
+  Data is split into blocks, which are deflated in batches.
+  While one batch is compressed in the background, the next batch is filled.
+  Blocks are written in the order of the input data.
+*/
+class CPPNGSSHARED_EXPORT BgzfOutfileStream
+{
+public:
+	///Constructor. @p threads is the number of threads used for compression.
+	BgzfOutfileStream(QString filename, int threads = 1, int level = Z_DEFAULT_COMPRESSION);
+	///Destructor - closes the stream if necessary.
+	~BgzfOutfileStream();
+
+	///Writes @p size bytes.
+	void write(const char* data, int size);
+	///Compresses and writes all buffered data. The next data starts a new block.
+	void flush();
+	///Flushes all data, writes the EOF marker block and closes the file.
+	void close();
+
+protected:
+	QString filename_;
+	QFile file_;
+	QThreadPool pool_[2];
+	QList<BgzfBlock*> batch_[2];
+	int batch_size_;
+	int current_;
+	int level_;
+	QByteArray buffer_;
+
+	///Appends the buffer as block to the current batch. If the batch is full, it is submitted.
+	void flushBuffer();
+	///Starts compression of the current batch and writes the previous batch.
+	void submitBatch();
+	///Waits until slot @p i is compressed and writes it.
+	void writeBatch(int i);
+
+	//declared away methods
+	BgzfOutfileStream(const BgzfOutfileStream&);
+	BgzfOutfileStream& operator=(const BgzfOutfileStream&);
+};
+
+#endif // BGZFFILESTREAM_H
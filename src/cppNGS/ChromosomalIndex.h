@@ -3,6 +3,7 @@
 #include "cppNGS_global.h"
 #include "limits"
 #include "Chromosome.h"
+#include "Profiler.h"
 #include <QHash>
 #include <QVector>
 #include <QPair>
@@ -50,6 +51,8 @@ ChromosomalIndex<T>::ChromosomalIndex(const T& container, int bin_size)
 template <class T>
 void ChromosomalIndex<T>::createIndex()
 {
+	ProfilerTimer timer("ChromosomalIndex::createIndex");
+
 	int min = std::numeric_limits<int>::min();
 	int max = std::numeric_limits<int>::max();
 
@@ -1,6 +1,8 @@
 #include "Chromosome.h"
 #include "Exceptions.h"
 #include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
 
 Chromosome::Chromosome()
 	: str_("")
@@ -77,9 +79,11 @@ int Chromosome::numericRepresentation() const
 	{
 		return value;
 	}
-	//other non-numeric chromosome
+	//other non-numeric chromosome (the cache is shared between threads)
 	static int next_num = 1004;
 	static QHash<QByteArray, int> cache;
+	static QMutex mutex;
+	QMutexLocker locker(&mutex);
 	if (!cache.contains(tmp))
 	{
 		cache[tmp] = next_num;
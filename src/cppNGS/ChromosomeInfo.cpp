@@ -4,7 +4,17 @@
 ChromosomeInfo::ChromosomeInfo(BamReader& reader)
 	: filename_(QString::fromStdString(reader.GetFilename()))
 {
-	const RefVector& ref_data = reader.GetReferenceData();
+	init(reader.GetReferenceData());
+}
+
+ChromosomeInfo::ChromosomeInfo(const RefVector& ref_data, QString filename)
+	: filename_(filename)
+{
+	init(ref_data);
+}
+
+void ChromosomeInfo::init(const RefVector& ref_data)
+{
 	chrs_.reserve(ref_data.size());
 	for (unsigned int i=0; i<ref_data.size(); ++i)
 	{
@@ -27,6 +37,11 @@ const Chromosome& ChromosomeInfo::chromosome(int ref_id) const
 	return chrs_[ref_id];
 }
 
+bool ChromosomeInfo::contains(const Chromosome& chr) const
+{
+	return info_.contains(chr.num());
+}
+
 int ChromosomeInfo::refID(const Chromosome& chr) const
 {
 	if (!info_.contains(chr.num()))
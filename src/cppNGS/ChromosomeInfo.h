@@ -13,12 +13,16 @@ class CPPNGSSHARED_EXPORT ChromosomeInfo
 {
 public:
 	ChromosomeInfo(BamReader& reader);
+	///Constructor from reference data. @p filename is used in error messages only.
+	ChromosomeInfo(const RefVector& ref_data, QString filename);
 
 	///Returns all chromosomes
 	const QList<Chromosome>& chromosomes() const;
 	///Returns a chromosome based on the reference ID. If the chomosome is not found, an ArgumentException is thrown.
 	const Chromosome& chromosome(int ref_id) const;
 
+	///Returns if the chromosome is contained in the reference.
+	bool contains(const Chromosome& chr) const;
 	///Returns the chromosome ID (called reference ID in BamTools). If the chomosome is not found, an ArgumentException is thrown.
 	int refID(const Chromosome& chr) const;
 	///Returns the size (number of bases) of a chromosome. If the chomosome is not found, an ArgumentException is thrown.
@@ -39,6 +43,8 @@ protected:
 	};
 	QHash<int, ChrInfo_> info_;
 	QString filename_;
+
+	void init(const RefVector& ref_data);
 };
 
 #endif // CHROMOSOMEINFO_H
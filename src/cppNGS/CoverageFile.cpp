@@ -0,0 +1,488 @@
+#include "CoverageFile.h"
+#include "BamFileStream.h"
+#include "Exceptions.h"
+#include <QDataStream>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <vector>
+
+//file layout: magic, header (min_mapq, chunk size, references), RLE-encoded chunks, chunk index, offset of chunk index
+static const char COV_MAGIC[4] = {'C', 'O', 'V', '\1'};
+static const int COV_CHUNK_SIZE = 65536;
+
+//appends an unsigned variable-length integer
+static void appendVarint(QByteArray& data, quint32 value)
+{
+	while (value>=0x80)
+	{
+		data.append((char)((value & 0x7f) | 0x80));
+		value >>= 7;
+	}
+	data.append((char)value);
+}
+
+//writes depth runs of one reference sequence as RLE-encoded chunks
+class CoverageChunkWriter
+{
+public:
+	CoverageChunkWriter(QFile& file, int ref_length, QVector<qint64>& offsets, QVector<int>& sizes)
+		: file_(file)
+		, ref_length_(ref_length)
+		, offsets_(offsets)
+		, sizes_(sizes)
+		, chunk_pos_(0)
+		, chunk_nonzero_(false)
+		, last_depth_(0)
+		, run_length_(0)
+		, run_depth_(0)
+	{
+	}
+
+	//adds a run of bases with the same depth (adjacent runs with the same depth are merged)
+	void add(int length, int depth)
+	{
+		if (length<=0) return;
+		if (depth!=run_depth_)
+		{
+			flushRun();
+			run_depth_ = depth;
+		}
+		run_length_ += length;
+	}
+
+	//writes the remaining data up to the end of the reference sequence
+	void close()
+	{
+		flushRun();
+		int written = (offsets_.count()) * COV_CHUNK_SIZE + chunk_pos_;
+		if (written<ref_length_)
+		{
+			encode(ref_length_ - written, 0);
+		}
+		if (chunk_pos_>0) flushChunk();
+	}
+
+protected:
+	QFile& file_;
+	int ref_length_;
+	QVector<qint64>& offsets_;
+	QVector<int>& sizes_;
+	QByteArray chunk_;
+	int chunk_pos_;
+	bool chunk_nonzero_;
+	int last_depth_;
+	long long run_length_;
+	int run_depth_;
+
+	void flushRun()
+	{
+		if (run_length_>0) encode(run_length_, run_depth_);
+		run_length_ = 0;
+	}
+
+	//encodes a run, splitting it at chunk boundaries
+	void encode(long long length, int depth)
+	{
+		while (length>0)
+		{
+			int part = (int)std::min(length, (long long)(COV_CHUNK_SIZE - chunk_pos_));
+			appendVarint(chunk_, part);
+			int delta = depth - last_depth_;
+			appendVarint(chunk_, ((quint32)delta << 1) ^ (quint32)(delta >> 31)); //zig-zag encoding
+			last_depth_ = depth;
+			if (depth!=0) chunk_nonzero_ = true;
+
+			chunk_pos_ += part;
+			length -= part;
+			if (chunk_pos_==COV_CHUNK_SIZE) flushChunk();
+		}
+	}
+
+	//writes the current chunk to the file (chunks without coverage are not stored)
+	void flushChunk()
+	{
+		if (chunk_nonzero_)
+		{
+			offsets_.append(file_.pos());
+			sizes_.append(chunk_.size());
+			if (file_.write(chunk_)!=chunk_.size())
+			{
+				THROW(FileAccessException, "Could not write to file '" + file_.fileName() + "'!");
+			}
+		}
+		else
+		{
+			offsets_.append(-1);
+			sizes_.append(0);
+		}
+
+		chunk_.clear();
+		chunk_pos_ = 0;
+		chunk_nonzero_ = false;
+		last_depth_ = 0;
+	}
+};
+
+CoverageFile::CoverageFile(QString filename)
+	: filename_(filename)
+	, file_(filename)
+	, min_mapq_(0)
+	, chunk_size_(0)
+	, cache_ref_(-1)
+	, cache_chunk_(-1)
+{
+	if (!file_.open(QIODevice::ReadOnly))
+	{
+		THROW(FileAccessException, "Could not open file '" + filename + "' for reading!");
+	}
+	load();
+}
+
+void CoverageFile::load()
+{
+	QDataStream stream(&file_);
+	stream.setByteOrder(QDataStream::LittleEndian);
+
+	//header
+	char magic[4];
+	if (stream.readRawData(magic, 4)!=4 || memcmp(magic, COV_MAGIC, 4)!=0)
+	{
+		THROW(FileParseException, "File '" + filename_ + "' is not a coverage file!");
+	}
+	qint32 min_mapq, chunk_size, n_ref;
+	stream >> min_mapq >> chunk_size >> n_ref;
+	if (stream.status()!=QDataStream::Ok || chunk_size<=0 || n_ref<0)
+	{
+		THROW(FileParseException, "Invalid header in coverage file '" + filename_ + "'!");
+	}
+	min_mapq_ = min_mapq;
+	chunk_size_ = chunk_size;
+	for (int r=0; r<n_ref; ++r)
+	{
+		qint32 name_length, length;
+		stream >> name_length;
+		QByteArray name(std::max(0, name_length), 0);
+		stream.readRawData(name.data(), name.size());
+		stream >> length;
+		references_.push_back(BamTools::RefData(name.toStdString(), length));
+	}
+	if (stream.status()!=QDataStream::Ok)
+	{
+		THROW(FileParseException, "Truncated header in coverage file '" + filename_ + "'!");
+	}
+	chr_info_.reset(new ChromosomeInfo(references_, filename_));
+
+	//chunk index
+	qint64 index_offset;
+	if (file_.size()<8 || !file_.seek(file_.size()-8))
+	{
+		THROW(FileParseException, "Truncated coverage file '" + filename_ + "'!");
+	}
+	stream >> index_offset;
+	if (index_offset<=0 || index_offset>=file_.size() || !file_.seek(index_offset))
+	{
+		THROW(FileParseException, "Invalid chunk index offset in coverage file '" + filename_ + "'!");
+	}
+	chunk_offsets_.resize(n_ref);
+	chunk_sizes_.resize(n_ref);
+	for (int r=0; r<n_ref; ++r)
+	{
+		int n_chunks = (references_[r].RefLength + chunk_size_ - 1) / chunk_size_;
+		chunk_offsets_[r].resize(n_chunks);
+		chunk_sizes_[r].resize(n_chunks);
+		for (int c=0; c<n_chunks; ++c)
+		{
+			qint32 size;
+			stream >> chunk_offsets_[r][c] >> size;
+			chunk_sizes_[r][c] = size;
+		}
+	}
+	if (stream.status()!=QDataStream::Ok)
+	{
+		THROW(FileParseException, "Truncated chunk index in coverage file '" + filename_ + "'!");
+	}
+}
+
+const QVector<int>& CoverageFile::chunk(int ref_id, int chunk)
+{
+	if (ref_id==cache_ref_ && chunk==cache_chunk_) return cache_;
+
+	cache_.fill(0, chunk_size_);
+	cache_ref_ = -1;
+	cache_chunk_ = -1;
+
+	int size = chunk_sizes_[ref_id][chunk];
+	if (size>0)
+	{
+		if (!file_.seek(chunk_offsets_[ref_id][chunk]))
+		{
+			THROW(FileAccessException, "Could not seek in coverage file '" + filename_ + "'!");
+		}
+		QByteArray data = file_.read(size);
+		if (data.size()!=size)
+		{
+			THROW(FileParseException, "Truncated chunk in coverage file '" + filename_ + "'!");
+		}
+
+		//decode runs
+		const uchar* ptr = (const uchar*)data.constData();
+		const uchar* end = ptr + data.size();
+		int pos = 0;
+		int depth = 0;
+		while (ptr<end)
+		{
+			quint32 values[2];
+			for (int v=0; v<2; ++v)
+			{
+				quint32 value = 0;
+				int shift = 0;
+				while (true)
+				{
+					if (ptr>=end || shift>28) THROW(FileParseException, "Invalid chunk data in coverage file '" + filename_ + "'!");
+					value |= (quint32)(*ptr & 0x7f) << shift;
+					shift += 7;
+					if ((*ptr++ & 0x80)==0) break;
+				}
+				values[v] = value;
+			}
+			int length = (int)values[0];
+			depth += (int)(values[1] >> 1) ^ -(int)(values[1] & 1);
+			if (length>chunk_size_-pos) THROW(FileParseException, "Invalid chunk data in coverage file '" + filename_ + "'!");
+			std::fill(cache_.begin()+pos, cache_.begin()+pos+length, depth);
+			pos += length;
+		}
+	}
+
+	cache_ref_ = ref_id;
+	cache_chunk_ = chunk;
+	return cache_;
+}
+
+void CoverageFile::checkMinMappingQuality(int min_mapq) const
+{
+	if (min_mapq!=min_mapq_)
+	{
+		THROW(ArgumentException, "Coverage file '" + filename_ + "' was created with minimum mapping quality " + QString::number(min_mapq_) + ", but " + QString::number(min_mapq) + " was requested!");
+	}
+}
+
+QVector<int> CoverageFile::depth(const Chromosome& chr, int start, int end)
+{
+	QVector<int> output(std::max(0, end-start+1), 0);
+
+	int ref_id = chr_info_->refID(chr);
+	int first = std::max(start, 1);
+	int last = std::min(end, (int)references_[ref_id].RefLength);
+	int p = first;
+	while (p<=last)
+	{
+		int c = (p-1) / chunk_size_;
+		int chunk_start = c * chunk_size_ + 1;
+		int part_end = std::min(last, chunk_start + chunk_size_ - 1);
+		const QVector<int>& data = chunk(ref_id, c);
+		std::copy(data.constBegin() + (p - chunk_start), data.constBegin() + (part_end - chunk_start + 1), output.begin() + (p - start));
+		p = part_end + 1;
+	}
+
+	return output;
+}
+
+long long CoverageFile::depthSum(const Chromosome& chr, int start, int end)
+{
+	long long sum = 0;
+
+	int ref_id = chr_info_->refID(chr);
+	int first = std::max(start, 1);
+	int last = std::min(end, (int)references_[ref_id].RefLength);
+	int p = first;
+	while (p<=last)
+	{
+		int c = (p-1) / chunk_size_;
+		int chunk_start = c * chunk_size_ + 1;
+		int part_end = std::min(last, chunk_start + chunk_size_ - 1);
+		if (chunk_sizes_[ref_id][c]>0)
+		{
+			const QVector<int>& data = chunk(ref_id, c);
+			for (int i=p-chunk_start; i<=part_end-chunk_start; ++i)
+			{
+				sum += data[i];
+			}
+		}
+		p = part_end + 1;
+	}
+
+	return sum;
+}
+
+void CoverageFile::create(QString bam_file, QString cov_file, int min_mapq, int threads)
+{
+	BamInfileStream reader(bam_file, threads);
+	const BamTools::RefVector& refs = reader.GetReferenceData();
+
+	QFile file(cov_file);
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		THROW(FileAccessException, "Could not open file '" + cov_file + "' for writing!");
+	}
+	QDataStream stream(&file);
+	stream.setByteOrder(QDataStream::LittleEndian);
+
+	//header
+	stream.writeRawData(COV_MAGIC, 4);
+	stream << (qint32)min_mapq << (qint32)COV_CHUNK_SIZE << (qint32)refs.size();
+	for (unsigned int r=0; r<refs.size(); ++r)
+	{
+		stream << (qint32)refs[r].RefName.size();
+		stream.writeRawData(refs[r].RefName.data(), refs[r].RefName.size());
+		stream << (qint32)refs[r].RefLength;
+	}
+
+	//chunks: sweep through the alignments and keep the end positions of overlapping alignments in a min-heap
+	QVector<QVector<qint64> > offsets(refs.size());
+	QVector<QVector<int> > sizes(refs.size());
+	int ref_id = -1;
+	int last_pos = -1;
+	int pos = 1; //next position to write (1-based)
+	int depth = 0;
+	std::priority_queue<int, std::vector<int>, std::greater<int> > ends; //1-based inclusive end positions
+	QScopedPointer<CoverageChunkWriter> writer;
+
+	BamTools::BamAlignment al;
+	while (true)
+	{
+		bool has_alignment = reader.GetNextAlignmentCore(al);
+		if (has_alignment && al.RefID!=-1 && al.RefID==ref_id && al.Position<last_pos)
+		{
+			THROW(ArgumentException, "BAM file '" + bam_file + "' is not sorted by coordinate!");
+		}
+
+		//finish references
+		int next_ref = (has_alignment && al.RefID!=-1) ? al.RefID : (int)refs.size();
+		if (next_ref<ref_id)
+		{
+			THROW(ArgumentException, "BAM file '" + bam_file + "' is not sorted by coordinate!");
+		}
+		while (ref_id<next_ref)
+		{
+			if (ref_id>=0)
+			{
+				int ref_length = refs[ref_id].RefLength;
+				while (!ends.empty())
+				{
+					int end = std::min(ends.top(), ref_length);
+					ends.pop();
+					if (end>=pos)
+					{
+						writer->add(end-pos+1, depth);
+						pos = end+1;
+					}
+					--depth;
+				}
+				writer->close();
+			}
+
+			++ref_id;
+			pos = 1;
+			depth = 0;
+			last_pos = -1;
+			if (ref_id<(int)refs.size())
+			{
+				writer.reset(new CoverageChunkWriter(file, refs[ref_id].RefLength, offsets[ref_id], sizes[ref_id]));
+			}
+		}
+		if (!has_alignment || al.RefID==-1) break;
+		last_pos = al.Position;
+
+		if (al.IsDuplicate()) continue;
+		if (!al.IsPrimaryAlignment()) continue;
+		if (!al.IsMapped() || al.MapQuality<min_mapq) continue;
+
+		//close alignments that end before the current alignment
+		int start = al.Position + 1;
+		while (!ends.empty() && ends.top()<start)
+		{
+			int end = ends.top();
+			ends.pop();
+			if (end>=pos)
+			{
+				writer->add(end-pos+1, depth);
+				pos = end+1;
+			}
+			--depth;
+		}
+
+		//open current alignment
+		if (start>pos)
+		{
+			writer->add(start-pos, depth);
+			pos = start;
+		}
+		int end = al.GetEndPosition();
+		if (end>=start)
+		{
+			++depth;
+			ends.push(end);
+		}
+	}
+
+	//chunk index
+	qint64 index_offset = file.pos();
+	for (int r=0; r<offsets.count(); ++r)
+	{
+		for (int c=0; c<offsets[r].count(); ++c)
+		{
+			stream << offsets[r][c] << (qint32)sizes[r][c];
+		}
+	}
+	stream << index_offset;
+
+	if (stream.status()!=QDataStream::Ok)
+	{
+		THROW(FileAccessException, "Could not write to file '" + cov_file + "'!");
+	}
+	file.close();
+}
+
+bool CoverageFile::isCoverageFile(QString filename)
+{
+	return filename.endsWith(".cov", Qt::CaseInsensitive);
+}
+
+QString CoverageFile::precalculated(QString bam_file, int min_mapq)
+{
+	QString cov_file = bam_file;
+	if (cov_file.endsWith(".bam", Qt::CaseInsensitive)) cov_file.chop(4);
+	cov_file += ".cov";
+
+	QFileInfo cov_info(cov_file);
+	QDateTime bam_modified = QFileInfo(bam_file).lastModified();
+	if (!cov_info.exists() || cov_info.lastModified()<bam_modified) return bam_file;
+
+	//the result is cached, because reading the header of the coverage file is expensive when called for many regions (the key contains the modification times, so changed files are checked again)
+	static QMutex mutex;
+	static QHash<QString, QString> cache;
+	QString key = bam_file + "\t" + QString::number(min_mapq) + "\t" + bam_modified.toString(Qt::ISODate) + "\t" + cov_info.lastModified().toString(Qt::ISODate);
+	QMutexLocker locker(&mutex);
+	if (cache.contains(key)) return cache[key];
+
+	QString output = cov_file;
+	try
+	{
+		CoverageFile file(cov_file);
+		if (file.minMappingQuality()!=min_mapq) output = bam_file;
+	}
+	catch(Exception& /*e*/)
+	{
+		output = bam_file;
+	}
+
+	cache.insert(key, output);
+	return output;
+}
@@ -0,0 +1,75 @@
+#ifndef COVERAGEFILE_H
+#define COVERAGEFILE_H
+
+#include "cppNGS_global.h"
+#include "Chromosome.h"
+#include "ChromosomeInfo.h"
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QScopedPointer>
+
+/**
+  @brief Precomputed per-base depth of coverage of a BAM file (".cov" file).
+
+  The depth is stored run-length encoded (run length and depth difference as variable-length integers) in chunks of 65536 bases.
+  A chunk index at the end of the file allows decoding only the chunks that overlap a queried region.
+  The depth is calculated like in Statistics::lowCoverage and Statistics::avgCoverage, i.e. duplicates, secondary alignments, unmapped reads and reads with low mapping quality are not counted.
+*/
+class CPPNGSSHARED_EXPORT CoverageFile
+{
+public:
+	///Constructor - opens a coverage file for reading.
+	CoverageFile(QString filename);
+
+	///Creates a coverage file from a coordinate-sorted BAM file. @p threads is the number of threads used for BAM decompression.
+	static void create(QString bam_file, QString cov_file, int min_mapq = 1, int threads = 1);
+	///Returns if the file is a coverage file (based on the '.cov' extension).
+	static bool isCoverageFile(QString filename);
+	///Returns the coverage file of a BAM file (same base name with '.cov' extension) if it exists, is newer than the BAM file and was created with the given mapping quality cutoff. Otherwise the BAM file is returned. The result is cached per BAM file.
+	static QString precalculated(QString bam_file, int min_mapq = 1);
+
+	///Returns the minimum mapping quality of reads counted when creating the file.
+	int minMappingQuality() const
+	{
+		return min_mapq_;
+	}
+	///Throws an ArgumentException if the file was not created with the given minimum mapping quality.
+	void checkMinMappingQuality(int min_mapq) const;
+	///Returns chromosome information of the reference sequences.
+	const ChromosomeInfo& chromosomeInfo() const
+	{
+		return *chr_info_;
+	}
+
+	///Returns the per-base depth of a region (1-based, closed interval). Bases outside the chromosome have depth 0.
+	QVector<int> depth(const Chromosome& chr, int start, int end);
+	///Returns the sum of the per-base depth of a region (1-based, closed interval).
+	long long depthSum(const Chromosome& chr, int start, int end);
+
+protected:
+	QString filename_;
+	QFile file_;
+	int min_mapq_;
+	int chunk_size_;
+	BamTools::RefVector references_;
+	QScopedPointer<ChromosomeInfo> chr_info_;
+	QVector<QVector<qint64> > chunk_offsets_;
+	QVector<QVector<int> > chunk_sizes_;
+
+	//decoded chunk cache
+	int cache_ref_;
+	int cache_chunk_;
+	QVector<int> cache_;
+
+	///Reads the header and chunk index.
+	void load();
+	///Decodes a chunk into the cache.
+	const QVector<int>& chunk(int ref_id, int chunk);
+
+	//declared away methods
+	CoverageFile(const CoverageFile&);
+	CoverageFile& operator=(const CoverageFile&);
+};
+
+#endif // COVERAGEFILE_H
@@ -2,6 +2,7 @@
 #include "Exceptions.h"
 #include "Helper.h"
 #include "Log.h"
+#include "Profiler.h"
 #include <QRegExp>
 #include <QStringList>
 
@@ -11,13 +12,24 @@ FastaFileIndex::FastaFileIndex(QString fasta_file)
 	: fasta_name_(fasta_file)
 	, index_name_(fasta_file + ".fai")
 	, file_(fasta_file)
+	, data_(nullptr)
+	, data_size_(0)
 {
+	ProfilerTimer timer("FastaFileIndex::load");
+
 	//open FASTA file handle
 	if (!file_.open(QIODevice::ReadOnly | QIODevice::Text))
 	{
 		THROW(FileAccessException, "Could not open FASTA file '" + fasta_name_ + "' for reading!");
 	}
 
+	//memory-map FASTA file (read-only, shared between threads)
+	data_size_ = file_.size();
+	if (data_size_>0)
+	{
+		data_ = file_.map(0, data_size_);
+	}
+
 	//load index file
 	int linenum = 0;
 	QSharedPointer<QFile> file = Helper::openFileForReading(index_name_);
@@ -49,6 +61,7 @@ FastaFileIndex::FastaFileIndex(QString fasta_file)
 
 FastaFileIndex::~FastaFileIndex()
 {
+	if (data_!=nullptr) file_.unmap(const_cast<uchar*>(data_));
 	file_.close();
 }
 
@@ -56,16 +69,10 @@ Sequence FastaFileIndex::seq(const Chromosome& chr, bool to_upper) const
 {
 	const FastaIndexEntry& entry = index(chr);
 
-	//jump to postion
-	if (!file_.seek(entry.offset))
-	{
-		THROW(FileAccessException, "QFile::seek did not work on " + fasta_name_ + "'!");
-	}
-
 	//read data
 	int newlines_in_sequence = entry.length / entry.line_blen;
 	int seqlen = newlines_in_sequence  + entry.length;
-	Sequence output = file_.read(seqlen).replace("\n", 1, "", 0);
+	Sequence output = read(entry.offset, seqlen).replace("\n", 1, "", 0);
 
 	//output
 	if (to_upper) output = output.toUpper();
@@ -87,24 +94,43 @@ Sequence FastaFileIndex::seq(const Chromosome& chr, int start, int length, bool
 		return "";
 	}
 
-	//jump to postion
-	int newlines_before = start > 0 ? (start - 1) / entry.line_blen : 0;
-	if (!file_.seek(entry.offset + newlines_before + start))
-	{
-		THROW(FileAccessException, "QFile::seek did not work on " + fasta_name_ + "'!");
-	}
-
 	//read data
+	int newlines_before = start > 0 ? (start - 1) / entry.line_blen : 0;
 	int newlines_by_end = (start + length - 1) / entry.line_blen;
 	int newlines_inside = newlines_by_end - newlines_before;
 	int seqlen = length + newlines_inside;
-	Sequence output = file_.read(seqlen).replace("\n", 1, "", 0);
+	Sequence output = read(entry.offset + newlines_before + start, seqlen).replace("\n", 1, "", 0);
 
 	//output
 	if (to_upper) output = output.toUpper();
 	return output;
 }
 
+QByteArray FastaFileIndex::read(qint64 pos, int size) const
+{
+	//memory-mapped file
+	if (data_!=nullptr)
+	{
+		if (pos<0 || pos>data_size_)
+		{
+			THROW(FileAccessException, "Invalid position in FASTA file '" + fasta_name_ + "'!");
+		}
+		QByteArray output((const char*)data_ + pos, (int)std::min((qint64)size, data_size_ - pos));
+
+		//remove carriage returns (like QIODevice::Text does when reading from the file)
+		if (output.contains('\r')) output.replace("\r", "");
+		return output;
+	}
+
+	//jump to postion
+	if (!file_.seek(pos))
+	{
+		THROW(FileAccessException, "QFile::seek did not work on " + fasta_name_ + "'!");
+	}
+
+	return file_.read(size);
+}
+
 const FastaFileIndex::FastaIndexEntry& FastaFileIndex::index(const Chromosome& chr) const
 {
 	QMap<QString, FastaIndexEntry>::const_iterator it = index_.find(chr.strNormalized(false));
@@ -7,7 +7,11 @@
 #include <QMap>
 #include <QFile>
 
-///Fasta file index for fast access to seqences in a FASTA file.
+/**
+  @brief Fasta file index for fast access to seqences in a FASTA file.
+
+  If possible, the FASTA file is memory-mapped. In that case, sequences can be accessed from several threads in parallel.
+*/
 class CPPNGSSHARED_EXPORT FastaFileIndex
 {
 public:
@@ -27,6 +31,12 @@ public:
         return index(chr).length;
     }
 
+	///Returns if the FASTA file is memory-mapped, i.e. if sequence access is thread-safe.
+	bool isMapped() const
+	{
+		return data_!=nullptr;
+	}
+
     ///Returns the chromosome names (normalized).
     QList<QString> names() const
     {
@@ -46,7 +56,11 @@ protected:
 	};
 	QMap<QString, FastaIndexEntry> index_;
 	mutable QFile file_;
+	const uchar* data_;
+	qint64 data_size_;
 	const FastaIndexEntry& index(const Chromosome& chr) const;
+	///Reads @p size bytes starting at file position @p pos (from the memory-mapped file if available).
+	QByteArray read(qint64 pos, int size) const;
 };
 
 #endif
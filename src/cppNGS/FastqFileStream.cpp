@@ -1,4 +1,6 @@
 #include "FastqFileStream.h"
+#include <algorithm>
+#include <cstring>
 
 void FastqEntry::validate() const
 {
@@ -41,48 +43,44 @@ void FastqEntry::clear()
 	qualities.clear();
 }
 
-int FastqEntry::trimQuality(int cutoff, int window, int offset)
+///Returns the read length after quality trimming from the end using a sliding window approach.
+static int qualityTrimmedLength(const char* qualities, int count, int cutoff, int window, int offset)
 {
     //too small read => abort
-	int count = qualities.count();
-    if (count<window) return 0;
+    if (count<window) return count;
 
     //init
     double sum = 0;
     for (int i=count-1; i>count-window; --i)
     {
-        sum += quality(i, offset);
+        sum += qualities[i] - offset;
     }
 
     //search
     for (int i=count-window; i>=0; --i)
     {
-        sum += quality(i, offset);
+        sum += qualities[i] - offset;
         if (sum/window >= cutoff) //window below cutoff
         {
             int count_new = i+window;
-            while(count_new>0 && quality(count_new-1, offset)<cutoff) //remove bases at the end of the window until the cutoff is reached.
+            while(count_new>0 && qualities[count_new-1] - offset<cutoff) //remove bases at the end of the window until the cutoff is reached.
             {
                 --count_new;
             }
-			bases.resize(count_new);
-			qualities.resize(count_new);
-            return count-count_new;
+            return count_new;
         }
-        sum -= quality(i+window-1, offset);
+        sum -= qualities[i+window-1] - offset;
     }
 
     //no windows above cutoff => remove all bases
-	bases.resize(0);
-	qualities.resize(0);
-    return count;
+    return 0;
 }
 
-int FastqEntry::trimN(int num_n)
+///Returns the read length after trimming of non-determined bases using a sliding window approach.
+static int nTrimmedLength(const char* bases, int count, int num_n)
 {
     //too small read => abort
-	int count = bases.count();
-    if (count<num_n) return 0;
+    if (count<num_n) return count;
 
     //init
     int sum = 0;
@@ -97,15 +95,157 @@ int FastqEntry::trimN(int num_n)
 		sum += (bases[i]=='N');
         if (sum==num_n)
         {
-            int count_new = i-num_n+1;
-			bases.resize(count_new);
-			qualities.resize(count_new);
-            return count-count_new;
+            return i-num_n+1;
         }
 		sum -= (bases[i-num_n+1]=='N');
     }
 
-    return 0;
+    return count;
+}
+
+///Sets the content of a line. The memory of the line is re-used if possible.
+static void setLine(QByteArray& line, const char* data, int length)
+{
+	line.resize(length);
+	memcpy(line.data(), data, length);
+}
+
+int FastqEntry::trimQuality(int cutoff, int window, int offset)
+{
+	int count = qualities.count();
+	int count_new = qualityTrimmedLength(qualities.constData(), count, cutoff, window, offset);
+	bases.resize(count_new);
+	qualities.resize(count_new);
+	return count-count_new;
+}
+
+int FastqEntry::trimN(int num_n)
+{
+	int count = bases.count();
+	int count_new = nTrimmedLength(bases.constData(), count, num_n);
+	bases.resize(count_new);
+	qualities.resize(count_new);
+	return count-count_new;
+}
+
+FastqBatch::FastqBatch(int capacity)
+	: capacity_(capacity)
+	, data_()
+	, data_size_(0)
+	, records_()
+{
+	if (capacity<1)
+	{
+		THROW(ArgumentException, "Invalid FASTQ batch capacity " + QString::number(capacity) + "!");
+	}
+	records_.reserve(capacity);
+}
+
+void FastqBatch::clear()
+{
+	//no QVector::clear(), because it releases the memory
+	records_.resize(0);
+	data_size_ = 0;
+}
+
+void FastqBatch::append(const FastqEntry& entry)
+{
+	Record record;
+	record.header = appendData(entry.header);
+	record.header_length = entry.header.length();
+	record.bases = appendData(entry.bases);
+	record.header2 = appendData(entry.header2);
+	record.header2_length = entry.header2.length();
+	record.qualities = appendData(entry.qualities);
+	record.length = entry.bases.length();
+	record.discarded = false;
+	records_.append(record);
+}
+
+int FastqBatch::appendData(const QByteArray& data)
+{
+	int offset = data_size_;
+	if (data_size_ + data.length() > data_.size())
+	{
+		data_.resize(std::max(2 * data_.size(), data_size_ + data.length()));
+	}
+	memcpy(data_.data() + offset, data.constData(), data.length());
+	data_size_ += data.length();
+	return offset;
+}
+
+void FastqBatch::entry(int i, FastqEntry& entry) const
+{
+	const Record& record = records_[i];
+	setLine(entry.header, data_.constData() + record.header, record.header_length);
+	setLine(entry.bases, data_.constData() + record.bases, record.length);
+	setLine(entry.header2, data_.constData() + record.header2, record.header2_length);
+	setLine(entry.qualities, data_.constData() + record.qualities, record.length);
+}
+
+void FastqBatch::trim(int i, int start, int length)
+{
+	Record& record = records_[i];
+	start = std::max(0, std::min(start, record.length));
+	length = std::max(0, std::min(length, record.length - start));
+	record.bases += start;
+	record.qualities += start;
+	record.length = length;
+}
+
+int FastqBatch::trimQuality(int i, int cutoff, int window, int offset)
+{
+	Record& record = records_[i];
+	int count = record.length;
+	record.length = qualityTrimmedLength(data_.constData() + record.qualities, count, cutoff, window, offset);
+	return count - record.length;
+}
+
+int FastqBatch::trimN(int i, int num_n)
+{
+	Record& record = records_[i];
+	int count = record.length;
+	record.length = nTrimmedLength(data_.constData() + record.bases, count, num_n);
+	return count - record.length;
+}
+
+int FastqBatch::trimQuality(int cutoff, int window, int offset)
+{
+	int trimmed = 0;
+	for (int i=0; i<records_.count(); ++i)
+	{
+		if (trimQuality(i, cutoff, window, offset)>0) ++trimmed;
+	}
+	return trimmed;
+}
+
+int FastqBatch::trimN(int num_n)
+{
+	int trimmed = 0;
+	for (int i=0; i<records_.count(); ++i)
+	{
+		if (trimN(i, num_n)>0) ++trimmed;
+	}
+	return trimmed;
+}
+
+void FastqBatch::toFastq(QByteArray& output) const
+{
+	const char* data = data_.constData();
+	for (int i=0; i<records_.count(); ++i)
+	{
+		const Record& record = records_[i];
+		if (record.discarded) continue;
+
+		output.append(data + record.header, record.header_length);
+		output.append('\n');
+		output.append(data + record.bases, record.length);
+		output.append('\n');
+		output.append(data + record.header2, record.header2_length);
+		output.append('\n');
+		output.append(data + record.qualities, record.length);
+		output.append('\n');
+	}
 }
 
 FastqFileStream::FastqFileStream(QString filename, bool auto_validate)
@@ -115,6 +255,7 @@ FastqFileStream::FastqFileStream(QString filename, bool auto_validate)
     , last_output_(NULL)
     , entry_index_(-1)
     , auto_validate_(auto_validate)
+	, batch_entry_()
 {
     gzfile_ = gzopen(filename.toLatin1().data(), "rb"); //read binary: always open in binary mode because windows and mac open in text mode
     if (gzfile_ == NULL)
@@ -157,6 +298,18 @@ void FastqFileStream::readEntry(FastqEntry& entry)
 	if (auto_validate_) entry.validate();
 }
 
+void FastqFileStream::readBatch(FastqBatch& batch)
+{
+	batch.clear();
+	while (!batch.isFull() && !atEnd())
+	{
+		readEntry(batch_entry_);
+		if (batch_entry_.header.isEmpty()) break; //no entry left (e.g. empty file)
+
+		batch.append(batch_entry_);
+	}
+}
+
 void FastqFileStream::extractLine(QByteArray& line)
 {
 	int i=0;
@@ -164,7 +317,7 @@ void FastqFileStream::extractLine(QByteArray& line)
 	{
 		++i;
 	}
-	line = QByteArray(buffer_, i);
+	setLine(line, buffer_, i);
 	last_output_ = gzgets(gzfile_, buffer_, 1024);
 }
 
@@ -174,6 +327,7 @@ FastqOutfileStream::FastqOutfileStream(QString filename, bool thread_safe_mode,
 	, thread_safe_(thread_safe_mode)
 	, filename_(filename)
     , is_closed_(false)
+	, buffer_()
 {
     gzfile_ = gzopen(filename.toLatin1().data(),"wb");
     if (gzfile_ == NULL)
@@ -211,6 +365,25 @@ void FastqOutfileStream::write(const FastqEntry& entry)
 	if (thread_safe_) mutex_.unlock();
 }
 
+void FastqOutfileStream::write(const FastqBatch& batch)
+{
+	if (thread_safe_) mutex_.lock();
+
+	//create output in buffer (re-used for the next batch)
+	buffer_.reserve(batch.data_size_ + 4 * batch.count());
+	buffer_.resize(0);
+	batch.toFastq(buffer_);
+
+	//write buffer
+	if (buffer_.size()>0 && gzwrite(gzfile_, buffer_.constData(), buffer_.size())==0)
+	{
+		if (thread_safe_) mutex_.unlock();
+		THROW(FileAccessException, "Could not write to file '" + filename_ + "'!");
+	}
+
+	if (thread_safe_) mutex_.unlock();
+}
+
 void FastqOutfileStream::close()
 {
     if (is_closed_) return;
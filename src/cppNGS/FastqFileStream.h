@@ -35,6 +35,116 @@ struct CPPNGSSHARED_EXPORT FastqEntry
     int trimN(int num_n);
 };
 
+/**
+  @brief Batch of FASTQ entries stored in one contiguous buffer.
+
+  The lines of all entries are stored consecutively in one buffer and are accessed via an offset table.
+  The buffer is re-used when the batch is cleared, i.e. processing batches does not allocate memory per entry.
+*/
+class CPPNGSSHARED_EXPORT FastqBatch
+{
+public:
+	///Constructor. @p capacity is the maximum number of entries.
+	FastqBatch(int capacity = 10000);
+
+	///Returns the number of entries.
+	int count() const
+	{
+		return records_.count();
+	}
+	///Returns the maximum number of entries.
+	int capacity() const
+	{
+		return capacity_;
+	}
+	///Returns if the maximum number of entries is reached.
+	bool isFull() const
+	{
+		return records_.count()>=capacity_;
+	}
+	///Removes all entries (the memory is kept for the next entries).
+	void clear();
+	///Appends an entry.
+	void append(const FastqEntry& entry);
+
+	///Returns the main header line of the entry with the index @p i (not null-terminated).
+	const char* header(int i) const
+	{
+		return data_.constData() + records_[i].header;
+	}
+	///Returns the main header line length of the entry with the index @p i.
+	int headerLength(int i) const
+	{
+		return records_[i].header_length;
+	}
+	///Returns the bases of the entry with the index @p i (not null-terminated).
+	const char* bases(int i) const
+	{
+		return data_.constData() + records_[i].bases;
+	}
+	///Returns the qualities of the entry with the index @p i (not null-terminated).
+	const char* qualities(int i) const
+	{
+		return data_.constData() + records_[i].qualities;
+	}
+	///Returns the number of bases/qualities of the entry with the index @p i.
+	int length(int i) const
+	{
+		return records_[i].length;
+	}
+	///Copies the entry with the index @p i into @p entry. The memory of @p entry is re-used if possible.
+	void entry(int i, FastqEntry& entry) const;
+
+	///Trims the entry with the index @p i to the @p length bases starting at the 0-based position @p start.
+	void trim(int i, int start, int length);
+	///Discards the entry with the index @p i, i.e. it is not written to output streams.
+	void discard(int i)
+	{
+		records_[i].discarded = true;
+	}
+	///Returns if the entry with the index @p i is discarded.
+	bool isDiscarded(int i) const
+	{
+		return records_[i].discarded;
+	}
+
+	///Trims the entry with the index @p i by quality from the end using a sliding window approach (see FastqEntry). Returns the number of trimmed bases.
+	int trimQuality(int i, int cutoff, int window=5, int offset=33);
+	///Trims the entry with the index @p i by non-determined bases using a sliding window approach (see FastqEntry). Returns the number of trimmed bases.
+	int trimN(int i, int num_n);
+	///Trims all entries by quality (see FastqEntry). Returns the number of trimmed entries.
+	int trimQuality(int cutoff, int window=5, int offset=33);
+	///Trims all entries by non-determined bases (see FastqEntry). Returns the number of trimmed entries.
+	int trimN(int num_n);
+
+	///Appends all entries that are not discarded to @p output in FASTQ format.
+	void toFastq(QByteArray& output) const;
+
+protected:
+	///Entry offsets in the buffer.
+	struct Record
+	{
+		int header;
+		int header_length;
+		int bases;
+		int header2;
+		int header2_length;
+		int qualities;
+		int length;
+		bool discarded;
+	};
+
+	int capacity_;
+	QByteArray data_;
+	int data_size_;
+	QVector<Record> records_;
+
+	///Appends data to the buffer and returns the offset of the data.
+	int appendData(const QByteArray& data);
+
+	friend class FastqOutfileStream;
+};
+
 /**
   @brief FASTQ file input stream (gzipped or plain).
 
@@ -56,6 +166,8 @@ public:
     }
     ///Reads a line (or until the buffer is full).
 	void readEntry(FastqEntry& entry);
+	///Clears the batch and reads entries until the batch is full or the end of the file is reached.
+	void readBatch(FastqBatch& batch);
     ///Returns the 0-based index of the current entry, or -1 if no entry has been loaded.
     int index() const
     {
@@ -69,6 +181,7 @@ protected:
     char* last_output_;
     int entry_index_;
     bool auto_validate_;
+	FastqEntry batch_entry_;
 	void extractLine(QByteArray& line);
 
     //declared away methods
@@ -92,6 +205,8 @@ public:
 
     ///Writes an entry to the stream.
     void write(const FastqEntry& entry);
+	///Writes all entries of a batch that are not discarded to the stream.
+	void write(const FastqBatch& batch);
     ///Closes the stream.
     void close();
 
@@ -107,6 +222,7 @@ protected:
     QString filename_;
     gzFile gzfile_;
 	bool is_closed_;
+	QByteArray buffer_;
 
     //declared away methods
     FastqOutfileStream(const FastqOutfileStream& );
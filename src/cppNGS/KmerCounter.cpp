@@ -0,0 +1,318 @@
+#include "KmerCounter.h"
+#include "BedChunkRunner.h"
+#include "Chromosome.h"
+#include "Exceptions.h"
+#include "FastaFileIndex.h"
+#include "Helper.h"
+#include "Log.h"
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QTextStream>
+#include <QThreadPool>
+#include <algorithm>
+
+///Worker that counts the k-mers of a list of reference genome segments.
+class KmerCountWorker
+	: public QRunnable
+{
+public:
+	KmerCountWorker(const FastaFileIndex& reference, const BedFile& segments, KmerCounter& counter, QString& error)
+		: QRunnable()
+		, reference_(reference)
+		, segments_(segments)
+		, counter_(counter)
+		, error_(error)
+	{
+	}
+
+	void run()
+	{
+		try
+		{
+			for (int i=0; i<segments_.count(); ++i)
+			{
+				const BedLine& segment = segments_[i];
+				counter_.add(reference_.seq(segment.chr(), segment.start(), segment.length(), true));
+			}
+		}
+		catch(Exception& e)
+		{
+			error_ = e.message();
+		}
+	}
+
+protected:
+	const FastaFileIndex& reference_;
+	const BedFile& segments_;
+	KmerCounter& counter_;
+	QString& error_;
+};
+
+KmerCounter::KmerCounter(int k)
+	: k_(k)
+	, counts_()
+{
+	if (k<1 || k>12)
+	{
+		THROW(ArgumentException, "Invalid k-mer length " + QString::number(k) + ". Valid range is 1 to 12!");
+	}
+	counts_.fill(0, 1<<(2*k));
+}
+
+void KmerCounter::add(const QByteArray& seq)
+{
+	const int mask = counts_.count() - 1;
+	const char* data = seq.constData();
+	const int length = seq.length();
+	int code = 0;
+	int valid = 0; //number of valid bases at the end of the current k-mer
+	for (int i=0; i<length; ++i)
+	{
+		int base = baseCode(data[i]);
+		if (base==-1)
+		{
+			valid = 0;
+			continue;
+		}
+
+		code = ((code << 2) | base) & mask;
+		++valid;
+		if (valid>=k_) ++counts_[code];
+	}
+}
+
+void KmerCounter::add(const KmerCounter& other)
+{
+	if (other.k_!=k_)
+	{
+		THROW(ArgumentException, "Cannot add k-mer counts with different k-mer length!");
+	}
+	for (int i=0; i<counts_.count(); ++i)
+	{
+		counts_[i] += other.counts_[i];
+	}
+}
+
+long long KmerCounter::count(const QByteArray& kmer) const
+{
+	if (kmer.length()!=k_)
+	{
+		THROW(ArgumentException, "K-mer '" + kmer + "' does not have length " + QString::number(k_) + "!");
+	}
+
+	int code = 0;
+	for (int i=0; i<kmer.length(); ++i)
+	{
+		int base = baseCode(kmer[i]);
+		if (base==-1) return 0;
+		code = (code << 2) | base;
+	}
+	return counts_[code];
+}
+
+void KmerCounter::store(QString filename) const
+{
+	QSharedPointer<QFile> file = Helper::openFileForWriting(filename);
+	QTextStream stream(file.data());
+	for (int code=0; code<counts_.count(); ++code)
+	{
+		QByteArray kmer(k_, 'N');
+		for (int i=0; i<k_; ++i)
+		{
+			kmer[k_-1-i] = "ACGT"[(code >> (2*i)) & 3];
+		}
+		stream << kmer << "\t" << counts_[code] << "\n";
+	}
+}
+
+void KmerCounter::load(QString filename)
+{
+	QStringList lines = Helper::loadTextFile(filename, true, '#', true);
+	if (lines.count()!=counts_.count())
+	{
+		THROW(FileParseException, "K-mer count file '" + filename + "' has " + QString::number(lines.count()) + " lines, but " + QString::number(counts_.count()) + " are expected!");
+	}
+
+	counts_.fill(0);
+	foreach(const QString& line, lines)
+	{
+		QStringList parts = line.split('\t');
+		if (parts.count()!=2 || parts[0].length()!=k_)
+		{
+			THROW(FileParseException, "Invalid line in k-mer count file '" + filename + "': " + line);
+		}
+
+		int code = 0;
+		for (int i=0; i<k_; ++i)
+		{
+			int base = baseCode(parts[0][i].toLatin1());
+			if (base==-1) THROW(FileParseException, "Invalid k-mer in k-mer count file '" + filename + "': " + line);
+			code = (code << 2) | base;
+		}
+
+		bool ok = false;
+		counts_[code] = parts[1].toLongLong(&ok);
+		if (!ok) THROW(FileParseException, "Invalid count in k-mer count file '" + filename + "': " + line);
+	}
+}
+
+KmerCounter KmerCounter::countGenome(QString ref_file, int k, int threads, QString cache_folder)
+{
+	FastaFileIndex reference(ref_file);
+
+	//cached counts
+	QString cache_file;
+	if (!cache_folder.isEmpty())
+	{
+		cache_file = cacheFile(cache_folder, ref_file, "genome", k);
+		if (QFile::exists(cache_file))
+		{
+			try
+			{
+				KmerCounter output(k);
+				output.load(cache_file);
+				return output;
+			}
+			catch(Exception& e)
+			{
+				Log::warn("Could not load k-mer count cache file: " + e.message());
+			}
+		}
+	}
+
+	//split chromosomes into bins (overlapping by k-1 bases, so that each k-mer is counted once)
+	const int bin = 50000000;
+	QList<BedFile> segments;
+	foreach(QString name, reference.names())
+	{
+		Chromosome chr(name);
+		if (!chr.isNonSpecial()) continue;
+
+		BedFile chr_segments;
+		int chrom_length = reference.lengthOf(chr);
+		for(int start=1; start<=chrom_length; start+=bin)
+		{
+			int seg_start = std::max(1, start-(k-1));
+			int seg_end = std::min(start+bin-1, chrom_length);
+			chr_segments.append(BedLine(chr, seg_start, seg_end));
+		}
+		segments << chr_segments;
+	}
+	KmerCounter output = countSegments(reference, segments, k, threads);
+
+	if (!cache_file.isEmpty()) output.storeCache(cache_file);
+
+	return output;
+}
+
+KmerCounter KmerCounter::countRegions(QString ref_file, const BedFile& regions, int k, int threads, QString cache_folder)
+{
+	//cached counts
+	QString cache_file;
+	if (!cache_folder.isEmpty())
+	{
+		QByteArray key_data = "regions\n";
+		for (int i=0; i<regions.count(); ++i)
+		{
+			key_data += regions[i].toString(false).toLatin1() + "\n";
+		}
+		cache_file = cacheFile(cache_folder, ref_file, key_data, k);
+		if (QFile::exists(cache_file))
+		{
+			try
+			{
+				KmerCounter output(k);
+				output.load(cache_file);
+				return output;
+			}
+			catch(Exception& e)
+			{
+				Log::warn("Could not load k-mer count cache file: " + e.message());
+			}
+		}
+	}
+
+	FastaFileIndex reference(ref_file);
+	KmerCounter output = countSegments(reference, BedChunkRunner::split(regions, std::max(1, threads)), k, threads);
+
+	if (!cache_file.isEmpty()) output.storeCache(cache_file);
+
+	return output;
+}
+
+KmerCounter KmerCounter::countSegments(const FastaFileIndex& reference, const QList<BedFile>& segments, int k, int threads)
+{
+	//one counter per segment list (merged at the end)
+	QVector<KmerCounter> counters(segments.count(), KmerCounter(k));
+	QVector<QString> errors(segments.count());
+
+	//parallel access is possible only if the reference genome is memory-mapped
+	if (threads>1 && reference.isMapped())
+	{
+		QThreadPool pool;
+		pool.setMaxThreadCount(threads);
+		for (int i=0; i<segments.count(); ++i)
+		{
+			pool.start(new KmerCountWorker(reference, segments[i], counters[i], errors[i]));
+		}
+		pool.waitForDone();
+	}
+	else
+	{
+		for (int i=0; i<segments.count(); ++i)
+		{
+			KmerCountWorker(reference, segments[i], counters[i], errors[i]).run();
+		}
+	}
+
+	KmerCounter output(k);
+	for (int i=0; i<segments.count(); ++i)
+	{
+		if (!errors[i].isEmpty()) THROW(Exception, "Counting k-mers failed: " + errors[i]);
+		output.add(counters[i]);
+	}
+	return output;
+}
+
+void KmerCounter::storeCache(QString cache_file) const
+{
+	//write to a temporary file first, so that other processes never read a partial cache file
+	QString tmp_file = cache_file + "." + QString::number(QCoreApplication::applicationPid()) + ".tmp";
+	try
+	{
+		QDir().mkpath(QFileInfo(cache_file).absolutePath());
+		store(tmp_file);
+		if (!QFile::rename(tmp_file, cache_file))
+		{
+			QFile::remove(tmp_file);
+		}
+	}
+	catch(Exception& e)
+	{
+		QFile::remove(tmp_file);
+		Log::warn("Could not store k-mer count cache file: " + e.message());
+	}
+}
+
+QString KmerCounter::cacheFile(QString cache_folder, QString ref_file, const QByteArray& key_data, int k)
+{
+	//the key contains the reference genome index, so that the cache is invalid if the reference genome changes
+	QFileInfo ref_info(ref_file);
+	QCryptographicHash hash(QCryptographicHash::Md5);
+	hash.addData(QByteArray::number(k) + "\n");
+	hash.addData(ref_info.absoluteFilePath().toLatin1() + "\n");
+	hash.addData(QByteArray::number(ref_info.size()) + "\n");
+	hash.addData(ref_info.lastModified().toString(Qt::ISODate).toLatin1() + "\n");
+	QFile fai(ref_file + ".fai");
+	if (fai.open(QIODevice::ReadOnly))
+	{
+		hash.addData(fai.readAll());
+	}
+	hash.addData(key_data);
+
+	return QDir(cache_folder).absoluteFilePath("kmer_counts_" + hash.result().toHex() + ".tsv");
+}
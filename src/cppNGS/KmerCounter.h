@@ -0,0 +1,71 @@
+#ifndef KMERCOUNTER_H
+#define KMERCOUNTER_H
+
+#include "cppNGS_global.h"
+#include "BedFile.h"
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+class FastaFileIndex;
+
+/**
+  @brief Counts all k-mers of sequences in one pass.
+
+  Each base is encoded with 2 bits and the code of the current k-mer is updated with each base (rolling code).
+  Only k-mers consisting of A, C, G and T are counted (case-insensitive). Overlapping k-mers are counted.
+  Counts of the reference genome or a target region can be cached on disk, keyed by a checksum of the reference genome index and the regions.
+*/
+class CPPNGSSHARED_EXPORT KmerCounter
+{
+public:
+	///Constructor. @p k must be between 1 and 12.
+	KmerCounter(int k = 3);
+
+	///Returns the k-mer length.
+	int k() const
+	{
+		return k_;
+	}
+	///Counts the k-mers of a sequence.
+	void add(const QByteArray& seq);
+	///Adds the counts of another counter with the same k-mer length.
+	void add(const KmerCounter& other);
+	///Returns the count of a k-mer. Returns 0 if the k-mer contains other bases than A, C, G and T.
+	long long count(const QByteArray& kmer) const;
+
+	///Stores the counts as a TSV file (one line per k-mer).
+	void store(QString filename) const;
+	///Loads counts from a TSV file created by store().
+	void load(QString filename);
+
+	///Counts the k-mers of all non-special chromosomes of the reference genome (one thread per chromosome). If @p cache_folder is not empty, the counts are cached in that folder.
+	static KmerCounter countGenome(QString ref_file, int k = 3, int threads = 1, QString cache_folder = QString());
+	///Counts the k-mers of all regions (each region separately). If @p cache_folder is not empty, the counts are cached in that folder.
+	static KmerCounter countRegions(QString ref_file, const BedFile& regions, int k = 3, int threads = 1, QString cache_folder = QString());
+
+protected:
+	int k_;
+	QVector<long long> counts_;
+
+	///Returns the 2-bit code of a base, or -1 for other characters than A, C, G and T.
+	static int baseCode(char base)
+	{
+		switch(base)
+		{
+			case 'A': case 'a': return 0;
+			case 'C': case 'c': return 1;
+			case 'G': case 'g': return 2;
+			case 'T': case 't': return 3;
+		}
+		return -1;
+	}
+	///Counts the k-mers of the given sequence segments of the reference genome in parallel. Each segment list is processed by one thread.
+	static KmerCounter countSegments(const FastaFileIndex& reference, const QList<BedFile>& segments, int k, int threads);
+	///Stores the counts in the cache file. Errors are logged as warnings only.
+	void storeCache(QString cache_file) const;
+	///Returns the cache file name for the given key data of the counts.
+	static QString cacheFile(QString cache_folder, QString ref_file, const QByteArray& key_data, int k);
+};
+
+#endif // KMERCOUNTER_H
@@ -5,6 +5,8 @@
 #include <QTextStream>
 #include <QFileInfo>
 #include <QDateTime>
+#include <QSharedPointer>
+#include <map>
 #include "math.h"
 
 void NGSHelper::openBAM(BamReader& reader, QString bam_file)
@@ -504,6 +506,353 @@ QStringList NGSHelper::textToGenes(QString text, int col_index)
 	return output;
 }
 
+///Variant list input of the sample overview, which is read chromosome by chromosome. Only the variants of the current indel window are kept in memory.
+class SampleOverviewInput
+{
+public:
+	SampleOverviewInput(QString filename)
+		: filename_(filename)
+		, temp_file_()
+		, header_()
+		, blocks_()
+		, chromosomes_()
+		, filter_index_(-1)
+		, anno_indices_()
+		, geno_index_(-1)
+		, chr_()
+		, at_end_(true)
+		, head_()
+		, window_()
+	{
+		//create a sorted copy if the input is not sorted by chromosome and position
+		if (!index(filename_))
+		{
+			VariantList vl;
+			vl.load(filename_, VariantList::TSV);
+			vl.sort();
+			temp_file_ = Helper::tempFileName(".tsv");
+			vl.store(temp_file_, VariantList::TSV);
+			index(temp_file_);
+		}
+		file_ = Helper::openFileForReading(temp_file_.isEmpty() ? filename_ : temp_file_, false);
+	}
+
+	~SampleOverviewInput()
+	{
+		file_->close();
+		if (!temp_file_.isEmpty()) QFile::remove(temp_file_);
+	}
+
+	///Returns the file name.
+	const QString& filename() const
+	{
+		return filename_;
+	}
+	///Returns a variant list that contains the meta data of the file, but no variants.
+	const VariantList& header() const
+	{
+		return header_;
+	}
+	///Returns the chromosomes contained in the file.
+	const QList<Chromosome>& chromosomes() const
+	{
+		return chromosomes_;
+	}
+
+	///Sets the annotation indices of the output columns and the genotype column.
+	void setColumns(const QVector<int>& anno_indices, int geno_index)
+	{
+		anno_indices_ = anno_indices;
+		geno_index_ = geno_index;
+	}
+
+	///Moves to the first variant of the given chromosome and clears the window.
+	void seek(const Chromosome& chr)
+	{
+		chr_ = chr;
+		window_.clear();
+		at_end_ = true;
+		if (!blocks_.contains(chr.num())) return;
+
+		file_->seek(blocks_[chr.num()]);
+		readHead();
+	}
+	///Returns if all variants of the current chromosome have been read.
+	bool atEnd() const
+	{
+		return at_end_;
+	}
+	///Returns the start position of the next variant.
+	int headStart() const
+	{
+		return head_.start();
+	}
+	///Adds the next variant to the window and returns it with the output columns as annotations.
+	Variant next()
+	{
+		Variant output = head_;
+		output.annotations().clear();
+		foreach(int index, anno_indices_)
+		{
+			output.annotations().append(head_.annotations()[index]);
+		}
+
+		//the window only needs the genotype
+		Variant& v = head_;
+		QByteArray geno = v.annotations()[geno_index_];
+		v.annotations().clear();
+		v.annotations().append(geno);
+		window_.append(v);
+
+		readHead();
+		return output;
+	}
+	///Removes variants from the window that end before the given position.
+	void trimWindow(int pos)
+	{
+		while (!window_.isEmpty() && window_.first().end()<pos)
+		{
+			window_.removeFirst();
+		}
+	}
+
+	///Returns the sample column entry of a variant. All variants of this sample that are in the indel window of the variant must have been read.
+	QByteArray entry(const Variant& v, int indel_window) const
+	{
+		QByteArray entry = "no";
+		if (v.isSNV()) //SNP
+		{
+			foreach(const Variant& v2, window_)
+			{
+				if (v2.overlapsWith(v.start(), v.end()) && v2.ref()==v.ref() && v2.obs()==v.obs())
+				{
+					entry = "yes (" + v2.annotations()[0] + ")";
+				}
+			}
+		}
+		else //indel
+		{
+			QVector<int> matches;
+			for (int i=0; i<window_.count(); ++i)
+			{
+				if (window_[i].overlapsWith(v.start()-indel_window, v.end()+indel_window))
+				{
+					matches.append(i);
+				}
+			}
+
+			//exact match (start, obs, ref)
+			foreach(int i, matches)
+			{
+				const Variant& v2 = window_[i];
+				if (v2.start()==v.start() && v2.ref()==v.ref() && v2.obs()==v.obs())
+				{
+					return "yes (" + v2.annotations()[0] + ")";
+				}
+			}
+
+			//same indel nearby (ref, obs)
+			foreach(int i, matches)
+			{
+				const Variant& v2 = window_[i];
+				if (v2.ref()==v.ref() && v2.obs()==v.obs())
+				{
+					return "near (" + v2.annotations()[0] + ")";
+				}
+			}
+
+			//different indel nearby
+			foreach(int i, matches)
+			{
+				const Variant& v2 = window_[i];
+				if (!v2.isSNV())
+				{
+					return "different (" + v2.annotations()[0] + ")";
+				}
+			}
+		}
+		return entry;
+	}
+
+protected:
+	QString filename_;
+	QString temp_file_;
+	QSharedPointer<QFile> file_;
+	VariantList header_;
+	QHash<int, qint64> blocks_;
+	QList<Chromosome> chromosomes_;
+	int filter_index_;
+	QVector<int> anno_indices_;
+	int geno_index_;
+
+	Chromosome chr_;
+	bool at_end_;
+	Variant head_;
+	QList<Variant> window_;
+
+	///Parses the meta data and determines the file offset of each chromosome. Returns if the file is sorted by chromosome and position.
+	bool index(QString filename)
+	{
+		header_.clear();
+		blocks_.clear();
+		chromosomes_.clear();
+
+		QSharedPointer<QFile> file = Helper::openFileForReading(filename, false);
+		Chromosome last_chr;
+		int last_start = -1;
+		while(!file->atEnd())
+		{
+			qint64 pos = file->pos();
+			QByteArray line = file->readLine();
+			while (line.endsWith('\n') || line.endsWith('\r')) line.chop(1);
+
+			//skip empty lines
+			if(line.length()==0) continue;
+
+			if (line.startsWith("##"))//description line
+			{
+				QList <QByteArray> parts = line.split('=');
+				if (parts.count()>2)
+				{
+					QByteArray tmp = parts[2];
+					for(int i=3; i<parts.count(); ++i)
+					{
+						tmp += "=" + parts[i];
+					}
+					if (line.startsWith("##DESCRIPTION="))
+					{
+						header_.annotationDescriptions().append(VariantAnnotationDescription(parts[1], tmp, VariantAnnotationDescription::STRING, false, "."));
+					}
+					else if (line.startsWith("##FILTER="))
+					{
+						header_.filters()[parts[1]] = tmp;
+					}
+				}
+				continue;
+			}
+			if (line.startsWith("#"))//header
+			{
+				QList <QByteArray> fields = line.split('\t');
+				for (int i=5; i<fields.count(); ++i)
+				{
+					header_.annotations().append(VariantAnnotationHeader(fields[i]));
+				}
+				filter_index_ = header_.annotationIndexByName("filter", true, false);
+				continue;
+			}
+
+			//variant line (only chromosome and start position are needed)
+			int tab1 = line.indexOf('\t');
+			int tab2 = line.indexOf('\t', tab1+1);
+			if (tab1==-1 || tab2==-1)
+			{
+				THROW(FileParseException, "Variant TSV file line with less than five fields found: '" + line.trimmed() + "'");
+			}
+			Chromosome chr(line.left(tab1));
+			int start = Helper::toInt(line.mid(tab1+1, tab2-tab1-1), "start position", line);
+			if (chr!=last_chr)
+			{
+				if (blocks_.contains(chr.num())) return false;
+				blocks_[chr.num()] = pos;
+				chromosomes_.append(chr);
+				last_chr = chr;
+			}
+			else if (start<last_start)
+			{
+				return false;
+			}
+			last_start = start;
+		}
+
+		return true;
+	}
+
+	///Reads the next variant of the current chromosome.
+	void readHead()
+	{
+		while(!file_->atEnd())
+		{
+			QByteArray line = file_->readLine();
+			while (line.endsWith('\n') || line.endsWith('\r')) line.chop(1);
+			if(line.length()==0 || line.startsWith("#")) continue;
+
+			QList<QByteArray> fields = line.split('\t');
+			if (fields.count()<5)
+			{
+				THROW(FileParseException, "Variant TSV file line with less than five fields found: '" + line.trimmed() + "'");
+			}
+			Chromosome chr(fields[0]);
+			if (chr!=chr_) break;
+
+			int start_pos = Helper::toInt(fields[1], "start position", line);
+			int end_pos = Helper::toInt(fields[2], "end position", line);
+			QList<QByteArray> annos;
+			for (int i=5; i<fields.count(); ++i)
+			{
+				annos.append(fields[i]);
+			}
+			if (annos.count()!=header_.annotations().count())
+			{
+				THROW(ArgumentException, "Invalid variant annotation data: Expected " + QString::number(header_.annotations().count()) + " values, but " + QString::number(annos.count()) + " values found, while loading file '" + filename_ + "'!");
+			}
+			head_ = Variant(chr, start_pos, end_pos, fields[3], fields[4], annos, filter_index_);
+			at_end_ = false;
+			return;
+		}
+
+		at_end_ = true;
+	}
+
+	//declared away methods
+	SampleOverviewInput(const SampleOverviewInput&);
+	SampleOverviewInput& operator=(const SampleOverviewInput&);
+};
+
+///Key of a variant in the sample overview (same order as VariantList::LessComparator within a chromosome).
+struct SampleOverviewKey
+{
+	int start;
+	int end;
+	Sequence ref;
+	Sequence obs;
+
+	bool operator<(const SampleOverviewKey& rhs) const
+	{
+		if (start!=rhs.start) return start<rhs.start;
+		if (end!=rhs.end) return end<rhs.end;
+		if (ref!=rhs.ref) return ref<rhs.ref;
+		return obs<rhs.obs;
+	}
+};
+
+///Returns the smallest start position of the unread variants of all inputs (or the maximum integer if all variants have been read).
+static int minHeadStart(const QList<QSharedPointer<SampleOverviewInput> >& inputs)
+{
+	int output = std::numeric_limits<int>::max();
+	foreach(const QSharedPointer<SampleOverviewInput>& input, inputs)
+	{
+		if (!input->atEnd()) output = std::min(output, input->headStart());
+	}
+	return output;
+}
+
+///Reads the next variant of an input into the pending variants. Duplicates are replaced (by the variant with higher quality if a quality column is present).
+static void readOverviewVariant(SampleOverviewInput& input, std::map<SampleOverviewKey, Variant>& pending, int quality_index)
+{
+	Variant v = input.next();
+	SampleOverviewKey key = { v.start(), v.end(), v.ref(), v.obs() };
+
+	std::map<SampleOverviewKey, Variant>::iterator it = pending.find(key);
+	if (it==pending.end())
+	{
+		pending[key] = v;
+	}
+	else if (quality_index==-1 || !VariantList::LessComparator(quality_index)(v, it->second))
+	{
+		it->second = v;
+	}
+}
+
 void NGSHelper::createSampleOverview(QStringList in, QString out, int indel_window, bool cols_auto, QStringList cols)
 {
 	//determine columns contained in all samples from file headers (keep order)
@@ -551,14 +900,14 @@ void NGSHelper::createSampleOverview(QStringList in, QString out, int indel_wind
 		}
 	}
 
-	//load variant lists
-	QVector<VariantList> vls;
-	QVector<QVector<int> > vls_anno_indices;
+	//open variant lists (only the meta data is loaded)
+	QList<QSharedPointer<SampleOverviewInput> > inputs;
 	QList <VariantAnnotationDescription> vls_anno_descriptions;
+	QMap<QString, QString> filters;
 	foreach(QString filename, in)
 	{
-		VariantList vl;
-		vl.load(filename, VariantList::TSV);
+		QSharedPointer<SampleOverviewInput> input(new SampleOverviewInput(filename));
+		const VariantList& vl = input->header();
 
 		//check the all required fields are present in the input file
 		QVector<int> anno_indices;
@@ -583,130 +932,132 @@ void NGSHelper::createSampleOverview(QStringList in, QString out, int indel_wind
 			}
 		}
 
-		vls_anno_indices.append(anno_indices);
-		vls.append(vl);
-	}
+		//get genotype index
+		int geno_index = vl.annotationIndexByName("genotype", true, false);
+		if(geno_index==-1)	geno_index = vl.annotationIndexByName("tumor_af", true, true);
+		input->setColumns(anno_indices, geno_index);
 
-	//set up combined variant list (annotation and filter descriptions)
-	VariantList vl_merged;
-	foreach(const VariantList& vl, vls)
-	{
+		//merge filters
 		auto it = vl.filters().begin();
 		while(it!=vl.filters().end())
 		{
-			if (!vl_merged.filters().contains(it.key()))
+			if (!filters.contains(it.key()))
 			{
-				vl_merged.filters().insert(it.key(), it.value());
+				filters.insert(it.key(), it.value());
 			}
 			++it;
 		}
+
+		inputs.append(input);
 	}
-	foreach(int index, vls_anno_indices[0])
-	{
-		vl_merged.annotations().append(vls[0].annotations()[index]);
-	}
-	foreach(VariantAnnotationDescription vad, vls_anno_descriptions)
+
+	//determine output columns and quality column used to resolve duplicates
+	QStringList anno_names;
+	foreach(QString col, cols)
 	{
-		vl_merged.annotationDescriptions().append(vad);
+		if (col=="genotype") continue;
+		anno_names.append(col);
 	}
+	int quality_index = anno_names.indexOf("QUAL");
+	if (quality_index==-1) quality_index = anno_names.indexOf("quality");
 
-	//merge variants
-	vl_merged.reserve(2 * vls[0].count());
-	for (int i=0; i<vls.count(); ++i)
+	//determine chromosomes (sorted numerically)
+	QMap<int, Chromosome> chrs;
+	foreach(const QSharedPointer<SampleOverviewInput>& input, inputs)
 	{
-		for(int j=0; j<vls[i].count(); ++j)
+		foreach(const Chromosome& chr, input->chromosomes())
 		{
-			Variant v = vls[i][j];
-			QList<QByteArray> annos = v.annotations();
-			v.annotations().clear();
-			foreach(int index, vls_anno_indices[i])
-			{
-				v.annotations().append(annos[index]);
-			}
-			vl_merged.append(v);
+			chrs[chr.num()] = chr;
 		}
 	}
 
-	//remove duplicates from variant list
-	vl_merged.removeDuplicates(true);
-
-	//append sample columns
-	for (int i=0; i<vls.count(); ++i)
+	//write header
+	QSharedPointer<QFile> file = Helper::openFileForWriting(out);
+	QTextStream stream(file.data());
+	foreach(const VariantAnnotationDescription& vad, vls_anno_descriptions)
 	{
-		//get genotype index
-		int geno_index = vls[i].annotationIndexByName("genotype", true, false);
-		if(geno_index==-1)	geno_index = vls[i].annotationIndexByName("tumor_af", true, true);
-
-		//add column header
-		vl_merged.annotationDescriptions().append(VariantAnnotationDescription(QFileInfo(in[i]).baseName(), ""));
-		vl_merged.annotations().append(VariantAnnotationHeader(QFileInfo(in[i]).baseName()));
+		if(vad.description()=="" || vad.name()==".") continue;
+		stream << "##DESCRIPTION=" << vad.name() << "=" << vad.description() << endl;
+	}
+	auto it = filters.cbegin();
+	while(it != filters.cend())
+	{
+		stream << "##FILTER=" << it.key() << "=" << it.value() << endl;
+		++it;
+	}
+	stream << "#chr\tstart\tend\tref\tobs";
+	foreach(QString name, anno_names)
+	{
+		stream << "\t" << name;
+	}
+	foreach(const QSharedPointer<SampleOverviewInput>& input, inputs)
+	{
+		stream << "\t" << QFileInfo(input->filename()).baseName();
+	}
+	stream << endl;
 
-		//create index over variant list to speed up the search
-		const VariantList& vl = vls[i];
-		ChromosomalIndex<VariantList> cidx(vl);
+	//k-way merge of the variants, chromosome by chromosome
+	foreach(const Chromosome& chr, chrs)
+	{
+		foreach(const QSharedPointer<SampleOverviewInput>& input, inputs)
+		{
+			input->seek(chr);
+		}
 
-		//add sample-specific columns
-		for (int j=0; j<vl_merged.count(); ++j)
+		std::map<SampleOverviewKey, Variant> pending;
+		while(true)
 		{
-			Variant& v = vl_merged[j];
-			QByteArray entry = "no";
-			if (v.isSNV()) //SNP
+			//read all variants at the smallest start position
+			int min_start = minHeadStart(inputs);
+			while (min_start!=std::numeric_limits<int>::max() && (pending.empty() || min_start<=pending.begin()->first.start))
 			{
-				QVector<int> matches = cidx.matchingIndices(v.chr(), v.start(), v.end());
-				for (int k=0; k<matches.count(); ++k)
+				foreach(const QSharedPointer<SampleOverviewInput>& input, inputs)
 				{
-					int match = matches[k];
-					if (match!=-1 && vl[match].ref()==v.ref() && vl[match].obs()==v.obs())
+					while (!input->atEnd() && input->headStart()==min_start)
 					{
-						entry = "yes (" + vl[match].annotations()[geno_index] + ")";
+						readOverviewVariant(*input, pending, quality_index);
 					}
 				}
+				min_start = minHeadStart(inputs);
 			}
-			else //indel
+			if (pending.empty()) break;
+
+			//read all variants in the indel window of the first pending variant
+			Variant v = pending.begin()->second;
+			pending.erase(pending.begin());
+			int window_end = v.end() + indel_window;
+			foreach(const QSharedPointer<SampleOverviewInput>& input, inputs)
 			{
-				QVector<int> matches = cidx.matchingIndices(v.chr(), v.start()-indel_window, v.end()+indel_window);
-				if (matches.count()>0)
+				while (!input->atEnd() && input->headStart()<=window_end)
 				{
-					//exact match (start, obs, ref)
-					bool done = false;
-					for (int k=0; k<matches.count(); ++k)
-					{
-						const Variant& v2 = vl[matches[k]];
-						if (!done && v2.start()==v.start() && v2.ref()==v.ref() && v2.obs()==v.obs())
-						{
-							entry = "yes (" + v2.annotations()[geno_index] + ")";
-							done = true;
-						}
-					}
+					readOverviewVariant(*input, pending, quality_index);
+				}
+			}
 
-					//same indel nearby (ref, obs)
-					for (int k=0; k<matches.count(); ++k)
-					{
-						const Variant& v2 = vl[matches[k]];
-						if (!done && v2.ref()==v.ref() && v2.obs()==v.obs())
-						{
-							entry = "near (" + v2.annotations()[geno_index] + ")";
-							done = true;
-						}
-					}
+			//write variant with sample columns
+			stream << v.chr().str() << "\t" << v.start() << "\t" << v.end() << "\t" << v.ref() << "\t" << v.obs();
+			foreach(const QByteArray& anno, v.annotations())
+			{
+				stream << "\t" << anno;
+			}
+			foreach(const QSharedPointer<SampleOverviewInput>& input, inputs)
+			{
+				stream << "\t" << input->entry(v, indel_window);
+			}
+			stream << endl;
 
-					//different indel nearby
-					for (int k=0; k<matches.count(); ++k)
-					{
-						const Variant& v2 = vl[matches[k]];
-						if (!done && !v2.isSNV())
-						{
-							entry = "different (" + v2.annotations()[geno_index] + ")";
-							done = true;
-						}
-					}
+			//remove variants that are not in the indel window of the remaining variants
+			int window_start = minHeadStart(inputs);
+			if (!pending.empty()) window_start = std::min(window_start, pending.begin()->first.start);
+			if (window_start!=std::numeric_limits<int>::max())
+			{
+				foreach(const QSharedPointer<SampleOverviewInput>& input, inputs)
+				{
+					input->trimWindow(window_start - indel_window);
 				}
 			}
-			v.annotations().append(entry);
 		}
 	}
-
-	vl_merged.store(out, VariantList::TSV);
 }
 
 void NGSHelper::softClipAlignment(BamAlignment& al, int start_ref_pos, int end_ref_pos)
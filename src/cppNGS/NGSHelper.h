@@ -81,7 +81,7 @@ public:
 	///Converts text to gene list (one gene per tab-separated line)
 	static QStringList textToGenes(QString text, int col_index = 0);
 
-	///Create sample overview file
+	///Create sample overview file. The input variant lists are merged chromosome by chromosome and only the variants in the indel window are kept in memory. Inputs that are not sorted by position are sorted into a temporary file first.
 	static void createSampleOverview(QStringList in, QString out, int indel_window=100, bool cols_auto=true, QStringList cols = QStringList());
 
 private:
@@ -0,0 +1,220 @@
+#include "Profiler.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+#include <cstdio>
+#ifndef Q_OS_WIN
+#include <sys/resource.h>
+#endif
+
+///Accumulated run time of a stage.
+struct ProfileStage
+{
+	int calls;
+	qint64 nsecs;
+};
+
+///Profile data of the process. The profile is written when the data is destroyed at program exit.
+class ProfileData
+{
+public:
+	ProfileData()
+		: enabled(false)
+		, output(QString::fromLocal8Bit(qgetenv("NGSBITS_PROFILE")))
+	{
+		enabled = !output.isEmpty();
+		timer.start();
+	}
+
+	~ProfileData()
+	{
+		if (enabled) write();
+	}
+
+	///Stores the tool name and arguments (only possible while the application object exists).
+	void storeArguments()
+	{
+		if (arguments.isEmpty() && QCoreApplication::instance()!=nullptr)
+		{
+			arguments = QCoreApplication::arguments();
+		}
+	}
+
+	///Returns the profile as JSON document.
+	QByteArray toJson()
+	{
+		storeArguments();
+
+		QJsonObject root;
+		root.insert("tool", arguments.isEmpty() ? QString() : arguments.first());
+		root.insert("arguments", QJsonArray::fromStringList(arguments.mid(1)));
+		root.insert("wall_time_seconds", timer.nsecsElapsed() / 1000000000.0);
+		qint64 peak_memory = Profiler::peakMemory();
+		root.insert("peak_memory_mb", peak_memory==-1 ? -1.0 : peak_memory / 1048576.0);
+
+		//stages (in order of first execution)
+		QJsonArray stage_array;
+		foreach(const QString& name, stage_order)
+		{
+			const ProfileStage& entry = stages[name];
+			QJsonObject stage;
+			stage.insert("name", name);
+			stage.insert("calls", entry.calls);
+			stage.insert("seconds", entry.nsecs / 1000000000.0);
+			stage_array.append(stage);
+		}
+		root.insert("stages", stage_array);
+
+		//counters
+		QJsonObject counter_object;
+		for (QMap<QString, qint64>::const_iterator it=counters.constBegin(); it!=counters.constEnd(); ++it)
+		{
+			counter_object.insert(it.key(), (double)it.value());
+		}
+		root.insert("counters", counter_object);
+
+		return QJsonDocument(root).toJson();
+	}
+
+	///Writes the profile to the output file. No exceptions are thrown, because this method is called when the program exits.
+	void write()
+	{
+		if (output.isEmpty()) return;
+
+		QByteArray json = toJson();
+		if (output=="-")
+		{
+			fwrite(json.constData(), 1, json.length(), stderr);
+			return;
+		}
+		QFile file(output);
+		if (!file.open(QIODevice::WriteOnly) || file.write(json)!=json.length())
+		{
+			fprintf(stderr, "Could not write profile to '%s'!\n", output.toLocal8Bit().constData());
+		}
+	}
+
+	bool enabled;
+	QString output;
+	QElapsedTimer timer;
+	QStringList arguments;
+	QStringList stage_order;
+	QHash<QString, ProfileStage> stages;
+	QMap<QString, qint64> counters;
+	QMutex mutex;
+};
+
+///Returns the profile data of the process.
+static ProfileData& profileData()
+{
+	static ProfileData data;
+	return data;
+}
+
+//create the profile data when the library is loaded (wall time since program start, destruction after all tool objects)
+static ProfileData& profile_data_init = profileData();
+
+bool Profiler::enabled()
+{
+	return profileData().enabled;
+}
+
+void Profiler::setOutput(QString filename)
+{
+	ProfileData& data = profileData();
+	QMutexLocker locker(&data.mutex);
+	data.output = filename;
+	data.enabled = !filename.isEmpty();
+	data.storeArguments();
+}
+
+void Profiler::addTime(QString stage, qint64 nsecs)
+{
+	ProfileData& data = profileData();
+	if (!data.enabled) return;
+
+	QMutexLocker locker(&data.mutex);
+	data.storeArguments();
+	if (!data.stages.contains(stage))
+	{
+		ProfileStage entry = { 0, 0 };
+		data.stages.insert(stage, entry);
+		data.stage_order.append(stage);
+	}
+	ProfileStage& entry = data.stages[stage];
+	entry.calls += 1;
+	entry.nsecs += nsecs;
+}
+
+void Profiler::addCount(QString counter, qint64 value)
+{
+	ProfileData& data = profileData();
+	if (!data.enabled) return;
+
+	QMutexLocker locker(&data.mutex);
+	data.storeArguments();
+	data.counters[counter] += value;
+}
+
+qint64 Profiler::peakMemory()
+{
+#ifdef Q_OS_WIN
+	return -1;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage)!=0) return -1;
+#ifdef Q_OS_MAC
+	return usage.ru_maxrss; //bytes
+#else
+	return 1024ll * usage.ru_maxrss; //kilobytes
+#endif
+#endif
+}
+
+QByteArray Profiler::toJson()
+{
+	ProfileData& data = profileData();
+	QMutexLocker locker(&data.mutex);
+	return data.toJson();
+}
+
+void Profiler::write()
+{
+	ProfileData& data = profileData();
+	QMutexLocker locker(&data.mutex);
+	data.write();
+}
+
+ProfilerTimer::ProfilerTimer(QString stage)
+	: stage_(stage)
+	, timer_()
+{
+	if (Profiler::enabled()) timer_.start();
+}
+
+ProfilerTimer::~ProfilerTimer()
+{
+	stop();
+}
+
+void ProfilerTimer::stop()
+{
+	if (!timer_.isValid()) return;
+
+	Profiler::addTime(stage_, timer_.nsecsElapsed());
+	timer_.invalidate();
+}
+
+void ProfilerTimer::restart(QString stage)
+{
+	stop();
+	stage_ = stage;
+	if (Profiler::enabled()) timer_.start();
+}
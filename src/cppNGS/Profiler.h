@@ -0,0 +1,68 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "cppNGS_global.h"
+#include <QString>
+#include <QElapsedTimer>
+
+/**
+  @brief Lightweight run-time profile of stages (e.g. load, index, query, write), counters and peak memory usage.
+
+  Profiling is enabled by setting the environment variable NGSBITS_PROFILE to the name of the JSON output file ('-' for STDERR), or by calling setOutput().
+  The profile is written when the program exits. If profiling is disabled, timers and counters do nothing.
+  Times of stages that are executed in several threads are summed up.
+  @note This class is thread-safe.
+*/
+class CPPNGSSHARED_EXPORT Profiler
+{
+public:
+	///Returns if profiling is enabled.
+	static bool enabled();
+	///Enables profiling and sets the JSON output file name ('-' for STDERR). An empty file name disables profiling.
+	static void setOutput(QString filename);
+
+	///Adds the run time of a stage in nanoseconds.
+	static void addTime(QString stage, qint64 nsecs);
+	///Adds a value to a counter.
+	static void addCount(QString counter, qint64 value = 1);
+
+	///Returns the peak resident set size of the process in bytes, or -1 if it cannot be determined.
+	static qint64 peakMemory();
+	///Returns the profile as JSON document.
+	static QByteArray toJson();
+	///Writes the profile to the output file (done automatically when the program exits).
+	static void write();
+
+protected:
+	///No default constructor
+	Profiler();
+};
+
+/**
+  @brief Scoped timer for a stage of the profile.
+
+  The time is added to the stage when the timer is destroyed, stopped or restarted.
+*/
+class CPPNGSSHARED_EXPORT ProfilerTimer
+{
+public:
+	///Constructor, starts the timer for the given stage.
+	ProfilerTimer(QString stage);
+	///Destructor, stops the timer.
+	~ProfilerTimer();
+
+	///Stops the timer and adds the time to the stage.
+	void stop();
+	///Stops the timer and starts it again for a new stage.
+	void restart(QString stage);
+
+protected:
+	QString stage_;
+	QElapsedTimer timer_;
+
+	//declared away
+	ProfilerTimer(const ProfilerTimer&);
+	ProfilerTimer& operator=(const ProfilerTimer&);
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,189 @@
+#include "ReadIdIndex.h"
+#include "Exceptions.h"
+#include <cstring>
+
+ReadIdIndex::ReadIdIndex(bool prefilter)
+	: prefilter_(prefilter)
+	, count_(0)
+	, blocks_()
+	, block_used_(BLOCK_SIZE)
+	, slots_(1024)
+	, slot_mask_(1023)
+	, filter_()
+	, filter_mask_(0)
+{
+	if (prefilter_)
+	{
+		filter_.assign(slots_.size() / 8, 0);
+		filter_mask_ = filter_.size() - 1;
+	}
+}
+
+quint64 ReadIdIndex::hash(const char* id, int length)
+{
+	//FNV-1a
+	quint64 h = Q_UINT64_C(14695981039346656037);
+	for (int i=0; i<length; ++i)
+	{
+		h ^= (unsigned char)id[i];
+		h *= Q_UINT64_C(1099511628211);
+	}
+
+	//final mixing (MurmurHash3), so that the lower bits used for the slot index depend on all bytes
+	h ^= h >> 33;
+	h *= Q_UINT64_C(0xff51afd7ed558ccd);
+	h ^= h >> 33;
+	h *= Q_UINT64_C(0xc4ceb9fe1a85ec53);
+	h ^= h >> 33;
+	return h;
+}
+
+///Returns the filter word index and bit mask (3 bits in one word) of a hash.
+static inline quint64 filterBits(quint64 h, quint64 filter_mask, quint64& word)
+{
+	quint64 g = h * Q_UINT64_C(0x9e3779b97f4a7c15);
+	word = (g >> 32) & filter_mask;
+	return (Q_UINT64_C(1) << (g & 63)) | (Q_UINT64_C(1) << ((g >> 6) & 63)) | (Q_UINT64_C(1) << ((g >> 12) & 63));
+}
+
+const char* ReadIdIndex::record(quint32 ref) const
+{
+	quint64 offset = 4 * (quint64)(ref - 1);
+	return blocks_[(int)(offset / BLOCK_SIZE)].constData() + offset % BLOCK_SIZE;
+}
+
+quint32 ReadIdIndex::appendRecord(const char* id, int length, int value)
+{
+	//record layout: value (4 bytes), ID length (2 bytes), ID (padded to a multiple of 4 bytes)
+	int size = (6 + length + 3) & ~3;
+	if (block_used_ + size > BLOCK_SIZE)
+	{
+		if ((quint64)(blocks_.count() + 1) * BLOCK_SIZE / 4 >= Q_UINT64_C(0xffffffff))
+		{
+			THROW(ArgumentException, "Too many read IDs - the ID index is limited to 16GB!");
+		}
+		blocks_.append(QByteArray(BLOCK_SIZE, Qt::Uninitialized));
+		block_used_ = 0;
+	}
+
+	char* data = blocks_.last().data() + block_used_;
+	quint16 length16 = length;
+	memcpy(data, &value, 4);
+	memcpy(data + 4, &length16, 2);
+	memcpy(data + 6, id, length);
+
+	quint64 offset = (quint64)(blocks_.count() - 1) * BLOCK_SIZE + block_used_;
+	block_used_ += size;
+	return (quint32)(offset / 4 + 1);
+}
+
+qint64 ReadIdIndex::find(const char* id, int length, quint64 h) const
+{
+	quint32 tag = (quint32)(h >> 32);
+	quint64 i = h & slot_mask_;
+	while (true)
+	{
+		const Slot& slot = slots_[i];
+		if (slot.ref==0) return -1;
+		if (slot.tag==tag)
+		{
+			const char* data = record(slot.ref);
+			quint16 length16;
+			memcpy(&length16, data + 4, 2);
+			if (length16==length && memcmp(data + 6, id, length)==0) return (qint64)i;
+		}
+		i = (i + 1) & slot_mask_;
+	}
+}
+
+void ReadIdIndex::insertRef(quint64 h, quint32 ref)
+{
+	quint64 i = h & slot_mask_;
+	while (slots_[i].ref!=0)
+	{
+		i = (i + 1) & slot_mask_;
+	}
+	slots_[i].tag = (quint32)(h >> 32);
+	slots_[i].ref = ref;
+
+	if (prefilter_)
+	{
+		quint64 word;
+		quint64 bits = filterBits(h, filter_mask_, word);
+		filter_[word] |= bits;
+	}
+}
+
+void ReadIdIndex::grow()
+{
+	//the arena references are 32-bit, so more slots would not be usable anyway
+	if (slots_.size()>=(Q_UINT64_C(1)<<32))
+	{
+		THROW(ArgumentException, "Too many read IDs - the ID index is limited to 3 billion IDs!");
+	}
+
+	std::vector<Slot> old_slots;
+	old_slots.swap(slots_);
+	slots_.resize(2 * old_slots.size());
+	slot_mask_ = slots_.size() - 1;
+	if (prefilter_)
+	{
+		filter_.assign(slots_.size() / 8, 0);
+		filter_mask_ = filter_.size() - 1;
+	}
+
+	for (size_t i=0; i<old_slots.size(); ++i)
+	{
+		const Slot& slot = old_slots[i];
+		if (slot.ref==0) continue;
+
+		const char* data = record(slot.ref);
+		quint16 length16;
+		memcpy(&length16, data + 4, 2);
+		insertRef(hash(data + 6, length16), slot.ref);
+	}
+}
+
+void ReadIdIndex::insert(const char* id, int length, int value)
+{
+	if (length>0xffff)
+	{
+		THROW(ArgumentException, "Read ID '" + QByteArray(id, length).left(50) + "...' is too long!");
+	}
+
+	//replace value of contained ID
+	quint64 h = hash(id, length);
+	qint64 i = find(id, length, h);
+	if (i!=-1)
+	{
+		memcpy(const_cast<char*>(record(slots_[i].ref)), &value, 4);
+		return;
+	}
+
+	//add new ID
+	if ((count_ + 1) * 100 > (qint64)slots_.size() * MAX_LOAD)
+	{
+		grow();
+	}
+	insertRef(h, appendRecord(id, length, value));
+	++count_;
+}
+
+int ReadIdIndex::value(const char* id, int length, int default_value) const
+{
+	quint64 h = hash(id, length);
+
+	if (prefilter_)
+	{
+		quint64 word;
+		quint64 bits = filterBits(h, filter_mask_, word);
+		if ((filter_[word] & bits)!=bits) return default_value;
+	}
+
+	qint64 i = find(id, length, h);
+	if (i==-1) return default_value;
+
+	int value;
+	memcpy(&value, record(slots_[i].ref), 4);
+	return value;
+}
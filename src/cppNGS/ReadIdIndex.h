@@ -0,0 +1,75 @@
+#ifndef READIDINDEX_H
+#define READIDINDEX_H
+
+#include "cppNGS_global.h"
+#include <QByteArray>
+#include <QVector>
+#include <vector>
+
+/**
+  @brief Memory-efficient hash map from read IDs to an integer value (e.g. the read length), designed for lists of 100M+ IDs.
+
+  The IDs are stored in large contiguous blocks (arena). The hash table uses open addressing with linear probing.
+  Each slot stores only a 32-bit hash tag and a 32-bit reference to the arena, so most failed lookups do not touch the arena at all.
+  Optionally, a blocked Bloom filter (one 64-bit word per ID) is used as pre-filter, which answers most lookups of IDs that are not contained with one memory access.
+  The hash table and filter are stored in std::vector, because they exceed the 2GB size limit of Qt containers for 100M+ IDs.
+*/
+class CPPNGSSHARED_EXPORT ReadIdIndex
+{
+public:
+	///Constructor. If @p prefilter is set, a Bloom filter is used to speed up lookups of IDs that are not contained.
+	ReadIdIndex(bool prefilter = false);
+
+	///Adds an ID with the given value. If the ID is already contained, the value is replaced.
+	void insert(const char* id, int length, int value);
+	///Returns the value of the ID, or @p default_value if the ID is not contained.
+	int value(const char* id, int length, int default_value) const;
+
+	///Returns the number of IDs.
+	qint64 count() const
+	{
+		return count_;
+	}
+	///Returns the number of hash table slots.
+	qint64 slotCount() const
+	{
+		return slots_.size();
+	}
+
+protected:
+	///Hash table slot.
+	struct Slot
+	{
+		quint32 tag; ///< upper 32 bits of the ID hash
+		quint32 ref; ///< arena offset divided by 4, plus one (0 marks an empty slot)
+	};
+
+	bool prefilter_;
+	qint64 count_;
+	QVector<QByteArray> blocks_;
+	int block_used_;
+	std::vector<Slot> slots_;
+	quint64 slot_mask_;
+	std::vector<quint64> filter_;
+	quint64 filter_mask_;
+
+	///Size of arena blocks in bytes (records do not span blocks).
+	static const int BLOCK_SIZE = 1 << 24;
+	///Maximum number of IDs per slot in percent before the table grows.
+	static const int MAX_LOAD = 70;
+
+	///Returns the 64-bit hash of an ID.
+	static quint64 hash(const char* id, int length);
+	///Returns the record data of an arena reference.
+	const char* record(quint32 ref) const;
+	///Appends a record to the arena and returns its reference.
+	quint32 appendRecord(const char* id, int length, int value);
+	///Returns the slot index of the ID, or -1 if it is not contained.
+	qint64 find(const char* id, int length, quint64 h) const;
+	///Inserts a reference into the hash table and filter (the ID must not be contained).
+	void insertRef(quint64 h, quint32 ref);
+	///Doubles the size of the hash table and filter and re-inserts all IDs.
+	void grow();
+};
+
+#endif // READIDINDEX_H
@@ -9,7 +9,10 @@
 #include <QVector>
 #include "Pileup.h"
 #include "NGSHelper.h"
+#include "Profiler.h"
 #include "FastqFileStream.h"
+#include "BamFileStream.h"
+#include "CoverageFile.h"
 #include "LinePlot.h"
 #include "ScatterPlot.h"
 #include "BarPlot.h"
@@ -21,6 +24,8 @@
 #include "Settings.h"
 #include "Histogram.h"
 #include "VariantFilter.h"
+#include "KmerCounter.h"
+#include <QDir>
 
 #include "api/BamReader.h"
 using namespace BamTools;
@@ -175,8 +180,10 @@ QCCollection Statistics::variantList(VariantList variants, bool filter)
     return output;
 }
 
-QCCollection Statistics::mapping(const BedFile& bed_file, const QString& bam_file, int min_mapq)
+QCCollection Statistics::mapping(const BedFile& bed_file, const QString& bam_file, int min_mapq, int threads)
 {
+	ProfilerTimer timer("Statistics::mapping");
+
     //check target region is merged/sorted and create index
     if (!bed_file.isMergedAndSorted())
     {
@@ -185,28 +192,20 @@ QCCollection Statistics::mapping(const BedFile& bed_file, const QString& bam_fil
     ChromosomalIndex<BedFile> roi_index(bed_file);
 
     //open BAM file
-    BamReader reader;
-    NGSHelper::openBAM(reader, bam_file);
-	ChromosomeInfo chr_info(reader);
+    BamInfileStream reader(bam_file, threads);
+	ChromosomeInfo chr_info(reader.GetReferenceData(), bam_file);
 
-    //create coverage statistics data structure
+    //create coverage statistics data structure: one depth difference array per region (with one additional element for the region end), stored contiguously in the order of the BED file
     long long roi_bases = 0;
-    QHash<int, QMap<int, int> > roi_cov;
+	QVector<int> roi_cov_offset(bed_file.count());
+	int roi_cov_size = 0;
     for (int i=0; i<bed_file.count(); ++i)
     {
-        const BedLine& line = bed_file[i];
-
-		if (!roi_cov.contains(line.chr().num()))
-        {
-			roi_cov.insert(line.chr().num(), QMap<int, int>());
-        }
-
-        for(int p=line.start(); p<=line.end(); ++p)
-        {
-			roi_cov[line.chr().num()].insert(p, 0);
-        }
-        roi_bases += line.length();
+		roi_cov_offset[i] = roi_cov_size;
+		roi_cov_size += bed_file[i].length() + 1;
+		roi_bases += bed_file[i].length();
     }
+	QVector<int> roi_cov(roi_cov_size, 0);
 
     //init counts
     int al_total = 0;
@@ -277,13 +276,9 @@ QCCollection Statistics::mapping(const BedFile& bed_file, const QString& bam_fil
                         const int ol_start = std::max(bed_file[index].start(), start_pos);
                         const int ol_end = std::min(bed_file[index].end(), end_pos);
 						bases_usable += ol_end - ol_start + 1;
-						auto it = roi_cov[chr.num()].lowerBound(ol_start);
-						auto end = roi_cov[chr.num()].upperBound(ol_end);
-						while (it!=end)
-						{
-							(*it)++;
-							++it;
-                        }
+						const int offset = roi_cov_offset[index] - bed_file[index].start();
+						++roi_cov[offset + ol_start];
+						--roi_cov[offset + ol_end + 1];
                     }
                 }
             }
@@ -304,16 +299,15 @@ QCCollection Statistics::mapping(const BedFile& bed_file, const QString& bam_fil
 
     //calculate coverage depth statistics
 	Histogram depth_dist(0, 1999, 5);
-	QHashIterator<int, QMap<int, int> > it(roi_cov);
-    while(it.hasNext())
-    {
-		it.next();
-		QMapIterator<int, int> it2(it.value());
-        while(it2.hasNext())
-        {
-			it2.next();
-			depth_dist.inc(it2.value(), true);
-        }
+	for (int i=0; i<bed_file.count(); ++i)
+	{
+		const int* diff = roi_cov.constData() + roi_cov_offset[i];
+		int depth = 0;
+		for (int p=0; p<bed_file[i].length(); ++p)
+		{
+			depth += diff[p];
+			depth_dist.inc(depth, true);
+		}
 	}
 
     //output
@@ -383,12 +377,11 @@ QCCollection Statistics::mapping(const BedFile& bed_file, const QString& bam_fil
     return output;
 }
 
-QCCollection Statistics::mapping_rna(const QString &bam_file, int min_mapq)
+QCCollection Statistics::mapping_rna(const QString &bam_file, int min_mapq, int threads)
 {
     //open BAM file
-    BamReader reader;
-    NGSHelper::openBAM(reader, bam_file);
-    ChromosomeInfo chr_info(reader);
+    BamInfileStream reader(bam_file, threads);
+    ChromosomeInfo chr_info(reader.GetReferenceData(), bam_file);
 
     //init counts
     int al_total = 0;
@@ -583,12 +576,11 @@ QCCollection Statistics::mapping_rna(const QString &bam_file, int min_mapq)
     return output;
 }
 
-QCCollection Statistics::mapping(const QString &bam_file, int min_mapq)
+QCCollection Statistics::mapping(const QString &bam_file, int min_mapq, int threads)
 {
     //open BAM file
-    BamReader reader;
-    NGSHelper::openBAM(reader, bam_file);
-	ChromosomeInfo chr_info(reader);
+    BamInfileStream reader(bam_file, threads);
+	ChromosomeInfo chr_info(reader.GetReferenceData(), bam_file);
 
     //init counts
     int al_total = 0;
@@ -775,7 +767,7 @@ QCCollection Statistics::region(const BedFile& bed_file, bool merge)
     return output;
 }
 
-QCCollection Statistics::somatic(QString& tumor_bam, QString& normal_bam, QString& somatic_vcf, QString target_file, bool skip_plots)
+QCCollection Statistics::somatic(QString& tumor_bam, QString& normal_bam, QString& somatic_vcf, QString target_file, bool skip_plots, int threads)
 {
 	QCCollection output;
 
@@ -1046,60 +1038,29 @@ QCCollection Statistics::somatic(QString& tumor_bam, QString& normal_bam, QStrin
 	}
 
 	plot2.setYLabel("variant type percentage");
-	QHash < QString, int > count_codons_target({
+	QHash < QString, long long > count_codons_target({
 	   {"ACA",0},{"ACC",0},{"ACG",0},{"ACT",0},{"CCA",0},{"CCC",0},{"CCG",0},{"CCT",0},
 	   {"GCA",0},{"GCC",0},{"GCG",0},{"GCT",0},{"TCA",0},{"TCC",0},{"TCG",0},{"TCT",0},
 	   {"ATA",0},{"ATC",0},{"ATG",0},{"ATT",0},{"CTA",0},{"CTC",0},{"CTG",0},{"CTT",0},
 	   {"GTA",0},{"GTC",0},{"GTG",0},{"GTT",0},{"TTA",0},{"TTC",0},{"TTG",0},{"TTT",0}
 	});
+	//codons: count in genome or target file (in one pass, cached in the temporary folder)
+	KmerCounter codon_counts;
 	if(target_file.isEmpty())
 	{
-		FastaFileIndex reference(Settings::string("reference_genome"));
-		int bin = 50000000;
-		for(int i=0; i<reference.names().count(); ++i)
-		{
-			Chromosome chr = reference.names().at(i);
-
-			if(!chr.isNonSpecial()) continue;
-
-			int chrom_length = reference.lengthOf(chr);
-			for(int j=1; j<=chrom_length; j+=bin)
-			{
-				int start = j;
-				int length = bin;
-				if(start>1)	//make bins overlap
-				{
-					start -= 2;
-					length += 2;
-				}
-				if((start+length-1)>chrom_length)	length = (chrom_length - start + 1);
-				Sequence seq = reference.seq(chr,start,length,true);
-				foreach(QString codon, count_codons_target.keys())
-				{
-					count_codons_target[codon] += seq.count(codon.toUpper().toLatin1());
-				}
-			}
-		}
+		codon_counts = KmerCounter::countGenome(Settings::string("reference_genome"), 3, threads, QDir::tempPath());
 	}
 	else
 	{
-		//codons: count in target file
 		BedFile target;
 		target.load(target_file);
 		if(target.baseCount()<100000)	Log::warn("Target size is less than 100 kb. Mutation signature may be imprecise.");
-		for(int i=0; i<target.count(); ++i)
-		{
-			Sequence seq = reference.seq(target[i].chr(),target[i].start(),target[i].length(),true);
-			foreach(QString codon, count_codons_target.keys())
-			{
-				count_codons_target[codon] += seq.count(codon.toLatin1());
-			}
-		}
+		codon_counts = KmerCounter::countRegions(Settings::string("reference_genome"), target, 3, threads, QDir::tempPath());
 	}
 
 	foreach(QString codon, count_codons_target.keys())
 	{
-		qDebug() << codon << QString::number(count_codons_target[codon]);
+		count_codons_target[codon] = codon_counts.count(codon.toLatin1());
 	}
 
 	//codons: normalize current codons and calculate percentages for each codon
@@ -1275,79 +1236,208 @@ QCCollection Statistics::mapping3Exons(const QString& bam_file)
     return output;
 }
 
-BedFile Statistics::lowCoverage(const BedFile& bed_file, const QString& bam_file, int cutoff, int min_mapq)
+//Adds the bases of an alignment to the coverage sum of the overlapping regions (default mode of avgCoverage).
+static void addCoverage(const BamAlignment& al, const Chromosome& chr, const BedFile& bed_file, const ChromosomalIndex<BedFile>& bed_idx, QVector<long>& cov)
 {
-	BedFile output;
-
-    //check target region is merged/sorted and create index
-    if (!bed_file.isMergedAndSorted())
-    {
-		THROW(ArgumentException, "Merged and sorted BED file required for low-coverage statistics!");
-    }
+	int end_position = al.GetEndPosition();
+	QVector<int> indices = bed_idx.matchingIndices(chr, al.Position+1, end_position);
+	foreach(int index, indices)
+	{
+		cov[index] += std::min(bed_file[index].end(), end_position) - std::max(bed_file[index].start(), al.Position+1);
+	}
+}
 
-    //open BAM file
-    BamReader reader;
-    NGSHelper::openBAM(reader, bam_file);
-	ChromosomeInfo chr_info(reader);
+//Calculates the per-base depth of the regions of a merged and sorted BED file by sweeping through the BAM file.
+//Nearby regions are grouped into clusters that are processed with a single jump, so that each alignment is read only once.
+class RegionSweep
+{
+public:
+	RegionSweep(BamReader& reader, const ChromosomeInfo& chr_info, const BedFile& bed_file, int min_mapq)
+		: reader_(reader)
+		, chr_info_(chr_info)
+		, bed_file_(bed_file)
+		, min_mapq_(min_mapq)
+		, first_(0)
+		, last_(-1)
+	{
+	}
 
-	//iterate trough all regions (i.e. exons in most cases)
-	for (int i=0; i<bed_file.count(); ++i)
+	//calculates the depth of the next cluster of regions. Returns 'false' if all regions have been processed.
+	bool nextCluster()
 	{
-		const BedLine& bed_line = bed_file[i];
-		const int start = bed_line.start();
-		//qDebug() << bed_line.chr().str().constData() << ":" << bed_line.start() << "-" << bed_line.end();
+		first_ = last_ + 1;
+		if (first_>=bed_file_.count()) return false;
 
-		//init coverage statistics
-        QVector<int> roi_cov(bed_line.length(), 0);
+		//determine cluster
+		last_ = first_;
+		while (last_+1<bed_file_.count() && bed_file_[last_+1].chr()==bed_file_[last_].chr() && bed_file_[last_+1].start()-bed_file_[last_].end()<=MAX_GAP)
+		{
+			++last_;
+		}
+
+		//init depth difference arrays (one array of length+1 per region)
+		offsets_.resize(last_-first_+2);
+		offsets_[0] = 0;
+		for (int i=first_; i<=last_; ++i)
+		{
+			offsets_[i-first_+1] = offsets_[i-first_] + bed_file_[i].length() + 1;
+		}
+		depth_.fill(0, offsets_.last());
 
-		//jump to region
-		int ref_id = chr_info.refID(bed_line.chr());
-		bool jump_ok = reader.SetRegion(ref_id, bed_line.start()-100, ref_id, bed_line.end()+100);
+		//jump to cluster
+		const Chromosome& chr = bed_file_[first_].chr();
+		int ref_id = chr_info_.refID(chr);
+		bool jump_ok = reader_.SetRegion(ref_id, bed_file_[first_].start()-100, ref_id, bed_file_[last_].end()+100);
 		//TODO There is a bug in bamtools that leads to skipping of some reads if we use the exact region borders.
 		//     Regularly check if this bug is fixed and if so, restore the original jump line (below) and remove the test and test data.
-		//     bool jump_ok = reader.SetRegion(ref_id, bed_line.start()-1, ref_id, bed_line.end());
-		if (!jump_ok) THROW(FileAccessException, QString::fromStdString(reader.GetErrorString()));
+		//     bool jump_ok = reader_.SetRegion(ref_id, bed_file_[first_].start()-1, ref_id, bed_file_[last_].end());
+		if (!jump_ok) THROW(FileAccessException, QString::fromStdString(reader_.GetErrorString()));
 
-		//iterate through all alignments
+		//iterate through all alignments (sorted by start position)
+		int current = first_; //first region that can overlap the current or following alignments
 		BamAlignment al;
-		while (reader.GetNextAlignmentCore(al))
+		while (reader_.GetNextAlignmentCore(al))
 		{
 			if (al.IsDuplicate()) continue;
 			if (!al.IsPrimaryAlignment()) continue;
-			if (!al.IsMapped() || al.MapQuality<min_mapq) continue;
+			if (!al.IsMapped() || al.MapQuality<min_mapq_) continue;
+
+			const int al_start = al.Position + 1;
+			const int al_end = al.GetEndPosition();
+			while (current<=last_ && bed_file_[current].end()<al_start)
+			{
+				++current;
+			}
+			if (current>last_) break;
 
-			const int ol_start = std::max(start, al.Position+1) - start;
-			const int ol_end = std::min(bed_line.end(), al.GetEndPosition()) - start;
-			for (int p=ol_start; p<=ol_end; ++p)
+			for (int i=current; i<=last_ && bed_file_[i].start()<=al_end; ++i)
 			{
-				++roi_cov[p];
+				const BedLine& line = bed_file_[i];
+				const int ol_start = std::max(line.start(), al_start);
+				const int ol_end = std::min(line.end(), al_end);
+				if (ol_start>ol_end) continue;
+
+				int* depth = depth_.data() + offsets_[i-first_];
+				++depth[ol_start - line.start()];
+				--depth[ol_end - line.start() + 1];
 			}
 		}
 
-        //create low-coverage regions file
-		bool reg_open = false;
-		int reg_start = -1;
-        for (int p=0; p<roi_cov.count(); ++p)
-        {
-            bool low_cov = roi_cov[p]<cutoff;
-            if (reg_open && !low_cov)
-            {
-				output.append(BedLine(bed_line.chr(), reg_start+start, p+start-1, bed_line.annotations()));
-                reg_open = false;
-                reg_start = -1;
-            }
-            if (!reg_open && low_cov)
-            {
-                reg_open = true;
-                reg_start = p;
-            }
-        }
-        if (reg_open)
-        {
-			output.append(BedLine(bed_line.chr(), reg_start+start, bed_line.length()+start-1, bed_line.annotations()));
-        }
+		//convert difference arrays to depth
+		for (int i=first_; i<=last_; ++i)
+		{
+			int* depth = depth_.data() + offsets_[i-first_];
+			const int length = bed_file_[i].length();
+			for (int p=1; p<length; ++p)
+			{
+				depth[p] += depth[p-1];
+			}
+		}
+
+		return true;
+	}
+
+	//returns the index of the first region of the current cluster
+	int first() const
+	{
+		return first_;
+	}
+	//returns the index of the last region of the current cluster
+	int last() const
+	{
+		return last_;
+	}
+	//returns the per-base depth of a region of the current cluster
+	QVector<int> depth(int index) const
+	{
+		return depth_.mid(offsets_[index-first_], bed_file_[index].length());
+	}
+	//returns the sum of the per-base depth of a region of the current cluster
+	long long depthSum(int index) const
+	{
+		const int* depth = depth_.constData() + offsets_[index-first_];
+		return std::accumulate(depth, depth + bed_file_[index].length(), 0ll);
+	}
+
+protected:
+	//maximum gap between regions that are processed with one jump
+	static const int MAX_GAP = 10000;
+
+	BamReader& reader_;
+	const ChromosomeInfo& chr_info_;
+	const BedFile& bed_file_;
+	int min_mapq_;
+	int first_;
+	int last_;
+	QVector<int> offsets_;
+	QVector<int> depth_;
+};
+
+//appends the low-coverage parts of a region with given per-base depth (starting at 1-based position @p start) to the output
+static void appendLowCoverageRegions(BedFile& output, const Chromosome& chr, int start, const QVector<int>& cov, int cutoff, const QStringList& annotations = QStringList())
+{
+	bool reg_open = false;
+	int reg_start = -1;
+	for (int p=0; p<cov.count(); ++p)
+	{
+		bool low_cov = cov[p]<cutoff;
+		if (reg_open && !low_cov)
+		{
+			output.append(BedLine(chr, reg_start+start, p+start-1, annotations));
+			reg_open = false;
+			reg_start = -1;
+		}
+		if (!reg_open && low_cov)
+		{
+			reg_open = true;
+			reg_start = p;
+		}
+	}
+	if (reg_open)
+	{
+		output.append(BedLine(chr, reg_start+start, cov.count()+start-1, annotations));
+	}
+}
+
+BedFile Statistics::lowCoverage(const BedFile& bed_file, const QString& bam_file, int cutoff, int min_mapq)
+{
+	BedFile output;
+
+    //check target region is merged/sorted and create index
+    if (!bed_file.isMergedAndSorted())
+    {
+		THROW(ArgumentException, "Merged and sorted BED file required for low-coverage statistics!");
     }
 
+	//precalculated coverage file
+	if (CoverageFile::isCoverageFile(bam_file))
+	{
+		CoverageFile cov_file(bam_file);
+		cov_file.checkMinMappingQuality(min_mapq);
+		for (int i=0; i<bed_file.count(); ++i)
+		{
+			const BedLine& bed_line = bed_file[i];
+			appendLowCoverageRegions(output, bed_line.chr(), bed_line.start(), cov_file.depth(bed_line.chr(), bed_line.start(), bed_line.end()), cutoff, bed_line.annotations());
+		}
+		return output;
+	}
+
+    //open BAM file
+    BamReader reader;
+    NGSHelper::openBAM(reader, bam_file);
+	ChromosomeInfo chr_info(reader);
+
+	//sweep trough all regions (i.e. exons in most cases)
+	RegionSweep sweep(reader, chr_info, bed_file, min_mapq);
+	while (sweep.nextCluster())
+	{
+		for (int i=sweep.first(); i<=sweep.last(); ++i)
+		{
+			const BedLine& bed_line = bed_file[i];
+			appendLowCoverageRegions(output, bed_line.chr(), bed_line.start(), sweep.depth(i), cutoff, bed_line.annotations());
+		}
+	}
+
 	return output;
 }
 
@@ -1355,6 +1445,28 @@ BedFile Statistics::lowCoverage(const QString& bam_file, int cutoff, int min_map
 {
     BedFile output;
 
+	//precalculated coverage file (processed in windows to limit memory usage)
+	if (CoverageFile::isCoverageFile(bam_file))
+	{
+		CoverageFile cov_file(bam_file);
+		cov_file.checkMinMappingQuality(min_mapq);
+		const ChromosomeInfo& chr_info = cov_file.chromosomeInfo();
+		foreach(const Chromosome& chr, chr_info.chromosomes())
+		{
+			if (!chr.isNonSpecial()) continue;
+
+			const int chr_size = chr_info.size(chr);
+			const int window = 1000000;
+			for (int start=1; start<=chr_size; start+=window)
+			{
+				int end = std::min(start+window-1, chr_size);
+				appendLowCoverageRegions(output, chr, start, cov_file.depth(chr, start, end), cutoff);
+			}
+		}
+		output.merge();
+		return output;
+	}
+
     //open BAM file
     BamReader reader;
     NGSHelper::openBAM(reader, bam_file);
@@ -1391,36 +1503,14 @@ BedFile Statistics::lowCoverage(const QString& bam_file, int cutoff, int min_map
         }
 
         //create low-coverage regions file
-        bool reg_open = false;
-        int reg_start = -1;
-        for (int p=0; p<cov.count(); ++p)
-        {
-            bool low_cov = cov[p]<cutoff;
-            if (reg_open && !low_cov)
-            {
-                //qDebug() << chr.str() << reg_start+1 << p;
-                output.append(BedLine(chr, reg_start+1, p));
-                reg_open = false;
-                reg_start = -1;
-            }
-            if (!reg_open && low_cov)
-            {
-                reg_open = true;
-                reg_start = p;
-            }
-        }
-        if (reg_open)
-        {
-            //qDebug() << chr.str() << reg_start+1 << chr_size;
-            output.append(BedLine(chr, reg_start+1, chr_size));
-        }
+        appendLowCoverageRegions(output, chr, 1, cov, cutoff);
     }
 
     output.merge();
     return output;
 }
 
-void Statistics::avgCoverage(BedFile& bed_file, const QString& bam_file, int min_mapq, bool panel_mode)
+void Statistics::avgCoverage(BedFile& bed_file, const QString& bam_file, int min_mapq, bool panel_mode, int threads)
 {
     //check target region is merged/sorted and create index
     if (!bed_file.isMergedAndSorted())
@@ -1428,46 +1518,31 @@ void Statistics::avgCoverage(BedFile& bed_file, const QString& bam_file, int min
         THROW(ArgumentException, "Merged and sorted BED file required for coverage calculation!");
     }
 
-    //open BAM file
-    BamReader reader;
-    NGSHelper::openBAM(reader, bam_file);
-	ChromosomeInfo chr_info(reader);
-
-	if (panel_mode) //panel mode
+	if (CoverageFile::isCoverageFile(bam_file)) //precalculated coverage file (the mode is irrelevant)
 	{
+		CoverageFile cov_file(bam_file);
+		cov_file.checkMinMappingQuality(min_mapq);
 		for (int i=0; i<bed_file.count(); ++i)
 		{
-			long cov = 0;
 			BedLine& bed_line = bed_file[i];
-
-			//jump to region
-			int ref_id = chr_info.refID(bed_line.chr());
-			bool jump_ok = reader.SetRegion(ref_id, bed_line.start()-100, ref_id, bed_line.end()+100);
-			//TODO There is a bug in bamtools that leads to skipping of some reads if we use the exact region borders.
-			//     Regularly check if this bug is fixed and if so, restore the original jump line (below).
-			//     bool jump_ok = reader.SetRegion(ref_id, bed_line.start()-1, ref_id, bed_line.end());
-			if (!jump_ok) THROW(FileAccessException, QString::fromStdString(reader.GetErrorString()));
-
-			//iterate through all alignments
-			BamAlignment al;
-			while (reader.GetNextAlignmentCore(al))
-			{
-				if (al.IsDuplicate()) continue;
-				if (!al.IsPrimaryAlignment()) continue;
-				if (!al.IsMapped() || al.MapQuality<min_mapq) continue;
-
-				const int ol_start = std::max(bed_line.start(), al.Position+1);
-				const int ol_end = std::min(bed_line.end(), al.GetEndPosition());
-				if (ol_start<=ol_end)
-				{
-					cov += ol_end - ol_start + 1;
-				}
-			}
+			long long cov = cov_file.depthSum(bed_line.chr(), bed_line.start(), bed_line.end());
 			bed_line.annotations().append(QString::number((double)cov / bed_line.length(), 'f', 2));
 		}
 	}
+	else if (panel_mode) //panel mode
+	{
+		//open BAM file (random access)
+		BamReader reader;
+		NGSHelper::openBAM(reader, bam_file);
+		avgCoverage(bed_file, reader, min_mapq, true);
+		reader.Close();
+	}
 	else //default mode
 	{
+		//open BAM file (sequential access)
+		BamInfileStream reader(bam_file, threads);
+		ChromosomeInfo chr_info(reader.GetReferenceData(), bam_file);
+
 		//init coverage statistics data structure
 		QVector<long> cov;
 		cov.fill(0, bed_file.count());
@@ -1481,13 +1556,75 @@ void Statistics::avgCoverage(BedFile& bed_file, const QString& bam_file, int min
 			if (!al.IsPrimaryAlignment()) continue;
 			if (!al.IsMapped() || al.MapQuality<min_mapq) continue;
 
-			const Chromosome& chr = chr_info.chromosome(al.RefID);
-			int end_position = al.GetEndPosition();
-			QVector<int> indices = bed_idx.matchingIndices(chr, al.Position+1, end_position);
-			foreach(int index, indices)
+			addCoverage(al, chr_info.chromosome(al.RefID), bed_file, bed_idx, cov);
+		}
+
+		//calculate output
+		for (int i=0; i<bed_file.count(); ++i)
+		{
+			bed_file[i].annotations().append(QString::number((double)(cov[i]) / bed_file[i].length(), 'f', 2));
+		}
+	}
+}
+
+void Statistics::avgCoverage(BedFile& bed_file, BamReader& reader, int min_mapq, bool panel_mode)
+{
+	//check target region is merged/sorted
+	if (!bed_file.isMergedAndSorted())
+	{
+		THROW(ArgumentException, "Merged and sorted BED file required for coverage calculation!");
+	}
+
+	ChromosomeInfo chr_info(reader);
+	if (panel_mode)
+	{
+		//sweep trough all regions
+		RegionSweep sweep(reader, chr_info, bed_file, min_mapq);
+		while (sweep.nextCluster())
+		{
+			for (int i=sweep.first(); i<=sweep.last(); ++i)
+			{
+				bed_file[i].annotations().append(QString::number((double)sweep.depthSum(i) / bed_file[i].length(), 'f', 2));
+			}
+		}
+	}
+	else
+	{
+		//init coverage statistics data structure
+		QVector<long> cov;
+		cov.fill(0, bed_file.count());
+
+		//iterate through the alignments of the regions on each chromosome (regions on chromosomes that are not in the BAM file have zero coverage, as in the sequential version)
+		ChromosomalIndex<BedFile> bed_idx(bed_file);
+		int first = 0;
+		while (first<bed_file.count())
+		{
+			const Chromosome& chr = bed_file[first].chr();
+			int last = first;
+			while (last+1<bed_file.count() && bed_file[last+1].chr()==chr)
+			{
+				++last;
+			}
+
+			if (chr_info.contains(chr))
 			{
-				cov[index] += std::min(bed_file[index].end(), end_position) - std::max(bed_file[index].start(), al.Position+1);
+				//jump to regions (see RegionSweep for the margin)
+				int ref_id = chr_info.refID(chr);
+				bool jump_ok = reader.SetRegion(ref_id, std::max(0, bed_file[first].start()-100), ref_id, bed_file[last].end()+100);
+				if (!jump_ok) THROW(FileAccessException, QString::fromStdString(reader.GetErrorString()));
+
+				BamAlignment al;
+				while (reader.GetNextAlignmentCore(al))
+				{
+					if (al.IsDuplicate()) continue;
+					if (!al.IsPrimaryAlignment()) continue;
+					if (!al.IsMapped() || al.MapQuality<min_mapq) continue;
+
+					addCoverage(al, chr, bed_file, bed_idx, cov);
+				}
 			}
+
+			first = last + 1;
 		}
 
 		//calculate output
@@ -1496,7 +1633,6 @@ void Statistics::avgCoverage(BedFile& bed_file, const QString& bam_file, int min
 			bed_file[i].annotations().append(QString::number((double)(cov[i]) / bed_file[i].length(), 'f', 2));
 		}
 	}
-	reader.Close();
 }
 
 QString Statistics::genderXY(const QString& bam_file, QStringList& debug_output, double max_female, double min_male)
@@ -5,6 +5,7 @@
 #include "VariantList.h"
 #include "BedFile.h"
 #include "QCCollection.h"
+#include "api/BamReader.h"
 #include <QMap>
 
 
@@ -15,24 +16,26 @@ public:
 	///Calculates QC metrics on a variant list (only for VCF).
 	static QCCollection variantList(VariantList variants, bool filter);
 	///Calculates mapping QC metrics for a target region from a BAM file. The input BED file must be merged!
-	static QCCollection mapping(const BedFile& bed_file, const QString& bam_file, int min_mapq=1);
+	static QCCollection mapping(const BedFile& bed_file, const QString& bam_file, int min_mapq=1, int threads=1);
     ///Calculates mapping QC metrics for RNA from a BAM file.
-    static QCCollection mapping_rna(const QString& bam_file, int min_mapq=1);
+    static QCCollection mapping_rna(const QString& bam_file, int min_mapq=1, int threads=1);
 	///Calculates mapping QC metrics for WGS from a BAM file.
-	static QCCollection mapping(const QString& bam_file, int min_mapq=1);
+	static QCCollection mapping(const QString& bam_file, int min_mapq=1, int threads=1);
     ///Calculates special mapping QC metrics on three defined exons.
 	static QCCollection mapping3Exons(const QString& bam_file);
 	///Calculates target region statistics (term-value pairs). @p merge determines if overlapping regions are merged before calculating the statistics.
 	static QCCollection region(const BedFile& bed_file, bool merge);
-	///Calculates somatic QC metrics from BAM and vcf file
-	static QCCollection somatic(QString& tumor_bam, QString& normal_bam, QString& somatic_vcf, QString target_file = QString(), bool skip_plots = false);
+	///Calculates somatic QC metrics from BAM and vcf file. The trinucleotide counts of the genome/target region used for the mutation signature are cached in the temporary folder.
+	static QCCollection somatic(QString& tumor_bam, QString& normal_bam, QString& somatic_vcf, QString target_file = QString(), bool skip_plots = false, int threads = 1);
 
-	///Calculates the part of the target region that has a lower coverage than the given cutoff. The input BED file must be merged and sorted!
+	///Calculates the part of the target region that has a lower coverage than the given cutoff. The input BED file must be merged and sorted! Instead of a BAM file, a coverage file (see CoverageFile) can be given.
 	static BedFile lowCoverage(const BedFile& bed_file, const QString& bam_file, int cutoff, int min_mapq=1);
-    ///Calculates the part of the genome that has a lower coverage than the given cutoff.
+    ///Calculates the part of the genome that has a lower coverage than the given cutoff. Instead of a BAM file, a coverage file (see CoverageFile) can be given.
     static BedFile lowCoverage(const QString& bam_file, int cutoff, int min_mapq=1);
-	///Calculates and annotates the average coverage of the regions in the bed file. The input BED file must be merged and sorted! Panel mode should be used if only a small part of the BAM data is needed.
-	static void avgCoverage(BedFile& bed_file, const QString& bam_file, int min_mapq=1, bool panel_mode=false);
+	///Calculates and annotates the average coverage of the regions in the bed file. The input BED file must be merged and sorted! Panel mode should be used if only a small part of the BAM data is needed. Instead of a BAM file, a coverage file (see CoverageFile) can be given.
+	static void avgCoverage(BedFile& bed_file, const QString& bam_file, int min_mapq=1, bool panel_mode=false, int threads=1);
+	///Calculates and annotates the average coverage of the regions in the bed file using an open BAM @p reader. The alignments of each chromosome are accessed randomly, so that chunks of regions can be processed in parallel (see BedChunkRunner). The results are the same as for the BAM file version.
+	static void avgCoverage(BedFile& bed_file, BamTools::BamReader& reader, int min_mapq=1, bool panel_mode=false);
 
 	///Determines the gender based on the read ratio between X and Y chromosome.
 	static QString genderXY(const QString& bam_file, QStringList& debug_output, double max_female=0.06, double min_male=0.09);
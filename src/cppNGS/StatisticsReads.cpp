@@ -19,7 +19,55 @@ StatisticsReads::StatisticsReads()
 void StatisticsReads::update(const FastqEntry& entry, ReadDirection direction)
 {
 	mutex_.lock();
+	updateRead(entry.bases.constData(), entry.qualities.constData(), entry.bases.count(), direction);
+	mutex_.unlock();
+}
+
+void StatisticsReads::update(const FastqBatch& batch, ReadDirection direction)
+{
+	mutex_.lock();
+	for (int i=0; i<batch.count(); ++i)
+	{
+		if (batch.isDiscarded(i)) continue;
+		updateRead(batch.bases(i), batch.qualities(i), batch.length(i), direction);
+	}
+	mutex_.unlock();
+}
 
+void StatisticsReads::merge(const StatisticsReads& other)
+{
+	mutex_.lock();
+	c_forward_ += other.c_forward_;
+	c_reverse_ += other.c_reverse_;
+	read_lengths_.unite(other.read_lengths_);
+	bases_sequenced_ += other.bases_sequenced_;
+	c_read_q20_ += other.c_read_q20_;
+	c_base_q30_ += other.c_base_q30_;
+
+	int cycles = other.pileups_.size();
+	if (cycles>pileups_.size())
+	{
+		pileups_.resize(cycles);
+		qualities1_.resize(cycles);
+		qualities2_.resize(cycles);
+	}
+	for (int i=0; i<cycles; ++i)
+	{
+		const Pileup& pileup = other.pileups_[i];
+		pileups_[i].inc('A', pileup.a());
+		pileups_[i].inc('C', pileup.c());
+		pileups_[i].inc('G', pileup.g());
+		pileups_[i].inc('T', pileup.t());
+		pileups_[i].inc('N', pileup.n());
+		pileups_[i].inc('-', pileup.depth(true) - pileup.depth(false));
+		qualities1_[i] += other.qualities1_[i];
+		qualities2_[i] += other.qualities2_[i];
+	}
+	mutex_.unlock();
+}
+
+void StatisticsReads::updateRead(const char* bases, const char* qualities, int cycles, ReadDirection direction)
+{
 	//update read counts
 	if (direction==FORWARD)
 	{
@@ -31,7 +79,6 @@ void StatisticsReads::update(const FastqEntry& entry, ReadDirection direction)
 	}
 
 	//check number of cycles
-	int cycles = entry.bases.count();
     bases_sequenced_ += cycles;
 	read_lengths_.insert(cycles);
 	if (cycles>pileups_.size())
@@ -42,13 +89,13 @@ void StatisticsReads::update(const FastqEntry& entry, ReadDirection direction)
 	}
 
 	//create pileups
-	for (int i=0; i<cycles; ++i) pileups_[i].inc(entry.bases[i]);
+	for (int i=0; i<cycles; ++i) pileups_[i].inc(bases[i]);
 
 	//handle qualities
 	double q_sum = 0.0;
 	for (int i=0; i<cycles; ++i)
 	{
-		int q = entry.quality(i);
+		int q = (int)(qualities[i]) - 33;
 		q_sum += q;
 		if (q>=30.0) ++c_base_q30_;
 		if (direction==FORWARD)
@@ -61,8 +108,6 @@ void StatisticsReads::update(const FastqEntry& entry, ReadDirection direction)
 		}
 	}
 	if (q_sum/cycles>=20.0) ++c_read_q20_;
-
-	mutex_.unlock();
 }
 
 QCCollection StatisticsReads::getResult()
@@ -28,6 +28,10 @@ public:
 	StatisticsReads();
 	///Updates the statistics based on the given read.
 	void update(const FastqEntry& entry, ReadDirection direction);
+	///Updates the statistics based on all reads of the batch (discarded reads are ignored).
+	void update(const FastqBatch& batch, ReadDirection direction);
+	///Adds the statistics of @p other, e.g. thread-local statistics of a batch. @p other must not be updated during the merge.
+	void merge(const StatisticsReads& other);
 	///Returns the statistics result.
 	QCCollection getResult();
 
@@ -42,6 +46,9 @@ private:
 	QVector<Pileup> pileups_;
 	QVector<double> qualities1_;
 	QVector<double> qualities2_;
+
+	///Updates the statistics based on the given read (not thread-safe).
+	void updateRead(const char* bases, const char* qualities, int cycles, ReadDirection direction);
 };
 
 #endif // STATISTICSREADS_H
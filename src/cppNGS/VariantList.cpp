@@ -5,11 +5,14 @@
 #include "Log.h"
 #include "ChromosomalIndex.h"
 #include "NGSHelper.h"
+#include "Profiler.h"
 
 #include <QFile>
 #include <QTextStream>
 #include <QRegExp>
 #include <QBitArray>
+#include <QRunnable>
+#include <QThreadPool>
 
 #include <zlib.h>
 
@@ -393,6 +396,8 @@ QStringList VariantList::sampleNames() const
 
 VariantList::Format VariantList::load(QString filename, VariantList::Format format)
 {
+	ProfilerTimer timer("VariantList::load");
+
 	//determine format
 	if (format==AUTO)
 	{
@@ -462,6 +467,9 @@ VariantList::Format VariantList::load(QString filename, VariantList::Format form
 
 void VariantList::store(QString filename, VariantList::Format format)
 {
+	ProfilerTimer timer("VariantList::store");
+	Profiler::addCount("VariantList::store variants", variants_.count());
+
 	//determine format
 	if (format==AUTO)
 	{
@@ -573,6 +581,8 @@ void VariantList::loadFromTSV(QString filename)
 
 	//validate
 	checkValid("loading file '" + filename + "'!");
+
+	Profiler::addCount("VariantList::load variants", variants_.count());
 }
 
 void VariantList::storeToTSV(QString filename)
@@ -981,6 +991,8 @@ void VariantList::loadFromVCF(QString filename)
 
 	//validate
 	checkValid("loading file '" + filename + "'!");
+
+	Profiler::addCount("VariantList::load variants", variants_.count());
 }
 
 void VariantList::storeToVCF(QString filename)
@@ -1210,162 +1222,229 @@ void VariantList::clearVariants()
 	variants_.clear();
 }
 
-void VariantList::leftAlign(QString ref_file)
+///Shifts a non complex insert or deletion to the left as far as possible.
+static void leftAlignVariant(Variant& variant, const FastaFileIndex& reference)
 {
-	//open refererence genome file
-	FastaFileIndex reference(ref_file);
+	Chromosome chr = variant.chr();
+	int pos = variant.start();
+	Sequence ref = variant.ref().toUpper();
+	Sequence alt = variant.obs().toUpper();
 
-	//init
-	for (QVector<Variant>::iterator variant = variants_.begin(); variant != variants_.end(); ++variant)
+	//skip SNVs
+	if (variant.isSNV()) return;
+
+	//skip SNVs disguised as indels (ACGT => AXGT)
+	if (!alt.contains(','))
+	{
+		Variant v2 = variant;
+		v2.normalize("");
+		if (v2.isSNV())
+		{
+			variant.setStart(v2.start());
+			variant.setEnd(v2.end());
+			variant.setRef(v2.ref());
+			variant.setObs(v2.obs());
+			return;
+		}
+	}
+
+	//normalize (remove surrounding bases)
+	QList<Sequence> alt_ma = alt.split(',');//list of alternative alleles
+	QVector<int> pos_ma(alt_ma.count(), pos);//vector with size equal to number of alleles and values of pos
+	QVector<Sequence> ref_ma(alt_ma.count(), ref);//vector with size equal to number of alleles and values of ref
+	bool complex = false;
+	bool tsv_style= false;//(e.g. deletion in VCF: "AG"->"A", deletion in tsv: "G"->"-")
+	for (int i=0; i<alt_ma.count(); ++i)
 	{
-		Chromosome chr = variant->chr();
-		int pos = variant->start();
-		Sequence ref = variant->ref().toUpper();
-		Sequence alt = variant->obs().toUpper();
+		if(ref_ma[i]=="-")//if it is a simple insertion from a tsv-file
+		{
+			ref_ma[i]="";
+			tsv_style=true;
+		}
+		if(alt_ma[i]=="-")//if it is a simple deletion from a tsv-file
+		{
+			alt_ma[i]="";
+			tsv_style=true;
+		}
+		//remove common bases at beginning or end of ref and alt and shift pos if beginning was removed
+		Variant::normalize(pos_ma[i], ref_ma[i], alt_ma[i]);
+		//skip complex indels
+		if (ref_ma[i].length()!=0 && alt_ma[i].length()!=0)
+		{
+			complex = true;
+			break;
+		}
+	}
 
-		//skip SNVs
-		if (variant->isSNV()) continue;
+	//skip complex variants
+	if (complex) return;
 
-		//skip SNVs disguised as indels (ACGT => AXGT)
-		if (!alt.contains(','))
+	//left-align
+	bool same_ref_ma = true;
+	for (int i=0; i<alt_ma.count(); ++i)
+	{
+		//INSERTION
+		//if the reference bases were completely included in the alt bases
+		if (ref_ma[i].length()==0)
 		{
-			Variant v2 = *variant;
-			v2.normalize("");
-			if (v2.isSNV())
+			//block shift insertion
+			Sequence block = Variant::minBlock(alt_ma[i]);//the normalized alt bases[i](or the smallest non-alternating part of it)
+			pos_ma[i] -= block.length();//position is moved to left by size of sequence
+			//as long as the ref matches the normalized alt, position is moved to left by size of sequence
+			while(reference.seq(chr, pos_ma[i], block.length())==block)
 			{
-				variant->setStart(v2.start());
-				variant->setEnd(v2.end());
-				variant->setRef(v2.ref());
-				variant->setObs(v2.obs());
-				continue;
+				pos_ma[i] -= block.length();
 			}
-		}
+			//after the ref didn't matches the normalized alt, position is moved back to the right by size of sequence
+			pos_ma[i] += block.length();
 
-		//normalize (remove surrounding bases)
-		QList<Sequence> alt_ma = alt.split(',');//list of alternative alleles
-		QVector<int> pos_ma(alt_ma.count(), pos);//vector with size equal to number of alleles and values of pos
-		QVector<Sequence> ref_ma(alt_ma.count(), ref);//vector with size equal to number of alleles and values of ref
-		bool complex = false;
-		bool tsv_style= false;//(e.g. deletion in VCF: "AG"->"A", deletion in tsv: "G"->"-")
-		for (int i=0; i<alt_ma.count(); ++i)
-		{
-			if(ref_ma[i]=="-")//if it is a simple insertion from a tsv-file
+			//prepend prefix base
+			if(!tsv_style)
 			{
-				ref_ma[i]="";
-				tsv_style=true;
+				pos_ma[i] -= 1;//position is moved to left by one
 			}
-			if(alt_ma[i]=="-")//if it is a simple deletion from a tsv-file
+			ref_ma[i] = reference.seq(chr, pos_ma[i], 1);//ref_ma= ref base at position
+			alt_ma[i] = ref_ma[i] + alt_ma[i];//ref_ma= ref base is added to alt bases
+			//single-base shift insertion
+			//as long as the ref base at position matches the right-end base of the alt seq
+			//shift insertion to the lef (because e.g. multiples of AGA could be multiples of AAG)
+			while(ref_ma[i]==alt_ma[i].right(1))
 			{
-				alt_ma[i]="";
-				tsv_style=true;
+				pos_ma[i] -= 1;//
+				ref_ma[i] = reference.seq(chr, pos_ma[i], 1);
+				alt_ma[i] = ref_ma[i] + alt_ma[i].left(alt_ma[i].length()-1);
 			}
-			//remove common bases at beginning or end of ref and alt and shift pos if beginning was removed
-			Variant::normalize(pos_ma[i], ref_ma[i], alt_ma[i]);
-			//skip complex indels
-			if (ref_ma[i].length()!=0 && alt_ma[i].length()!=0)
+			if (tsv_style)
 			{
-				complex = true;
-				break;
+				ref_ma[i]="-";//VCF "G" -> TSV "-"
+				alt_ma[i]=alt_ma[i].right(alt_ma[i].length()-1);//VCF "GA" -> TSV "A"
 			}
 		}
-
-		//skip complex variants
-		if (complex) continue;
-
-		//left-align
-		bool same_ref_ma = true;
-		for (int i=0; i<alt_ma.count(); ++i)
+		//DELETION
+		//if the alternative bases were completely included in reference bases
+		//everything as a above, except ref and alt exchanged
+		else if (alt_ma[i].length()==0)
 		{
-			//INSERTION
-			//if the reference bases were completely included in the alt bases
-			if (ref_ma[i].length()==0)
+			//block shift deletion
+			Sequence block = Variant::minBlock(ref_ma[i]);
+			while(reference.seq(chr, pos_ma[i], block.length())==block)
 			{
-				//block shift insertion
-				Sequence block = Variant::minBlock(alt_ma[i]);//the normalized alt bases[i](or the smallest non-alternating part of it)
-				pos_ma[i] -= block.length();//position is moved to left by size of sequence
-				//as long as the ref matches the normalized alt, position is moved to left by size of sequence
-				while(reference.seq(chr, pos_ma[i], block.length())==block)
-				{
-					pos_ma[i] -= block.length();
-				}
-				//after the ref didn't matches the normalized alt, position is moved back to the right by size of sequence
-				pos_ma[i] += block.length();
-
-				//prepend prefix base
-				if(!tsv_style)
-				{
-					pos_ma[i] -= 1;//position is moved to left by one
-				}
-				ref_ma[i] = reference.seq(chr, pos_ma[i], 1);//ref_ma= ref base at position
-				alt_ma[i] = ref_ma[i] + alt_ma[i];//ref_ma= ref base is added to alt bases
-				//single-base shift insertion
-				//as long as the ref base at position matches the right-end base of the alt seq
-				//shift insertion to the lef (because e.g. multiples of AGA could be multiples of AAG)
-				while(ref_ma[i]==alt_ma[i].right(1))
-				{
-					pos_ma[i] -= 1;//
-					ref_ma[i] = reference.seq(chr, pos_ma[i], 1);
-					alt_ma[i] = ref_ma[i] + alt_ma[i].left(alt_ma[i].length()-1);
-				}
-				if (tsv_style)
-				{
-					ref_ma[i]="-";//VCF "G" -> TSV "-"
-					alt_ma[i]=alt_ma[i].right(alt_ma[i].length()-1);//VCF "GA" -> TSV "A"
-				}
+				pos_ma[i] -= block.length();
 			}
-			//DELETION
-			//if the alternative bases were completely included in reference bases
-			//everything as a above, except ref and alt exchanged
-			else if (alt_ma[i].length()==0)
-			{
-				//block shift deletion
-				Sequence block = Variant::minBlock(ref_ma[i]);
-				while(reference.seq(chr, pos_ma[i], block.length())==block)
-				{
-					pos_ma[i] -= block.length();
-				}
-				pos_ma[i] += block.length();
+			pos_ma[i] += block.length();
 
-				//prepend prefix base
+			//prepend prefix base
+			pos_ma[i] -= 1;
+			alt_ma[i] = reference.seq(chr, pos_ma[i], 1);
+			ref_ma[i] = alt_ma[i] + ref_ma[i];
+
+			//single-base shift deletion
+			while(ref_ma[i].right(1)==alt_ma[i])
+			{
 				pos_ma[i] -= 1;
 				alt_ma[i] = reference.seq(chr, pos_ma[i], 1);
-				ref_ma[i] = alt_ma[i] + ref_ma[i];
-
-				//single-base shift deletion
-				while(ref_ma[i].right(1)==alt_ma[i])
-				{
-					pos_ma[i] -= 1;
-					alt_ma[i] = reference.seq(chr, pos_ma[i], 1);
-					ref_ma[i] = alt_ma[i] + ref_ma[i].left(ref_ma[i].length()-1);
-				}
+				ref_ma[i] = alt_ma[i] + ref_ma[i].left(ref_ma[i].length()-1);
+			}
 
-				if (tsv_style)
-				{
-					alt_ma[i]="-";//VCF "G" -> TSV "-"
-					ref_ma[i]=ref_ma[i].right(ref_ma[i].length()-1);//VCF "GA" -> TSV "A"
-					pos_ma[i] += 1;//go one base to the right, since the common "G" is not saved in TSV-entries
-				}
+			if (tsv_style)
+			{
+				alt_ma[i]="-";//VCF "G" -> TSV "-"
+				ref_ma[i]=ref_ma[i].right(ref_ma[i].length()-1);//VCF "GA" -> TSV "A"
+				pos_ma[i] += 1;//go one base to the right, since the common "G" is not saved in TSV-entries
 			}
+		}
+
+		if (ref_ma[i]!=ref_ma[0] || pos_ma[i]!=pos_ma[0])
+		{
+			same_ref_ma = false;
+		}
+	}
+
+	//skip multi-allelic variants the have different reference sequence after normalization and left-alignment
+	if(!same_ref_ma) return;
+
+	//save left-aligned and normalized ref,alt and pos
+	variant.setRef(ref_ma[0]);
+	variant.setStart(pos_ma[0]);
+	variant.setEnd(pos_ma[0]+ref_ma[0].length()-1);
+	alt = alt_ma[0];
+	for (int i=1; i<alt_ma.count(); ++i)//for each of multiples alt alleles
+	{
+		alt.append("," + alt_ma[i]);
+	}
+	variant.setObs(alt);
+}
+
+///Worker that left-aligns a range of variants.
+class LeftAlignWorker
+	: public QRunnable
+{
+public:
+	LeftAlignWorker(QVector<Variant>& variants, int start, int end, const FastaFileIndex& reference, QString& error)
+		: QRunnable()
+		, variants_(variants)
+		, start_(start)
+		, end_(end)
+		, reference_(reference)
+		, error_(error)
+	{
+	}
 
-			if (ref_ma[i]!=ref_ma[0] || pos_ma[i]!=pos_ma[0])
+	void run()
+	{
+		try
+		{
+			for (int i=start_; i<end_; ++i)
 			{
-				same_ref_ma = false;
+				leftAlignVariant(variants_[i], reference_);
 			}
 		}
+		catch(Exception& e)
+		{
+			error_ = e.message();
+		}
+	}
 
-		//skip multi-allelic variants the have different reference sequence after normalization and left-alignment
-		if(!same_ref_ma) continue;
+protected:
+	QVector<Variant>& variants_;
+	int start_;
+	int end_;
+	const FastaFileIndex& reference_;
+	QString& error_;
+};
 
-		//save left-aligned and normalized ref,alt and pos
-		variant->setRef(ref_ma[0]);
-		variant->setStart(pos_ma[0]);
-		variant->setEnd(pos_ma[0]+ref_ma[0].length()-1);
-		alt = alt_ma[0];
-		for (int i=1; i<alt_ma.count(); ++i)//for each of multiples alt alleles
+void VariantList::leftAlign(QString ref_file, int threads)
+{
+	//open refererence genome file
+	FastaFileIndex reference(ref_file);
+
+	//left-align chunks of variants in parallel (only possible if the reference genome is memory-mapped)
+	if (threads>1 && reference.isMapped() && variants_.count()>1)
+	{
+		variants_.detach();
+		int chunk_size = (variants_.count() + threads - 1) / threads;
+		QVector<QString> errors(threads);
+		QThreadPool pool;
+		pool.setMaxThreadCount(threads);
+		for (int i=0; i<threads; ++i)
+		{
+			int start = i * chunk_size;
+			int end = std::min(start + chunk_size, variants_.count());
+			if (start>=end) break;
+			pool.start(new LeftAlignWorker(variants_, start, end, reference, errors[i]));
+		}
+		pool.waitForDone();
+		foreach(const QString& error, errors)
+		{
+			if (!error.isEmpty()) THROW(Exception, error);
+		}
+	}
+	else
+	{
+		for (int i=0; i<variants_.count(); ++i)
 		{
-			alt.append("," + alt_ma[i]);
+			leftAlignVariant(variants_[i], reference);
 		}
-		variant->setObs(alt);
 	}
 
 	//by shifting all indels to the left, we might have produced duplicates - remove them
@@ -289,8 +289,8 @@ public:
 	///Removes all variants.
 	void clearVariants();
 
-    ///Shifts each non complex insert or deletion to the left as far as possible. Then, removes duplicates.
-    void leftAlign(QString ref_file);
+    ///Shifts each non complex insert or deletion to the left as far as possible. Then, removes duplicates. If @p threads is bigger than 1, chunks of variants are processed in parallel (if the reference genome can be memory-mapped).
+    void leftAlign(QString ref_file, int threads = 1);
 
     ///Checks if the variants are valid. Throws ArgumentException if not. The @p action string is appended to the error message after ', while'.
     void checkValid(QString action) const;
@@ -0,0 +1,384 @@
+#include "VcfExternalSort.h"
+#include "BgzfFileStream.h"
+#include "Chromosome.h"
+#include "Exceptions.h"
+#include "Helper.h"
+#include <QAtomicInt>
+#include <QFile>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QVector>
+#include <algorithm>
+
+///Variant line of a run (the text is stored in the run data).
+struct VcfSortLine
+{
+	int chr;
+	int pos;
+	int offset;
+	int length;
+
+	bool operator<(const VcfSortLine& rhs) const
+	{
+		if (chr!=rhs.chr) return chr<rhs.chr;
+		return pos<rhs.pos;
+	}
+};
+
+///Sorted run of variant lines.
+struct VcfSortRun
+{
+	QByteArray data;
+	QVector<VcfSortLine> lines;
+	QString filename;
+	QString error;
+	QAtomicInt done;
+
+	///Returns the memory allocated by the run (capacity, not size).
+	qint64 memoryUsage() const
+	{
+		return data.capacity() + (qint64)lines.capacity() * sizeof(VcfSortLine);
+	}
+	///Appends a line. Returns 'false' without appending if the run is not empty and the allocated memory would exceed @p max_memory.
+	bool append(const QByteArray& line, const VcfSortLine& key, qint64 max_memory)
+	{
+		//buffers grow in steps of 1/16 of the budget, so that the allocated memory does not exceed the budget
+		qint64 step = std::max(max_memory / 16, 65536ll);
+		if (data.size() + line.size() > data.capacity())
+		{
+			qint64 capacity = data.capacity() + std::max(step, (qint64)line.size());
+			if (!lines.isEmpty() && capacity + (qint64)lines.capacity() * sizeof(VcfSortLine) > max_memory) return false;
+			data.reserve((int)capacity);
+		}
+		if (lines.count()==lines.capacity())
+		{
+			qint64 capacity = lines.capacity() + step / (qint64)sizeof(VcfSortLine);
+			if (!lines.isEmpty() && data.capacity() + capacity * sizeof(VcfSortLine) > max_memory) return false;
+			lines.reserve((int)capacity);
+		}
+
+		VcfSortLine sort_line = key;
+		sort_line.offset = data.size();
+		sort_line.length = line.size();
+		data.append(line);
+		lines.append(sort_line);
+		return true;
+	}
+	///Sorts the lines (stable, i.e. lines with the same position keep their order).
+	void sort()
+	{
+		std::stable_sort(lines.begin(), lines.end());
+	}
+};
+
+///Worker that sorts a run and writes it to a temporary file.
+class VcfSortRunWorker
+	: public QRunnable
+{
+public:
+	VcfSortRunWorker(VcfSortRun& run, QSemaphore& free_threads)
+		: QRunnable()
+		, run_(run)
+		, free_threads_(free_threads)
+	{
+	}
+
+	void run()
+	{
+		try
+		{
+			run_.sort();
+			BgzfOutfileStream out(run_.filename);
+			foreach(const VcfSortLine& line, run_.lines)
+			{
+				out.write(run_.data.constData() + line.offset, line.length);
+			}
+			out.close();
+		}
+		catch(Exception& e)
+		{
+			run_.error = e.message();
+		}
+
+		//release memory
+		run_.data.clear();
+		run_.data.squeeze();
+		run_.lines.clear();
+		run_.lines.squeeze();
+
+		run_.done = 1;
+		free_threads_.release();
+	}
+
+protected:
+	VcfSortRun& run_;
+	QSemaphore& free_threads_;
+};
+
+///Line reader for run files.
+class VcfSortRunReader
+{
+public:
+	VcfSortRunReader(QString filename)
+		: stream_(filename)
+		, buffer_()
+		, pos_(0)
+	{
+	}
+
+	///Reads the next line (including the newline). Returns 'false' at the end of the file.
+	bool readLine(QByteArray& line)
+	{
+		int end = buffer_.indexOf('\n', pos_);
+		while (end==-1 && !stream_.atEnd())
+		{
+			buffer_.remove(0, pos_);
+			pos_ = 0;
+			int size = buffer_.size();
+			buffer_.resize(size + BUFFER_SIZE);
+			int read = stream_.read(buffer_.data() + size, BUFFER_SIZE);
+			buffer_.resize(size + read);
+			end = buffer_.indexOf('\n', size);
+		}
+		if (end==-1) end = buffer_.size()-1;
+		if (pos_>end) return false;
+
+		line = buffer_.mid(pos_, end - pos_ + 1);
+		pos_ = end + 1;
+		return true;
+	}
+
+protected:
+	BgzfInfileStream stream_;
+	QByteArray buffer_;
+	int pos_;
+
+	static const int BUFFER_SIZE = 1048576;
+};
+
+VcfExternalSort::VcfExternalSort(QString fai, int max_memory_mb, int threads)
+	: max_memory_(1024ll * 1024ll * max_memory_mb)
+	, threads_(std::max(1, threads))
+	, use_fai_(!fai.isEmpty())
+	, fai_rank_()
+	, chr_rank_()
+	, runs_()
+	, run_count_(0)
+	, temp_files_()
+	, pool_()
+	, free_threads_(threads_)
+{
+	pool_.setMaxThreadCount(threads_);
+
+	//determine chromosome rank from FASTA index file (rank=position in file)
+	if (use_fai_)
+	{
+		QStringList lines = Helper::loadTextFile(fai, true, '~', true);
+		int rank = 0;
+		foreach(QString line, lines)
+		{
+			++rank;
+			Chromosome chr(line.split('\t')[0]);
+			fai_rank_[chr.num()] = rank;
+		}
+	}
+}
+
+VcfExternalSort::~VcfExternalSort()
+{
+	clearRuns();
+}
+
+void VcfExternalSort::sort(QString in, QString out)
+{
+	clearRuns();
+	run_count_ = 0;
+
+	//each pending run and the run that is filled get the same share of the memory budget (runs are limited to 1GB because of the 32-bit line offsets)
+	qint64 max_run_memory = std::min(max_memory_ / (threads_ + 1), (qint64)MAX_RUN_MEMORY);
+
+	//read input and create runs
+	QByteArray header;
+	QSharedPointer<VcfSortRun> run(new VcfSortRun());
+	QSharedPointer<QFile> in_p = Helper::openFileForReading(in, true);
+	while(!in_p->atEnd())
+	{
+		QByteArray line = in_p->readLine();
+		if (!line.endsWith('\n')) line += '\n';
+
+		//skip empty lines
+		if (line.trimmed().isEmpty()) continue;
+
+		//keep headers/comments unchanged
+		if (line.startsWith('#'))
+		{
+			header.append(line);
+			continue;
+		}
+
+		VcfSortLine sort_line;
+		parseKey(line, sort_line.chr, sort_line.pos);
+		if (!run->append(line, sort_line, max_run_memory))
+		{
+			spill(run);
+			run = QSharedPointer<VcfSortRun>(new VcfSortRun());
+			run->append(line, sort_line, max_run_memory);
+		}
+	}
+	in_p->close();
+
+	//open output stream
+	QSharedPointer<QFile> out_p = Helper::openFileForWriting(out, true);
+	out_p->write(header);
+
+	//input fits into memory > no temporary files needed
+	if (runs_.isEmpty())
+	{
+		run->sort();
+		foreach(const VcfSortLine& line, run->lines)
+		{
+			out_p->write(run->data.constData() + line.offset, line.length);
+		}
+		return;
+	}
+
+	//write last run and wait for all runs
+	if (!run->lines.isEmpty()) spill(run);
+	run.clear();
+	pool_.waitForDone();
+	checkRuns();
+
+	//merge runs (in several passes if there are too many runs to open them at once)
+	QStringList files;
+	foreach(const QSharedPointer<VcfSortRun>& r, runs_)
+	{
+		files << r->filename;
+	}
+	while (files.count()>MAX_MERGE_RUNS)
+	{
+		QStringList merged;
+		for (int i=0; i<files.count(); i+=MAX_MERGE_RUNS)
+		{
+			QString filename = Helper::tempFileName(".vcf.gz");
+			temp_files_ << filename;
+			BgzfOutfileStream merge_out(filename, threads_);
+			merge(files.mid(i, MAX_MERGE_RUNS), 0, &merge_out);
+			merge_out.close();
+			merged << filename;
+
+			//remove merged files to save disk space
+			foreach(QString file, files.mid(i, MAX_MERGE_RUNS))
+			{
+				QFile::remove(file);
+			}
+		}
+		files = merged;
+	}
+	merge(files, out_p.data(), 0);
+	clearRuns();
+}
+
+void VcfExternalSort::merge(const QStringList& files, QFile* out, BgzfOutfileStream* bgzf_out)
+{
+	QList<QSharedPointer<VcfSortRunReader> > readers;
+	QVector<QByteArray> heads(files.count());
+	QVector<VcfSortLine> keys(files.count());
+	QVector<bool> valid(files.count());
+	for (int i=0; i<files.count(); ++i)
+	{
+		readers << QSharedPointer<VcfSortRunReader>(new VcfSortRunReader(files[i]));
+		valid[i] = readers[i]->readLine(heads[i]);
+		if (valid[i]) parseKey(heads[i], keys[i].chr, keys[i].pos);
+	}
+	while (true)
+	{
+		//determine run with the smallest line (the first run on ties, which keeps the input order)
+		int best = -1;
+		for (int i=0; i<files.count(); ++i)
+		{
+			if (!valid[i]) continue;
+			if (best==-1 || keys[i]<keys[best]) best = i;
+		}
+		if (best==-1) break;
+
+		//write line and advance run
+		if (out!=0) out->write(heads[best]);
+		if (bgzf_out!=0) bgzf_out->write(heads[best].constData(), heads[best].size());
+		valid[best] = readers[best]->readLine(heads[best]);
+		if (valid[best]) parseKey(heads[best], keys[best].chr, keys[best].pos);
+	}
+}
+
+int VcfExternalSort::chrRank(const QByteArray& chr)
+{
+	QHash<QByteArray, int>::const_iterator it = chr_rank_.find(chr);
+	if (it!=chr_rank_.end()) return it.value();
+
+	Chromosome chr_obj(chr);
+	int rank = chr_obj.num();
+	if (use_fai_)
+	{
+		if (!fai_rank_.contains(chr_obj.num()))
+		{
+			THROW(FileParseException, "Reference file for sorting does not contain chromosome '" + chr_obj.str() + "'!");
+		}
+		rank = fai_rank_[chr_obj.num()];
+	}
+	chr_rank_[chr] = rank;
+
+	return rank;
+}
+
+void VcfExternalSort::parseKey(const QByteArray& line, int& chr, int& pos)
+{
+	int tab1 = line.indexOf('\t');
+	int tab2 = line.indexOf('\t', tab1+1);
+	if (tab1==-1 || tab2==-1)
+	{
+		THROW(FileParseException, "VCF line with less than three fields found: '" + line.trimmed() + "'");
+	}
+
+	chr = chrRank(line.left(tab1));
+	pos = Helper::toInt(line.mid(tab1+1, tab2-tab1-1), "chromosomal position", line.trimmed());
+}
+
+void VcfExternalSort::spill(QSharedPointer<VcfSortRun> run)
+{
+	//wait for a free thread to limit the memory used by pending runs
+	free_threads_.acquire();
+	checkRuns();
+
+	run->filename = Helper::tempFileName(".vcf.gz");
+	run->done = 0;
+	runs_ << run;
+	++run_count_;
+	pool_.start(new VcfSortRunWorker(*run, free_threads_));
+}
+
+void VcfExternalSort::checkRuns()
+{
+	foreach(const QSharedPointer<VcfSortRun>& run, runs_)
+	{
+		if (run->done.load()==1 && !run->error.isEmpty())
+		{
+			QString error = run->error;
+			clearRuns();
+			THROW(Exception, "Writing temporary file of VCF sort failed: " + error);
+		}
+	}
+}
+
+void VcfExternalSort::clearRuns()
+{
+	pool_.waitForDone();
+	foreach(const QSharedPointer<VcfSortRun>& run, runs_)
+	{
+		QFile::remove(run->filename);
+	}
+	runs_.clear();
+	foreach(QString filename, temp_files_)
+	{
+		QFile::remove(filename);
+	}
+	temp_files_.clear();
+}
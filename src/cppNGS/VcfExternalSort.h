@@ -0,0 +1,79 @@
+#ifndef VCFEXTERNALSORT_H
+#define VCFEXTERNALSORT_H
+
+#include "cppNGS_global.h"
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QSemaphore>
+
+struct VcfSortRun;
+class BgzfOutfileStream;
+class QFile;
+
+/**
+  @brief External merge sort of VCF files according to chromosome and position.
+
+  Variant lines are collected in runs until the memory budget is exhausted.
+  Each run is sorted and written to a BGZF-compressed temporary file (in parallel if several threads are used).
+  Finally, the runs are merged (in several passes if there are more runs than can be opened at once).
+  If the input fits into one run, it is sorted in memory without temporary files.
+  Header lines are written unchanged. Variant lines with the same chromosome and position keep their input order.
+*/
+class CPPNGSSHARED_EXPORT VcfExternalSort
+{
+public:
+	///Constructor. The chromosome order is taken from the FASTA index file @p fai. If it is empty, chromosomes are sorted numerically like in VariantList::sort.
+	VcfExternalSort(QString fai = "", int max_memory_mb = 1000, int threads = 1);
+	///Destructor - removes temporary files.
+	~VcfExternalSort();
+
+	///Sorts the VCF file @p in and writes the result to @p out. If a file name is empty, STDIN/STDOUT is used.
+	void sort(QString in, QString out);
+
+	///Returns the number of runs written to temporary files during the last call of sort().
+	int runCount() const
+	{
+		return run_count_;
+	}
+
+protected:
+	qint64 max_memory_;
+	int threads_;
+	bool use_fai_;
+	QHash<int, int> fai_rank_;
+	QHash<QByteArray, int> chr_rank_;
+	QList<QSharedPointer<VcfSortRun> > runs_;
+	int run_count_;
+	QStringList temp_files_;
+	QThreadPool pool_;
+	QSemaphore free_threads_;
+
+	///Returns the sort rank of a chromosome.
+	int chrRank(const QByteArray& chr);
+	///Determines chromosome rank and position of a variant line.
+	void parseKey(const QByteArray& line, int& chr, int& pos);
+	///Starts sorting and writing a run in the background. Waits if all threads are busy with other runs.
+	void spill(QSharedPointer<VcfSortRun> run);
+	///Throws an exception if writing a run failed.
+	void checkRuns();
+	///Merges sorted run files into @p out or @p bgzf_out (the other one is null).
+	void merge(const QStringList& files, QFile* out, BgzfOutfileStream* bgzf_out);
+	///Removes temporary files.
+	void clearRuns();
+
+	///Maximum number of runs that are merged at once.
+	static const int MAX_MERGE_RUNS = 64;
+	///Maximum memory of a run in bytes (line offsets in the run data are 32-bit).
+	static const qint64 MAX_RUN_MEMORY = 1024ll * 1024ll * 1024ll;
+
+	//declared away methods
+	VcfExternalSort(const VcfExternalSort&);
+	VcfExternalSort& operator=(const VcfExternalSort&);
+};
+
+#endif // VCFEXTERNALSORT_H
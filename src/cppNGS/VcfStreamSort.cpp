@@ -0,0 +1,168 @@
+#include "VcfStreamSort.h"
+#include "Exceptions.h"
+#include "Helper.h"
+#include <QFile>
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <QSharedPointer>
+#include <QVector>
+#include <algorithm>
+#include <limits>
+
+///Cached VCF line.
+struct VcfStreamSortLine
+{
+	int pos;
+	qint64 index; //line number (used to order lines with the same position)
+	QByteArray line;
+};
+
+///Heap comparator: smallest position first. Lines with the same position are written in reverse input order (as with the former QMap cache).
+static bool cachedLineGreater(const VcfStreamSortLine& a, const VcfStreamSortLine& b)
+{
+	if (a.pos!=b.pos) return a.pos>b.pos;
+	return a.index<b.index;
+}
+
+///Removes the line with the smallest position from the heap and returns it.
+static VcfStreamSortLine takeFirst(QVector<VcfStreamSortLine>& heap)
+{
+	std::pop_heap(heap.begin(), heap.end(), cachedLineGreater);
+	VcfStreamSortLine output = heap.last();
+	heap.removeLast();
+	return output;
+}
+
+///Comparator for running maxima (by position).
+static bool secondLess(const QPair<qint64, int>& a, const QPair<qint64, int>& b)
+{
+	return a.second < b.second;
+}
+
+VcfStreamSort::VcfStreamSort(int n, int max_memory_mb)
+	: n_(n)
+	, max_memory_(1024ll * 1024ll * max_memory_mb)
+	, cache_size_(n)
+{
+}
+
+void VcfStreamSort::sort(QString in, QString out)
+{
+	//init
+	QVector<VcfStreamSortLine> heap;
+	int n = n_;
+	qint64 mem = 0;
+
+	QByteArray last_chr;
+	int last_pos_written = -1;
+	QSet<QByteArray> chr_done;
+	qint64 index = 0;
+
+	//running maxima of the position (line number and position) used to determine how far variants are apart
+	QList<QPair<qint64, int> > maxima;
+
+	//open input/output streams
+	if(in!="" && in==out)
+	{
+		THROW(ArgumentException, "Input and output files must be different when streaming!");
+	}
+	QSharedPointer<QFile> in_p = Helper::openFileForReading(in, true);
+	QSharedPointer<QFile> out_p = Helper::openFileForWriting(out, true);
+
+	while(!in_p->atEnd())
+	{
+		QByteArray line = in_p->readLine();
+		if (!line.endsWith('\n')) line += '\n';
+
+		//skip empty lines
+		if (line.trimmed().isEmpty()) continue;
+
+		//write out headers/comments unchanged
+		if (line.startsWith('#'))
+		{
+			out_p->write(line);
+			continue;
+		}
+
+		int tab1 = line.indexOf('\t');
+		int tab2 = line.indexOf('\t', tab1+1);
+
+		QByteArray chr = line.left(tab1);
+		int pos = Helper::toInt(line.mid(tab1, tab2-tab1), "chromosomal position");
+
+		//handle new chromosome
+		if (chr!=last_chr)
+		{
+			//flush lines
+			while (!heap.isEmpty())
+			{
+				out_p->write(takeFirst(heap).line);
+			}
+			mem = 0;
+			last_pos_written = -1;
+			maxima.clear();
+
+			//check chromosome done
+			if (chr_done.contains(chr))
+			{
+				THROW(FileParseException, "Variants in input are not grouped according to chromosome. Found chromosome '" + chr + "' twice!");
+			}
+
+			//mark chromosome done
+			chr_done.insert(chr);
+
+			//set last chromosome
+			last_chr = chr;
+		}
+
+		//check position
+		if (pos<last_pos_written)
+		{
+			THROW(FileParseException, "Variants in input could not be sorted with given cache size and memory limit! Positions " + QString::number(pos) + " and " + QString::number(last_pos_written) + " are too far apart on chromosome '" + chr + "'!");
+		}
+
+		//grow cache if the variant is further apart from the variants with bigger position than the cache size
+		if (maxima.isEmpty() || pos>maxima.last().second)
+		{
+			maxima.append(qMakePair(index, pos));
+		}
+		else if (pos<maxima.last().second)
+		{
+			QList<QPair<qint64, int> >::const_iterator it = std::upper_bound(maxima.constBegin(), maxima.constEnd(), qMakePair(std::numeric_limits<qint64>::max(), pos), secondLess);
+			qint64 distance = index - it->first;
+			if (distance*2>n)
+			{
+				n = (int)std::min(distance*2, (qint64)std::numeric_limits<int>::max());
+			}
+		}
+		while (maxima.count()>1 && maxima.first().first<index-n)
+		{
+			maxima.removeFirst();
+		}
+
+		//insert line
+		mem += line.capacity() + sizeof(VcfStreamSortLine);
+		VcfStreamSortLine cached = { pos, index, line };
+		heap.append(cached);
+		std::push_heap(heap.begin(), heap.end(), cachedLineGreater);
+		++index;
+
+		//write overflow lines
+		while (heap.count()>n || (mem>max_memory_ && !heap.isEmpty()))
+		{
+			VcfStreamSortLine first = takeFirst(heap);
+			out_p->write(first.line);
+			mem -= first.line.capacity() + sizeof(VcfStreamSortLine);
+			last_pos_written = first.pos;
+		}
+	}
+
+	//flush lines
+	while (!heap.isEmpty())
+	{
+		out_p->write(takeFirst(heap).line);
+	}
+
+	cache_size_ = n;
+}
@@ -0,0 +1,39 @@
+#ifndef VCFSTREAMSORT_H
+#define VCFSTREAMSORT_H
+
+#include "cppNGS_global.h"
+#include <QString>
+
+/**
+  @brief Sorts VCF files according to position using a stream. Variants must be grouped by chromosome.
+
+  Variant lines are kept in a cache (binary heap) and the line with the smallest position is written when the cache is full.
+  The cache size is a starting value. It grows if variants are further out of order than half the cache size, up to the memory limit.
+  Header lines are written unchanged.
+*/
+class CPPNGSSHARED_EXPORT VcfStreamSort
+{
+public:
+	///Constructor. @p n is the initial number of cached variants, @p max_memory_mb the maximum memory used for caching variants.
+	VcfStreamSort(int n = 10000, int max_memory_mb = 1000);
+
+	///Sorts the VCF file @p in and writes the result to @p out. If a file name is empty, STDIN/STDOUT is used. Throws FileParseException if variants are too far out of order.
+	void sort(QString in, QString out);
+
+	///Returns the cache size reached during the last call of sort().
+	int cacheSize() const
+	{
+		return cache_size_;
+	}
+
+protected:
+	int n_;
+	qint64 max_memory_;
+	int cache_size_;
+
+	//declared away methods
+	VcfStreamSort(const VcfStreamSort&);
+	VcfStreamSort& operator=(const VcfStreamSort&);
+};
+
+#endif // VCFSTREAMSORT_H
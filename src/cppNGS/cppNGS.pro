@@ -51,7 +51,19 @@ SOURCES += BedFile.cpp \
     CnvList.cpp \
     LovdUploadFile.cpp \
     Phenotype.cpp \
-    Transcript.cpp
+    Transcript.cpp \
+    BamMateCache.cpp \
+    BgzfFileStream.cpp \
+    BamFileStream.cpp \
+    BamIndexFile.cpp \
+    CoverageFile.cpp \
+    VcfExternalSort.cpp \
+    BedChunkRunner.cpp \
+    KmerCounter.cpp \
+    Profiler.cpp \
+    BedFileStream.cpp \
+    ReadIdIndex.cpp \
+    VcfStreamSort.cpp
 
 HEADERS += BedFile.h \
 	Chromosome.h \
@@ -73,7 +85,19 @@ HEADERS += BedFile.h \
     CnvList.h \
     LovdUploadFile.h \
     Phenotype.h \
-    Transcript.h
+    Transcript.h \
+    BamMateCache.h \
+    BgzfFileStream.h \
+    BamFileStream.h \
+    BamIndexFile.h \
+    CoverageFile.h \
+    VcfExternalSort.h \
+    BedChunkRunner.h \
+    KmerCounter.h \
+    Profiler.h \
+    BedFileStream.h \
+    ReadIdIndex.h \
+    VcfStreamSort.h
 
 
 RESOURCES += \
@@ -4,8 +4,14 @@
 #include "Log.h"
 #include "Settings.h"
 #include "ChromosomalIndex.h"
+#include "Profiler.h"
 #include <QFileInfo>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
 #include <QPair>
+#include <QStandardPaths>
 
 NGSD::NGSD(bool test_db)
 	: test_db_(test_db)
@@ -536,41 +542,30 @@ void NGSD::annotate(VariantList& variants, QString filename)
 	int comment_idx = variants.annotationIndexByName("comment", true, false);
 	int gene_idx = variants.annotationIndexByName("gene", true, false);
 	int geneinfo_idx = variants.addAnnotation("gene_info", "Gene information from NGSD (inheritance mode, ExAC pLI score).");
-	/*
-	//Timing benchmarks
-	//Outcome for Qt 5.5.0:
+
+	//(re-)annotate the variants (the time of each step is written to the run-time profile, see Profiler)
+	//Outcome of timing benchmarks for Qt 5.5.0:
 	// - Prepared queries take about twice as long
 	// - Setting the query to forward-only has no effect
-	QTime timer;
-	timer.start();
-	long long time_cl = 0;
-	long long time_dv = 0;
-	long long time_vv = 0;
-	long long time_vvo = 0;
-	long long time_co = 0;
-	long long time_gt = 0;
-	*/
-
-	//(re-)annotate the variants
 	SqlQuery query = getQuery();
 	for (int i=0; i<variants.count(); ++i)
 	{
 		//variant id
+		ProfilerTimer timer("NGSD::annotate variant id");
 		Variant& v = variants[i];
 		QByteArray v_id = variantId(v, false).toLatin1();
 
 		//variant classification
-		//timer.restart();
+		timer.restart("NGSD::annotate classification");
 		QVariant classification = getValue("SELECT class FROM variant_classification WHERE variant_id='" + v_id + "'", true);
 		if (!classification.isNull())
 		{
 			v.annotations()[class_idx] = classification.toByteArray().replace("n/a", "");
 			v.annotations()[clacom_idx] = getValue("SELECT comment FROM variant_classification WHERE variant_id='" + v_id + "'", true).toByteArray().replace("\n", " ").replace("\t", " ");
 		}
-		//time_cl += timer.elapsed();
 
 		//detected variant infos
-		//timer.restart();
+		timer.restart("NGSD::annotate detected variant");
 		int dv_id = -1;
 		QByteArray comment = "";
 		if (found_in_db)
@@ -583,10 +578,9 @@ void NGSD::annotate(VariantList& variants, QString filename)
 				comment = query.value(1).toByteArray();
 			}
 		}
-		//time_dv += timer.elapsed();
 
 		//validation info
-		//timer.restart();
+		timer.restart("NGSD::annotate validation");
 		int vv_id = -1;
 		QByteArray val_status = "";
 		if (found_in_db)
@@ -599,10 +593,9 @@ void NGSD::annotate(VariantList& variants, QString filename)
 				val_status = query.value(1).toByteArray().replace("n/a", "");
 			}
 		}
-		//time_vv += timer.elapsed();
 
 		//validation info other samples
-		//timer.restart();
+		timer.restart("NGSD::annotate validation other samples");
 		int tps = 0;
 		int fps = 0;
 		query.exec("SELECT id, status FROM variant_validation WHERE variant_id='"+v_id+"' AND status!='n/a'");
@@ -617,10 +610,9 @@ void NGSD::annotate(VariantList& variants, QString filename)
 			if (val_status=="") val_status = "n/a";
 			val_status += " (" + QByteArray::number(tps) + "xTP, " + QByteArray::number(fps) + "xFP)";
 		}
-		//time_vvo += timer.elapsed();
 
 		//comments other samples
-		//timer.restart();
+		timer.restart("NGSD::annotate comments other samples");
 		QList<QByteArray> comments;
 		query.exec("SELECT id, comment FROM detected_variant WHERE variant_id='"+v_id+"' AND comment IS NOT NULL");
 		while(query.next())
@@ -643,10 +635,9 @@ void NGSD::annotate(VariantList& variants, QString filename)
 			}
 			comment += ")";
 		}
-		//time_co += timer.elapsed();
 
 		//genotype counts
-		//timer.restart();
+		timer.restart("NGSD::annotate genotype counts");
 		int allsys_hom_count = 0;
 		int allsys_het_count = 0;
 		QSet<int> s_ids_done;
@@ -672,7 +663,6 @@ void NGSD::annotate(VariantList& variants, QString filename)
 				++allsys_het_count;
 			}
 		}
-		//qDebug() << (v.isSNV() ? "S" : "I") << query.size() << t_v << t_dv << t_val << t_com << timer.elapsed();
 
 		v.annotations()[ihdb_all_hom_idx] = QByteArray::number(allsys_hom_count);
 		v.annotations()[ihdb_all_het_idx] = QByteArray::number(allsys_het_count);
@@ -686,9 +676,9 @@ void NGSD::annotate(VariantList& variants, QString filename)
 			v.annotations()[valid_idx] = "n/a";
 			v.annotations()[comment_idx] = "n/a";
 		}
-		//time_gt += timer.elapsed();
 
 		//gene info
+		timer.restart("NGSD::annotate gene info");
 		if (gene_idx!=-1)
 		{
 			//TODO: use QByteArrayList (when upgraded to Qt5.5)
@@ -699,15 +689,7 @@ void NGSD::annotate(VariantList& variants, QString filename)
 
 		emit updateProgress(100*i/variants.count());
 	}
-
-	/*
-	qDebug() << "class   : " << time_cl;
-	qDebug() << "det. var: " << time_dv;
-	qDebug() << "val     : " << time_vv;
-	qDebug() << "val oth : " << time_vvo;
-	qDebug() << "comment : " << time_co;
-	qDebug() << "counts  : " << time_gt;
-	*/
+	Profiler::addCount("NGSD::annotate variants", variants.count());
 }
 
 void NGSD::annotateSomatic(VariantList& variants, QString filename)
@@ -1183,18 +1165,12 @@ QStringList NGSD::phenotypeToGenes(QString phenotype, bool recursive)
 
 QStringList NGSD::genesOverlapping(const Chromosome& chr, int start, int end, int extend)
 {
-	//init static data (load gene regions file from NGSD to memory)
+	//init static data (load gene regions file from NGSD or from the disk cache to memory)
 	static BedFile bed;
 	static ChromosomalIndex<BedFile> index(bed);
 	if (bed.count()==0)
 	{
-		SqlQuery query = getQuery();
-		query.exec("SELECT DISTINCT g.symbol, g.chromosome, gt.start_coding, gt.end_coding FROM gene g, gene_transcript gt WHERE g.id=gt.gene_id AND gt.start_coding IS NOT NULL AND gt.end_coding IS NOT NULL");
-		while(query.next())
-		{
-			bed.append(BedLine(query.value(1).toString(), query.value(2).toInt(), query.value(3).toInt(), QStringList() << query.value(0).toString()));
-		}
-		bed.sort();
+		loadGeneRegions(bed, "gene", "SELECT DISTINCT g.symbol, g.chromosome, gt.start_coding, gt.end_coding FROM gene g, gene_transcript gt WHERE g.id=gt.gene_id AND gt.start_coding IS NOT NULL AND gt.end_coding IS NOT NULL");
 		index.createIndex();
 	}
 
@@ -1213,18 +1189,12 @@ QStringList NGSD::genesOverlapping(const Chromosome& chr, int start, int end, in
 
 QStringList NGSD::genesOverlappingByExon(const Chromosome& chr, int start, int end, int extend)
 {
-	//init static data (load gene regions file from NGSD to memory)
+	//init static data (load gene regions file from NGSD or from the disk cache to memory)
 	static BedFile bed;
 	static ChromosomalIndex<BedFile> index(bed);
 	if (bed.count()==0)
 	{
-		SqlQuery query = getQuery();
-		query.exec("SELECT DISTINCT g.symbol, g.chromosome, ge.start, ge.end FROM gene g, gene_exon ge, gene_transcript gt WHERE g.type='protein-coding gene' AND ge.transcript_id=gt.id AND gt.gene_id=g.id");
-		while(query.next())
-		{
-			bed.append(BedLine(query.value(1).toString(), query.value(2).toInt(), query.value(3).toInt(), QStringList() << query.value(0).toString()));
-		}
-		bed.sort();
+		loadGeneRegions(bed, "exon", "SELECT DISTINCT g.symbol, g.chromosome, ge.start, ge.end FROM gene g, gene_exon ge, gene_transcript gt WHERE g.type='protein-coding gene' AND ge.transcript_id=gt.id AND gt.gene_id=g.id");
 		index.createIndex();
 	}
 
@@ -1241,6 +1211,108 @@ QStringList NGSD::genesOverlappingByExon(const Chromosome& chr, int start, int e
 	return genes;
 }
 
+void NGSD::loadGeneRegions(BedFile& bed, QString type, QString query_str)
+{
+	//the cache key consists of the database/query and the version of the gene tables
+	QStringList tables;
+	tables << "gene" << "gene_transcript";
+	if (type=="exon") tables << "gene_exon";
+	QByteArray source = (db_->hostName() + "\t" + QString::number(db_->port()) + "\t" + db_->databaseName() + "\t" + query_str).toLatin1();
+	QByteArray version = geneTablesVersion(tables);
+
+	//cache files are stored in a folder of the current user that is not accessible for other users
+	QString cache_file;
+	QString cache_prefix;
+	QString cache_dir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+	if (!cache_dir.isEmpty()) cache_dir += "/ngs-bits/";
+	if (!version.isEmpty() && !cache_dir.isEmpty() && QDir().mkpath(cache_dir) && QFile::setPermissions(cache_dir, QFile::ReadOwner|QFile::WriteOwner|QFile::ExeOwner))
+	{
+		cache_prefix = "ngsd_gene_regions_" + type + "_" + QCryptographicHash::hash(source, QCryptographicHash::Md5).toHex() + "_";
+		cache_file = cache_dir + cache_prefix + QCryptographicHash::hash(version, QCryptographicHash::Md5).toHex() + ".bed";
+	}
+
+	//load from cache
+	if (!cache_file.isEmpty() && QFile::exists(cache_file))
+	{
+		try
+		{
+			bed.load(cache_file);
+			return;
+		}
+		catch(Exception& e)
+		{
+			Log::warn("Could not load NGSD gene region cache file: " + e.message());
+			bed.clear();
+		}
+	}
+
+	//load from NGSD
+	SqlQuery query = getQuery();
+	query.exec(query_str);
+	while(query.next())
+	{
+		bed.append(BedLine(query.value(1).toString(), query.value(2).toInt(), query.value(3).toInt(), QStringList() << query.value(0).toString()));
+	}
+	bed.sort();
+	if (cache_file.isEmpty()) return;
+
+	//remove outdated cache files of the same database and query (caches of other databases stay valid)
+	foreach(QString file, QDir(cache_dir).entryList(QStringList() << cache_prefix + "*.bed", QDir::Files))
+	{
+		QFile::remove(cache_dir + file);
+	}
+
+	//store cache (a temporary file is renamed, so that other processes never read a partial cache file)
+	QString tmp_file = cache_file + "." + QString::number(QCoreApplication::applicationPid()) + ".tmp";
+	try
+	{
+		bed.store(tmp_file);
+		if (!QFile::rename(tmp_file, cache_file))
+		{
+			QFile::remove(tmp_file);
+		}
+	}
+	catch(Exception& e)
+	{
+		QFile::remove(tmp_file);
+		Log::warn("Could not store NGSD gene region cache file: " + e.message());
+	}
+}
+
+QByteArray NGSD::geneTablesVersion(QStringList tables)
+{
+	//table metadata: the import tools clear the tables and insert new rows, which increases the AUTO_INCREMENT value (gene_exon has no ID, but is only imported together with gene_transcript). Re-created tables have a new creation time.
+	QByteArray output;
+	bool complete = true;
+	SqlQuery status = getQuery();
+	status.exec("SELECT TABLE_NAME, AUTO_INCREMENT, CREATE_TIME, UPDATE_TIME FROM information_schema.TABLES WHERE TABLE_SCHEMA=DATABASE() AND TABLE_NAME IN ('" + tables.join("', '") + "') ORDER BY TABLE_NAME");
+	int count = 0;
+	while(status.next())
+	{
+		++count;
+		QString table = status.value(0).toString();
+		if (table!="gene_exon" && status.value(1).isNull()) complete = false;
+
+		//update time is only available for InnoDB tables in MySQL 5.7 or newer and is reset when the server is restarted
+		output += "\t" + table.toLatin1() + "=" + status.value(1).toString().toLatin1() + "/" + status.value(2).toDateTime().toString(Qt::ISODate).toLatin1() + "/" + status.value(3).toDateTime().toString(Qt::ISODate).toLatin1();
+	}
+	if (complete && count==tables.count()) return output;
+
+	//fallback: content checksums (slow, because all rows of the tables are read)
+	output.clear();
+	SqlQuery checksum = getQuery();
+	checksum.exec("CHECKSUM TABLE " + tables.join(", "));
+	while(checksum.next())
+	{
+		//checksum is NULL for missing tables > no caching
+		if (checksum.value(1).isNull()) return QByteArray();
+
+		output += "\t" + checksum.value(0).toString().toLatin1() + "=" + checksum.value(1).toString().toLatin1();
+	}
+
+	return output;
+}
+
 BedFile NGSD::genesToRegions(QStringList genes, Transcript::SOURCE source, QString mode, bool fallback, QTextStream* messages)
 {
 	QString source_str = Transcript::sourceToString(source);
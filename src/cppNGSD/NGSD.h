@@ -210,6 +210,10 @@ signals:
 protected:
 	///Copy constructor "declared away".
 	NGSD(const NGSD&);
+	///Loads gene regions (gene symbol as first annotation) with the given query. The regions are cached in the user cache folder (keyed by the version of the gene tables), so that following tool calls do not have to query the database again.
+	void loadGeneRegions(BedFile& bed, QString type, QString query_str);
+	///Returns a version string of the given tables that changes when the tables are re-imported. Uses the table metadata and falls back to the content checksums. Returns an empty string if the tables do not exist.
+	QByteArray geneTablesVersion(QStringList tables);
 
 	///The database adapter
 	QSharedPointer<QSqlDatabase> db_;
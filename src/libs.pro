@@ -4,6 +4,7 @@ SUBDIRS =   cppCORE \
             cppXML \
             cppNGS \
             cppNGS-TEST \
+            cppNGS-BENCH \
             cppNGSD \
             cppNGSD-TEST
 
@@ -11,6 +12,7 @@ cppCORE-TEST.depends = cppCORE
 cppXML.depends = cppCORE
 cppNGS.depends = cppXML
 cppNGS-TEST.depends = cppNGS
+cppNGS-BENCH.depends = cppNGS
 cppNGSD.depends = cppNGS
 cppNGSD-TEST.depends = cppNGSD
 
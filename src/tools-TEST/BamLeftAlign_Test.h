@@ -15,5 +15,15 @@ private slots:
 		IS_TRUE(QFile::exists("out/BamLeftAlign_out1.bam"));
 		COMPARE_FILES("out/BamLeftAlign_Test_line14.log", TESTDATA("data_out/BamLeftAlign_out1.log"));
 	}
+
+	void test_02_threads()
+	{
+		QString ref_file = Settings::string("reference_genome");
+		if (ref_file=="") SKIP("Test needs the reference genome!");
+
+		EXECUTE("BamLeftAlign", "-in " + TESTDATA("data_in/BamLeftAlign_in1.bam") + " -out out/BamLeftAlign_out2.bam -ref " + ref_file + " -v -threads 4");
+		IS_TRUE(QFile::exists("out/BamLeftAlign_out2.bam"));
+		COMPARE_FILES("out/BamLeftAlign_Test_line24.log", TESTDATA("data_out/BamLeftAlign_out1.log"));
+	}
 	
 };
@@ -0,0 +1,27 @@
+#include "TestFramework.h"
+
+TEST_CLASS(BamToCoverage_Test)
+{
+Q_OBJECT
+private slots:
+
+	void low_coverage()
+	{
+		EXECUTE("BamToCoverage", "-in " + TESTDATA("../cppNGS-TEST/data_in/panel.bam") + " -out out/BamToCoverage_test01_out.cov");
+
+		//the coverage file must give the same results as the BAM file
+		EXECUTE("BedLowCoverage", "-in " + TESTDATA("../cppNGS-TEST/data_in/panel.bed") + " -bam out/BamToCoverage_test01_out.cov -out out/BamToCoverage_test01_out.bed -cutoff 20");
+		COMPARE_FILES("out/BamToCoverage_test01_out.bed", TESTDATA("data_out/BedLowCoverage_test01_out.bed"));
+		EXECUTE("BedLowCoverage", "-wgs -bam out/BamToCoverage_test01_out.cov -out out/BamToCoverage_test02_out.bed -cutoff 20");
+		COMPARE_FILES("out/BamToCoverage_test02_out.bed", TESTDATA("data_out/BedLowCoverage_test02_out.bed"));
+	}
+
+	void min_mapq0_avg_coverage()
+	{
+		EXECUTE("BamToCoverage", "-in " + TESTDATA("../cppNGS-TEST/data_in/panel.bam") + " -out out/panel.cov -min_mapq 0 -threads 2");
+
+		//the coverage file must give the same results as the BAM file in panel mode (the file name is used as column header)
+		EXECUTE("BedCoverage", "-in " + TESTDATA("../cppNGS-TEST/data_in/panel.bed") + " -bam out/panel.cov -out out/BamToCoverage_test03_out.tsv -min_mapq 0");
+		COMPARE_FILES("out/BamToCoverage_test03_out.tsv", TESTDATA("data_out/BedCoverage_test03_out.tsv"));
+	}
+};
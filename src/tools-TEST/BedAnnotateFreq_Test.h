@@ -10,5 +10,11 @@ private slots:
 		EXECUTE("BedAnnotateFreq", "-in " + TESTDATA("data_in/BedAnnotateFreq_in1.bed") + " -bam " + TESTDATA("../cppNGS-TEST/data_in/panel.bam") + " -out out/BedAnnotateFreq_test01_out.tsv");
 		COMPARE_FILES("out/BedAnnotateFreq_test01_out.tsv", TESTDATA("data_out/BedAnnotateFreq_test01_out.tsv"));
 	}
+
+	void test_02_multithreaded()
+	{
+		EXECUTE("BedAnnotateFreq", "-in " + TESTDATA("data_in/BedAnnotateFreq_in1.bed") + " -bam " + TESTDATA("../cppNGS-TEST/data_in/panel.bam") + " -out out/BedAnnotateFreq_test02_out.tsv -threads 2");
+		COMPARE_FILES("out/BedAnnotateFreq_test02_out.tsv", TESTDATA("data_out/BedAnnotateFreq_test01_out.tsv"));
+	}
 	
 };
@@ -22,4 +22,10 @@ private slots:
 		EXECUTE("BedCoverage", "-in " + TESTDATA("../cppNGS-TEST/data_in/panel.bed") + " -bam " + TESTDATA("../cppNGS-TEST/data_in/panel.bam") + " " + TESTDATA("../cppNGS-TEST/data_in/panel.bam") + " -out out/BedCoverage_test04_out.tsv");
 		COMPARE_FILES("out/BedCoverage_test04_out.tsv", TESTDATA("data_out/BedCoverage_test04_out.tsv"));
 	}
+
+	void two_input_files_multithreaded()
+	{
+		EXECUTE("BedCoverage", "-in " + TESTDATA("../cppNGS-TEST/data_in/panel.bed") + " -bam " + TESTDATA("../cppNGS-TEST/data_in/panel.bam") + " " + TESTDATA("../cppNGS-TEST/data_in/panel.bam") + " -out out/BedCoverage_test05_out.tsv -threads 4");
+		COMPARE_FILES("out/BedCoverage_test05_out.tsv", TESTDATA("data_out/BedCoverage_test04_out.tsv"));
+	}
 };
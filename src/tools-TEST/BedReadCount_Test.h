@@ -16,4 +16,10 @@ private slots:
 		EXECUTE("BedReadCount", "-in " + TESTDATA("../cppNGS-TEST/data_in/panel.bed") + " -bam " + TESTDATA("../cppNGS-TEST/data_in/panel.bam") + " -out out/BedReadCount_test02_out.tsv -min_mapq 0");
 		COMPARE_FILES("out/BedReadCount_test02_out.tsv", TESTDATA("data_out/BedReadCount_test02_out.tsv"));
 	}
+
+	void multithreaded()
+	{
+		EXECUTE("BedReadCount", "-in " + TESTDATA("../cppNGS-TEST/data_in/panel.bed") + " -bam " + TESTDATA("../cppNGS-TEST/data_in/panel.bam") + " -out out/BedReadCount_test03_out.tsv -threads 4");
+		COMPARE_FILES("out/BedReadCount_test03_out.tsv", TESTDATA("data_out/BedReadCount_test01_out.tsv"));
+	}
 };
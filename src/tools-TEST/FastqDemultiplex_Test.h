@@ -51,4 +51,11 @@ private slots:
 		EXECUTE("FastqDemultiplex", "-in1 " +TESTDATA("data_in/FastqDemultiplex_in3.fastq")+ " -in2 "+TESTDATA("data_in/FastqDemultiplex_in4.fastq")+ " -sheet " + TESTDATA("data_in/FastqDemultiplex_in2.tsv") + " -out out/FastqDemultiplex7 -rev2 -summary FastqDemultiplex_out7.txt");
 		COMPARE_FILES("out/FastqDemultiplex7/FastqDemultiplex_out7.txt", TESTDATA("data_out/FastqDemultiplex_out6.txt"));
 	}
+
+	//test multiple lanes with several threads (statistics must not depend on the thread count)
+	void test_multiple_lanes_threads()
+	{
+		EXECUTE("FastqDemultiplex", "-in1 " +TESTDATA("data_in/FastqDemultiplex_in1_1.fastq") + " " + TESTDATA("data_in/FastqDemultiplex_in2_1.fastq") + " -in2 "+TESTDATA("data_in/FastqDemultiplex_in1_2.fastq") + " " + TESTDATA("data_in/FastqDemultiplex_in2_2.fastq")+ " -sheet " + TESTDATA("data_in/FastqDemultiplex_in2.tsv") + " -out out/FastqDemultiplex8 -rev2 -summary FastqDemultiplex_out8.txt -threads 4");
+		COMPARE_FILES("out/FastqDemultiplex8/FastqDemultiplex_out8.txt", TESTDATA("data_out/FastqDemultiplex_out6.txt"));
+	}
 };
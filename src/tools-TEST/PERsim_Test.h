@@ -0,0 +1,15 @@
+#include "TestFramework.h"
+
+TEST_CLASS(PERsim_Test)
+{
+Q_OBJECT
+private slots:
+
+	void reproducible_multithreaded()
+	{
+		EXECUTE("PERsim", "-roi " + TESTDATA("data_in/PERsim_roi.bed") + " -count 500 -ref " + TESTDATA("../cppNGS-TEST/data_in/example.fa") + " -seed 42 -out1 out/PERsim_out1_R1.fastq.gz -out2 out/PERsim_out1_R2.fastq.gz");
+		EXECUTE("PERsim", "-roi " + TESTDATA("data_in/PERsim_roi.bed") + " -count 500 -ref " + TESTDATA("../cppNGS-TEST/data_in/example.fa") + " -seed 42 -threads 4 -out1 out/PERsim_out2_R1.fastq.gz -out2 out/PERsim_out2_R2.fastq.gz");
+		COMPARE_GZ_FILES("out/PERsim_out2_R1.fastq.gz", "out/PERsim_out1_R1.fastq.gz");
+		COMPARE_GZ_FILES("out/PERsim_out2_R2.fastq.gz", "out/PERsim_out1_R2.fastq.gz");
+	}
+};
@@ -42,5 +42,13 @@ private slots:
 		REMOVE_LINES("out/ReadQC_out5.qcML", QRegExp("<binary>"));
 		COMPARE_FILES("out/ReadQC_out5.qcML", TESTDATA("data_out/ReadQC_out5.qcML"));
 	}
+
+	void multiple_input_files_threads()
+	{
+		EXECUTE("ReadQC", "-in1 " + TESTDATA("data_in/ReadQC_in1.fastq.gz") + " " + TESTDATA("data_in/ReadQC_in3.fastq.gz") + " -in2 " + TESTDATA("data_in/ReadQC_in2.fastq.gz") + " " + TESTDATA("data_in/ReadQC_in4.fastq.gz") + " -out out/ReadQC_out6.qcML -threads 4");
+		REMOVE_LINES("out/ReadQC_out6.qcML", QRegExp("creation "));
+		REMOVE_LINES("out/ReadQC_out6.qcML", QRegExp("<binary>"));
+		COMPARE_FILES("out/ReadQC_out6.qcML", TESTDATA("data_out/ReadQC_out5.qcML"));
+	}
 };
 
@@ -15,5 +15,24 @@ private slots:
 		COMPARE_FILES("out/VcfLeftNormalize_out1.vcf", TESTDATA("data_out/VcfLeftNormalize_out1.vcf"));
 	}
 
+	void test_02_multithreaded()
+	{
+		QString ref_file = Settings::string("reference_genome");
+		if (ref_file=="") SKIP("Test needs the reference genome!");
+
+		EXECUTE("VcfLeftNormalize", "-in " + TESTDATA("data_in/VcfLeftNormalize_in1.vcf") + " -out out/VcfLeftNormalize_out2.vcf -ref " + ref_file + " -threads 4");
+		COMPARE_FILES("out/VcfLeftNormalize_out2.vcf", TESTDATA("data_out/VcfLeftNormalize_out1.vcf"));
+	}
+
+	void test_03_multithreaded_batches()
+	{
+		QString ref_file = Settings::string("reference_genome");
+		if (ref_file=="") SKIP("Test needs the reference genome!");
+
+		//small batches, so that several batches are processed in parallel and written in input order
+		EXECUTE("VcfLeftNormalize", "-in " + TESTDATA("data_in/VcfLeftNormalize_in1.vcf") + " -out out/VcfLeftNormalize_out3.vcf -ref " + ref_file + " -threads 4 -batch_size 3");
+		COMPARE_FILES("out/VcfLeftNormalize_out3.vcf", TESTDATA("data_out/VcfLeftNormalize_out1.vcf"));
+	}
+
 };
 
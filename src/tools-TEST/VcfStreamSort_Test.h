@@ -12,5 +12,11 @@ private slots:
 		COMPARE_FILES("out/VcfStreamSort_out1.vcf", TESTDATA("data_out/VcfStreamSort_out1.vcf"));
 	}
 
+	void test_02()
+	{
+		EXECUTE("VcfStreamSort", "-n 1 -in " + TESTDATA("data_in/VcfStreamSort_in2.vcf") + " -out out/VcfStreamSort_out2.vcf");
+		COMPARE_FILES("out/VcfStreamSort_out2.vcf", TESTDATA("data_out/VcfStreamSort_out2.vcf"));
+	}
+
 };
 
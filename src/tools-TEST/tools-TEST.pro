@@ -90,7 +90,9 @@ HEADERS += \
     NGSDInit_Test.h \
     SomaticQC_Test.h \
     NGSDImportGeneInfo_Test.h \	
-    VariantAnnotateStrand.h
+    VariantAnnotateStrand.h \
+    BamToCoverage_Test.h \
+    PERsim_Test.h
 
 SOURCES += \
     main.cpp \
@@ -289,6 +289,10 @@ SUBDIRS += VariantAnnotateStrand
 tools-TEST.depends += VariantAnnotateStrand
 VariantAnnotateStrand.depends = cppNGS
 
+SUBDIRS += BamToCoverage
+tools-TEST.depends += BamToCoverage
+BamToCoverage.depends = cppNGS
+
 #other stuff
 OTHER_FILES += ToDos.txt
 